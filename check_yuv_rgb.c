@@ -0,0 +1,3321 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// Differential test harness for the conversion kernels
+// Synthetic frames (random, gradient and edge case values) are generated for many widths, heights,
+// strides and alignments, and each kernel variant is run on them. Results are compared against a
+// double precision implementation of the conversion formulas, and against the other variants of
+// the same conversion.
+// For each conversion and color space, the max and mean error of each variant is reported, with the
+// location of the worst pixel, and the first location where a variant diverges from the reference
+// variant (the first one of the list, usually the std implementation).
+// The program fails if a kernel writes outside of its image, if the error is above the tolerance,
+// or if two variants that are expected to be bit exact (same exact group) give different results.
+
+// _POSIX_C_SOURCE is needed for fcntl
+#define _POSIX_C_SOURCE 200809L
+
+#include "yuv_rgb.h"
+#include "yuv_rgb_alloc.h"
+#include "yuv_rgb_batch.h"
+#include "yuv_rgb_lut3d.h"
+#include "yuv_rgb_pipeline.h"
+#include "yuv_rgb_plan.h"
+#include "yuv_rgb_private.h"
+#include "yuv_rgb_stats.h"
+#include "yuv_rgb_stream.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// number of guard bytes before and after each plane
+#define GUARD_SIZE 64
+// value used to fill guard bytes and stride padding
+#define GUARD_VALUE 0xA5
+
+typedef enum
+{
+	YUV420_RGB24,
+	NV12_RGB24,
+	NV21_RGB24,
+	RGB24_YUV420,
+	RGB32_YUV420
+} Conversion;
+
+static const char *const conversion_names[] = {
+	"yuv420_rgb24", "nv12_rgb24", "nv21_rgb24", "rgb24_yuv420", "rgb32_yuv420"
+};
+
+typedef struct
+{
+	const char *name;
+	Conversion conversion;
+	uint32_t block_width;   // number of pixels processed per iteration, last (width%block_width) pixels are not affected
+	int aligned;            // requires 16 byte aligned pointers and strides
+	int exact_group;        // kernels of the same conversion and exact group must give identical results
+	yuv2rgb_ptr yuv2rgb;
+	yuvsp2rgb_ptr yuvsp2rgb;
+	rgb2yuv_ptr rgb2yuv;
+} Kernel;
+
+// the first kernel of each conversion is used as the reference variant for divergence report
+static const Kernel kernels[] = {
+	{"std", YUV420_RGB24, 2, 0, 0, yuv420_rgb24_std, NULL, NULL},
+#ifdef _YUVRGB_SSE2_
+	{"sse", YUV420_RGB24, 2, 1, 0, yuv420_rgb24_sse, NULL, NULL},
+	{"sseu", YUV420_RGB24, 2, 0, 0, yuv420_rgb24_sseu, NULL, NULL},
+#endif
+#ifdef _YUVRGB_VEC_
+	{"vec", YUV420_RGB24, 2, 0, 0, yuv420_rgb24_vec, NULL, NULL},
+#endif
+#ifdef _YUVRGB_SSSE3_
+	{"ssse3", YUV420_RGB24, 2, 0, 0, yuv420_rgb24_ssse3, NULL, NULL},
+#endif
+	{"lut", YUV420_RGB24, 2, 0, 0, yuv420_rgb24_lut, NULL, NULL},
+	{"std", NV12_RGB24, 2, 0, 0, NULL, nv12_rgb24_std, NULL},
+#ifdef _YUVRGB_SSE2_
+	{"sse", NV12_RGB24, 2, 1, 0, NULL, nv12_rgb24_sse, NULL},
+	{"sseu", NV12_RGB24, 2, 0, 0, NULL, nv12_rgb24_sseu, NULL},
+#endif
+#ifdef _YUVRGB_VEC_
+	{"vec", NV12_RGB24, 2, 0, 0, NULL, nv12_rgb24_vec, NULL},
+#endif
+#ifdef _YUVRGB_SSSE3_
+	{"ssse3", NV12_RGB24, 2, 0, 0, NULL, nv12_rgb24_ssse3, NULL},
+#endif
+	{"lut", NV12_RGB24, 2, 0, 0, NULL, nv12_rgb24_lut, NULL},
+	{"std", NV21_RGB24, 2, 0, 0, NULL, nv21_rgb24_std, NULL},
+#ifdef _YUVRGB_SSE2_
+	{"sse", NV21_RGB24, 2, 1, 0, NULL, nv21_rgb24_sse, NULL},
+	{"sseu", NV21_RGB24, 2, 0, 0, NULL, nv21_rgb24_sseu, NULL},
+#endif
+#ifdef _YUVRGB_VEC_
+	{"vec", NV21_RGB24, 2, 0, 0, NULL, nv21_rgb24_vec, NULL},
+#endif
+#ifdef _YUVRGB_SSSE3_
+	{"ssse3", NV21_RGB24, 2, 0, 0, NULL, nv21_rgb24_ssse3, NULL},
+#endif
+	{"lut", NV21_RGB24, 2, 0, 0, NULL, nv21_rgb24_lut, NULL},
+	{"std", RGB24_YUV420, 2, 0, 0, NULL, NULL, rgb24_yuv420_std},
+#ifdef _YUVRGB_SSE2_
+	{"sse", RGB24_YUV420, 2, 1, 0, NULL, NULL, rgb24_yuv420_sse},
+	{"sseu", RGB24_YUV420, 2, 0, 0, NULL, NULL, rgb24_yuv420_sseu},
+#endif
+#ifdef _YUVRGB_VEC_
+	{"vec", RGB24_YUV420, 2, 0, 0, NULL, NULL, rgb24_yuv420_vec},
+#endif
+#ifdef _YUVRGB_SSSE3_
+	{"ssse3", RGB24_YUV420, 2, 0, 0, NULL, NULL, rgb24_yuv420_ssse3},
+#endif
+	{"std", RGB32_YUV420, 2, 0, 0, NULL, NULL, rgb32_yuv420_std},
+#ifdef _YUVRGB_SSE2_
+	{"sse", RGB32_YUV420, 2, 1, 0, NULL, NULL, rgb32_yuv420_sse},
+	{"sseu", RGB32_YUV420, 2, 0, 0, NULL, NULL, rgb32_yuv420_sseu},
+#endif
+#ifdef _YUVRGB_VEC_
+	{"vec", RGB32_YUV420, 2, 0, 0, NULL, NULL, rgb32_yuv420_vec},
+#endif
+};
+#define KERNEL_NUMBER (sizeof(kernels)/sizeof(kernels[0]))
+
+// kernels using an instruction set that the cpu may not have are skipped
+static int kernel_supported(const Kernel *kernel)
+{
+#ifdef _YUVRGB_SSSE3_
+	return strcmp(kernel->name, "ssse3")!=0 || __builtin_cpu_supports("ssse3");
+#else
+	(void)kernel;
+	return 1;
+#endif
+}
+// maximum number of kernels for a single conversion
+#define MAX_VARIANTS 16
+
+// parameters of the color spaces, in the same order as YCbCrType, see yuv_rgb.c for details
+typedef struct
+{
+	double rf, bf, y_min, y_max, cbcr_range;
+} ColorSpace;
+
+static const ColorSpace color_spaces[] = {
+	{0.299, 0.114, 0.0, 255.0, 255.0},
+	{0.299, 0.114, 16.0, 235.0, 224.0},
+	{0.2126, 0.0722, 16.0, 235.0, 224.0},
+	{0.2627, 0.0593, 16.0, 235.0, 224.0}
+};
+static const char *const color_space_names[] = {"jpeg", "bt601", "bt709", "bt2020"};
+#define COLOR_SPACE_NUMBER (sizeof(color_spaces)/sizeof(color_spaces[0]))
+
+typedef enum
+{
+	PATTERN_RANDOM,
+	PATTERN_GRADIENT,
+	PATTERN_EDGE
+} Pattern;
+
+static const char *const pattern_names[] = {"random", "gradient", "edge"};
+#define PATTERN_NUMBER 3
+
+static const uint32_t widths[] = {1, 2, 6, 16, 30, 31, 32, 33, 34, 48, 62, 64, 66, 95, 96, 130, 318, 320, 642};
+static const uint32_t heights[] = {1, 2, 3, 4, 7, 16, 33};
+
+// memory layout of the planes of an image, for a given kernel
+typedef enum
+{
+	LAYOUT_TIGHT,   // stride equal to the line size (rounded up to 16 bytes for aligned kernels)
+	LAYOUT_PADDED,  // stride larger than the line size, and pointers offset from 16 byte boundary for unaligned kernels
+	LAYOUT_NUMBER
+} Layout;
+
+static const char *const layout_names[] = {"tight", "padded"};
+
+// simple xorshift generator, to get reproducible frames
+static uint32_t rng_state = 2463534242u;
+
+static uint32_t rng_next(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+static uint8_t clamp_round(double value)
+{
+	if(value<0.0)
+		return 0;
+	if(value>255.0)
+		return 255;
+	return (uint8_t)(value+0.5);
+}
+
+// an image plane, surrounded by guard bytes
+typedef struct
+{
+	uint8_t *memory;
+	uint8_t *data;
+	uint32_t line_size;
+	uint32_t lines;
+	uint32_t stride;
+	size_t size;
+} Plane;
+
+static void plane_alloc(Plane *plane, uint32_t line_size, uint32_t lines, Layout layout, int aligned)
+{
+	uint32_t offset = 0;
+	plane->line_size = line_size;
+	plane->lines = lines;
+	plane->stride = line_size;
+	if(aligned)
+		plane->stride = (line_size+15)&~15u;
+	if(layout==LAYOUT_PADDED)
+	{
+		plane->stride += aligned ? 64 : 37;
+		offset = aligned ? 0 : 7;
+	}
+	plane->size = GUARD_SIZE + offset + (size_t)plane->stride*lines + GUARD_SIZE;
+	void *memory;
+	if(posix_memalign(&memory, 64, plane->size)!=0)
+	{
+		fprintf(stderr, "failed to allocate a plane of %zu bytes\n", plane->size);
+		exit(1);
+	}
+	plane->memory = memory;
+	memset(plane->memory, GUARD_VALUE, plane->size);
+	plane->data = plane->memory + GUARD_SIZE + offset;
+}
+
+static void plane_free(Plane *plane)
+{
+	free(plane->memory);
+	plane->memory = NULL;
+	plane->data = NULL;
+}
+
+// copy tightly packed data into the plane
+static void plane_write(Plane *plane, const uint8_t *src)
+{
+	for(uint32_t i=0; i<plane->lines; ++i)
+		memcpy(plane->data+(size_t)i*plane->stride, src+(size_t)i*plane->line_size, plane->line_size);
+}
+
+// copy plane content to tightly packed data
+static void plane_read(const Plane *plane, uint8_t *dst)
+{
+	for(uint32_t i=0; i<plane->lines; ++i)
+		memcpy(dst+(size_t)i*plane->line_size, plane->data+(size_t)i*plane->stride, plane->line_size);
+}
+
+// return the number of modified bytes outside of the image lines
+static size_t plane_check_guard(const Plane *plane)
+{
+	size_t errors = 0;
+	for(size_t i=0; i<plane->size; ++i)
+	{
+		const uint8_t *p = plane->memory+i;
+		if(p>=plane->data && p<plane->data+(size_t)plane->stride*plane->lines &&
+			((size_t)(p-plane->data))%plane->stride < plane->line_size)
+			continue;
+		if(*p!=GUARD_VALUE)
+			errors++;
+	}
+	return errors;
+}
+
+// tightly packed image, used to store source data, reference and results
+typedef struct
+{
+	uint32_t width, height;
+	uint8_t *plane[3];
+	uint32_t line_size[3];
+	uint32_t lines[3];
+	uint32_t plane_number;
+} Image;
+
+static void image_alloc(Image *image, int is_rgb, uint32_t bpp, int semi_planar, uint32_t width, uint32_t height)
+{
+	const uint32_t uv_width=(width+1)/2, uv_height=(height+1)/2;
+	image->width = width;
+	image->height = height;
+	if(is_rgb)
+	{
+		image->plane_number = 1;
+		image->line_size[0] = width*bpp;
+		image->lines[0] = height;
+	}
+	else if(semi_planar)
+	{
+		image->plane_number = 2;
+		image->line_size[0] = width;
+		image->lines[0] = height;
+		image->line_size[1] = uv_width*2;
+		image->lines[1] = uv_height;
+	}
+	else
+	{
+		image->plane_number = 3;
+		image->line_size[0] = width;
+		image->lines[0] = height;
+		image->line_size[1] = image->line_size[2] = uv_width;
+		image->lines[1] = image->lines[2] = uv_height;
+	}
+	for(uint32_t p=0; p<3; ++p)
+		image->plane[p] = p<image->plane_number ? malloc((size_t)image->line_size[p]*image->lines[p]) : NULL;
+}
+
+static void image_free(Image *image)
+{
+	for(uint32_t p=0; p<3; ++p)
+	{
+		free(image->plane[p]);
+		image->plane[p] = NULL;
+	}
+}
+
+static int is_yuv2rgb(Conversion conversion)
+{
+	return conversion==YUV420_RGB24 || conversion==NV12_RGB24 || conversion==NV21_RGB24;
+}
+
+static void source_alloc(Image *image, Conversion conversion, uint32_t width, uint32_t height)
+{
+	switch(conversion)
+	{
+		case YUV420_RGB24: image_alloc(image, 0, 1, 0, width, height); break;
+		case NV12_RGB24:
+		case NV21_RGB24: image_alloc(image, 0, 1, 1, width, height); break;
+		case RGB24_YUV420: image_alloc(image, 1, 3, 0, width, height); break;
+		case RGB32_YUV420: image_alloc(image, 1, 4, 0, width, height); break;
+	}
+}
+
+static void destination_alloc(Image *image, Conversion conversion, uint32_t width, uint32_t height)
+{
+	if(is_yuv2rgb(conversion))
+		image_alloc(image, 1, 3, 0, width, height);
+	else
+		image_alloc(image, 0, 1, 0, width, height);
+}
+
+// extreme values, used for edge case frames
+static const uint8_t edge_yuv_values[] = {0, 1, 15, 16, 17, 127, 128, 129, 235, 236, 240, 241, 254, 255};
+static const uint8_t edge_rgb_values[] = {0, 1, 128, 254, 255};
+
+static void generate_pattern(Image *image, Pattern pattern, int is_rgb)
+{
+	for(uint32_t p=0; p<image->plane_number; ++p)
+	{
+		const uint32_t line_size=image->line_size[p], lines=image->lines[p];
+		for(uint32_t y=0; y<lines; ++y)
+		{
+			for(uint32_t x=0; x<line_size; ++x)
+			{
+				uint8_t value=0;
+				switch(pattern)
+				{
+					case PATTERN_RANDOM:
+						value = rng_next()>>24;
+						break;
+					case PATTERN_GRADIENT:
+						// different gradient direction for each channel of interleaved data and for each plane
+						switch((p + (is_rgb ? x%(line_size/image->width) : x%2*(p>0 && image->plane_number==2)))%3)
+						{
+							case 0: value = line_size>1 ? (x*255)/(line_size-1) : 0; break;
+							case 1: value = lines>1 ? (y*255)/(lines-1) : 0; break;
+							default: value = (line_size+lines)>2 ? ((x+y)*255)/(line_size+lines-2) : 0; break;
+						}
+						break;
+					case PATTERN_EDGE:
+						if(is_rgb)
+							value = edge_rgb_values[rng_next()%sizeof(edge_rgb_values)];
+						else
+							value = edge_yuv_values[rng_next()%sizeof(edge_yuv_values)];
+						break;
+				}
+				image->plane[p][y*line_size+x] = value;
+			}
+		}
+	}
+}
+
+// compute expected result in double precision
+static void reference_convert(Conversion conversion, const Image *src, Image *dst, YCbCrType yuv_type)
+{
+	const ColorSpace *cs = &color_spaces[yuv_type];
+	const double gf = 1.0-cs->rf-cs->bf;
+	const uint32_t width=src->width, height=src->height;
+	if(is_yuv2rgb(conversion))
+	{
+		for(uint32_t y=0; y<height; ++y)
+		{
+			for(uint32_t x=0; x<width; ++x)
+			{
+				double cb, cr;
+				const uint8_t *uv_line = src->plane[1]+(y/2)*src->line_size[1];
+				if(conversion==YUV420_RGB24)
+				{
+					cb = uv_line[x/2];
+					cr = src->plane[2][(y/2)*src->line_size[2]+x/2];
+				}
+				else if(conversion==NV12_RGB24)
+				{
+					cb = uv_line[(x/2)*2];
+					cr = uv_line[(x/2)*2+1];
+				}
+				else
+				{
+					cr = uv_line[(x/2)*2];
+					cb = uv_line[(x/2)*2+1];
+				}
+				const double ey = (src->plane[0][y*src->line_size[0]+x]-cs->y_min)/(cs->y_max-cs->y_min);
+				const double ecb = (cb-128.0)/cs->cbcr_range, ecr = (cr-128.0)/cs->cbcr_range;
+				const double r = ey + 2.0*(1.0-cs->rf)*ecr;
+				const double b = ey + 2.0*(1.0-cs->bf)*ecb;
+				const double g = (ey - cs->rf*r - cs->bf*b)/gf;
+				uint8_t *rgb = dst->plane[0]+y*dst->line_size[0]+x*3;
+				rgb[0] = clamp_round(255.0*r);
+				rgb[1] = clamp_round(255.0*g);
+				rgb[2] = clamp_round(255.0*b);
+			}
+		}
+	}
+	else
+	{
+		const uint32_t bpp = src->line_size[0]/width;
+		for(uint32_t y=0; y<height; y+=2)
+		{
+			for(uint32_t x=0; x<width; x+=2)
+			{
+				double cb=0.0, cr=0.0;
+				uint32_t n=0;
+				for(uint32_t dy=0; dy<2 && y+dy<height; ++dy)
+				{
+					for(uint32_t dx=0; dx<2 && x+dx<width; ++dx)
+					{
+						const uint8_t *rgb = src->plane[0]+(y+dy)*src->line_size[0]+(x+dx)*bpp;
+						const double r=rgb[0]/255.0, g=rgb[1]/255.0, b=rgb[2]/255.0;
+						const double ey = cs->rf*r + gf*g + cs->bf*b;
+						dst->plane[0][(y+dy)*dst->line_size[0]+x+dx] = clamp_round((cs->y_max-cs->y_min)*ey + cs->y_min);
+						cb += (b-ey)/(2.0*(1.0-cs->bf));
+						cr += (r-ey)/(2.0*(1.0-cs->rf));
+						n++;
+					}
+				}
+				dst->plane[1][(y/2)*dst->line_size[1]+x/2] = clamp_round(cs->cbcr_range*cb/n + 128.0);
+				dst->plane[2][(y/2)*dst->line_size[2]+x/2] = clamp_round(cs->cbcr_range*cr/n + 128.0);
+			}
+		}
+	}
+}
+
+static void run_variant(const Kernel *kernel, uint32_t width, uint32_t height, Plane *src, Plane *dst, YCbCrType yuv_type)
+{
+	switch(kernel->conversion)
+	{
+		case YUV420_RGB24:
+			kernel->yuv2rgb(width, height, src[0].data, src[1].data, src[2].data, src[0].stride, src[1].stride,
+				dst[0].data, dst[0].stride, yuv_type);
+			break;
+		case NV12_RGB24:
+		case NV21_RGB24:
+			kernel->yuvsp2rgb(width, height, src[0].data, src[1].data, src[0].stride, src[1].stride,
+				dst[0].data, dst[0].stride, yuv_type);
+			break;
+		case RGB24_YUV420:
+		case RGB32_YUV420:
+			kernel->rgb2yuv(width, height, src[0].data, src[0].stride,
+				dst[0].data, dst[1].data, dst[2].data, dst[0].stride, dst[1].stride, yuv_type);
+			break;
+	}
+}
+
+// location of a pixel in the test set
+typedef struct
+{
+	uint32_t width, height;
+	Pattern pattern;
+	Layout layout;
+	uint32_t plane, x, y, channel;
+	int value, expected;
+} Location;
+
+static void print_location(const Location *loc, int is_rgb)
+{
+	static const char *const yuv_planes[] = {"Y", "U", "V"};
+	static const char *const rgb_channels[] = {"R", "G", "B"};
+	printf("%ux%u %s %s, ", loc->width, loc->height, pattern_names[loc->pattern], layout_names[loc->layout]);
+	if(is_rgb)
+		printf("%s at (%u,%u)", rgb_channels[loc->channel], loc->x, loc->y);
+	else
+		printf("%s at (%u,%u)", yuv_planes[loc->plane], loc->x, loc->y);
+	printf(": %d instead of %d", loc->value, loc->expected);
+}
+
+// accumulated statistics of a kernel for one color space
+typedef struct
+{
+	uint64_t count;
+	uint64_t error_sum;
+	int max_error;
+	Location max_location;
+	uint64_t tested, skipped;
+	uint64_t guard_errors;
+	uint64_t diverging;          // number of values different from the reference variant
+	int max_divergence;
+	int has_divergence;
+	Location first_divergence;
+	int has_exact_failure;       // differs from another kernel of the same exact group
+	uint32_t exact_reference;
+	Location first_exact_failure;
+} KernelStats;
+
+// compare result to expected values, on the area affected by the kernel
+// if divergence is set, expected values come from another kernel, and divergence fields are updated
+static void compare(const Kernel *kernel, const Image *result, const Image *expected,
+	uint32_t width, uint32_t height, Pattern pattern, Layout layout, KernelStats *stats, int divergence)
+{
+	const int to_rgb = is_yuv2rgb(kernel->conversion);
+	const uint32_t covered_width = (width/kernel->block_width)*kernel->block_width;
+	const uint32_t covered_height = height&~1u;
+	for(uint32_t p=0; p<result->plane_number; ++p)
+	{
+		const uint32_t bpp = to_rgb ? 3 : 1;
+		const uint32_t sub = (!to_rgb && p>0) ? 2 : 1;
+		for(uint32_t y=0; y<covered_height/sub; ++y)
+		{
+			for(uint32_t x=0; x<covered_width/sub; ++x)
+			{
+				for(uint32_t c=0; c<bpp; ++c)
+				{
+					const int value = result->plane[p][y*result->line_size[p]+x*bpp+c];
+					const int ref = expected->plane[p][y*expected->line_size[p]+x*bpp+c];
+					const int error = value>ref ? value-ref : ref-value;
+					Location loc = {width, height, pattern, layout, p, x, y, c, value, ref};
+					if(divergence)
+					{
+						if(error!=0)
+						{
+							if(!stats->has_divergence)
+							{
+								stats->has_divergence = 1;
+								stats->first_divergence = loc;
+							}
+							stats->diverging++;
+							if(error>stats->max_divergence)
+								stats->max_divergence = error;
+						}
+					}
+					else
+					{
+						stats->count++;
+						stats->error_sum += error;
+						if(error>stats->max_error || stats->count==1)
+						{
+							stats->max_error = error;
+							stats->max_location = loc;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+// convert a whole image with the std kernel of a conversion
+static void std_convert(Conversion conversion, const Image *src, Image *dst, YCbCrType yuv_type)
+{
+	const uint32_t width=src->width, height=src->height;
+	const uint8_t *const *s = (const uint8_t *const *)src->plane;
+	uint8_t *const *d = dst->plane;
+	switch(conversion)
+	{
+		case YUV420_RGB24: yuv420_rgb24_std(width, height, s[0], s[1], s[2], src->line_size[0], src->line_size[1], d[0], dst->line_size[0], yuv_type); break;
+		case NV12_RGB24: nv12_rgb24_std(width, height, s[0], s[1], src->line_size[0], src->line_size[1], d[0], dst->line_size[0], yuv_type); break;
+		case NV21_RGB24: nv21_rgb24_std(width, height, s[0], s[1], src->line_size[0], src->line_size[1], d[0], dst->line_size[0], yuv_type); break;
+		case RGB24_YUV420: rgb24_yuv420_std(width, height, s[0], src->line_size[0], d[0], d[1], d[2], dst->line_size[0], dst->line_size[1], yuv_type); break;
+		case RGB32_YUV420: rgb32_yuv420_std(width, height, s[0], src->line_size[0], d[0], d[1], d[2], dst->line_size[0], dst->line_size[1], yuv_type); break;
+	}
+}
+
+// describe the conversion of src to dst images as a BatchFrame
+static void batch_frame_init(BatchFrame *frame, Conversion conversion, const Image *src, Image *dst, YCbCrType yuv_type)
+{
+	static const PixelFormat src_formats[] = {PIXEL_FORMAT_YUV420, PIXEL_FORMAT_NV12, PIXEL_FORMAT_NV21, PIXEL_FORMAT_RGB24, PIXEL_FORMAT_RGB32};
+	static const PixelFormat dst_formats[] = {PIXEL_FORMAT_RGB24, PIXEL_FORMAT_RGB24, PIXEL_FORMAT_RGB24, PIXEL_FORMAT_YUV420, PIXEL_FORMAT_YUV420};
+	memset(frame, 0, sizeof(BatchFrame));
+	frame->width = src->width;
+	frame->height = src->height;
+	frame->src_format = src_formats[conversion];
+	frame->dst_format = dst_formats[conversion];
+	frame->yuv_type = yuv_type;
+	for(uint32_t p=0; p<src->plane_number; ++p)
+	{
+		frame->src[p] = src->plane[p];
+		frame->src_stride[p] = src->line_size[p];
+	}
+	for(uint32_t p=0; p<dst->plane_number; ++p)
+	{
+		frame->dst[p] = dst->plane[p];
+		frame->dst_stride[p] = dst->line_size[p];
+	}
+}
+
+// compare two images, return 1 if they are identical
+static int image_equal(const Image *a, const Image *b)
+{
+	for(uint32_t p=0; p<a->plane_number; ++p)
+		if(memcmp(a->plane[p], b->plane[p], (size_t)a->line_size[p]*a->lines[p])!=0)
+			return 0;
+	return 1;
+}
+
+// check plane layout of allocated frames, and recycling of frames by a pool
+// return the number of failures
+static int check_alloc(void)
+{
+	static const PixelFormat formats[] = {PIXEL_FORMAT_YUV420, PIXEL_FORMAT_NV12, PIXEL_FORMAT_NV21, PIXEL_FORMAT_RGB24, PIXEL_FORMAT_RGB32};
+	static const uint32_t sizes[][2] = {{1, 1}, {31, 7}, {320, 240}, {3840, 2160}};
+	int failures = 0;
+
+	for(uint32_t f=0; f<sizeof(formats)/sizeof(formats[0]); ++f)
+	for(uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+	for(uint32_t flags=0; flags<=FRAME_BUFFER_GUARD; flags+=FRAME_BUFFER_GUARD)
+	{
+		const uint32_t width=sizes[s][0], height=sizes[s][1];
+		const int is_rgb = formats[f]==PIXEL_FORMAT_RGB24 || formats[f]==PIXEL_FORMAT_RGB32;
+		FrameBuffer frame;
+		if(frame_buffer_alloc(&frame, formats[f], width, height, flags)!=0)
+		{
+			printf("alloc: FAILED to allocate %ux%u frame\n", width, height);
+			failures++;
+			continue;
+		}
+		const uint32_t bpp = formats[f]==PIXEL_FORMAT_RGB24 ? 3 : formats[f]==PIXEL_FORMAT_RGB32 ? 4 : 1;
+		const uint32_t expected_planes = is_rgb ? 1 : formats[f]==PIXEL_FORMAT_YUV420 ? 3 : 2;
+		int error = frame.plane_number!=expected_planes;
+		const uint8_t *end = (const uint8_t *)frame.memory;
+		for(uint32_t p=0; p<frame.plane_number && !error; ++p)
+		{
+			const uint32_t line_size = p==0 ? width*bpp : formats[f]==PIXEL_FORMAT_YUV420 ? (width+1)/2 : ((width+1)/2)*2;
+			const uint32_t lines = p==0 ? height : (height+1)/2;
+			const size_t plane_size = (size_t)frame.stride[p]*lines;
+			error = ((uintptr_t)frame.plane[p]%FRAME_BUFFER_ALIGNMENT)!=0 || frame.stride[p]%FRAME_BUFFER_ALIGNMENT!=0 ||
+				frame.stride[p]<line_size || frame.plane[p]<end;
+			end = frame.plane[p]+plane_size;
+			if(flags&FRAME_BUFFER_GUARD)
+			{
+				for(uint32_t i=0; i<FRAME_BUFFER_ALIGNMENT; ++i)
+					error |= frame.plane[p][plane_size+i]!=0;
+				end += FRAME_BUFFER_ALIGNMENT;
+			}
+			// all the plane must be writable
+			memset(frame.plane[p], 0x5A, plane_size);
+		}
+		error |= end>(const uint8_t *)frame.memory+frame.size;
+		if(frame.size>=2*1024*1024)
+			error |= ((uintptr_t)frame.memory%(2*1024*1024))!=0;
+		if(error)
+		{
+			printf("alloc: FAILED, wrong layout of %ux%u frame, format %u\n", width, height, formats[f]);
+			failures++;
+		}
+		frame_buffer_free(&frame);
+	}
+
+	// pool keeps at most 2 free frames
+	FramePool *pool = frame_pool_create(PIXEL_FORMAT_NV12, 64, 48, 0, 2);
+	FrameBuffer *frames[3];
+	for(uint32_t i=0; i<3; ++i)
+		frames[i] = frame_pool_get(pool);
+	if(!frames[0] || !frames[1] || !frames[2] || frames[0]==frames[1] || frames[1]==frames[2] ||
+		frames[0]->format!=PIXEL_FORMAT_NV12 || frames[0]->width!=64 || frames[0]->height!=48)
+	{
+		printf("alloc: FAILED, wrong frames from pool\n");
+		failures++;
+	}
+	frame_pool_put(pool, frames[0]);
+	frame_pool_put(pool, frames[1]);
+	frame_pool_put(pool, frames[2]);
+	FrameBuffer *recycled[2] = {frame_pool_get(pool), frame_pool_get(pool)};
+	if(recycled[0]!=frames[0] || recycled[1]!=frames[1])
+	{
+		printf("alloc: FAILED, frames not recycled\n");
+		failures++;
+	}
+	frame_pool_put(pool, recycled[0]);
+	frame_pool_put(pool, recycled[1]);
+	frame_pool_destroy(pool);
+	if(frame_pool_create(PIXEL_FORMAT_RGB24, 64, 48, 0, 0)!=NULL)
+	{
+		printf("alloc: FAILED, pool without capacity created\n");
+		failures++;
+	}
+
+	if(!failures)
+		printf("alloc: frames allocated correctly\n");
+	return failures;
+}
+
+// convert a batch of frames of mixed sizes and formats with a thread pool, and compare
+// the results with direct calls to the std kernels
+// return the number of failures
+static int check_batch(uint32_t thread_number)
+{
+	static const uint32_t sizes[][2] = {{320, 240}, {64, 48}, {2, 2}, {1920, 1080}, {33, 17}, {160, 120}, {640, 480}, {31, 7}};
+	static const Conversion conversions[] = {YUV420_RGB24, NV12_RGB24, NV21_RGB24, RGB24_YUV420, RGB32_YUV420};
+	#define BATCH_SIZE 40
+	Image src[BATCH_SIZE], expected[BATCH_SIZE], result[BATCH_SIZE];
+	BatchFrame frames[BATCH_SIZE];
+	int failures = 0;
+
+	for(uint32_t f=0; f<BATCH_SIZE; ++f)
+	{
+		const uint32_t width=sizes[f%8][0], height=sizes[f%8][1];
+		const uint32_t c = (f/3)%5;
+		const Conversion conversion = conversions[c];
+		const YCbCrType yuv_type = (YCbCrType)(f%COLOR_SPACE_NUMBER);
+		source_alloc(&src[f], conversion, width, height);
+		generate_pattern(&src[f], PATTERN_RANDOM, !is_yuv2rgb(conversion));
+		destination_alloc(&expected[f], conversion, width, height);
+		destination_alloc(&result[f], conversion, width, height);
+
+		for(uint32_t p=0; p<expected[f].plane_number; ++p)
+		{
+			memset(expected[f].plane[p], 0, (size_t)expected[f].line_size[p]*expected[f].lines[p]);
+			memset(result[f].plane[p], 0, (size_t)result[f].line_size[p]*result[f].lines[p]);
+		}
+		std_convert(conversion, &src[f], &expected[f], yuv_type);
+		batch_frame_init(&frames[f], conversion, &src[f], &result[f], yuv_type);
+	}
+
+	ThreadPool *pool = thread_number ? thread_pool_create(thread_number) : NULL;
+	if(thread_number && !pool)
+	{
+		printf("batch: FAILED to create thread pool\n");
+		failures++;
+	}
+	// run several times to check that the pool can be reused
+	for(uint32_t run=0; run<3 && !failures; ++run)
+	{
+		if(batch_convert(pool, frames, BATCH_SIZE)!=0)
+		{
+			printf("batch: FAILED, conversion not supported\n");
+			failures++;
+		}
+	}
+	for(uint32_t f=0; f<BATCH_SIZE; ++f)
+	{
+		if(!image_equal(&result[f], &expected[f]))
+		{
+			printf("batch: FAILED, frame %u (%ux%u %s) differs from std kernel\n", f, result[f].width, result[f].height,
+				conversion_names[conversions[(f/3)%5]]);
+			failures++;
+		}
+	}
+
+	// unsupported conversion
+	BatchFrame invalid = frames[0];
+	invalid.src_format = PIXEL_FORMAT_RGB24;
+	invalid.dst_format = PIXEL_FORMAT_NV12;
+	if(batch_convert(pool, &invalid, 1)!=-1)
+	{
+		printf("batch: FAILED, unsupported conversion accepted\n");
+		failures++;
+	}
+
+	thread_pool_destroy(pool);
+	for(uint32_t f=0; f<BATCH_SIZE; ++f)
+	{
+		image_free(&src[f]);
+		image_free(&expected[f]);
+		image_free(&result[f]);
+	}
+	if(!failures)
+		printf("batch (%u threads): %u frames converted correctly\n", thread_number, BATCH_SIZE);
+	return failures;
+	#undef BATCH_SIZE
+}
+
+// describe an image as a yuv or rgb frame descriptor
+static void yuv_frame_init(YUVFrame *frame, PixelFormat format, uint8_t *const plane[3], const uint32_t stride[3],
+	uint32_t width, uint32_t height, YCbCrType yuv_type)
+{
+	frame->width = width;
+	frame->height = height;
+	frame->format = format;
+	frame->y = plane[0];
+	frame->u = plane[1];
+	frame->v = format==PIXEL_FORMAT_YUV420 ? plane[2] : NULL;
+	frame->y_stride = stride[0];
+	frame->uv_stride = stride[1];
+	frame->yuv_type = yuv_type;
+}
+
+static void rgb_frame_init(RGBFrame *frame, PixelFormat format, uint8_t *pixels, uint32_t stride, uint32_t width, uint32_t height)
+{
+	frame->width = width;
+	frame->height = height;
+	frame->format = format;
+	frame->pixels = pixels;
+	frame->stride = stride;
+}
+
+// copy an image to a frame buffer with another stride, or back
+static void frame_buffer_copy(FrameBuffer *frame, Image *image, int to_frame)
+{
+	for(uint32_t p=0; p<image->plane_number; ++p)
+		for(uint32_t l=0; l<image->lines[p]; ++l)
+		{
+			uint8_t *line = frame->plane[p]+(size_t)l*frame->stride[p], *image_line = image->plane[p]+(size_t)l*image->line_size[p];
+			if(to_frame)
+				memcpy(line, image_line, image->line_size[p]);
+			else
+				memcpy(image_line, line, image->line_size[p]);
+		}
+}
+
+// execute plans with different options on aligned and unaligned frames, and compare with the std kernels
+// return the number of failures
+static int check_plan(void)
+{
+	static const Conversion conversions[] = {YUV420_RGB24, NV12_RGB24, NV21_RGB24, RGB24_YUV420, RGB32_YUV420};
+	static const PixelFormat src_formats[] = {PIXEL_FORMAT_YUV420, PIXEL_FORMAT_NV12, PIXEL_FORMAT_NV21, PIXEL_FORMAT_RGB24, PIXEL_FORMAT_RGB32};
+	static const PixelFormat dst_formats[] = {PIXEL_FORMAT_RGB24, PIXEL_FORMAT_RGB24, PIXEL_FORMAT_RGB24, PIXEL_FORMAT_YUV420, PIXEL_FORMAT_YUV420};
+	static const uint32_t sizes[][2] = {{130, 33}, {640, 480}, {31, 7}};
+	static const uint32_t thread_numbers[] = {1, 3};
+	static const uint32_t band_lines[] = {0, 2, 7};
+	int failures = 0;
+	uint32_t plan_number = 0;
+
+	for(uint32_t c=0; c<sizeof(conversions)/sizeof(conversions[0]); ++c)
+	for(uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+	{
+		const Conversion conversion = conversions[c];
+		const int to_rgb = is_yuv2rgb(conversion);
+		const uint32_t width=sizes[s][0], height=sizes[s][1];
+		const YCbCrType yuv_type = (YCbCrType)((c+s)%COLOR_SPACE_NUMBER);
+		Image src, expected, result;
+		source_alloc(&src, conversion, width, height);
+		generate_pattern(&src, PATTERN_RANDOM, !to_rgb);
+		destination_alloc(&expected, conversion, width, height);
+		destination_alloc(&result, conversion, width, height);
+		for(uint32_t p=0; p<expected.plane_number; ++p)
+			memset(expected.plane[p], 0, (size_t)expected.line_size[p]*expected.lines[p]);
+		std_convert(conversion, &src, &expected, yuv_type);
+		FrameBuffer aligned_src, aligned_dst;
+		frame_buffer_alloc(&aligned_src, src_formats[c], width, height, 0);
+		frame_buffer_alloc(&aligned_dst, dst_formats[c], width, height, 0);
+		frame_buffer_copy(&aligned_src, &src, 1);
+
+		// descriptors of tight (unaligned) and aligned frames
+		YUVFrame yuv[2];
+		RGBFrame rgb[2];
+		Image *const yuv_image = to_rgb ? &src : &result, *const rgb_image = to_rgb ? &result : &src;
+		FrameBuffer *const yuv_buffer = to_rgb ? &aligned_src : &aligned_dst, *const rgb_buffer = to_rgb ? &aligned_dst : &aligned_src;
+		yuv_frame_init(&yuv[0], yuv_buffer->format, yuv_image->plane, yuv_image->line_size, width, height, yuv_type);
+		yuv_frame_init(&yuv[1], yuv_buffer->format, yuv_buffer->plane, yuv_buffer->stride, width, height, yuv_type);
+		rgb_frame_init(&rgb[0], rgb_buffer->format, rgb_image->plane[0], rgb_image->line_size[0], width, height);
+		rgb_frame_init(&rgb[1], rgb_buffer->format, rgb_buffer->plane[0], rgb_buffer->stride[0], width, height);
+
+		for(uint32_t t=0; t<sizeof(thread_numbers)/sizeof(thread_numbers[0]); ++t)
+		for(uint32_t b=0; b<sizeof(band_lines)/sizeof(band_lines[0]); ++b)
+		for(uint32_t plan_alignment=0; plan_alignment<2; ++plan_alignment)
+		{
+			PlanOptions options;
+			plan_options_init(&options);
+			options.thread_number = thread_numbers[t];
+			options.band_lines = band_lines[b];
+			Plan *plan = to_rgb ? plan_create_yuv_rgb(&yuv[plan_alignment], &rgb[plan_alignment], &options) :
+				plan_create_rgb_yuv(&rgb[plan_alignment], &yuv[plan_alignment], &options);
+			if(!plan)
+			{
+				printf("plan: FAILED to create %s plan\n", conversion_names[conversion]);
+				failures++;
+				continue;
+			}
+			// execute on frames with the same and the other alignment
+			for(uint32_t alignment=0; alignment<2; ++alignment)
+			{
+				for(uint32_t p=0; p<result.plane_number; ++p)
+					memset(result.plane[p], 0, (size_t)result.line_size[p]*result.lines[p]);
+				for(uint32_t p=0; p<aligned_dst.plane_number; ++p)
+					memset(aligned_dst.plane[p], 0, aligned_dst.stride[p]*(p ? (height+1)/2 : height));
+				const int error = to_rgb ? plan_execute_yuv_rgb(plan, &yuv[alignment], &rgb[alignment]) :
+					plan_execute_rgb_yuv(plan, &rgb[alignment], &yuv[alignment]);
+				if(alignment)
+					frame_buffer_copy(&aligned_dst, &result, 0);
+				if(error || !image_equal(&result, &expected))
+				{
+					printf("plan: FAILED, %ux%u %s, %u threads, bands of %u lines, %s plan on %s frame\n", width, height,
+						conversion_names[conversion], thread_numbers[t], band_lines[b],
+						plan_alignment ? "aligned" : "unaligned", alignment ? "aligned" : "unaligned");
+					failures++;
+				}
+			}
+			// frames that do not match the plan
+			YUVFrame other_yuv = yuv[0];
+			other_yuv.yuv_type = (YCbCrType)((yuv_type+1)%COLOR_SPACE_NUMBER);
+			if((to_rgb ? plan_execute_yuv_rgb(plan, &other_yuv, &rgb[0]) : plan_execute_rgb_yuv(plan, &rgb[0], &other_yuv))!=-1 ||
+				(to_rgb ? plan_execute_rgb_yuv(plan, &rgb[0], &yuv[0]) : plan_execute_yuv_rgb(plan, &yuv[0], &rgb[0]))!=-1)
+			{
+				printf("plan: FAILED, frame that does not match the plan accepted\n");
+				failures++;
+			}
+			plan_destroy(plan);
+			plan_number++;
+		}
+		frame_buffer_free(&aligned_src);
+		frame_buffer_free(&aligned_dst);
+		image_free(&src);
+		image_free(&expected);
+		image_free(&result);
+	}
+
+	// unsupported conversion
+	uint8_t pixels[64], *planes[3] = {pixels, pixels, pixels};
+	const uint32_t strides[3] = {8, 4, 4};
+	YUVFrame yuv;
+	RGBFrame rgb;
+	yuv_frame_init(&yuv, PIXEL_FORMAT_YUV420, planes, strides, 2, 2, YCBCR_601);
+	rgb_frame_init(&rgb, PIXEL_FORMAT_RGB32, pixels, 8, 2, 2);
+	if(plan_create_yuv_rgb(&yuv, &rgb, NULL)!=NULL)
+	{
+		printf("plan: FAILED, unsupported conversion accepted\n");
+		failures++;
+	}
+	if(!failures)
+		printf("plan: %u plans executed correctly\n", plan_number);
+	return failures;
+}
+
+// tune plans, save and reload the wisdom, and check that plans created from the wisdom do not tune again
+// return the number of failures
+static int check_wisdom(void)
+{
+	static const char *const filename = "check_yuv_rgb_wisdom.txt";
+	const uint32_t width=320, height=240;
+	int failures = 0;
+
+	Image src, expected, result;
+	source_alloc(&src, YUV420_RGB24, width, height);
+	generate_pattern(&src, PATTERN_RANDOM, 0);
+	destination_alloc(&expected, YUV420_RGB24, width, height);
+	destination_alloc(&result, YUV420_RGB24, width, height);
+	std_convert(YUV420_RGB24, &src, &expected, YCBCR_709);
+	FrameBuffer aligned_src, aligned_dst;
+	frame_buffer_alloc(&aligned_src, PIXEL_FORMAT_YUV420, width, height, 0);
+	frame_buffer_alloc(&aligned_dst, PIXEL_FORMAT_RGB24, width, height, 0);
+	frame_buffer_copy(&aligned_src, &src, 1);
+	YUVFrame yuv[2];
+	RGBFrame rgb[2];
+	yuv_frame_init(&yuv[0], PIXEL_FORMAT_YUV420, src.plane, src.line_size, width, height, YCBCR_709);
+	yuv_frame_init(&yuv[1], PIXEL_FORMAT_YUV420, aligned_src.plane, aligned_src.stride, width, height, YCBCR_709);
+	rgb_frame_init(&rgb[0], PIXEL_FORMAT_RGB24, result.plane[0], result.line_size[0], width, height);
+	rgb_frame_init(&rgb[1], PIXEL_FORMAT_RGB24, aligned_dst.plane[0], aligned_dst.stride[0], width, height);
+
+	PlanOptions options;
+	plan_options_init(&options);
+	options.flags = PLAN_AUTOTUNE;
+	options.thread_number = 2;
+	plan_forget_wisdom();
+	for(int step=0; step<2; ++step)
+	{
+		// first step tunes, second step uses the wisdom loaded from the file
+		for(uint32_t alignment=0; alignment<2; ++alignment)
+		{
+			memset(rgb[alignment].pixels, 0x42, (size_t)rgb[alignment].stride*height);
+			Plan *plan = plan_create_yuv_rgb(&yuv[alignment], &rgb[alignment], &options);
+			if(!plan)
+			{
+				printf("wisdom: FAILED to create plan\n");
+				failures++;
+				continue;
+			}
+			if(step==1 && rgb[alignment].pixels[0]!=0x42)
+			{
+				printf("wisdom: FAILED, plan tuned again\n");
+				failures++;
+			}
+			if(plan_execute_yuv_rgb(plan, &yuv[alignment], &rgb[alignment])!=0)
+				failures++;
+			if(alignment)
+				frame_buffer_copy(&aligned_dst, &result, 0);
+			if(!image_equal(&result, &expected))
+			{
+				printf("wisdom: FAILED, %s tuned plan differs from std kernel\n", alignment ? "aligned" : "unaligned");
+				failures++;
+			}
+			plan_destroy(plan);
+		}
+		if(step==0)
+		{
+			if(plan_export_wisdom(filename)!=0)
+			{
+				printf("wisdom: FAILED to export\n");
+				failures++;
+			}
+			plan_forget_wisdom();
+			if(plan_import_wisdom(filename)!=0)
+			{
+				printf("wisdom: FAILED to import\n");
+				failures++;
+			}
+		}
+	}
+
+	// invalid files are rejected
+	FILE *fp = fopen(filename, "w");
+	fprintf(fp, "yuv_rgb wisdom 1\nyuv420 rgb24 320 240 aligned avx9 64 1\n");
+	fclose(fp);
+	if(plan_import_wisdom(filename)!=-1 || plan_import_wisdom("no_such_wisdom_file.txt")!=-1)
+	{
+		printf("wisdom: FAILED, invalid wisdom accepted\n");
+		failures++;
+	}
+	remove(filename);
+	plan_forget_wisdom();
+
+	frame_buffer_free(&aligned_src);
+	frame_buffer_free(&aligned_dst);
+	image_free(&src);
+	image_free(&expected);
+	image_free(&result);
+	if(!failures)
+		printf("wisdom: tuned plans saved and reloaded correctly\n");
+	return failures;
+}
+
+// convert frames with plans and check the counters of the kernels, if stats are available
+// return the number of failures
+// number of open file descriptors, among the first 1024
+static uint32_t count_open_fds(void)
+{
+	uint32_t count = 0;
+	for(int fd=0; fd<1024; ++fd)
+		count += fcntl(fd, F_GETFD)!=-1;
+	return count;
+}
+
+static int check_stats(void)
+{
+	const uint32_t width=320, height=240, runs=5, plans=8;
+	int failures = 0;
+	StatsEntry entries[64];
+	if(!stats_available())
+	{
+		if(stats_snapshot(entries, 64)!=0)
+		{
+			printf("stats: FAILED, counters without stats\n");
+			return 1;
+		}
+		printf("stats: not available\n");
+		return 0;
+	}
+
+	Image src, dst;
+	source_alloc(&src, RGB32_YUV420, width, height);
+	generate_pattern(&src, PATTERN_RANDOM, 1);
+	destination_alloc(&dst, RGB32_YUV420, width, height);
+	RGBFrame rgb;
+	YUVFrame yuv;
+	rgb_frame_init(&rgb, PIXEL_FORMAT_RGB32, src.plane[0], src.line_size[0], width, height);
+	yuv_frame_init(&yuv, PIXEL_FORMAT_YUV420, dst.plane, dst.line_size, width, height, YCBCR_601);
+	PlanOptions options;
+	plan_options_init(&options);
+	options.thread_number = 2;
+	options.band_lines = 16;
+	Plan *plan = plan_create_rgb_yuv(&rgb, &yuv, &options);
+
+	stats_reset();
+	for(uint32_t run=0; run<runs; ++run)
+		plan_execute_rgb_yuv(plan, &rgb, &yuv);
+	plan_destroy(plan);
+
+	const uint32_t entry_number = stats_snapshot(entries, 64);
+	uint64_t total_calls = 0, histogram_calls = 0;
+	const StatsEntry *entry = NULL;
+	for(uint32_t i=0; i<entry_number && i<64; ++i)
+	{
+		total_calls += entries[i].calls;
+		for(uint32_t b=0; b<STATS_HISTOGRAM_BUCKETS; ++b)
+			histogram_calls += entries[i].histogram[b];
+		if(strcmp(entries[i].conversion, "rgb32_yuv420")==0 && entries[i].calls)
+			entry = &entries[i];
+	}
+	// 15 bands of 16 lines per run
+	if(!entry || entry->calls!=runs*15 || total_calls!=entry->calls || histogram_calls!=total_calls ||
+		entry->pixels!=(uint64_t)runs*width*height || entry->bytes!=(uint64_t)runs*width*height*(4+1.5) || entry->ticks==0)
+	{
+		printf("stats: FAILED, wrong counters\n");
+		failures++;
+	}
+	stats_reset();
+	stats_snapshot(entries, 64);
+	if(entries[0].calls!=0)
+	{
+		printf("stats: FAILED, counters not reset\n");
+		failures++;
+	}
+
+	// threads of destroyed plans must close their perf counters, and their counts must be kept
+	const int perf = stats_enable_perf()==0;
+	options.thread_number = 4;
+	// the calling thread may run bands too, and keeps its counters
+	plan = plan_create_rgb_yuv(&rgb, &yuv, &options);
+	plan_execute_rgb_yuv(plan, &rgb, &yuv);
+	plan_destroy(plan);
+	const uint32_t open_fds = count_open_fds();
+	stats_reset();
+	for(uint32_t run=0; run<plans; ++run)
+	{
+		plan = plan_create_rgb_yuv(&rgb, &yuv, &options);
+		plan_execute_rgb_yuv(plan, &rgb, &yuv);
+		plan_destroy(plan);
+	}
+	if(count_open_fds()!=open_fds)
+	{
+		printf("stats: FAILED, %u file descriptors leaked by exited threads\n", count_open_fds()-open_fds);
+		failures++;
+	}
+	const uint32_t threaded_entry_number = stats_snapshot(entries, 64);
+	total_calls = 0;
+	for(uint32_t i=0; i<threaded_entry_number && i<64; ++i)
+		total_calls += entries[i].calls;
+	if(total_calls!=plans*15)
+	{
+		printf("stats: FAILED, %llu calls counted for %u calls of exited threads\n", (unsigned long long)total_calls, 
+			plans*15);
+		failures++;
+	}
+	image_free(&src);
+	image_free(&dst);
+	if(!failures)
+		printf("stats: kernel calls counted correctly%s\n", perf ? "" : " (perf counters not available)");
+	return failures;
+}
+
+// feed frames to a stream converter by slices of random size, ending on odd or even lines,
+// in shuffled order, and compare the results with direct calls to the std kernels
+// return the number of failures
+static int check_stream(void)
+{
+	static const Conversion conversions[] = {YUV420_RGB24, NV12_RGB24, RGB24_YUV420, RGB32_YUV420};
+	static const uint32_t sizes[][2] = {{130, 33}, {320, 64}, {31, 7}, {64, 1}};
+	#define MAX_SLICES 64
+	int failures = 0;
+	uint32_t frame_number = 0;
+	StreamConverter *stream = NULL;
+
+	for(uint32_t c=0; c<sizeof(conversions)/sizeof(conversions[0]); ++c)
+	for(uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+	{
+		const Conversion conversion = conversions[c];
+		const uint32_t width=sizes[s][0], height=sizes[s][1];
+		const YCbCrType yuv_type = (YCbCrType)((c+s)%COLOR_SPACE_NUMBER);
+		Image src, expected, result;
+		source_alloc(&src, conversion, width, height);
+		generate_pattern(&src, PATTERN_RANDOM, !is_yuv2rgb(conversion));
+		destination_alloc(&expected, conversion, width, height);
+		destination_alloc(&result, conversion, width, height);
+		for(uint32_t p=0; p<expected.plane_number; ++p)
+		{
+			memset(expected.plane[p], 0, (size_t)expected.line_size[p]*expected.lines[p]);
+			memset(result.plane[p], 0, (size_t)result.line_size[p]*result.lines[p]);
+		}
+		std_convert(conversion, &src, &expected, yuv_type);
+
+		BatchFrame frame;
+		batch_frame_init(&frame, conversion, &src, &result, yuv_type);
+		// the first converter is created with the tallest frame, then reset for the next ones
+		if(!stream)
+		{
+			BatchFrame tallest = frame;
+			tallest.height = 64;
+			stream = stream_converter_create(&tallest);
+		}
+		if(!stream || stream_converter_reset(stream, &frame)!=0)
+		{
+			printf("stream: FAILED to create converter\n");
+			failures++;
+			image_free(&src);
+			image_free(&expected);
+			image_free(&result);
+			continue;
+		}
+
+		// random slices, pushed in shuffled order
+		uint32_t slice_begin[MAX_SLICES], slice_end[MAX_SLICES], slice_number = 0;
+		for(uint32_t row=0; row<height; ++slice_number)
+		{
+			uint32_t size = 1+rng_next()%9;
+			if(size>height-row || slice_number==MAX_SLICES-1)
+				size = height-row;
+			slice_begin[slice_number] = row;
+			slice_end[slice_number] = row+size;
+			row += size;
+		}
+		for(uint32_t i=slice_number; i>1; --i)
+		{
+			const uint32_t j = rng_next()%i, b = slice_begin[i-1], e = slice_end[i-1];
+			slice_begin[i-1] = slice_begin[j];
+			slice_end[i-1] = slice_end[j];
+			slice_begin[j] = b;
+			slice_end[j] = e;
+		}
+		uint32_t converted = 0;
+		for(uint32_t i=0; i<slice_number; ++i)
+		{
+			if(stream_converter_complete(stream))
+			{
+				printf("stream: FAILED, frame complete before its last slice\n");
+				failures++;
+			}
+			converted += stream_converter_push(stream, slice_begin[i], slice_end[i]);
+		}
+		if(!stream_converter_complete(stream) || converted!=(height&~1u))
+		{
+			printf("stream: FAILED, %u lines of %u converted\n", converted, height&~1u);
+			failures++;
+		}
+		if(!image_equal(&result, &expected))
+		{
+			printf("stream: FAILED, frame %ux%u %s differs from std kernel\n", width, height, conversion_names[conversion]);
+			failures++;
+		}
+		image_free(&src);
+		image_free(&expected);
+		image_free(&result);
+		frame_number++;
+	}
+
+	if(stream && stream_converter_push(stream, 2, 1000)!=-1)
+	{
+		printf("stream: FAILED, invalid range accepted\n");
+		failures++;
+	}
+	stream_converter_destroy(stream);
+	if(!failures)
+		printf("stream: %u frames converted correctly\n", frame_number);
+	return failures;
+	#undef MAX_SLICES
+}
+
+typedef struct
+{
+	Image *result;
+	uint32_t next_row;
+	const uint8_t *previous;     // previous strip, must still be valid
+	uint32_t previous_row, previous_lines, previous_stride;
+	uint32_t strip_number, stop_at;
+	int errors;
+} StripState;
+
+static int strip_callback(void *user_data, uint32_t row, uint32_t lines, const uint8_t *rgb, uint32_t rgb_stride)
+{
+	StripState *state = (StripState *)user_data;
+	Image *result = state->result;
+	const uint32_t line_size = result->line_size[0];
+	if(row!=state->next_row || lines==0 || row+lines>result->height)
+	{
+		state->errors++;
+		return 1;
+	}
+	for(uint32_t l=0; l<state->previous_lines; ++l)
+		if(memcmp(state->previous+l*state->previous_stride, result->plane[0]+(state->previous_row+l)*line_size, line_size)!=0)
+			state->errors++;
+	for(uint32_t l=0; l<lines; ++l)
+		memcpy(result->plane[0]+(row+l)*line_size, rgb+l*rgb_stride, line_size);
+	state->next_row = row+lines;
+	state->previous = rgb;
+	state->previous_row = row;
+	state->previous_lines = lines;
+	state->previous_stride = rgb_stride;
+	return ++state->strip_number==state->stop_at ? 7 : 0;
+}
+
+// convert frames by strips of different sizes, and compare with the std kernels
+// return the number of failures
+static int check_strips(void)
+{
+	static const Conversion conversions[] = {YUV420_RGB24, NV12_RGB24, NV21_RGB24};
+	static const uint32_t sizes[][2] = {{130, 33}, {320, 64}, {31, 7}, {1920, 17}, {6, 1}};
+	static const uint32_t strip_lines[] = {0, 1, 3, 16, 1000};
+	int failures = 0;
+	uint32_t frame_number = 0;
+
+	for(uint32_t c=0; c<sizeof(conversions)/sizeof(conversions[0]); ++c)
+	for(uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+	{
+		const Conversion conversion = conversions[c];
+		const uint32_t width=sizes[s][0], height=sizes[s][1];
+		const YCbCrType yuv_type = (YCbCrType)((c+s)%COLOR_SPACE_NUMBER);
+		Image src, expected, result;
+		source_alloc(&src, conversion, width, height);
+		generate_pattern(&src, PATTERN_RANDOM, 0);
+		destination_alloc(&expected, conversion, width, height);
+		destination_alloc(&result, conversion, width, height);
+		memset(expected.plane[0], 0, (size_t)expected.line_size[0]*height);
+		std_convert(conversion, &src, &expected, yuv_type);
+		if(height&1)
+		{
+			// last line of odd frames is converted as a pair with itself
+			Image last = src;
+			last.height = 2;
+			last.plane[0] += (height-1)*src.line_size[0];
+			last.line_size[0] = 0;
+			for(uint32_t p=1; p<src.plane_number; ++p)
+				last.plane[p] += (height-1)/2*src.line_size[p];
+			uint8_t *rgb = calloc(2, expected.line_size[0]);
+			Image pair = expected;
+			pair.plane[0] = rgb;
+			std_convert(conversion, &last, &pair, yuv_type);
+			memcpy(expected.plane[0]+(height-1)*expected.line_size[0], rgb, expected.line_size[0]);
+			free(rgb);
+		}
+
+		BatchFrame frame;
+		batch_frame_init(&frame, conversion, &src, &result, yuv_type);
+		frame.dst[0] = NULL;
+		for(uint32_t l=0; l<sizeof(strip_lines)/sizeof(strip_lines[0]); ++l)
+		{
+			StripState state;
+			memset(&state, 0, sizeof(state));
+			state.result = &result;
+			memset(result.plane[0], 0, (size_t)result.line_size[0]*height);
+			if(convert_to_strips(&frame, strip_lines[l], strip_callback, &state)!=0 || state.errors ||
+				state.next_row!=height || !image_equal(&result, &expected))
+			{
+				printf("strips: FAILED, frame %ux%u %s with strips of %u lines\n", width, height,
+					conversion_names[conversion], strip_lines[l]);
+				failures++;
+			}
+			frame_number++;
+		}
+
+		// stop after the first strip
+		StripState state;
+		memset(&state, 0, sizeof(state));
+		state.result = &result;
+		state.stop_at = 1;
+		if(convert_to_strips(&frame, 2, strip_callback, &state)!=7 || state.strip_number!=1)
+		{
+			printf("strips: FAILED, conversion not stopped by callback\n");
+			failures++;
+		}
+
+		image_free(&src);
+		image_free(&expected);
+		image_free(&result);
+	}
+
+	BatchFrame invalid;
+	memset(&invalid, 0, sizeof(invalid));
+	invalid.src_format = PIXEL_FORMAT_RGB24;
+	invalid.dst_format = PIXEL_FORMAT_YUV420;
+	if(convert_to_strips(&invalid, 0, strip_callback, NULL)!=-1)
+	{
+		printf("strips: FAILED, unsupported conversion accepted\n");
+		failures++;
+	}
+	if(!failures)
+		printf("strips: %u frames converted correctly\n", frame_number);
+	return failures;
+}
+
+#define PIPELINE_FRAMES 200
+
+static void *pipeline_producer(void *arg)
+{
+	Pipeline *pipeline = (Pipeline *)arg;
+	uintptr_t index = 0;
+	uint32_t seed = 12345;
+	while(index<PIPELINE_FRAMES)
+	{
+		FrameSlot *slot = pipeline_acquire(pipeline);
+		if(!slot)
+			continue;
+		const BatchFrame *frame = &slot->frame;
+		// frame content depends on its index, with a flat area to make frames different
+		for(uint32_t p=0; p<3; ++p)
+		{
+			const uint32_t w = p ? (frame->width+1)/2 : frame->width, h = p ? (frame->height+1)/2 : frame->height;
+			for(uint32_t y=0; y<h; ++y)
+				for(uint32_t x=0; x<w; ++x)
+				{
+					seed = seed*1103515245u+12345u;
+					((uint8_t *)frame->src[p])[y*frame->src_stride[p]+x] = y<4 ? (uint8_t)index : (uint8_t)(seed>>24);
+				}
+		}
+		slot->user_data = (void *)index;
+		pipeline_submit(pipeline, slot);
+		index++;
+	}
+	pipeline_close(pipeline);
+	return NULL;
+}
+
+static void *pipeline_converter(void *arg)
+{
+	pipeline_convert_loop((Pipeline *)arg);
+	return NULL;
+}
+
+// run frames through a pipeline with a producer thread and two converter threads,
+// and check the frames received by the calling thread
+// return the number of failures
+static int check_pipeline(void)
+{
+	const uint32_t width=320, height=240;
+	int failures = 0;
+
+	// raw ring in mpmc mode, with several producers and consumers
+	FrameRing *ring = frame_ring_create(5, RING_MPMC);
+	uintptr_t sum = 0;
+	for(uintptr_t i=1; i<=8; ++i)
+		if(frame_ring_push(ring, (void *)i)!=0)
+			failures++;
+	if(frame_ring_push(ring, (void *)9)!=-1)
+		failures++;
+	for(void *item; (item=frame_ring_pop(ring))!=NULL; )
+		sum += (uintptr_t)item;
+	if(sum!=36 || frame_ring_pop(ring)!=NULL)
+		failures++;
+	frame_ring_destroy(ring);
+	if(failures)
+		printf("pipeline: FAILED, wrong ring content\n");
+
+	// the pipeline accepts the conversions of the dispatcher, and only them
+	Pipeline *repack = pipeline_create(2, width, height, PIXEL_FORMAT_RGB24, PIXEL_FORMAT_RGB32, YCBCR_601,
+		RING_SPSC, 1, RING_SPSC);
+	Pipeline *invalid = pipeline_create(2, width, height, PIXEL_FORMAT_RGB24, PIXEL_FORMAT_NV12, YCBCR_601,
+		RING_SPSC, 1, RING_SPSC);
+	if(!repack || invalid)
+	{
+		printf("pipeline: FAILED, conversions accepted differ from the dispatcher\n");
+		failures++;
+	}
+	if(repack)
+		pipeline_destroy(repack);
+	if(invalid)
+		pipeline_destroy(invalid);
+
+	Pipeline *pipeline = pipeline_create(8, width, height, PIXEL_FORMAT_YUV420, PIXEL_FORMAT_RGB24, YCBCR_601,
+		RING_SPSC, 2, RING_SPSC);
+	if(!pipeline)
+	{
+		printf("pipeline: FAILED to create pipeline\n");
+		return failures+1;
+	}
+	pthread_t producer, converters[2];
+	pthread_create(&producer, NULL, pipeline_producer, pipeline);
+	pthread_create(&converters[0], NULL, pipeline_converter, pipeline);
+	pthread_create(&converters[1], NULL, pipeline_converter, pipeline);
+
+	uint8_t *expected = malloc(width*height*3);
+	uint32_t received = 0;
+	uint8_t seen[PIPELINE_FRAMES];
+	memset(seen, 0, sizeof(seen));
+	while(received<PIPELINE_FRAMES)
+	{
+		FrameSlot *slot = pipeline_receive(pipeline);
+		if(!slot)
+			continue;
+		const BatchFrame *frame = &slot->frame;
+		const uintptr_t index = (uintptr_t)slot->user_data;
+		if(index>=PIPELINE_FRAMES || seen[index])
+		{
+			printf("pipeline: FAILED, unexpected frame %lu\n", (unsigned long)index);
+			failures++;
+		}
+		else
+			seen[index] = 1;
+		yuv420_rgb24_std(width, height, frame->src[0], frame->src[1], frame->src[2], frame->src_stride[0], frame->src_stride[1],
+			expected, width*3, frame->yuv_type);
+		for(uint32_t y=0; y<height; ++y)
+		{
+			if(memcmp(frame->dst[0]+y*frame->dst_stride[0], expected+y*width*3, width*3)!=0)
+			{
+				printf("pipeline: FAILED, frame %lu differs from std kernel\n", (unsigned long)index);
+				failures++;
+				break;
+			}
+		}
+		pipeline_release(pipeline, slot);
+		received++;
+	}
+	pthread_join(producer, NULL);
+	pthread_join(converters[0], NULL);
+	pthread_join(converters[1], NULL);
+	free(expected);
+	pipeline_destroy(pipeline);
+	if(!failures)
+		printf("pipeline: %u frames converted correctly\n", PIPELINE_FRAMES);
+	return failures;
+}
+
+// sseu variant of a kernel for the checks that compare it with the std one, without sse2 the std kernel
+// is compared with itself and only checked against the reference conversions
+#ifdef _YUVRGB_SSE2_
+#define SSEU_KERNEL(name) name##_sseu
+#else
+#define SSEU_KERNEL(name) name##_std
+#endif
+
+// luma only kernels must give the luma of the full conversions, and sseu must be bit exact with std,
+// with unaligned pointers and odd sizes
+static int check_luma(void)
+{
+	static const uint32_t sizes[][2] = {{1, 1}, {31, 3}, {33, 5}, {64, 2}, {101, 7}};
+	int failures = 0;
+
+	for(uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+	for(int type=YCBCR_JPEG; type<=YCBCR_2020; ++type)
+	{
+		const uint32_t width=sizes[s][0], height=sizes[s][1];
+		const uint32_t even_width=width&~1u, even_height=height&~1u;
+		const YCbCrType yuv_type = (YCbCrType)type;
+		// strides are not multiples of 16 and planes start at an odd address
+		const uint32_t y_stride=width+3, rgb_stride=width*3+5, rgba_stride=width*4+7, uv_stride=width/2+1;
+		uint8_t *y = malloc((size_t)y_stride*height+1), *rgb = malloc((size_t)rgb_stride*height+1),
+			*rgba = malloc((size_t)rgba_stride*height+1), *uv = malloc((size_t)uv_stride*height+1);
+		uint8_t *out[4], *ref[3];
+		for(uint32_t i=0; i<4; ++i)
+			out[i] = malloc((size_t)rgba_stride*height+1);
+		for(uint32_t i=0; i<3; ++i)
+			ref[i] = calloc((size_t)rgba_stride*height+1, 1);
+		for(size_t i=0; i<(size_t)y_stride*height+1; ++i)
+			y[i] = rng_next();
+		for(size_t i=0; i<(size_t)rgb_stride*height+1; ++i)
+			rgb[i] = rng_next();
+		for(size_t i=0; i<(size_t)rgba_stride*height+1; ++i)
+			rgba[i] = rng_next();
+		memset(uv, 128, (size_t)uv_stride*height+1);
+		int error = 0;
+
+		// Y to gray, compared with yuv to rgb without chroma
+		luma_gray8_std(width, height, y+1, y_stride, out[0]+1, y_stride, yuv_type);
+		SSEU_KERNEL(luma_gray8)(width, height, y+1, y_stride, out[1]+1, y_stride, yuv_type);
+		luma_rgb24_std(width, height, y+1, y_stride, out[2]+1, rgb_stride, yuv_type);
+		SSEU_KERNEL(luma_rgb32)(width, height, y+1, y_stride, out[3]+1, rgba_stride, yuv_type);
+		yuv420_rgb24_std(width, height, y+1, uv+1, uv+1, y_stride, uv_stride, ref[0]+1, rgb_stride, yuv_type);
+		for(uint32_t j=0; j<height; ++j)
+		for(uint32_t i=0; i<width; ++i)
+		{
+			const uint8_t gray = out[0][1+j*y_stride+i];
+			const uint8_t *pixel = out[2]+1+j*rgb_stride+i*3, *rgba_pixel = out[3]+1+j*rgba_stride+i*4;
+			error |= out[1][1+j*y_stride+i]!=gray || pixel[0]!=gray || pixel[1]!=gray || pixel[2]!=gray ||
+				rgba_pixel[0]!=gray || rgba_pixel[1]!=gray || rgba_pixel[2]!=gray || rgba_pixel[3]!=255;
+			if(i<even_width && j<even_height)
+				error |= memcmp(pixel, ref[0]+1+j*rgb_stride+i*3, 3)!=0;
+		}
+		SSEU_KERNEL(luma_rgb24)(width, height, y+1, y_stride, out[3]+1, rgb_stride, yuv_type);
+		luma_rgb32_std(width, height, y+1, y_stride, out[2]+1, rgba_stride, yuv_type);
+		for(uint32_t j=0; j<height; ++j)
+		for(uint32_t i=0; i<width; ++i)
+		{
+			const uint8_t gray = out[0][1+j*y_stride+i];
+			const uint8_t *pixel = out[3]+1+j*rgb_stride+i*3, *rgba_pixel = out[2]+1+j*rgba_stride+i*4;
+			error |= pixel[0]!=gray || pixel[1]!=gray || pixel[2]!=gray ||
+				rgba_pixel[0]!=gray || rgba_pixel[1]!=gray || rgba_pixel[2]!=gray || rgba_pixel[3]!=255;
+		}
+
+		// rgb to Y, compared with the Y plane of rgb to yuv
+		rgb24_luma_std(width, height, rgb+1, rgb_stride, out[0]+1, y_stride, yuv_type);
+		SSEU_KERNEL(rgb24_luma)(width, height, rgb+1, rgb_stride, out[1]+1, y_stride, yuv_type);
+		rgb32_luma_std(width, height, rgba+1, rgba_stride, out[2]+1, y_stride, yuv_type);
+		SSEU_KERNEL(rgb32_luma)(width, height, rgba+1, rgba_stride, out[3]+1, y_stride, yuv_type);
+		rgb24_yuv420_std(width, height, rgb+1, rgb_stride, ref[0]+1, ref[2]+1, ref[2]+1, y_stride, uv_stride, yuv_type);
+		rgb32_yuv420_std(width, height, rgba+1, rgba_stride, ref[1]+1, ref[2]+1, ref[2]+1, y_stride, uv_stride, yuv_type);
+		for(uint32_t j=0; j<height; ++j)
+		{
+			const size_t line = 1+(size_t)j*y_stride;
+			error |= memcmp(out[0]+line, out[1]+line, width)!=0 || memcmp(out[2]+line, out[3]+line, width)!=0;
+			if(j<even_height)
+				error |= memcmp(out[0]+line, ref[0]+line, even_width)!=0 || memcmp(out[2]+line, ref[1]+line, even_width)!=0;
+		}
+
+		if(error)
+		{
+			printf("luma: FAILED, %ux%u %s\n", width, height, color_space_names[type]);
+			failures++;
+		}
+		free(y);
+		free(rgb);
+		free(rgba);
+		free(uv);
+		for(uint32_t i=0; i<4; ++i)
+			free(out[i]);
+		for(uint32_t i=0; i<3; ++i)
+			free(ref[i]);
+	}
+	if(!failures)
+		printf("luma: %u cases converted correctly\n", (unsigned)(COLOR_SPACE_NUMBER*sizeof(sizes)/sizeof(sizes[0])));
+	return failures;
+}
+
+// conversions between color spaces must be within 1 of a floating point reference, sseu must be bit exact
+// with std, identity must be exact, and nv12 and in place conversions must give the same result
+static int check_yuv2yuv(void)
+{
+	static const uint32_t sizes[][2] = {{2, 2}, {16, 2}, {30, 6}, {33, 5}, {66, 10}, {320, 8}};
+	int failures = 0;
+	uint32_t cases = 0;
+
+	for(uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+	for(uint32_t src_type=0; src_type<COLOR_SPACE_NUMBER; ++src_type)
+	for(uint32_t dst_type=0; dst_type<COLOR_SPACE_NUMBER; ++dst_type)
+	{
+		const uint32_t width=sizes[s][0], height=sizes[s][1];
+		const uint32_t even_width=width&~1u, even_height=height&~1u;
+		// strides are not multiples of 16 and planes start at an odd address
+		const uint32_t y_stride=width+3, uv_stride=width/2+5, nv_stride=(width/2)*2+7;
+		const size_t y_size=(size_t)y_stride*height+1, uv_size=(size_t)uv_stride*((height+1)/2)+1, 
+			nv_size=(size_t)nv_stride*((height+1)/2)+1;
+		uint8_t *src[3], *std[3], *sse[3], *nv[2], *nv_std[2], *nv_sse[2];
+		for(uint32_t p=0; p<3; ++p)
+		{
+			const size_t size = p==0 ? y_size : uv_size;
+			src[p] = malloc(size);
+			std[p] = calloc(size, 1);
+			sse[p] = calloc(size, 1);
+			for(size_t i=0; i<size; ++i)
+				src[p][i] = rng_next();
+		}
+		for(uint32_t p=0; p<2; ++p)
+		{
+			const size_t size = p==0 ? y_size : nv_size;
+			nv[p] = calloc(size, 1);
+			nv_std[p] = calloc(size, 1);
+			nv_sse[p] = calloc(size, 1);
+		}
+		memcpy(nv[0], src[0], y_size);
+		for(uint32_t j=0; j<(height+1)/2; ++j)
+		for(uint32_t i=0; i<width/2; ++i)
+		{
+			nv[1][1+j*nv_stride+2*i] = src[1][1+j*uv_stride+i];
+			nv[1][1+j*nv_stride+2*i+1] = src[2][1+j*uv_stride+i];
+		}
+		int error = 0;
+
+		yuv420_yuv420_std(width, height, src[0]+1, src[1]+1, src[2]+1, y_stride, uv_stride, 
+			std[0]+1, std[1]+1, std[2]+1, y_stride, uv_stride, (YCbCrType)src_type, (YCbCrType)dst_type);
+		SSEU_KERNEL(yuv420_yuv420)(width, height, src[0]+1, src[1]+1, src[2]+1, y_stride, uv_stride, 
+			sse[0]+1, sse[1]+1, sse[2]+1, y_stride, uv_stride, (YCbCrType)src_type, (YCbCrType)dst_type);
+		nv12_nv12_std(width, height, nv[0]+1, nv[1]+1, y_stride, nv_stride, 
+			nv_std[0]+1, nv_std[1]+1, y_stride, nv_stride, (YCbCrType)src_type, (YCbCrType)dst_type);
+		SSEU_KERNEL(nv12_nv12)(width, height, nv[0]+1, nv[1]+1, y_stride, nv_stride, 
+			nv_sse[0]+1, nv_sse[1]+1, y_stride, nv_stride, (YCbCrType)src_type, (YCbCrType)dst_type);
+		error |= memcmp(std[0], sse[0], y_size)!=0 || memcmp(std[1], sse[1], uv_size)!=0 || memcmp(std[2], sse[2], uv_size)!=0;
+		error |= memcmp(std[0], nv_std[0], y_size)!=0 || memcmp(nv_std[0], nv_sse[0], y_size)!=0 || 
+			memcmp(nv_std[1], nv_sse[1], nv_size)!=0;
+
+		// floating point reference, through analog rgb
+		const ColorSpace *in = &color_spaces[src_type], *out = &color_spaces[dst_type];
+		for(uint32_t j=0; j<even_height; j+=2)
+		for(uint32_t i=0; i<even_width; i+=2)
+		{
+			const size_t uv_pos = 1+(j/2)*uv_stride+i/2;
+			const double cb = (src[1][uv_pos]-128.0)/in->cbcr_range, cr = (src[2][uv_pos]-128.0)/in->cbcr_range;
+			double y_mean = 0.0;
+			error |= nv_std[1][1+(j/2)*nv_stride+i]!=std[1][uv_pos] || nv_std[1][1+(j/2)*nv_stride+i+1]!=std[2][uv_pos];
+			for(uint32_t k=0; k<4; ++k)
+			{
+				const size_t pos = 1+(j+k/2)*y_stride+i+k%2;
+				const double y = (src[0][pos]-in->y_min)/(in->y_max-in->y_min);
+				const double r = y + 2.0*(1.0-in->rf)*cr, b = y + 2.0*(1.0-in->bf)*cb, 
+					g = (y - in->rf*r - in->bf*b)/(1.0-in->rf-in->bf);
+				const double y2 = out->rf*r + (1.0-out->rf-out->bf)*g + out->bf*b;
+				y_mean += y/4.0;
+				error |= abs(std[0][pos]-clamp_round(y2*(out->y_max-out->y_min)+out->y_min))>1;
+				if(src_type==dst_type)
+					error |= std[0][pos]!=src[0][pos];
+			}
+			const double r = y_mean + 2.0*(1.0-in->rf)*cr, b = y_mean + 2.0*(1.0-in->bf)*cb, 
+				g = (y_mean - in->rf*r - in->bf*b)/(1.0-in->rf-in->bf);
+			const double y2 = out->rf*r + (1.0-out->rf-out->bf)*g + out->bf*b;
+			// chroma does not depend on luma, the mean is used to check it
+			error |= abs(std[1][uv_pos]-clamp_round((b-y2)/(2.0*(1.0-out->bf))*out->cbcr_range+128.0))>1;
+			error |= abs(std[2][uv_pos]-clamp_round((r-y2)/(2.0*(1.0-out->rf))*out->cbcr_range+128.0))>1;
+			if(src_type==dst_type)
+				error |= std[1][uv_pos]!=src[1][uv_pos] || std[2][uv_pos]!=src[2][uv_pos];
+		}
+
+		// in place
+		for(uint32_t p=0; p<3; ++p)
+			memcpy(sse[p], src[p], p==0 ? y_size : uv_size);
+		SSEU_KERNEL(yuv420_yuv420)(width, height, sse[0]+1, sse[1]+1, sse[2]+1, y_stride, uv_stride, 
+			sse[0]+1, sse[1]+1, sse[2]+1, y_stride, uv_stride, (YCbCrType)src_type, (YCbCrType)dst_type);
+		for(uint32_t j=0; j<even_height; ++j)
+		{
+			error |= memcmp(sse[0]+1+j*y_stride, std[0]+1+j*y_stride, even_width)!=0;
+			if(j%2==0)
+				error |= memcmp(sse[1]+1+(j/2)*uv_stride, std[1]+1+(j/2)*uv_stride, width/2)!=0 || 
+					memcmp(sse[2]+1+(j/2)*uv_stride, std[2]+1+(j/2)*uv_stride, width/2)!=0;
+		}
+
+		if(error)
+		{
+			printf("yuv2yuv: FAILED, %ux%u %s to %s\n", width, height, color_space_names[src_type], color_space_names[dst_type]);
+			failures++;
+		}
+		cases++;
+		for(uint32_t p=0; p<3; ++p)
+		{
+			free(src[p]);
+			free(std[p]);
+			free(sse[p]);
+		}
+		for(uint32_t p=0; p<2; ++p)
+		{
+			free(nv[p]);
+			free(nv_std[p]);
+			free(nv_sse[p]);
+		}
+	}
+	if(!failures)
+		printf("yuv2yuv: %u cases converted correctly\n", cases);
+	return failures;
+}
+
+typedef void (*PlanarToSemiPlanar)(uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *uv2, uint32_t y2_stride, uint32_t uv2_stride);
+typedef void (*SemiPlanarToPlanar)(uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *u2, uint8_t *v2, uint32_t y2_stride, uint32_t uv2_stride);
+typedef void (*SemiPlanarToSemiPlanar)(uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *uv2, uint32_t y2_stride, uint32_t uv2_stride);
+
+typedef struct
+{
+	const char *name;
+	int aligned;
+	PlanarToSemiPlanar yuv420_nv12, yuv420_nv21;
+	SemiPlanarToPlanar nv12_yuv420, nv21_yuv420;
+	SemiPlanarToSemiPlanar nv12_nv21;
+} RepackKernels;
+
+static const RepackKernels repack_kernels[] = {
+	{"std", 0, yuv420_nv12_std, yuv420_nv21_std, nv12_yuv420_std, nv21_yuv420_std, nv12_nv21_std},
+#ifdef _YUVRGB_SSE2_
+	{"sse", 1, yuv420_nv12_sse, yuv420_nv21_sse, nv12_yuv420_sse, nv21_yuv420_sse, nv12_nv21_sse},
+	{"sseu", 0, yuv420_nv12_sseu, yuv420_nv21_sseu, nv12_yuv420_sseu, nv21_yuv420_sseu, nv12_nv21_sseu},
+#endif
+};
+
+// return 1 if the plane content is different from the tightly packed data
+static int plane_differ(const Plane *plane, const uint8_t *expected)
+{
+	uint8_t *data = malloc((size_t)plane->line_size*plane->lines);
+	plane_read(plane, data);
+	const int differ = memcmp(data, expected, (size_t)plane->line_size*plane->lines)!=0;
+	free(data);
+	return differ;
+}
+
+static int check_repack(void)
+{
+	static const uint32_t sizes[][2] = {{1, 1}, {2, 2}, {17, 3}, {33, 5}, {64, 4}, {130, 7}};
+	int failures = 0;
+	uint32_t cases = 0;
+
+	for(uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+	for(uint32_t l=0; l<LAYOUT_NUMBER; ++l)
+	for(uint32_t k=0; k<sizeof(repack_kernels)/sizeof(repack_kernels[0]); ++k)
+	{
+		const RepackKernels *kernel = &repack_kernels[k];
+		const uint32_t width=sizes[s][0], height=sizes[s][1], uv_width=(width+1)/2, uv_height=(height+1)/2;
+		const size_t y_size=(size_t)width*height, uv_size=(size_t)uv_width*uv_height;
+		uint8_t *y = malloc(y_size), *u = malloc(uv_size), *v = malloc(uv_size), 
+			*uv = malloc(2*uv_size), *vu = malloc(2*uv_size);
+		for(size_t i=0; i<y_size; ++i)
+			y[i] = rng_next();
+		for(size_t i=0; i<uv_size; ++i)
+		{
+			uv[2*i] = vu[2*i+1] = u[i] = rng_next();
+			uv[2*i+1] = vu[2*i] = v[i] = rng_next();
+		}
+		Plane src[4], dst[4];
+		for(uint32_t p=0; p<4; ++p)
+		{
+			const uint32_t line_size = p==0 ? width : p==3 ? 2*uv_width : uv_width, lines = p==0 ? height : uv_height;
+			plane_alloc(&src[p], line_size, lines, (Layout)l, kernel->aligned);
+			plane_alloc(&dst[p], line_size, lines, (Layout)l, kernel->aligned);
+		}
+		plane_write(&src[0], y);
+		plane_write(&src[1], u);
+		plane_write(&src[2], v);
+		plane_write(&src[3], uv);
+		int error = 0;
+
+		kernel->yuv420_nv12(width, height, src[0].data, src[1].data, src[2].data, src[0].stride, src[1].stride, 
+			dst[0].data, dst[3].data, dst[0].stride, dst[3].stride);
+		error |= plane_differ(&dst[0], y) || plane_differ(&dst[3], uv);
+		// the Y plane is not written if the destination is NULL
+		dst[0].data[0] = y[0] ? 0 : 1;
+		kernel->yuv420_nv21(width, height, src[0].data, src[1].data, src[2].data, src[0].stride, src[1].stride, 
+			NULL, dst[3].data, dst[0].stride, dst[3].stride);
+		error |= plane_differ(&dst[3], vu) || dst[0].data[0]!=(y[0] ? 0 : 1);
+		kernel->nv12_yuv420(width, height, src[0].data, src[3].data, src[0].stride, src[3].stride, 
+			dst[0].data, dst[1].data, dst[2].data, dst[0].stride, dst[1].stride);
+		error |= plane_differ(&dst[0], y) || plane_differ(&dst[1], u) || plane_differ(&dst[2], v);
+		kernel->nv21_yuv420(width, height, src[0].data, src[3].data, src[0].stride, src[3].stride, 
+			dst[0].data, dst[1].data, dst[2].data, dst[0].stride, dst[1].stride);
+		error |= plane_differ(&dst[1], v) || plane_differ(&dst[2], u);
+		kernel->nv12_nv21(width, height, src[0].data, src[3].data, src[0].stride, src[3].stride, 
+			dst[0].data, dst[3].data, dst[0].stride, dst[3].stride);
+		error |= plane_differ(&dst[0], y) || plane_differ(&dst[3], vu);
+		// in place, Y is shared
+		kernel->nv12_nv21(width, height, src[0].data, src[3].data, src[0].stride, src[3].stride, 
+			src[0].data, src[3].data, src[0].stride, src[3].stride);
+		error |= plane_differ(&src[0], y) || plane_differ(&src[3], vu);
+		for(uint32_t p=0; p<4; ++p)
+			error |= plane_check_guard(&src[p])!=0 || plane_check_guard(&dst[p])!=0;
+
+		if(error)
+		{
+			printf("repack: FAILED, %ux%u %s %s\n", width, height, layout_names[l], kernel->name);
+			failures++;
+		}
+		cases++;
+		for(uint32_t p=0; p<4; ++p)
+		{
+			plane_free(&src[p]);
+			plane_free(&dst[p]);
+		}
+		free(y);
+		free(u);
+		free(v);
+		free(uv);
+		free(vu);
+	}
+
+	// through the batch api, with the Y plane shared between source and destination
+	{
+		const uint32_t width=66, height=10, uv_width=33, uv_height=5;
+		uint8_t *y = malloc(width*height), *u = malloc(uv_width*uv_height), *v = malloc(uv_width*uv_height), 
+			*vu = malloc(2*uv_width*uv_height), *expected = malloc(2*uv_width*uv_height);
+		for(uint32_t i=0; i<width*height; ++i)
+			y[i] = rng_next();
+		for(uint32_t i=0; i<uv_width*uv_height; ++i)
+		{
+			expected[2*i+1] = u[i] = rng_next();
+			expected[2*i] = v[i] = rng_next();
+		}
+		BatchFrame frame = {width, height, PIXEL_FORMAT_YUV420, {y, u, v}, {width, uv_width, 0}, 
+			PIXEL_FORMAT_NV21, {y, vu, NULL}, {width, 2*uv_width, 0}, YCBCR_601};
+		if(batch_convert(NULL, &frame, 1)!=0 || memcmp(vu, expected, 2*uv_width*uv_height)!=0)
+		{
+			printf("repack: FAILED, batch yuv420 to nv21\n");
+			failures++;
+		}
+		cases++;
+		free(y);
+		free(u);
+		free(v);
+		free(vu);
+		free(expected);
+	}
+	if(!failures)
+		printf("repack: %u cases converted correctly\n", cases);
+	return failures;
+}
+
+typedef void (*PlanarToRgb16)(uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, int dither, YCbCrType yuv_type);
+typedef void (*SemiPlanarToRgb16)(uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, int dither, YCbCrType yuv_type);
+
+typedef struct
+{
+	const char *name;
+	int aligned;
+	PlanarToRgb16 yuv420_rgb565, yuv420_rgb555;
+	SemiPlanarToRgb16 nv12_rgb565, nv12_rgb555;
+} Rgb16Kernels;
+
+static const Rgb16Kernels rgb16_kernels[] = {
+	{"std", 0, yuv420_rgb565_std, yuv420_rgb555_std, nv12_rgb565_std, nv12_rgb555_std},
+#ifdef _YUVRGB_SSE2_
+	{"sse", 1, yuv420_rgb565_sse, yuv420_rgb555_sse, nv12_rgb565_sse, nv12_rgb555_sse},
+	{"sseu", 0, yuv420_rgb565_sseu, yuv420_rgb555_sseu, nv12_rgb565_sseu, nv12_rgb555_sseu},
+#endif
+};
+
+// 16 bits outputs must be the rgb24 output, with dither thresholds added, and truncated
+static int check_rgb16(void)
+{
+	static const uint32_t sizes[][2] = {{2, 2}, {34, 6}, {64, 4}, {101, 9}};
+	static const uint8_t dither_matrix[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+	int failures = 0;
+	uint32_t cases = 0;
+
+	for(uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+	for(uint32_t l=0; l<LAYOUT_NUMBER; ++l)
+	for(uint32_t k=0; k<sizeof(rgb16_kernels)/sizeof(rgb16_kernels[0]); ++k)
+	for(uint32_t c=0; c<COLOR_SPACE_NUMBER; ++c)
+	for(int dither=0; dither<2; ++dither)
+	{
+		const Rgb16Kernels *kernel = &rgb16_kernels[k];
+		const YCbCrType yuv_type = (YCbCrType)c;
+		const uint32_t width=sizes[s][0], height=sizes[s][1], uv_width=(width+1)/2, uv_height=(height+1)/2;
+		uint8_t *y = malloc((size_t)width*height), *u = malloc(uv_width*uv_height), *v = malloc(uv_width*uv_height), 
+			*uv = malloc(2*uv_width*uv_height), *rgb24 = malloc((size_t)width*height*3), *rgb16 = malloc((size_t)width*height*2);
+		for(uint32_t i=0; i<width*height; ++i)
+			y[i] = rng_next();
+		for(uint32_t i=0; i<uv_width*uv_height; ++i)
+		{
+			uv[2*i] = u[i] = rng_next();
+			uv[2*i+1] = v[i] = rng_next();
+		}
+		yuv420_rgb24_std(width, height, y, u, v, width, uv_width, rgb24, width*3, yuv_type);
+		Plane src[4], dst;
+		for(uint32_t p=0; p<4; ++p)
+			plane_alloc(&src[p], p==0 ? width : p==3 ? 2*uv_width : uv_width, p==0 ? height : uv_height, (Layout)l, kernel->aligned);
+		plane_write(&src[0], y);
+		plane_write(&src[1], u);
+		plane_write(&src[2], v);
+		plane_write(&src[3], uv);
+		plane_alloc(&dst, width*2, height, (Layout)l, kernel->aligned);
+		int error = 0;
+
+		for(uint32_t f=0; f<4; ++f)
+		{
+			const int green_bits = f%2==0 ? 6 : 5;
+			for(uint32_t j=0; j<height; ++j)
+				memset(dst.data+(size_t)j*dst.stride, 0, dst.line_size);
+			if(f==0)
+				kernel->yuv420_rgb565(width, height, src[0].data, src[1].data, src[2].data, src[0].stride, src[1].stride, 
+					dst.data, dst.stride, dither, yuv_type);
+			else if(f==1)
+				kernel->yuv420_rgb555(width, height, src[0].data, src[1].data, src[2].data, src[0].stride, src[1].stride, 
+					dst.data, dst.stride, dither, yuv_type);
+			else if(f==2)
+				kernel->nv12_rgb565(width, height, src[0].data, src[3].data, src[0].stride, src[3].stride, 
+					dst.data, dst.stride, dither, yuv_type);
+			else
+				kernel->nv12_rgb555(width, height, src[0].data, src[3].data, src[0].stride, src[3].stride, 
+					dst.data, dst.stride, dither, yuv_type);
+			plane_read(&dst, rgb16);
+			for(uint32_t j=0; j<(height&~1u); ++j)
+			for(uint32_t i=0; i<(width&~1u); ++i)
+			{
+				const uint8_t *rgb = rgb24+((size_t)j*width+i)*3;
+				const int threshold = dither ? dither_matrix[j%4][i%4] : 0;
+				const int r = rgb[0]+threshold/2>255 ? 255 : rgb[0]+threshold/2, 
+					g = rgb[1]+(threshold>>(green_bits-4))>255 ? 255 : rgb[1]+(threshold>>(green_bits-4)), 
+					b = rgb[2]+threshold/2>255 ? 255 : rgb[2]+threshold/2;
+				const int expected = ((r>>3)<<(green_bits+5)) | ((g>>(8-green_bits))<<5) | (b>>3);
+				const uint8_t *pixel = rgb16+((size_t)j*width+i)*2;
+				error |= (pixel[0]|(pixel[1]<<8))!=expected;
+			}
+			error |= plane_check_guard(&dst)!=0;
+		}
+
+		if(error)
+		{
+			printf("rgb16: FAILED, %ux%u %s %s %s%s\n", width, height, layout_names[l], kernel->name, 
+				color_space_names[c], dither ? " dither" : "");
+			failures++;
+		}
+		cases++;
+		for(uint32_t p=0; p<4; ++p)
+			plane_free(&src[p]);
+		plane_free(&dst);
+		free(y);
+		free(u);
+		free(v);
+		free(uv);
+		free(rgb24);
+		free(rgb16);
+	}
+	if(!failures)
+		printf("rgb16: %u cases converted correctly\n", cases);
+	return failures;
+}
+
+typedef void (*RgbaToYuva)(uint32_t width, uint32_t height, const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *a, uint32_t y_stride, uint32_t uv_stride, YCbCrType yuv_type);
+typedef void (*YuvaToRgba)(uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, int premultiply, YCbCrType yuv_type);
+
+typedef struct
+{
+	const char *name;
+	int aligned;
+	RgbaToYuva rgba32_yuva420;
+	YuvaToRgba yuva420_rgba32, yuva420_bgra32;
+} YuvaKernels;
+
+static const YuvaKernels yuva_kernels[] = {
+	{"std", 0, rgba32_yuva420_std, yuva420_rgba32_std, yuva420_bgra32_std},
+#ifdef _YUVRGB_SSE2_
+	{"sse", 1, rgba32_yuva420_sse, yuva420_rgba32_sse, yuva420_bgra32_sse},
+	{"sseu", 0, rgba32_yuva420_sseu, yuva420_rgba32_sseu, yuva420_bgra32_sseu},
+#endif
+};
+
+// yuva420 conversions must give the yuv420 results, with alpha copied, and rgb multiplied by alpha/255 and 
+// rounded when premultiplied
+static int check_yuva(void)
+{
+	static const uint32_t sizes[][2] = {{2, 2}, {34, 6}, {64, 4}, {101, 9}};
+	int failures = 0;
+	uint32_t cases = 0;
+
+	for(uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+	for(uint32_t l=0; l<LAYOUT_NUMBER; ++l)
+	for(uint32_t k=0; k<sizeof(yuva_kernels)/sizeof(yuva_kernels[0]); ++k)
+	for(uint32_t c=0; c<COLOR_SPACE_NUMBER; ++c)
+	{
+		const YuvaKernels *kernel = &yuva_kernels[k];
+		const YCbCrType yuv_type = (YCbCrType)c;
+		const uint32_t width=sizes[s][0], height=sizes[s][1], uv_width=(width+1)/2, uv_height=(height+1)/2;
+		const size_t pixels=(size_t)width*height;
+		uint8_t *y = malloc(pixels), *u = malloc(uv_width*uv_height), *v = malloc(uv_width*uv_height), *a = malloc(pixels), 
+			*rgba = malloc(pixels*4), *rgb24 = malloc(pixels*3), *result = malloc(pixels*4), 
+			*expected_y = malloc(pixels), *expected_u = malloc(uv_width*uv_height), *expected_v = malloc(uv_width*uv_height);
+		for(size_t i=0; i<pixels; ++i)
+		{
+			const uint8_t value = rng_next();
+			y[i] = rng_next();
+			// fully transparent and opaque pixels are the most common ones
+			a[i] = value<64 ? 0 : value<128 ? 255 : rng_next();
+			for(uint32_t b=0; b<4; ++b)
+				rgba[4*i+b] = rng_next();
+		}
+		for(uint32_t i=0; i<uv_width*uv_height; ++i)
+		{
+			u[i] = rng_next();
+			v[i] = rng_next();
+		}
+		yuv420_rgb24_std(width, height, y, u, v, width, uv_width, rgb24, width*3, yuv_type);
+		memset(expected_y, 0, pixels);
+		memset(expected_u, 0, uv_width*uv_height);
+		memset(expected_v, 0, uv_width*uv_height);
+		rgb32_yuv420_std(width, height, rgba, width*4, expected_y, expected_u, expected_v, width, uv_width, yuv_type);
+		Plane src[4], dst[4], packed;
+		for(uint32_t p=0; p<4; ++p)
+		{
+			plane_alloc(&src[p], p==1 || p==2 ? uv_width : width, p==1 || p==2 ? uv_height : height, (Layout)l, kernel->aligned);
+			plane_alloc(&dst[p], p==1 || p==2 ? uv_width : width, p==1 || p==2 ? uv_height : height, (Layout)l, kernel->aligned);
+			for(uint32_t j=0; j<dst[p].lines; ++j)
+				memset(dst[p].data+(size_t)j*dst[p].stride, 0, dst[p].line_size);
+		}
+		plane_write(&src[0], y);
+		plane_write(&src[1], u);
+		plane_write(&src[2], v);
+		plane_write(&src[3], a);
+		plane_alloc(&packed, width*4, height, (Layout)l, kernel->aligned);
+		int error = 0;
+
+		// the alpha plane uses the y stride
+		for(int f=0; f<4; ++f)
+		{
+			const int swap = f&1, premultiply = f>>1;
+			for(uint32_t j=0; j<height; ++j)
+				memset(packed.data+(size_t)j*packed.stride, 0, packed.line_size);
+			(swap ? kernel->yuva420_bgra32 : kernel->yuva420_rgba32)(width, height, src[0].data, src[1].data, src[2].data, 
+				src[3].data, src[0].stride, src[1].stride, packed.data, packed.stride, premultiply, yuv_type);
+			plane_read(&packed, result);
+			for(uint32_t j=0; j<(height&~1u); ++j)
+			for(uint32_t i=0; i<(width&~1u); ++i)
+			{
+				const size_t index = (size_t)j*width+i;
+				const uint8_t *pixel = result+index*4;
+				for(uint32_t b=0; b<3; ++b)
+				{
+					const int value = rgb24[index*3+b], 
+						expected = premultiply ? (2*value*a[index]+255)/510 : value;
+					error |= pixel[swap ? 2-b : b]!=expected;
+				}
+				error |= pixel[3]!=a[index];
+			}
+			error |= plane_check_guard(&packed)!=0;
+		}
+
+		plane_write(&packed, rgba);
+		kernel->rgba32_yuva420(width, height, packed.data, packed.stride, dst[0].data, dst[1].data, dst[2].data, dst[3].data, 
+			dst[0].stride, dst[1].stride, yuv_type);
+		plane_read(&dst[0], result);
+		error |= memcmp(result, expected_y, pixels)!=0;
+		plane_read(&dst[3], result);
+		for(uint32_t j=0; j<(height&~1u); ++j)
+		for(uint32_t i=0; i<(width&~1u); ++i)
+			error |= result[(size_t)j*width+i]!=rgba[((size_t)j*width+i)*4+3];
+		plane_read(&dst[1], result);
+		error |= memcmp(result, expected_u, uv_width*uv_height)!=0;
+		plane_read(&dst[2], result);
+		error |= memcmp(result, expected_v, uv_width*uv_height)!=0;
+		for(uint32_t p=0; p<4; ++p)
+			error |= plane_check_guard(&dst[p])!=0;
+
+		if(error)
+		{
+			printf("yuva: FAILED, %ux%u %s %s %s\n", width, height, layout_names[l], kernel->name, color_space_names[c]);
+			failures++;
+		}
+		cases++;
+		for(uint32_t p=0; p<4; ++p)
+		{
+			plane_free(&src[p]);
+			plane_free(&dst[p]);
+		}
+		plane_free(&packed);
+		free(y);
+		free(u);
+		free(v);
+		free(a);
+		free(rgba);
+		free(rgb24);
+		free(result);
+		free(expected_y);
+		free(expected_u);
+		free(expected_v);
+	}
+	if(!failures)
+		printf("yuva: %u cases converted correctly\n", cases);
+	return failures;
+}
+
+typedef void (*BlendRgba)(uint32_t width, uint32_t height, const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride, uint32_t left, uint32_t top, YCbCrType yuv_type);
+typedef void (*BlendRgbaSemiPlanar)(uint32_t width, uint32_t height, const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, uint32_t left, uint32_t top, YCbCrType yuv_type);
+typedef void (*BlendYuva)(uint32_t width, uint32_t height, 
+	const uint8_t *overlay_y, const uint8_t *overlay_u, const uint8_t *overlay_v, const uint8_t *overlay_a, 
+	uint32_t overlay_y_stride, uint32_t overlay_uv_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride, uint32_t left, uint32_t top);
+typedef void (*BlendYuvaSemiPlanar)(uint32_t width, uint32_t height, 
+	const uint8_t *overlay_y, const uint8_t *overlay_u, const uint8_t *overlay_v, const uint8_t *overlay_a, 
+	uint32_t overlay_y_stride, uint32_t overlay_uv_stride, 
+	uint8_t *y, uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, uint32_t left, uint32_t top);
+
+typedef struct
+{
+	const char *name;
+	BlendRgba yuv420_blend_rgba32;
+	BlendRgbaSemiPlanar nv12_blend_rgba32;
+	BlendYuva yuv420_blend_yuva420;
+	BlendYuvaSemiPlanar nv12_blend_yuva420;
+} BlendKernels;
+
+static const BlendKernels blend_kernels[] = {
+	{"std", yuv420_blend_rgba32_std, nv12_blend_rgba32_std, yuv420_blend_yuva420_std, nv12_blend_yuva420_std},
+#ifdef _YUVRGB_SSE2_
+	{"sseu", yuv420_blend_rgba32_sseu, nv12_blend_rgba32_sseu, yuv420_blend_yuva420_sseu, nv12_blend_yuva420_sseu},
+#endif
+};
+
+// overlays of the blend check
+typedef enum
+{
+	OVERLAY_RGBA,
+	OVERLAY_RGBA_OPAQUE,
+	OVERLAY_RGBA_TRANSPARENT,
+	OVERLAY_YUVA,
+	OVERLAY_NUMBER
+} OverlayType;
+
+static const char *const overlay_names[] = {"rgba", "opaque rgba", "transparent rgba", "yuva"};
+
+// blending of an overlay in a yuv420 image, in double precision, alpha of pixels outside of the overlay is 0
+static void reference_blend(OverlayType overlay, uint32_t width, uint32_t height, const uint8_t *rgba, 
+	const uint8_t *oy, const uint8_t *ou, const uint8_t *ov, const uint8_t *oa, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride, uint32_t left, uint32_t top, YCbCrType yuv_type)
+{
+	const ColorSpace *cs = &color_spaces[yuv_type];
+	const double gf = 1.0-cs->rf-cs->bf;
+	for(uint32_t by=top/2; by<=(top+height-1)/2; ++by)
+	for(uint32_t bx=left/2; bx<=(left+width-1)/2; ++bx)
+	{
+		double a_sum=0.0, cb=0.0, cr=0.0;
+		for(uint32_t j=2*by; j<2*by+2; ++j)
+		for(uint32_t i=2*bx; i<2*bx+2; ++i)
+		{
+			if(j<top || j>=top+height || i<left || i>=left+width)
+				continue;
+			const size_t index=(size_t)(j-top)*width+(i-left);
+			double a, y_overlay;
+			if(overlay==OVERLAY_YUVA)
+			{
+				a = oa[index]/255.0;
+				y_overlay = oy[index];
+			}
+			else
+			{
+				const double r=rgba[4*index]/255.0, g=rgba[4*index+1]/255.0, b=rgba[4*index+2]/255.0;
+				const double ey = cs->rf*r + gf*g + cs->bf*b;
+				a = rgba[4*index+3]/255.0;
+				y_overlay = (cs->y_max-cs->y_min)*ey + cs->y_min;
+				cb += a*cs->cbcr_range*(b-ey)/(2.0*(1.0-cs->bf));
+				cr += a*cs->cbcr_range*(r-ey)/(2.0*(1.0-cs->rf));
+			}
+			uint8_t *y_ptr = y+(size_t)j*y_stride+i;
+			*y_ptr = clamp_round(*y_ptr*(1.0-a) + y_overlay*a);
+			a_sum += a;
+		}
+		a_sum /= 4.0;
+		uint8_t *u_ptr = u+(size_t)by*uv_stride+bx, *v_ptr = v+(size_t)by*uv_stride+bx;
+		if(overlay==OVERLAY_YUVA)
+		{
+			const size_t index=(size_t)(by-top/2)*((width+1)/2)+(bx-left/2);
+			*u_ptr = clamp_round(*u_ptr*(1.0-a_sum) + ou[index]*a_sum);
+			*v_ptr = clamp_round(*v_ptr*(1.0-a_sum) + ov[index]*a_sum);
+		}
+		else
+		{
+			*u_ptr = clamp_round(*u_ptr*(1.0-a_sum) + 128.0*a_sum + cb/4.0);
+			*v_ptr = clamp_round(*v_ptr*(1.0-a_sum) + 128.0*a_sum + cr/4.0);
+		}
+	}
+}
+
+// blending must be close to the double precision reference, bit exact between kernels and between yuv420 and 
+// nv12, and must not modify pixels outside of the overlay
+static int check_blend(void)
+{
+	static const uint32_t rects[][4] = {{0, 0, 96, 40}, {1, 1, 37, 13}, {3, 2, 64, 7}, {2, 3, 1, 1}, {5, 5, 2, 2}, 
+		{0, 1, 95, 38}, {10, 4, 70, 31}, {4, 2, 70, 36}, {31, 9, 65, 31}};
+	const uint32_t width=96, height=40, y_stride=101, uv_stride=53, uv_height=height/2;
+	// truncations of Y' and of premultiplied chroma add up to 3 for chroma
+	const int tolerance=3;
+	int failures = 0, max_error = 0;
+	uint32_t cases = 0;
+	uint8_t *y = malloc(y_stride*height), *u = malloc(uv_stride*uv_height), *v = malloc(uv_stride*uv_height), 
+		*expected_y = malloc(y_stride*height), *expected_u = malloc(uv_stride*uv_height), *expected_v = malloc(uv_stride*uv_height), 
+		*result_y = malloc(y_stride*height), *result_u = malloc(uv_stride*uv_height), *result_v = malloc(uv_stride*uv_height), 
+		*nv12_y = malloc(y_stride*height), *nv12_uv = malloc(2*uv_stride*uv_height), 
+		*rgba = malloc(width*height*4), *oy = malloc(width*height), *oa = malloc(width*height), 
+		*ou = malloc(width*height/4), *ov = malloc(width*height/4), 
+		*opaque_y = malloc(width*height), *opaque_u = malloc(width*height/4), *opaque_v = malloc(width*height/4);
+
+	for(uint32_t r=0; r<sizeof(rects)/sizeof(rects[0]); ++r)
+	for(uint32_t c=0; c<COLOR_SPACE_NUMBER; ++c)
+	for(uint32_t o=0; o<OVERLAY_NUMBER; ++o)
+	for(uint32_t k=0; k<sizeof(blend_kernels)/sizeof(blend_kernels[0]); ++k)
+	{
+		const BlendKernels *kernel = &blend_kernels[k];
+		const YCbCrType yuv_type = (YCbCrType)c;
+		const OverlayType overlay = (OverlayType)o;
+		// yuva overlays must be on even positions
+		const uint32_t left = overlay==OVERLAY_YUVA ? rects[r][0]&~1u : rects[r][0], 
+			top = overlay==OVERLAY_YUVA ? rects[r][1]&~1u : rects[r][1], 
+			overlay_width = rects[r][2], overlay_height = rects[r][3], 
+			overlay_uv_width = (overlay_width+1)/2, overlay_uv_height = (overlay_height+1)/2;
+		for(uint32_t i=0; i<y_stride*height; ++i)
+			y[i] = rng_next();
+		for(uint32_t i=0; i<uv_stride*uv_height; ++i)
+		{
+			u[i] = rng_next();
+			v[i] = rng_next();
+		}
+		for(uint32_t i=0; i<overlay_width*overlay_height; ++i)
+		{
+			const uint8_t value = rng_next();
+			for(uint32_t b=0; b<3; ++b)
+				rgba[4*i+b] = rng_next();
+			rgba[4*i+3] = overlay==OVERLAY_RGBA_OPAQUE ? 255 : overlay==OVERLAY_RGBA_TRANSPARENT ? 0 : 
+				value<64 ? 0 : value<128 ? 255 : rng_next();
+			oy[i] = rng_next();
+			oa[i] = rgba[4*i+3];
+		}
+		for(uint32_t i=0; i<overlay_uv_width*overlay_uv_height; ++i)
+		{
+			ou[i] = rng_next();
+			ov[i] = rng_next();
+		}
+		for(uint32_t j=0; j<height; ++j)
+			memcpy(nv12_y+j*y_stride, y+j*y_stride, y_stride);
+		for(uint32_t j=0; j<uv_height; ++j)
+		for(uint32_t i=0; i<uv_stride; ++i)
+		{
+			nv12_uv[j*2*uv_stride+2*i] = u[j*uv_stride+i];
+			nv12_uv[j*2*uv_stride+2*i+1] = v[j*uv_stride+i];
+		}
+		memcpy(expected_y, y, y_stride*height);
+		memcpy(expected_u, u, uv_stride*uv_height);
+		memcpy(expected_v, v, uv_stride*uv_height);
+		memcpy(result_y, y, y_stride*height);
+		memcpy(result_u, u, uv_stride*uv_height);
+		memcpy(result_v, v, uv_stride*uv_height);
+		reference_blend(overlay, overlay_width, overlay_height, rgba, oy, ou, ov, oa, expected_y, expected_u, expected_v, 
+			y_stride, uv_stride, left, top, yuv_type);
+		if(overlay==OVERLAY_YUVA)
+		{
+			kernel->yuv420_blend_yuva420(overlay_width, overlay_height, oy, ou, ov, oa, overlay_width, overlay_uv_width, 
+				result_y, result_u, result_v, y_stride, uv_stride, left, top);
+			kernel->nv12_blend_yuva420(overlay_width, overlay_height, oy, ou, ov, oa, overlay_width, overlay_uv_width, 
+				nv12_y, nv12_uv, y_stride, 2*uv_stride, left, top);
+		}
+		else
+		{
+			kernel->yuv420_blend_rgba32(overlay_width, overlay_height, rgba, overlay_width*4, 
+				result_y, result_u, result_v, y_stride, uv_stride, left, top, yuv_type);
+			kernel->nv12_blend_rgba32(overlay_width, overlay_height, rgba, overlay_width*4, 
+				nv12_y, nv12_uv, y_stride, 2*uv_stride, left, top, yuv_type);
+		}
+		
+		// pixels outside of the overlay are not modified, since the reference does not modify them
+		int error = 0;
+		for(uint32_t i=0; i<y_stride*height; ++i)
+		{
+			const int diff = abs(result_y[i]-expected_y[i]);
+			max_error = diff>max_error ? diff : max_error;
+			error |= diff>tolerance || nv12_y[i]!=result_y[i];
+		}
+		for(uint32_t i=0; i<uv_stride*uv_height; ++i)
+		{
+			const int diff_u = abs(result_u[i]-expected_u[i]), diff_v = abs(result_v[i]-expected_v[i]);
+			max_error = diff_u>max_error ? diff_u : max_error;
+			max_error = diff_v>max_error ? diff_v : max_error;
+			error |= diff_u>tolerance || diff_v>tolerance;
+			error |= nv12_uv[2*i]!=result_u[i] || nv12_uv[2*i+1]!=result_v[i];
+		}
+		if(overlay==OVERLAY_RGBA_TRANSPARENT)
+			error |= memcmp(result_y, y, y_stride*height)!=0 || memcmp(result_u, u, uv_stride*uv_height)!=0 || 
+				memcmp(result_v, v, uv_stride*uv_height)!=0;
+		// an opaque overlay of whole blocks is converted like by rgb32_yuv420
+		if(overlay==OVERLAY_RGBA_OPAQUE && left%2==0 && top%2==0 && overlay_width%2==0 && overlay_height%2==0)
+		{
+			rgb32_yuv420_std(overlay_width, overlay_height, rgba, overlay_width*4, opaque_y, opaque_u, opaque_v, 
+				overlay_width, overlay_uv_width, yuv_type);
+			for(uint32_t j=0; j<overlay_height; ++j)
+				error |= memcmp(result_y+(top+j)*y_stride+left, opaque_y+j*overlay_width, overlay_width)!=0;
+			for(uint32_t j=0; j<overlay_uv_height; ++j)
+				error |= memcmp(result_u+(top/2+j)*uv_stride+left/2, opaque_u+j*overlay_uv_width, overlay_uv_width)!=0 || 
+					memcmp(result_v+(top/2+j)*uv_stride+left/2, opaque_v+j*overlay_uv_width, overlay_uv_width)!=0;
+		}
+		// sse kernels must give the result of the std kernel
+		if(k>0)
+		{
+			memcpy(expected_y, y, y_stride*height);
+			memcpy(expected_u, u, uv_stride*uv_height);
+			memcpy(expected_v, v, uv_stride*uv_height);
+			if(overlay==OVERLAY_YUVA)
+				blend_kernels[0].yuv420_blend_yuva420(overlay_width, overlay_height, oy, ou, ov, oa, overlay_width, 
+					overlay_uv_width, expected_y, expected_u, expected_v, y_stride, uv_stride, left, top);
+			else
+				blend_kernels[0].yuv420_blend_rgba32(overlay_width, overlay_height, rgba, overlay_width*4, 
+					expected_y, expected_u, expected_v, y_stride, uv_stride, left, top, yuv_type);
+			error |= memcmp(result_y, expected_y, y_stride*height)!=0 || memcmp(result_u, expected_u, uv_stride*uv_height)!=0 || 
+				memcmp(result_v, expected_v, uv_stride*uv_height)!=0;
+		}
+
+		if(error)
+		{
+			printf("blend: FAILED, %ux%u at (%u, %u) %s %s %s\n", overlay_width, overlay_height, left, top, 
+				overlay_names[o], kernel->name, color_space_names[c]);
+			failures++;
+		}
+		cases++;
+	}
+	free(y);
+	free(u);
+	free(v);
+	free(expected_y);
+	free(expected_u);
+	free(expected_v);
+	free(result_y);
+	free(result_u);
+	free(result_v);
+	free(nv12_y);
+	free(nv12_uv);
+	free(rgba);
+	free(oy);
+	free(oa);
+	free(ou);
+	free(ov);
+	free(opaque_y);
+	free(opaque_u);
+	free(opaque_v);
+	if(!failures)
+		printf("blend: %u cases converted correctly, max error %d\n", cases, max_error);
+	return failures;
+}
+
+typedef void (*RgbToRgba)(uint32_t width, uint32_t height, const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, uint8_t alpha);
+typedef void (*PackedToPacked)(uint32_t width, uint32_t height, const uint8_t *src, uint32_t src_stride, 
+	uint8_t *dst, uint32_t dst_stride);
+typedef void (*PackedToPlanes)(uint32_t width, uint32_t height, const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *r, uint8_t *g, uint8_t *b, uint32_t planes_stride);
+typedef void (*PlanesToPacked)(uint32_t width, uint32_t height, const uint8_t *r, const uint8_t *g, const uint8_t *b, 
+	uint32_t planes_stride, uint8_t *rgb, uint32_t rgb_stride);
+
+typedef struct
+{
+	const char *name;
+	int aligned;
+	RgbToRgba rgb24_rgba32, rgb24_bgra32;
+	PackedToPacked rgba32_rgb24, bgra32_rgb24, rgb24_bgr24, rgba32_bgra32;
+	PackedToPlanes rgb24_rgb_planes;
+	PlanesToPacked rgb_planes_rgb24;
+} PackedKernels;
+
+static const PackedKernels packed_kernels[] = {
+	{"std", 0, rgb24_rgba32_std, rgb24_bgra32_std, rgba32_rgb24_std, bgra32_rgb24_std, rgb24_bgr24_std, 
+		rgba32_bgra32_std, rgb24_rgb_planes_std, rgb_planes_rgb24_std},
+#ifdef _YUVRGB_SSE2_
+	{"sse", 1, rgb24_rgba32_sse, rgb24_bgra32_sse, rgba32_rgb24_sse, bgra32_rgb24_sse, rgb24_bgr24_sse, 
+		rgba32_bgra32_sse, rgb24_rgb_planes_sse, rgb_planes_rgb24_sse},
+	{"sseu", 0, rgb24_rgba32_sseu, rgb24_bgra32_sseu, rgba32_rgb24_sseu, bgra32_rgb24_sseu, rgb24_bgr24_sseu, 
+		rgba32_bgra32_sseu, rgb24_rgb_planes_sseu, rgb_planes_rgb24_sseu},
+#endif
+};
+
+static int check_packed(void)
+{
+	static const uint32_t sizes[][2] = {{1, 1}, {5, 2}, {33, 3}, {64, 2}, {100, 5}};
+	int failures = 0;
+	uint32_t cases = 0;
+
+	for(uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+	for(uint32_t l=0; l<LAYOUT_NUMBER; ++l)
+	for(uint32_t k=0; k<sizeof(packed_kernels)/sizeof(packed_kernels[0]); ++k)
+	{
+		const PackedKernels *kernel = &packed_kernels[k];
+		const uint32_t width=sizes[s][0], height=sizes[s][1];
+		const size_t pixels=(size_t)width*height;
+		const uint8_t alpha = rng_next();
+		uint8_t *rgb = malloc(pixels*3), *rgba = malloc(pixels*4), *bgr = malloc(pixels*3), *bgra = malloc(pixels*4), 
+			*rgb_alpha = malloc(pixels*4), *bgr_alpha = malloc(pixels*4), *r = malloc(pixels), *g = malloc(pixels), *b = malloc(pixels);
+		for(size_t i=0; i<pixels; ++i)
+		{
+			r[i] = rgba[4*i] = bgra[4*i+2] = rgb[3*i] = bgr[3*i+2] = rng_next();
+			g[i] = rgba[4*i+1] = bgra[4*i+1] = rgb[3*i+1] = bgr[3*i+1] = rng_next();
+			b[i] = rgba[4*i+2] = bgra[4*i] = rgb[3*i+2] = bgr[3*i] = rng_next();
+			rgba[4*i+3] = bgra[4*i+3] = rng_next();
+			memcpy(rgb_alpha+4*i, rgb+3*i, 3);
+			memcpy(bgr_alpha+4*i, bgr+3*i, 3);
+			rgb_alpha[4*i+3] = bgr_alpha[4*i+3] = alpha;
+		}
+		Plane src24, src32, dst24, dst32, src_planes[3], dst_planes[3];
+		plane_alloc(&src24, width*3, height, (Layout)l, kernel->aligned);
+		plane_alloc(&src32, width*4, height, (Layout)l, kernel->aligned);
+		plane_alloc(&dst24, width*3, height, (Layout)l, kernel->aligned);
+		plane_alloc(&dst32, width*4, height, (Layout)l, kernel->aligned);
+		for(uint32_t p=0; p<3; ++p)
+		{
+			plane_alloc(&src_planes[p], width, height, (Layout)l, kernel->aligned);
+			plane_alloc(&dst_planes[p], width, height, (Layout)l, kernel->aligned);
+		}
+		plane_write(&src24, rgb);
+		plane_write(&src32, rgba);
+		plane_write(&src_planes[0], r);
+		plane_write(&src_planes[1], g);
+		plane_write(&src_planes[2], b);
+		int error = 0;
+
+		kernel->rgb24_rgba32(width, height, src24.data, src24.stride, dst32.data, dst32.stride, alpha);
+		error |= plane_differ(&dst32, rgb_alpha);
+		kernel->rgb24_bgra32(width, height, src24.data, src24.stride, dst32.data, dst32.stride, alpha);
+		error |= plane_differ(&dst32, bgr_alpha);
+		kernel->rgba32_rgb24(width, height, src32.data, src32.stride, dst24.data, dst24.stride);
+		error |= plane_differ(&dst24, rgb);
+		kernel->bgra32_rgb24(width, height, src32.data, src32.stride, dst24.data, dst24.stride);
+		error |= plane_differ(&dst24, bgr);
+		kernel->rgb24_bgr24(width, height, src24.data, src24.stride, dst24.data, dst24.stride);
+		error |= plane_differ(&dst24, bgr);
+		kernel->rgba32_bgra32(width, height, src32.data, src32.stride, dst32.data, dst32.stride);
+		error |= plane_differ(&dst32, bgra);
+		kernel->rgb24_rgb_planes(width, height, src24.data, src24.stride, 
+			dst_planes[0].data, dst_planes[1].data, dst_planes[2].data, dst_planes[0].stride);
+		error |= plane_differ(&dst_planes[0], r) || plane_differ(&dst_planes[1], g) || plane_differ(&dst_planes[2], b);
+		kernel->rgb_planes_rgb24(width, height, src_planes[0].data, src_planes[1].data, src_planes[2].data, 
+			src_planes[0].stride, dst24.data, dst24.stride);
+		error |= plane_differ(&dst24, rgb);
+		// in place channel swaps
+		kernel->rgb24_bgr24(width, height, src24.data, src24.stride, src24.data, src24.stride);
+		error |= plane_differ(&src24, bgr);
+		kernel->rgba32_bgra32(width, height, src32.data, src32.stride, src32.data, src32.stride);
+		error |= plane_differ(&src32, bgra);
+		error |= plane_check_guard(&src24)!=0 || plane_check_guard(&src32)!=0 || 
+			plane_check_guard(&dst24)!=0 || plane_check_guard(&dst32)!=0;
+		for(uint32_t p=0; p<3; ++p)
+			error |= plane_check_guard(&src_planes[p])!=0 || plane_check_guard(&dst_planes[p])!=0;
+
+		if(error)
+		{
+			printf("packed: FAILED, %ux%u %s %s\n", width, height, layout_names[l], kernel->name);
+			failures++;
+		}
+		cases++;
+		plane_free(&src24);
+		plane_free(&src32);
+		plane_free(&dst24);
+		plane_free(&dst32);
+		for(uint32_t p=0; p<3; ++p)
+		{
+			plane_free(&src_planes[p]);
+			plane_free(&dst_planes[p]);
+		}
+		free(rgb);
+		free(rgba);
+		free(bgr);
+		free(bgra);
+		free(rgb_alpha);
+		free(bgr_alpha);
+		free(r);
+		free(g);
+		free(b);
+	}
+
+	// through the batch api, rgb24 to rgb32 is opaque
+	{
+		const uint32_t width=70, height=9;
+		uint8_t *rgb = malloc(width*height*3), *rgba = malloc(width*height*4), *result = malloc(width*height*3);
+		for(uint32_t i=0; i<width*height*3; ++i)
+			rgb[i] = rng_next();
+		BatchFrame frames[2] = {
+			{width, height, PIXEL_FORMAT_RGB24, {rgb, NULL, NULL}, {width*3, 0, 0}, 
+				PIXEL_FORMAT_RGB32, {rgba, NULL, NULL}, {width*4, 0, 0}, YCBCR_601}, 
+			{width, height, PIXEL_FORMAT_RGB32, {rgba, NULL, NULL}, {width*4, 0, 0}, 
+				PIXEL_FORMAT_RGB24, {result, NULL, NULL}, {width*3, 0, 0}, YCBCR_601}};
+		int error = batch_convert(NULL, &frames[0], 1)!=0 || batch_convert(NULL, &frames[1], 1)!=0 || 
+			memcmp(rgb, result, width*height*3)!=0;
+		for(uint32_t i=0; i<width*height; ++i)
+			error |= rgba[4*i+3]!=255;
+		if(error)
+		{
+			printf("packed: FAILED, batch rgb24 to rgb32 and back\n");
+			failures++;
+		}
+		cases++;
+		free(rgb);
+		free(rgba);
+		free(result);
+	}
+	if(!failures)
+		printf("packed: %u cases converted correctly\n", cases);
+	return failures;
+}
+
+// grade a color with a lut in double precision, table values are in [0:65535]
+static void reference_lut3d(uint32_t size, const uint16_t *table, Lut3DInterpolation interpolation, const uint8_t *rgb, 
+	double *result)
+{
+	uint32_t index[3];
+	double f[3];
+	for(uint32_t i=0; i<3; ++i)
+	{
+		const double position = rgb[i]*(size-1)/255.0;
+		index[i] = position>=size-1 ? size-2 : (uint32_t)position;
+		f[i] = position-index[i];
+	}
+	// value of channel c at corner (dr, dg, db) of the cell
+	#define CORNER(dr, dg, db, c) (table[3*(((index[2]+(db))*size+index[1]+(dg))*size+index[0]+(dr))+(c)]*255.0/65535.0)
+	for(uint32_t c=0; c<3; ++c)
+	{
+		if(interpolation==LUT3D_TRILINEAR)
+		{
+			result[c] = 0.0;
+			for(uint32_t corner=0; corner<8; ++corner)
+			{
+				const uint32_t dr=corner&1, dg=(corner>>1)&1, db=corner>>2;
+				result[c] += CORNER(dr, dg, db, c)*(dr ? f[0] : 1.0-f[0])*(dg ? f[1] : 1.0-f[1])*(db ? f[2] : 1.0-f[2]);
+			}
+		}
+		else
+		{
+			// walk from the first corner to the last one, along axes by decreasing weight
+			uint32_t order[3] = {0, 1, 2}, d[3] = {0, 0, 0};
+			for(uint32_t i=0; i<3; ++i)
+			for(uint32_t j=i+1; j<3; ++j)
+				if(f[order[j]]>f[order[i]])
+				{
+					const uint32_t tmp = order[i];
+					order[i] = order[j];
+					order[j] = tmp;
+				}
+			result[c] = CORNER(0, 0, 0, c)*(1.0-f[order[0]]);
+			for(uint32_t i=0; i<3; ++i)
+			{
+				d[order[i]] = 1;
+				result[c] += CORNER(d[0], d[1], d[2], c)*(f[order[i]]-(i<2 ? f[order[i+1]] : 0.0));
+			}
+		}
+	}
+	#undef CORNER
+}
+
+static int check_lut3d(void)
+{
+	static const uint32_t lut_sizes[] = {2, 17, 33};
+	static const uint32_t sizes[][2] = {{2, 2}, {33, 17}, {100, 64}, {641, 45}, {6001, 5}};
+	static const char *const interpolation_names[] = {"trilinear", "tetrahedral"};
+	int failures = 0;
+	uint32_t cases = 0;
+
+	if(lut3d_create(1, NULL, LUT3D_TRILINEAR)!=NULL || lut3d_create(257, NULL, LUT3D_TRILINEAR)!=NULL)
+	{
+		printf("lut3d: FAILED, invalid size accepted\n");
+		failures++;
+	}
+	cases++;
+
+	for(uint32_t s=0; s<sizeof(lut_sizes)/sizeof(lut_sizes[0]); ++s)
+	for(uint32_t interpolation=LUT3D_TRILINEAR; interpolation<=LUT3D_TETRAHEDRAL; ++interpolation)
+	{
+		const uint32_t lut_size = lut_sizes[s];
+		uint16_t *identity = malloc(lut_size*lut_size*lut_size*3*sizeof(uint16_t)), 
+			*random = malloc(lut_size*lut_size*lut_size*3*sizeof(uint16_t));
+		for(uint32_t i=0; i<lut_size*lut_size*lut_size; ++i)
+		{
+			identity[3*i] = (i%lut_size)*65535/(lut_size-1);
+			identity[3*i+1] = (i/lut_size%lut_size)*65535/(lut_size-1);
+			identity[3*i+2] = (i/lut_size/lut_size)*65535/(lut_size-1);
+			for(uint32_t c=0; c<3; ++c)
+				random[3*i+c] = rng_next();
+		}
+		Lut3D *identity_lut = lut3d_create(lut_size, identity, (Lut3DInterpolation)interpolation), 
+			*random_lut = lut3d_create(lut_size, random, (Lut3DInterpolation)interpolation);
+
+		// all colors of a gray ramp and random colors, graded in place with a stride
+		const uint32_t width=256, height=64, stride=width*3+5;
+		uint8_t *rgb = malloc(stride*height), *identity_result = malloc(stride*height), *random_result = malloc(stride*height);
+		for(uint32_t i=0; i<stride*height; ++i)
+			rgb[i] = i<stride ? (i/3)&0xFF : rng_next();
+		memcpy(identity_result, rgb, stride*height);
+		memcpy(random_result, rgb, stride*height);
+		lut3d_apply_rgb24(identity_lut, width, height, identity_result, stride);
+		lut3d_apply_rgb24(random_lut, width, height, random_result, stride);
+		// interpolation weights have 8 bits, which is exact for the identity only with small cells
+		const int identity_tolerance = lut_size<17 ? 1 : 0;
+		int error = 0;
+		for(uint32_t y=0; y<height; ++y)
+		{
+			for(uint32_t x=0; x<width*3; x+=3)
+			{
+				const uint32_t i = y*stride+x;
+				double expected[3];
+				reference_lut3d(lut_size, random, (Lut3DInterpolation)interpolation, rgb+i, expected);
+				for(uint32_t c=0; c<3; ++c)
+					error |= abs(identity_result[i+c]-rgb[i+c])>identity_tolerance || 
+						abs(random_result[i+c]-clamp_round(expected[c]))>1;
+			}
+			error |= memcmp(identity_result+y*stride+width*3, rgb+y*stride+width*3, stride-width*3)!=0;
+		}
+		if(error)
+		{
+			printf("lut3d: FAILED, apply with size %u %s\n", lut_size, interpolation_names[interpolation]);
+			failures++;
+		}
+		cases++;
+		free(rgb);
+		free(identity_result);
+		free(random_result);
+
+		// fused conversion gives the result of the conversion followed by grading, last column and line of odd 
+		// sizes are not modified
+		for(uint32_t f=0; f<sizeof(sizes)/sizeof(sizes[0]); ++f)
+		for(uint32_t format=0; format<2; ++format)
+		{
+			const uint32_t width = sizes[f][0]+(format^(f&1)), height = sizes[f][1]+format, 
+				uv_width = (width+1)/2, uv_height = (height+1)/2, 
+				y_stride = width+3, uv_stride = 2*uv_width+7, rgb_stride = width*3+11;
+			const YCbCrType yuv_type = (YCbCrType)((f+format+s)%COLOR_SPACE_NUMBER);
+			uint8_t *y = malloc(y_stride*height), *uv = malloc(uv_stride*uv_height), 
+				*result = malloc(rgb_stride*height), *expected = malloc(rgb_stride*height);
+			for(uint32_t i=0; i<y_stride*height; ++i)
+				y[i] = rng_next();
+			for(uint32_t i=0; i<uv_stride*uv_height; ++i)
+				uv[i] = rng_next();
+			memset(result, 0x5A, rgb_stride*height);
+			memset(expected, 0x5A, rgb_stride*height);
+			// yuv420 planes share the chroma buffer
+			BatchFrame frame = format==0 ? 
+				(BatchFrame){width, height, PIXEL_FORMAT_YUV420, {y, uv, uv+uv_width}, {y_stride, uv_stride, uv_stride}, 
+					PIXEL_FORMAT_RGB24, {expected, NULL, NULL}, {rgb_stride, 0, 0}, yuv_type} : 
+				(BatchFrame){width, height, PIXEL_FORMAT_NV12, {y, uv, NULL}, {y_stride, uv_stride, 0}, 
+					PIXEL_FORMAT_RGB24, {expected, NULL, NULL}, {rgb_stride, 0, 0}, yuv_type};
+			error = batch_convert(NULL, &frame, 1)!=0;
+			lut3d_apply_rgb24(random_lut, width&~1u, height&~1u, expected, rgb_stride);
+			frame.dst[0] = result;
+			error |= lut3d_convert(random_lut, &frame)!=0 || memcmp(result, expected, rgb_stride*height)!=0;
+			for(uint32_t j=0; j<height; ++j)
+				error |= (width%2 && (result[j*rgb_stride+width*3-3]!=0x5A || result[j*rgb_stride+width*3-1]!=0x5A)) || 
+					(height%2 && j==height-1 && result[j*rgb_stride]!=0x5A);
+			frame.dst_format = PIXEL_FORMAT_RGB32;
+			error |= lut3d_convert(random_lut, &frame)!=-1;
+			frame.src_format = PIXEL_FORMAT_RGB32;
+			frame.dst_format = PIXEL_FORMAT_RGB24;
+			error |= lut3d_convert(random_lut, &frame)!=-1;
+			if(error)
+			{
+				printf("lut3d: FAILED, convert %ux%u %s with size %u %s\n", width, height, format==0 ? "yuv420" : "nv12", 
+					lut_size, interpolation_names[interpolation]);
+				failures++;
+			}
+			cases++;
+			free(y);
+			free(uv);
+			free(result);
+			free(expected);
+		}
+
+		lut3d_destroy(identity_lut);
+		lut3d_destroy(random_lut);
+		free(identity);
+		free(random);
+	}
+	if(!failures)
+		printf("lut3d: %u cases converted correctly\n", cases);
+	return failures;
+}
+
+static double reference_eotf(TransferFunction transfer, double value)
+{
+	if(transfer==TRANSFER_SRGB)
+		return value<=0.04045 ? value/12.92 : pow((value+0.055)/1.055, 2.4);
+	return pow(value, 2.4);
+}
+
+static double reference_inverse_eotf(TransferFunction transfer, double value)
+{
+	// values below 2^-24 are rounded up to 2^-24 by the conversion
+	value = value>0x1p-24 ? (value<1.0 ? value : 1.0) : 0x1p-24;
+	if(transfer==TRANSFER_SRGB)
+		return value<=0.0031308 ? value*12.92 : 1.055*pow(value, 1.0/2.4)-0.055;
+	return pow(value, 1.0/2.4);
+}
+
+// true if value is value_exact rounded to the nearest 8 bits value, with a margin for single precision
+static int rounded_from(uint8_t value, double value_exact)
+{
+	value_exact = value_exact<0.0 ? 0.0 : value_exact>255.0 ? 255.0 : value_exact;
+	return fabs(value-value_exact)<=0.5+1e-3;
+}
+
+static float half_to_float(uint16_t half)
+{
+	const uint32_t exponent = (half>>10)&0x1F, mantissa = half&0x3FF;
+	const float value = exponent==0 ? ldexpf(mantissa, -24) : ldexpf(mantissa|0x400, exponent-25);
+	return half&0x8000 ? -value : value;
+}
+
+static int check_linear(void)
+{
+	static const uint32_t sizes[][2] = {{2, 2}, {33, 17}, {64, 8}, {101, 45}};
+	static const char *const transfer_names[] = {"srgb", "bt1886"};
+	// the EOTF table has 16 entries per 8 bits level, the matrix products have 8 fractional bits, and the 
+	// largest slope of the EOTF is 2.4
+	const double tolerance = 2.4*(1.0/32+3.0/512)/255.0+1e-6;
+	int failures = 0;
+	uint32_t cases = 0;
+	double max_error = 0.0;
+
+	for(uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+	for(uint32_t c=0; c<COLOR_SPACE_NUMBER; ++c)
+	for(uint32_t t=TRANSFER_SRGB; t<=TRANSFER_BT1886; ++t)
+	{
+		const YCbCrType yuv_type = (YCbCrType)c;
+		const TransferFunction transfer = (TransferFunction)t;
+		const ColorSpace *space = &color_spaces[c];
+		const uint32_t width = sizes[s][0], height = sizes[s][1], uv_width = (width+1)/2, uv_height = (height+1)/2, 
+			y_stride = width+5, uv_stride = uv_width+3, rgba_stride = width*16+20, half_stride = width*8+12;
+		uint8_t *y = malloc(y_stride*height), *u = malloc(uv_stride*uv_height), *v = malloc(uv_stride*uv_height), 
+			*uv = malloc(2*uv_stride*uv_height), *y2 = malloc(y_stride*height), *u2 = malloc(uv_stride*uv_height), 
+			*v2 = malloc(uv_stride*uv_height);
+		float *rgba = malloc(rgba_stride*height), *nv12_rgba = malloc(rgba_stride*height);
+		uint16_t *half = malloc(half_stride*height), *nv12_half = malloc(half_stride*height);
+		for(uint32_t i=0; i<y_stride*height; ++i)
+			y[i] = rng_next();
+		for(uint32_t i=0; i<uv_stride*uv_height; ++i)
+		{
+			u[i] = uv[2*i] = rng_next();
+			v[i] = uv[2*i+1] = rng_next();
+		}
+		memset(rgba, 0, rgba_stride*height);
+		memset(nv12_rgba, 0, rgba_stride*height);
+		memset(half, 0, half_stride*height);
+		memset(nv12_half, 0, half_stride*height);
+		yuv420_rgbaf32_std(width, height, y, u, v, y_stride, uv_stride, rgba, rgba_stride, transfer, yuv_type);
+		nv12_rgbaf32_std(width, height, y, uv, y_stride, 2*uv_stride, nv12_rgba, rgba_stride, transfer, yuv_type);
+		yuv420_rgbaf16_std(width, height, y, u, v, y_stride, uv_stride, half, half_stride, transfer, yuv_type);
+		nv12_rgbaf16_std(width, height, y, uv, y_stride, 2*uv_stride, nv12_half, half_stride, transfer, yuv_type);
+
+		int error = memcmp(rgba, nv12_rgba, rgba_stride*height)!=0 || memcmp(half, nv12_half, half_stride*height)!=0;
+		for(uint32_t j=0; j<height; ++j)
+		for(uint32_t i=0; i<width; ++i)
+		{
+			const float *pixel = (const float *)((const uint8_t *)rgba+j*rgba_stride)+4*i;
+			const uint16_t *half_pixel = (const uint16_t *)((const uint8_t *)half+j*half_stride)+4*i;
+			// last column and line of odd sizes are not converted
+			if((i==width-1 && width%2) || (j==height-1 && height%2))
+			{
+				error |= pixel[0]!=0.0f || half_pixel[0]!=0;
+				continue;
+			}
+			const double cb = u[j/2*uv_stride+i/2]-128.0, cr = v[j/2*uv_stride+i/2]-128.0, 
+				luma = (y[j*y_stride+i]-space->y_min)/(space->y_max-space->y_min), 
+				cb_scale = 2.0*(1.0-space->bf)/space->cbcr_range, cr_scale = 2.0*(1.0-space->rf)/space->cbcr_range, 
+				gf = 1.0-space->rf-space->bf;
+			const double nonlinear[3] = {luma + cr*cr_scale, luma - (space->rf*cr*cr_scale + space->bf*cb*cb_scale)/gf, 
+				luma + cb*cb_scale};
+			for(uint32_t k=0; k<3; ++k)
+			{
+				const double expected = reference_eotf(transfer, nonlinear[k]<0.0 ? 0.0 : nonlinear[k]>1.0 ? 1.0 : nonlinear[k]), 
+					diff = fabs(pixel[k]-expected);
+				max_error = diff>max_error ? diff : max_error;
+				error |= diff>tolerance;
+				// half values are the rounded float values
+				error |= fabsf(half_to_float(half_pixel[k])-pixel[k])>pixel[k]/2048.0f+1.0f/(1<<25);
+			}
+			error |= pixel[3]!=1.0f || half_pixel[3]!=0x3C00;
+		}
+
+		// linear values, including out of range ones, back to yuv420
+		for(uint32_t j=0; j<height; ++j)
+		for(uint32_t i=0; i<width*4; ++i)
+		{
+			float *value = (float *)((uint8_t *)rgba+j*rgba_stride)+i;
+			const uint32_t random = rng_next()%64;
+			*value = random==0 ? -0.5f : random==1 ? 2.0f : random==2 ? 1e-9f : random==3 ? NAN : (rng_next()%65536)/65535.0f;
+			*value = random>=32 ? *value**value**value : *value;
+		}
+		memset(y2, 0, y_stride*height);
+		memset(u2, 0, uv_stride*uv_height);
+		memset(v2, 0, uv_stride*uv_height);
+		rgbaf32_yuv420_std(width, height, rgba, rgba_stride, y2, u2, v2, y_stride, uv_stride, transfer, yuv_type);
+		for(uint32_t j=0; j<height-height%2; j+=2)
+		for(uint32_t i=0; i<width-width%2; i+=2)
+		{
+			double cb_sum = 0.0, cr_sum = 0.0;
+			for(uint32_t k=0; k<4; ++k)
+			{
+				const float *pixel = (const float *)((const uint8_t *)rgba+(j+k/2)*rgba_stride)+4*(i+k%2);
+				double nonlinear[3];
+				for(uint32_t l=0; l<3; ++l)
+					nonlinear[l] = reference_inverse_eotf(transfer, isnan(pixel[l]) ? 0.0 : pixel[l]);
+				const double luma = space->rf*nonlinear[0] + (1.0-space->rf-space->bf)*nonlinear[1] + space->bf*nonlinear[2];
+				error |= !rounded_from(y2[(j+k/2)*y_stride+i+k%2], luma*(space->y_max-space->y_min)+space->y_min);
+				cb_sum += nonlinear[2]-luma;
+				cr_sum += nonlinear[0]-luma;
+			}
+			error |= !rounded_from(u2[j/2*uv_stride+i/2], cb_sum/4.0*space->cbcr_range/(2.0*(1.0-space->bf))+128.0);
+			error |= !rounded_from(v2[j/2*uv_stride+i/2], cr_sum/4.0*space->cbcr_range/(2.0*(1.0-space->rf))+128.0);
+		}
+		if(width%2)
+			for(uint32_t j=0; j<height; ++j)
+				error |= y2[j*y_stride+width-1]!=0;
+
+		if(error)
+		{
+			printf("linear: FAILED, %ux%u %s %s\n", width, height, transfer_names[t], color_space_names[c]);
+			failures++;
+		}
+		cases++;
+		free(y);
+		free(u);
+		free(v);
+		free(uv);
+		free(y2);
+		free(u2);
+		free(v2);
+		free(rgba);
+		free(nv12_rgba);
+		free(half);
+		free(nv12_half);
+	}
+	if(!failures)
+		printf("linear: %u cases converted correctly, max error %g\n", cases, max_error);
+	return failures;
+}
+
+typedef void (*P010ToRgb)(uint32_t width, uint32_t height, const uint16_t *y, const uint16_t *uv, 
+	uint32_t y_stride, uint32_t uv_stride, uint8_t *rgb, uint32_t rgb_stride, const HdrToneMap *tone_map);
+typedef void (*Yuv420p10ToRgb)(uint32_t width, uint32_t height, const uint16_t *y, const uint16_t *u, const uint16_t *v, 
+	uint32_t y_stride, uint32_t uv_stride, uint8_t *rgb, uint32_t rgb_stride, const HdrToneMap *tone_map);
+
+typedef struct
+{
+	const char *name;
+	P010ToRgb p010_rgb24, p010_rgba32;
+	Yuv420p10ToRgb yuv420p10_rgb24, yuv420p10_rgba32;
+} HdrKernels;
+
+static const HdrKernels hdr_kernels[] = {
+	{"std", p010_rgb24_std, p010_rgba32_std, yuv420p10_rgb24_std, yuv420p10_rgba32_std},
+#ifdef _YUVRGB_SSE2_
+	{"sseu", p010_rgb24_sseu, p010_rgba32_sseu, yuv420p10_rgb24_sseu, yuv420p10_rgba32_sseu},
+#endif
+};
+
+// tone mapped linear value in [0:1] of a nonlinear value in [0:1]
+static double reference_hdr_linear(HdrTransfer transfer, double peak, double value)
+{
+	double luminance;
+	value = value<0.0 ? 0.0 : value>1.0 ? 1.0 : value;
+	if(transfer==HDR_TRANSFER_PQ)
+	{
+		const double m1 = 0.1593017578125, m2 = 78.84375, c1 = 0.8359375, c2 = 18.8515625, c3 = 18.6875;
+		const double p = pow(value, 1.0/m2);
+		luminance = 10000.0*pow(fmax(p-c1, 0.0)/(c2-c3*p), 1.0/m1);
+	}
+	else
+	{
+		const double a = 0.17883277, b = 0.28466892, c = 0.55991073;
+		const double scene = value<=0.5 ? value*value/3.0 : (exp((value-c)/a)+b)/12.0;
+		luminance = peak*pow(scene, 1.2*pow(1.111, log2(peak/1000.0)));
+	}
+	// luminances up to 0.75 of the 203 cd/m2 reference white are kept, and higher ones are compressed so that 
+	// the peak maps to 1
+	const double x = luminance/203.0, w = peak/203.0;
+	if(x<=0.75 || w<=1.0)
+		return x<1.0 ? x : 1.0;
+	if(x>=w)
+		return 1.0;
+	const double u = (x-0.75)/0.25, m = (w-0.75)/0.25;
+	return 0.75 + 0.25*u*(1.0+u/(m*m))/(1.0+u);
+}
+
+// HDR conversions must give the double precision result within the errors of their fixed point steps, and all 
+// kernels and layouts must give the same results
+static int check_hdr(void)
+{
+	static const uint32_t sizes[][2] = {{2, 2}, {33, 17}, {64, 8}, {101, 45}};
+	static const float peaks[] = {100.0f, 1000.0f, 4000.0f};
+	static const char *const hdr_names[] = {"pq", "hlg"};
+	static const char *const transfer_names[] = {"srgb", "bt1886"};
+	// BT.2020 to BT.709 primaries matrix (ITU-R BT.2087)
+	static const double gamut[3][3] = {
+		{1.6605, -0.5876, -0.0728}, 
+		{-0.1246, 1.1329, -0.0083}, 
+		{-0.0182, -0.1006, 1.1187}};
+	const ColorSpace *space = &color_spaces[YCBCR_2020];
+	// nonlinear values are off by at most 3 of 4095 (three floored products), and linear values by the rounding 
+	// of the matrix to 12 bits and of the tables and matrix products to 14 bits
+	const double nonlinear_tolerance = 3.0/4095.0, linear_tolerance = 1.5/4096.0 + 3.0/16383.0;
+	int failures = 0;
+	uint32_t cases = 0;
+
+	const float invalid_peaks[] = {0.0f, -100.0f, NAN, INFINITY};
+	for(uint32_t i=0; i<sizeof(invalid_peaks)/sizeof(invalid_peaks[0]); ++i)
+	{
+		HdrToneMap *tone_map = hdr_tone_map_create(HDR_TRANSFER_PQ, invalid_peaks[i], TRANSFER_SRGB);
+		if(tone_map)
+		{
+			printf("hdr: FAILED, tone map created with peak luminance %g\n", invalid_peaks[i]);
+			hdr_tone_map_destroy(tone_map);
+			failures++;
+		}
+	}
+
+	for(uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+	for(uint32_t h=HDR_TRANSFER_PQ; h<=HDR_TRANSFER_HLG; ++h)
+	for(uint32_t p=0; p<sizeof(peaks)/sizeof(peaks[0]); ++p)
+	for(uint32_t t=TRANSFER_SRGB; t<=TRANSFER_BT1886; ++t)
+	{
+		const HdrTransfer hdr_transfer = (HdrTransfer)h;
+		const TransferFunction transfer = (TransferFunction)t;
+		const double peak = peaks[p];
+		const uint32_t width = sizes[s][0], height = sizes[s][1], uv_width = (width+1)/2, uv_height = (height+1)/2, 
+			y_stride = 2*width+6, uv_stride = 2*uv_width+4, p010_uv_stride = 4*uv_width+8, 
+			rgb_stride = width*3+5, rgba_stride = width*4+12;
+		uint16_t *y = malloc(y_stride*height), *u = malloc(uv_stride*uv_height), *v = malloc(uv_stride*uv_height), 
+			*p010_y = malloc(y_stride*height), *p010_uv = malloc(p010_uv_stride*uv_height);
+		uint8_t *expected_rgb = malloc(rgb_stride*height), *rgb = malloc(rgb_stride*height), 
+			*rgba = malloc(rgba_stride*height);
+		// random samples, with black, white and out of range values, and random bits around the 10 bits values
+		uint16_t samples[3][256];
+		for(uint32_t i=0; i<256; ++i)
+			for(uint32_t c=0; c<3; ++c)
+			{
+				const uint32_t random = rng_next()%16;
+				samples[c][i] = random==0 ? 0 : random==1 ? 1023 : random==2 ? (c==0 ? 64 : 512) : 
+					random==3 ? (c==0 ? 940 : 960) : (rng_next()|(rng_next()<<8))%1024;
+			}
+		for(uint32_t j=0; j<height; ++j)
+		for(uint32_t i=0; i<y_stride/2; ++i)
+		{
+			const uint16_t value = samples[0][rng_next()%256];
+			y[j*y_stride/2+i] = value|((rng_next()%64)<<10);
+			p010_y[j*y_stride/2+i] = (value<<6)|(rng_next()%64);
+		}
+		for(uint32_t j=0; j<uv_height; ++j)
+		for(uint32_t i=0; i<uv_stride/2; ++i)
+		{
+			const uint16_t u_value = samples[1][rng_next()%256], v_value = samples[2][rng_next()%256];
+			u[j*uv_stride/2+i] = u_value|((rng_next()%64)<<10);
+			v[j*uv_stride/2+i] = v_value|((rng_next()%64)<<10);
+			p010_uv[j*p010_uv_stride/2+2*i] = (u_value<<6)|(rng_next()%64);
+			p010_uv[j*p010_uv_stride/2+2*i+1] = (v_value<<6)|(rng_next()%64);
+		}
+
+		HdrToneMap *tone_map = hdr_tone_map_create(hdr_transfer, peaks[p], transfer);
+		int error = 0;
+		memset(expected_rgb, 0, rgb_stride*height);
+		yuv420p10_rgb24_std(width, height, y, u, v, y_stride, uv_stride, expected_rgb, rgb_stride, tone_map);
+		for(uint32_t k=0; k<sizeof(hdr_kernels)/sizeof(hdr_kernels[0]) && !error; ++k)
+		for(uint32_t l=0; l<4 && !error; ++l)
+		{
+			const HdrKernels *kernels = &hdr_kernels[k];
+			const uint32_t pixel_size = l%2 ? 4 : 3, stride = l%2 ? rgba_stride : rgb_stride;
+			uint8_t *result = l%2 ? rgba : rgb;
+			memset(result, 0, stride*height);
+			if(l==0)
+				kernels->yuv420p10_rgb24(width, height, y, u, v, y_stride, uv_stride, result, stride, tone_map);
+			else if(l==1)
+				kernels->yuv420p10_rgba32(width, height, y, u, v, y_stride, uv_stride, result, stride, tone_map);
+			else if(l==2)
+				kernels->p010_rgb24(width, height, p010_y, p010_uv, y_stride, p010_uv_stride, result, stride, tone_map);
+			else
+				kernels->p010_rgba32(width, height, p010_y, p010_uv, y_stride, p010_uv_stride, result, stride, tone_map);
+			for(uint32_t j=0; j<height; ++j)
+			for(uint32_t i=0; i<width; ++i)
+			{
+				const uint8_t *pixel = result+j*stride+i*pixel_size;
+				for(uint32_t c=0; c<3; ++c)
+					error |= pixel[c]!=expected_rgb[j*rgb_stride+3*i+c];
+				// last column and line of odd sizes are not converted
+				const int converted = !((i==width-1 && width%2) || (j==height-1 && height%2));
+				if(pixel_size==4)
+					error |= pixel[3]!=(converted ? 255 : 0);
+			}
+			if(error)
+				printf("hdr: FAILED, %s differs from std, %ux%u %s %s\n", kernels->name, width, height, 
+					l<2 ? "yuv420p10" : "p010", l%2 ? "rgba32" : "rgb24");
+		}
+
+		for(uint32_t j=0; j<height-height%2; ++j)
+		for(uint32_t i=0; i<width-width%2; ++i)
+		{
+			const double luma = ((y[j*y_stride/2+i]&0x3FF)-64.0)/876.0, 
+				cb = ((u[j/2*uv_stride/2+i/2]&0x3FF)-512.0)/896.0, cr = ((v[j/2*uv_stride/2+i/2]&0x3FF)-512.0)/896.0, 
+				gf = 1.0-space->rf-space->bf;
+			const double nonlinear[3] = {luma + 2.0*(1.0-space->rf)*cr, 
+				luma - 2.0*(space->rf*(1.0-space->rf)*cr + space->bf*(1.0-space->bf)*cb)/gf, 
+				luma + 2.0*(1.0-space->bf)*cb};
+			// tone mapped linear values are increasing with nonlinear values
+			double low[3], high[3];
+			for(uint32_t c=0; c<3; ++c)
+			{
+				low[c] = reference_hdr_linear(hdr_transfer, peak, nonlinear[c]-nonlinear_tolerance);
+				high[c] = reference_hdr_linear(hdr_transfer, peak, nonlinear[c]+nonlinear_tolerance);
+			}
+			for(uint32_t c=0; c<3; ++c)
+			{
+				double low_709 = -linear_tolerance, high_709 = linear_tolerance;
+				for(uint32_t k=0; k<3; ++k)
+				{
+					low_709 += gamut[c][k]*(gamut[c][k]>0.0 ? low[k] : high[k]);
+					high_709 += gamut[c][k]*(gamut[c][k]>0.0 ? high[k] : low[k]);
+				}
+				// linear values that are rounded to the sdr value
+				const uint8_t value = expected_rgb[j*rgb_stride+3*i+c];
+				const double value_low = value==0 ? -1.0 : reference_eotf(transfer, (value-0.5)/255.0), 
+					value_high = value==255 ? 2.0 : reference_eotf(transfer, (value+0.5)/255.0);
+				if(high_709<value_low-1e-9 || low_709>value_high+1e-9)
+				{
+					if(!error)
+						printf("hdr: FAILED, %ux%u %s %g %s, at (%u, %u) component %u is %u, expected linear value "
+							"in [%g:%g]\n", width, height, hdr_names[h], peak, transfer_names[t], i, j, c, value, 
+							low_709, high_709);
+					error = 1;
+				}
+			}
+		}
+
+		if(error)
+			failures++;
+		cases++;
+		hdr_tone_map_destroy(tone_map);
+		free(y);
+		free(u);
+		free(v);
+		free(p010_y);
+		free(p010_uv);
+		free(expected_rgb);
+		free(rgb);
+		free(rgba);
+	}
+	if(!failures)
+		printf("hdr: %u cases converted correctly\n", cases);
+	return failures;
+}
+
+int main(int argc, char **argv)
+{
+	int tolerance = 3;
+	int verbose = 0;
+	for(int i=1; i<argc; ++i)
+	{
+		if(strcmp(argv[i], "-v")==0)
+			verbose = 1;
+		else if(strcmp(argv[i], "-t")==0 && i+1<argc)
+			tolerance = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-s")==0 && i+1<argc)
+			rng_state = strtoul(argv[++i], NULL, 10) | 1;
+		else
+		{
+			printf("Usage : check_yuv_rgb [-v] [-t <tolerance>] [-s <seed>]\n");
+			printf("  -v : print results for each tested configuration\n");
+			printf("  -t : maximum allowed error compared to double precision conversion (default %d)\n", tolerance);
+			printf("  -s : seed of the random frame generator\n");
+			return 1;
+		}
+	}
+
+	static KernelStats stats[KERNEL_NUMBER][COLOR_SPACE_NUMBER];
+	memset(stats, 0, sizeof(stats));
+
+	for(uint32_t wi=0; wi<sizeof(widths)/sizeof(widths[0]); ++wi)
+	for(uint32_t hi=0; hi<sizeof(heights)/sizeof(heights[0]); ++hi)
+	for(uint32_t pi=0; pi<PATTERN_NUMBER; ++pi)
+	for(uint32_t ci=0; ci<COLOR_SPACE_NUMBER; ++ci)
+	{
+		const uint32_t width=widths[wi], height=heights[hi];
+		const Pattern pattern = (Pattern)pi;
+		const YCbCrType yuv_type = (YCbCrType)ci;
+		uint32_t k=0;
+		while(k<KERNEL_NUMBER)
+		{
+			// process all kernels of the same conversion on the same source frame
+			const Conversion conversion = kernels[k].conversion;
+			uint32_t k_end=k;
+			while(k_end<KERNEL_NUMBER && kernels[k_end].conversion==conversion)
+				k_end++;
+
+			Image src, expected, results[MAX_VARIANTS];
+			source_alloc(&src, conversion, width, height);
+			generate_pattern(&src, pattern, !is_yuv2rgb(conversion));
+			destination_alloc(&expected, conversion, width, height);
+			for(uint32_t kk=k; kk<k_end; ++kk)
+				destination_alloc(&results[kk-k], conversion, width, height);
+			reference_convert(conversion, &src, &expected, yuv_type);
+
+			for(uint32_t layout=0; layout<LAYOUT_NUMBER; ++layout)
+			{
+				for(uint32_t kk=k; kk<k_end; ++kk)
+				{
+					const Kernel *kernel = &kernels[kk];
+					KernelStats *ks = &stats[kk][ci];
+					if(width<kernel->block_width || !kernel_supported(kernel))
+					{
+						ks->skipped++;
+						continue;
+					}
+
+					Image *result = &results[kk-k];
+					Plane src_planes[3], dst_planes[3];
+					for(uint32_t p=0; p<src.plane_number; ++p)
+					{
+						plane_alloc(&src_planes[p], src.line_size[p], src.lines[p], (Layout)layout, kernel->aligned);
+						plane_write(&src_planes[p], src.plane[p]);
+					}
+					for(uint32_t p=0; p<result->plane_number; ++p)
+						plane_alloc(&dst_planes[p], result->line_size[p], result->lines[p], (Layout)layout, kernel->aligned);
+
+					run_variant(kernel, width, height, src_planes, dst_planes, yuv_type);
+
+					uint64_t guard_errors = 0;
+					for(uint32_t p=0; p<src.plane_number; ++p)
+					{
+						guard_errors += plane_check_guard(&src_planes[p]);
+						plane_free(&src_planes[p]);
+					}
+					for(uint32_t p=0; p<result->plane_number; ++p)
+					{
+						guard_errors += plane_check_guard(&dst_planes[p]);
+						plane_read(&dst_planes[p], result->plane[p]);
+						plane_free(&dst_planes[p]);
+					}
+
+					KernelStats case_stats;
+					memset(&case_stats, 0, sizeof(case_stats));
+					compare(kernel, result, &expected, width, height, pattern, (Layout)layout, &case_stats, 0);
+					if(kk>k && width>=kernels[k].block_width)
+						compare(kernel, result, &results[0], width, height, pattern, (Layout)layout, &case_stats, 1);
+					// bit exactness is checked against the first tested kernel of the same group
+					for(uint32_t kj=k; kj<kk; ++kj)
+					{
+						if(kernels[kj].exact_group==kernel->exact_group && width>=kernels[kj].block_width && kernel_supported(&kernels[kj]))
+						{
+							KernelStats exact_stats;
+							memset(&exact_stats, 0, sizeof(exact_stats));
+							compare(kernel, result, &results[kj-k], width, height, pattern, (Layout)layout, &exact_stats, 1);
+							if(exact_stats.has_divergence && !ks->has_exact_failure)
+							{
+								ks->has_exact_failure = 1;
+								ks->exact_reference = kj;
+								ks->first_exact_failure = exact_stats.first_divergence;
+							}
+							break;
+						}
+					}
+
+					if(verbose)
+					{
+						printf("%s_%s %s %ux%u %s %s: max error %d, mean error %.3f", conversion_names[conversion], kernel->name,
+							color_space_names[ci], width, height, pattern_names[pattern], layout_names[layout], case_stats.max_error,
+							case_stats.count ? (double)case_stats.error_sum/case_stats.count : 0.0);
+						if(case_stats.has_divergence)
+							printf(", %llu values differ from %s", (unsigned long long)case_stats.diverging, kernels[k].name);
+						if(guard_errors)
+							printf(", %llu bytes written out of image", (unsigned long long)guard_errors);
+						printf("\n");
+					}
+
+					// accumulate
+					ks->tested++;
+					ks->guard_errors += guard_errors;
+					if(case_stats.count && (ks->count==0 || case_stats.max_error>ks->max_error))
+					{
+						ks->max_error = case_stats.max_error;
+						ks->max_location = case_stats.max_location;
+					}
+					ks->count += case_stats.count;
+					ks->error_sum += case_stats.error_sum;
+					if(case_stats.has_divergence && !ks->has_divergence)
+					{
+						ks->has_divergence = 1;
+						ks->first_divergence = case_stats.first_divergence;
+					}
+					ks->diverging += case_stats.diverging;
+					if(case_stats.max_divergence>ks->max_divergence)
+						ks->max_divergence = case_stats.max_divergence;
+				}
+			}
+
+			image_free(&src);
+			image_free(&expected);
+			for(uint32_t kk=k; kk<k_end; ++kk)
+				image_free(&results[kk-k]);
+			k = k_end;
+		}
+	}
+
+	// report
+	int failures = 0;
+	for(uint32_t k=0; k<KERNEL_NUMBER; ++k)
+	{
+		const Kernel *kernel = &kernels[k];
+		const int to_rgb = is_yuv2rgb(kernel->conversion);
+		uint32_t first=k;
+		while(first>0 && kernels[first-1].conversion==kernel->conversion)
+			first--;
+		for(uint32_t ci=0; ci<COLOR_SPACE_NUMBER; ++ci)
+		{
+			const KernelStats *ks = &stats[k][ci];
+			printf("%s_%s %s: %llu tests", conversion_names[kernel->conversion], kernel->name, color_space_names[ci],
+				(unsigned long long)ks->tested);
+			if(ks->skipped)
+				printf(" (%llu skipped)", (unsigned long long)ks->skipped);
+			if(ks->tested==0)
+			{
+				printf("\n");
+				continue;
+			}
+			printf(", max error %d, mean error %.3f\n", ks->max_error, ks->count ? (double)ks->error_sum/ks->count : 0.0);
+			if(ks->max_error>0)
+			{
+				printf("    worst: ");
+				print_location(&ks->max_location, to_rgb);
+				printf("\n");
+			}
+			if(ks->has_divergence)
+			{
+				printf("    diverges from %s on %llu values (max difference %d), first: ", kernels[first].name,
+					(unsigned long long)ks->diverging, ks->max_divergence);
+				print_location(&ks->first_divergence, to_rgb);
+				printf("\n");
+			}
+			if(ks->guard_errors)
+			{
+				printf("    FAILED: %llu bytes written outside of image\n", (unsigned long long)ks->guard_errors);
+				failures++;
+			}
+			if(ks->max_error>tolerance)
+			{
+				printf("    FAILED: max error above tolerance (%d)\n", tolerance);
+				failures++;
+			}
+			if(ks->has_exact_failure)
+			{
+				printf("    FAILED: should be bit exact with %s, first difference: ", kernels[ks->exact_reference].name);
+				print_location(&ks->first_exact_failure, to_rgb);
+				printf("\n");
+				failures++;
+			}
+		}
+	}
+
+	failures += check_alloc();
+	failures += check_batch(0);
+	failures += check_batch(1);
+	failures += check_batch(4);
+	failures += check_plan();
+	failures += check_wisdom();
+	failures += check_stats();
+	failures += check_stream();
+	failures += check_strips();
+	failures += check_pipeline();
+	failures += check_luma();
+	failures += check_yuv2yuv();
+	failures += check_repack();
+	failures += check_rgb16();
+	failures += check_packed();
+	failures += check_yuva();
+	failures += check_blend();
+	failures += check_lut3d();
+	failures += check_linear();
+	failures += check_hdr();
+
+	if(failures)
+	{
+		printf("%d failures\n", failures);
+		return 1;
+	}
+	printf("All tests passed\n");
+	return 0;
+}
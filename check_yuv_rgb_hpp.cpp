@@ -0,0 +1,144 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// Test of the C++ interface
+// Conversions through typed views and owning frames must give the same result as the C kernels,
+// with aligned and unaligned views, and unsupported conversions must be rejected at compile time.
+
+#include "yuv_rgb.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+using namespace yuv_rgb;
+
+static_assert(can_convert_v<Yuv420View, Rgb24View>);
+static_assert(can_convert_v<ConstNv12View, Rgb24View>);
+static_assert(can_convert_v<ConstRgb32View, Yuv420View>);
+static_assert(!can_convert_v<Yuv420View, ConstRgb24View>);
+static_assert(!can_convert_v<Rgb24View, Rgb32View>);
+static_assert(!can_convert_v<Nv12View, Yuv420View>);
+static_assert(!std::is_copy_constructible_v<Frame<Rgb24View>>);
+static_assert(std::is_nothrow_move_constructible_v<Frame<Rgb24View>>);
+static_assert(std::is_trivially_copyable_v<Yuv420View>);
+static_assert(std::is_same_v<decltype(std::declval<const Frame<Rgb24View> &>().view()), ConstRgb24View>);
+static_assert(!std::is_convertible_v<const Frame<Rgb24View> &, Rgb24View>);
+static_assert(std::is_convertible_v<const Frame<Rgb24View> &, ConstRgb24View>);
+
+static uint32_t rng_state = 1;
+
+static uint8_t random_byte()
+{
+	rng_state = rng_state*1103515245u+12345u;
+	return uint8_t(rng_state>>16);
+}
+
+static void fill(const FrameBuffer &buffer)
+{
+	for(uint32_t p=0; p<buffer.plane_number; ++p)
+	{
+		const uint32_t lines = p==0 ? buffer.height : (buffer.height+1)/2;
+		for(size_t i=0; i<size_t(buffer.stride[p])*lines; ++i)
+			buffer.plane[p][i] = random_byte();
+	}
+}
+
+static bool equal(const Rgb24View &a, const Rgb24View &b)
+{
+	for(uint32_t y=0; y<a.height; ++y)
+		if(std::memcmp(a.row(y), b.row(y), size_t(a.width)*3)!=0)
+			return false;
+	return true;
+}
+
+static bool equal(const Yuv420View &a, const Yuv420View &b)
+{
+	for(uint32_t y=0; y<a.height; ++y)
+		if(std::memcmp(a.y_row(y), b.y_row(y), a.width)!=0 ||
+			std::memcmp(a.u_row(y), b.u_row(y), a.width/2)!=0 ||
+			std::memcmp(a.v_row(y), b.v_row(y), a.width/2)!=0)
+			return false;
+	return true;
+}
+
+static int check_yuv_rgb(uint32_t width, uint32_t height, YCbCrType yuv_type)
+{
+	int failures = 0;
+	Frame<Yuv420View> yuv(width, height, yuv_type);
+	Frame<Nv12View> nv12(width, height, yuv_type);
+	Frame<Rgb24View> rgb(width, height), expected(width, height);
+	fill(yuv.buffer());
+	fill(nv12.buffer());
+
+	const Rgb24View e = expected;
+	const Yuv420View s = yuv;
+	yuv420_rgb24_std(width, height, s.y, s.u, s.v, s.y_stride, s.uv_stride, e.pixels, e.stride, yuv_type);
+	if(convert(yuv, rgb)!=0 || !equal(rgb, e))
+	{
+		std::printf("hpp: FAILED, yuv420 to rgb24 %ux%u\n", width, height);
+		failures++;
+	}
+
+	// unaligned destination, through a view on a vector
+	std::vector<uint8_t> buffer(size_t(width*3+1)*height+1);
+	const Rgb24View unaligned(width, height, buffer.data()+1, width*3+1);
+	if(convert(ConstYuv420View(s), unaligned)!=0 || !equal(unaligned, e))
+	{
+		std::printf("hpp: FAILED, yuv420 to unaligned rgb24 %ux%u\n", width, height);
+		failures++;
+	}
+
+	const Nv12View n = nv12;
+	nv12_rgb24_std(width, height, n.y, n.uv, n.y_stride, n.uv_stride, e.pixels, e.stride, yuv_type);
+	if(convert(nv12, rgb.view())!=0 || !equal(rgb, e))
+	{
+		std::printf("hpp: FAILED, nv12 to rgb24 %ux%u\n", width, height);
+		failures++;
+	}
+
+	Frame<Yuv420View> result(width, height, yuv_type), expected_yuv(width, height, yuv_type);
+	const Yuv420View r = expected_yuv;
+	rgb24_yuv420_std(width, height, e.pixels, e.stride, r.y, r.u, r.v, r.y_stride, r.uv_stride, yuv_type);
+	if(convert(ConstRgb24View(e), result)!=0 || !equal(result, r))
+	{
+		std::printf("hpp: FAILED, rgb24 to yuv420 %ux%u\n", width, height);
+		failures++;
+	}
+	return failures;
+}
+
+static int check_frames()
+{
+	int failures = 0;
+	Frame<Rgb24View> a(64, 32);
+	const uint8_t *pixels = a.view().pixels;
+	Frame<Rgb24View> b(std::move(a));
+	Frame<Rgb24View> c(16, 16);
+	c = std::move(b);
+	if(c.view().pixels!=pixels || c.width()!=64 || a.view().pixels || b.view().pixels)
+	{
+		std::printf("hpp: FAILED, frame move\n");
+		failures++;
+	}
+
+	Frame<Yuv420View> yuv(64, 30);
+	if(convert(yuv, c)!=-1)
+	{
+		std::printf("hpp: FAILED, size mismatch accepted\n");
+		failures++;
+	}
+	return failures;
+}
+
+int main()
+{
+	static const uint32_t sizes[][2] = {{2, 2}, {32, 2}, {66, 10}, {320, 240}, {1920, 1080}};
+	int failures = check_frames();
+	for(const auto &size : sizes)
+		for(int type=YCBCR_JPEG; type<=YCBCR_2020; ++type)
+			failures += check_yuv_rgb(size[0], size[1], YCbCrType(type));
+	std::printf("hpp: %s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
@@ -4,6 +4,7 @@
 // This program demonstrate how to convert a YUV420p image (raw format) to RGB (ppm format), and the reverse operation
 
 #include "yuv_rgb.h"
+#include "yuv_rgb_alloc.h"
 
 #include <stdint.h>
 #include <stdio.h>
@@ -11,8 +12,6 @@
 #include <string.h>
 #include <time.h>
 
-#include <x86intrin.h>
-
 #if USE_FFMPEG
 #include <libswscale/swscale.h>
 #endif
@@ -182,21 +181,6 @@ int savePPM(const char* filename, uint32_t width, uint32_t height, const uint8_t
 	return 0;
 }
 
-void convert_rgb_to_rgba(const uint8_t *RGB, uint32_t width, uint32_t height, uint8_t **RGBA)
-{
-	*RGBA = malloc(4*width*height);
-	for(uint32_t y=0; y<height; ++y)
-	{
-		for(uint32_t x=0; x<width; ++x)
-		{
-			(*RGBA)[(y*width+x)*4] = RGB[(y*width+x)*3];
-			(*RGBA)[(y*width+x)*4+1] = RGB[(y*width+x)*3+1];
-			(*RGBA)[(y*width+x)*4+2] = RGB[(y*width+x)*3+2];
-			(*RGBA)[(y*width+x)*4+3] = 0;
-		}
-	}
-}
-
 typedef enum
 {
 	RGB2YUV,
@@ -400,7 +384,13 @@ int main(int argc, char **argv)
 	const char *filename = argv[2];
 	uint32_t width, height;
 	const char *out;
-	uint8_t *YUV=NULL, *RGB=NULL, *Y=NULL, *U=NULL, *V=NULL, *RGBa=NULL, *YUVa=NULL, *Ya=NULL, *Ua=NULL, *Va=NULL;
+	uint8_t *YUV=NULL, *RGB=NULL, *Y=NULL, *U=NULL, *V=NULL, *RGBa=NULL, *Ya=NULL, *Ua=NULL, *Va=NULL;
+	uint8_t *RGBA=NULL;
+	int status = 0;
+	// aligned frames, for aligned kernels
+	FrameBuffer yuv_frame, rgb_frame;
+	memset(&yuv_frame, 0, sizeof(yuv_frame));
+	memset(&rgb_frame, 0, sizeof(rgb_frame));
 	
 	if(mode==YUV2RGB || mode==YUV2RGB_NV12 ||  mode==YUV2RGB_NV21)
 	{
@@ -413,7 +403,8 @@ int main(int argc, char **argv)
 		if(readRawYUV(filename, width, height, &YUV)!=0)
 		{
 			printf("Error reading image file, check that the file exists and has the correct format and resolution.\n");
-			return 1;
+			status = 1;
+			goto end;
 		}
 		
 #if USE_FFMPEG
@@ -421,21 +412,29 @@ int main(int argc, char **argv)
 #endif
 		
 		RGB = malloc(3*width*height);
+		if(!RGB)
+		{
+			printf("Error allocating rgb image.\n");
+			status = 1;
+			goto end;
+		}
 		
 		Y = YUV;
 		U = YUV+width*height;
 		V = YUV+width*height+((width+1)/2)*((height+1)/2);
 		
 		// allocate aligned data
-		const size_t y_stride = width + (16-width%16)%16;
-		const size_t uv_stride = (mode==YUV2RGB) ? (width+1)/2 + (16-((width+1)/2)%16)%16 : y_stride;
-		const size_t rgb_stride = width*3 +(16-(3*width)%16)%16;
-	
-		const size_t y_size = y_stride*height, uv_size = uv_stride*((height+1)/2);
-		YUVa = _mm_malloc(y_size+2*uv_size, 16);
-		Ya = YUVa;
-		Ua = YUVa+y_size;
-		Va = YUVa+y_size+uv_size;
+		if(frame_buffer_alloc(&yuv_frame, (mode==YUV2RGB) ? PIXEL_FORMAT_YUV420 : PIXEL_FORMAT_NV12, width, height, 0)!=0 ||
+			frame_buffer_alloc(&rgb_frame, PIXEL_FORMAT_RGB24, width, height, 0)!=0)
+		{
+			printf("Error allocating aligned images.\n");
+			status = 1;
+			goto end;
+		}
+		const size_t y_stride = yuv_frame.stride[0], uv_stride = yuv_frame.stride[1], rgb_stride = rgb_frame.stride[0];
+		Ya = yuv_frame.plane[0];
+		Ua = yuv_frame.plane[1];
+		Va = yuv_frame.plane[2];
 		for(unsigned int i=0; i<height; ++i)
 		{
 			memcpy(Ya+i*y_stride, Y+i*width, width);
@@ -453,7 +452,7 @@ int main(int argc, char **argv)
 			}
 		}
 		
-		RGBa = _mm_malloc(rgb_stride*height, 16);
+		RGBa = rgb_frame.plane[0];
 		
 		// test all versions
 		if(mode==YUV2RGB)
@@ -509,7 +508,8 @@ int main(int argc, char **argv)
 		if(readPPM(filename, &width, &height, &RGB)!=0)
 		{
 			printf("Error reading image file, check that the file exists and has the correct format.\n");
-			return 1;
+			status = 1;
+			goto end;
 		}
 		
 #if USE_FFMPEG
@@ -517,27 +517,36 @@ int main(int argc, char **argv)
 #endif
 		
 		YUV = malloc(width*height*3/2);
+		if(!YUV)
+		{
+			printf("Error allocating yuv image.\n");
+			status = 1;
+			goto end;
+		}
 		
 		Y = YUV;
 		U = YUV+width*height;
 		V = YUV+width*height+((width+1)/2)*((height+1)/2);
 		
 		// allocate aligned data
-		const size_t y_stride = width + (16-width%16)%16,
-		uv_stride = (width+1)/2 + (16-((width+1)/2)%16)%16,
-		rgb_stride = width*3 +(16-(3*width)%16)%16;
+		if(frame_buffer_alloc(&rgb_frame, PIXEL_FORMAT_RGB24, width, height, 0)!=0 ||
+			frame_buffer_alloc(&yuv_frame, PIXEL_FORMAT_YUV420, width, height, 0)!=0)
+		{
+			printf("Error allocating aligned images.\n");
+			status = 1;
+			goto end;
+		}
+		const size_t y_stride = yuv_frame.stride[0], uv_stride = yuv_frame.stride[1], rgb_stride = rgb_frame.stride[0];
 		
-		RGBa = _mm_malloc(rgb_stride*height, 16);
+		RGBa = rgb_frame.plane[0];
 		for(unsigned int i=0; i<height; ++i)
 		{
 			memcpy(RGBa+i*rgb_stride, RGB+i*width*3, width*3);
 		}
 		
-		const size_t y_size = y_stride*height, uv_size = uv_stride*((height+1)/2);
-		YUVa = _mm_malloc(y_size+2*uv_size, 16);
-		Ya = YUVa;
-		Ua = YUVa+y_size;
-		Va = YUVa+y_size+uv_size;
+		Ya = yuv_frame.plane[0];
+		Ua = yuv_frame.plane[1];
+		Va = yuv_frame.plane[2];
 
 		
 		// test all versions
@@ -573,34 +582,40 @@ int main(int argc, char **argv)
 		if(readPPM(filename, &width, &height, &RGB)!=0)
 		{
 			printf("Error reading image file, check that the file exists and has the correct format.\n");
-			return 1;
+			status = 1;
+			goto end;
 		}
-		// convert rgb to rgba
-		uint8_t *RGBA = NULL;
-		convert_rgb_to_rgba(RGB, width, height, &RGBA);
-		
+		RGBA = malloc(4*width*height);
 		YUV = malloc(width*height*3/2);
+		if(!RGBA || !YUV)
+		{
+			printf("Error allocating rgba and yuv images.\n");
+			status = 1;
+			goto end;
+		}
 		
 		Y = YUV;
 		U = YUV+width*height;
 		V = YUV+width*height+((width+1)/2)*((height+1)/2);
 		
 		// allocate aligned data
-		const size_t y_stride = width + (16-width%16)%16,
-		uv_stride = (width+1)/2 + (16-((width+1)/2)%16)%16,
-		rgba_stride = width*4 +(16-(4*width)%16)%16;
-		
-		RGBa = _mm_malloc(rgba_stride*height, 16);
-		for(unsigned int i=0; i<height; ++i)
+		if(frame_buffer_alloc(&rgb_frame, PIXEL_FORMAT_RGB32, width, height, 0)!=0 ||
+			frame_buffer_alloc(&yuv_frame, PIXEL_FORMAT_YUV420, width, height, 0)!=0)
 		{
-			memcpy(RGBa+i*rgba_stride, RGBA+i*width*4, width*4);
+			printf("Error allocating aligned images.\n");
+			status = 1;
+			goto end;
 		}
+		const size_t y_stride = yuv_frame.stride[0], uv_stride = yuv_frame.stride[1], rgba_stride = rgb_frame.stride[0];
 		
-		const size_t y_size = y_stride*height, uv_size = uv_stride*((height+1)/2);
-		YUVa = _mm_malloc(y_size+2*uv_size, 16);
-		Ya = YUVa;
-		Ua = YUVa+y_size;
-		Va = YUVa+y_size+uv_size;
+		// convert rgb to rgba, in both the unaligned and the aligned images
+		RGBa = rgb_frame.plane[0];
+		rgb24_rgba32_sseu(width, height, RGB, width*3, RGBA, width*4, 255);
+		rgb24_rgba32_sseu(width, height, RGB, width*3, RGBa, rgba_stride, 255);
+		
+		Ya = yuv_frame.plane[0];
+		Ua = yuv_frame.plane[1];
+		Va = yuv_frame.plane[2];
 		
 		// test all versions
 		test_rgb2yuv(width, height, RGBA, width*4, Y, U, V, width, (width+1)/2, yuv_format, 
@@ -609,15 +624,15 @@ int main(int argc, char **argv)
 			out, "sse2_unaligned", iteration_number, rgb32_yuv420_sseu);
 		test_rgb2yuv(width, height, RGBa, rgba_stride, Ya, Ua, Va, y_stride, uv_stride, yuv_format, 
 			out, "sse2_aligned", iteration_number, rgb32_yuv420_sse);
-		
-		free(RGBA);
 	}
 	
-	_mm_free(RGBa);
-	_mm_free(YUVa);
+end:
+	frame_buffer_free(&rgb_frame);
+	frame_buffer_free(&yuv_frame);
+	free(RGBA);
 	free(RGB);
 	free(YUV);
 	
-	return 0;
+	return status;
 }
 
@@ -2,20 +2,15 @@
 // Distributed under BSD 3-Clause License
 
 #include "yuv_rgb.h"
+#include "yuv_rgb_private.h"
 
-#include <emmintrin.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
-#ifdef _MSC_VER
-// MSVC does not have __SSE2__ macro
-  #if (defined(_M_AMD64) || defined(_M_X64) || (_M_IX86_FP == 2))
-    #define _YUVRGB_SSE2_
-  #endif
-#else
-// For everything else than MSVC
-  #ifdef __SSE2__
-    #define _YUVRGB_SSE2_
-  #endif // __SSE2__
-#endif // _MSC_VER
+#ifdef _YUVRGB_SSE2_
+#include <emmintrin.h>
+#endif
 
 uint8_t clamp(int16_t value)
 {
@@ -79,6 +74,48 @@ uint8_t clamp(int16_t value)
 // * G = Y' - ((Cr-128)*[Rf/Gf*(255*CrNorm)/CrRange] + (Cb-128)*[Bf/Gf*(255*CbNorm)/CbRange])>>N
 // 
 // Note : in ITU-T T.871(JPEG), Y=Y', so that part could be optimized out
+//
+// Canonical integer pipeline
+//
+// All implementations (std and sse) use the exact same integer operations, and give bit exact results, 
+// so that they can be freely mixed (sse for the body of a line and std for its last pixels, 
+// different cpus or threads working on parts of the same image, ...).
+// The factors are the fixed point values defined below, and >> is an arithmetic (floor) shift.
+// For RGB to YCbCr, for each 2x2 block of pixels:
+// * Y' = ([Rf]*R + [Gf]*G + [Bf]*B)>>8 for each pixel
+// * Y = ((Y'*[(YMax-YMin)/255])>>7) + YMin for each pixel
+// * Cb = (((sum(B-Y')>>2)*[CbRange/(255*CbNorm)])>>8) + 128, with the sum over the four pixels
+// * Cr = (((sum(R-Y')>>2)*[CrRange/(255*CrNorm)])>>8) + 128
+// For YCbCr to RGB, for each pixel:
+// * Y' = ((Y-YMin)*[255/(YMax-YMin)])>>7, note that Y-YMin can be negative
+// * R = clamp(Y' + (((Cr-128)*[(255*CrNorm)/CrRange])>>6))
+// * G = clamp(Y' - (((Cb-128)*[Bf/Gf*(255*CbNorm)/CbRange] + (Cr-128)*[Rf/Gf*(255*CrNorm)/CrRange])>>7))
+// * B = clamp(Y' + (((Cb-128)*[(255*CbNorm)/CbRange])>>6))
+// For YCbCr to YCbCr, the 3x3 matrix M of the conversion through analog RGB, including both range 
+// changes, is computed in double precision and rounded to 14 bits, and for each 2x2 block of pixels:
+// * mul(x, [m]) = (x*[m])>>16, where x has 6 fractional bits, so that results have 4 fractional bits
+//   (<<n stands for a multiplication by 2^n, values can be negative)
+// * Y2 = clamp((mul((Y-YMin)<<6, [M00]) + mul((Cb-128)<<6, [M01]) + mul((Cr-128)<<6, [M02]) + YMin2*16 + 8)>>4)
+//   for each pixel
+// * Cb2 = clamp((mul((Cb-128)<<6, [M11]) + mul((Cr-128)<<6, [M12]) + 128*16 + 8)>>4), and the same for Cr2 
+//   with the last line of M, M10 and M20 being 0 since gray stays gray in all color spaces
+// For alpha blending of an overlay, alpha is first rescaled to [0:256] with a = A + (A>>7), then:
+// * Y = (Ydst*(256-a) + Yov*a + 128)>>8 for each pixel, Yov being Y of the RGB to YCbCr conversion for an
+//   rgba overlay
+// * for each 2x2 block, with pixels outside of the overlay counting as a=0, a = sum(a)>>2
+// * Cb = clamp(((Cbdst*(256-a) + 128*a + 128)>>8) + (((sum(((B-Y')*a)>>8)>>2)*[CbRange/(255*CbNorm)])>>8))
+//   for an rgba overlay, that is the RGB to YCbCr conversion of (B-Y') premultiplied by alpha, and the same for Cr
+// * Cb = (Cbdst*(256-a) + Cbov*a + 128)>>8 for a yuva overlay
+// For HDR to SDR conversion of 10 bits BT.2020 limited range yuv, with mul(x, [m]) = (x*[m])>>16, where x has 
+// 5 fractional bits and factors 11 fractional bits, and factors rescaled to 12 bits full range:
+// * Y' = mul((Y-64)<<5, [4095/876]) for each pixel
+// * R' = clamp12(Y' + mul((Cr-512)<<5, [(4095*CrNorm)/896]))
+// * G' = clamp12(Y' - (mul((Cb-512)<<5, [Bf/Gf*(4095*CbNorm)/896]) + mul((Cr-512)<<5, [Rf/Gf*(4095*CrNorm)/896])))
+// * B' = clamp12(Y' + mul((Cb-512)<<5, [(4095*CbNorm)/896])), with clamp12 a clamp to [0:4095]
+// * R = linear[R'], G = linear[G'], B = linear[B'], tone mapped linear values in [0:16383]
+// * R709 = clamp14(([M00]*R + [M01]*G + [M02]*B + 2048)>>12), and the same for G709 and B709, with M the BT.2020 
+//   to BT.709 primaries matrix with 12 fractional bits, and clamp14 a clamp to [0:16383]
+// * Rsdr = sdr[R709], Gsdr = sdr[G709], Bsdr = sdr[B709]
 
 
 #define FIXED_POINT_VALUE(value, precision) ((int)(((value)*(1<<precision))+0.5))
@@ -122,26 +159,58 @@ typedef struct
 .y_factor=FIXED_POINT_VALUE(255.0/(YMax-YMin), 7), \
 .y_offset=YMin}
 
-static const RGB2YUVParam RGB2YUV[3] = {
-	// ITU-T T.871 (JPEG)
-	RGB2YUV_PARAM(0.299, 0.114, 0.0, 255.0, 255.0),
-	// ITU-R BT.601-7
-	RGB2YUV_PARAM(0.299, 0.114, 16.0, 235.0, 224.0),
-	// ITU-R BT.709-6
-	RGB2YUV_PARAM(0.2126, 0.0722, 16.0, 235.0, 224.0)
-};
+// Rf, Bf, YMin, YMax and CbCrRange of each color space, in the same order as YCbCrType
+#define COLOR_SPACES(PARAM) \
+	PARAM(0.299, 0.114, 0.0, 255.0, 255.0),     /* ITU-T T.871 (JPEG) */ \
+	PARAM(0.299, 0.114, 16.0, 235.0, 224.0),    /* ITU-R BT.601-7 */ \
+	PARAM(0.2126, 0.0722, 16.0, 235.0, 224.0),  /* ITU-R BT.709-6 */ \
+	PARAM(0.2627, 0.0593, 16.0, 235.0, 224.0)   /* ITU-R BT.2020-2, non constant luminance */
 
-static const YUV2RGBParam YUV2RGB[3] = {
-	// ITU-T T.871 (JPEG)
-	YUV2RGB_PARAM(0.299, 0.114, 0.0, 255.0, 255.0),
-	// ITU-R BT.601-7
-	YUV2RGB_PARAM(0.299, 0.114, 16.0, 235.0, 224.0),
-	// ITU-R BT.709-6
-	YUV2RGB_PARAM(0.2126, 0.0722, 16.0, 235.0, 224.0)
-};
+static const RGB2YUVParam RGB2YUV[] = {COLOR_SPACES(RGB2YUV_PARAM)};
 
+static const YUV2RGBParam YUV2RGB[] = {COLOR_SPACES(YUV2RGB_PARAM)};
 
-void rgb24_yuv420_std(
+// color space definitions, for the matrices computed at runtime
+typedef struct
+{
+	double r_factor, b_factor, y_min, y_max, cbcr_range;
+} ColorSpaceParam;
+
+#define COLOR_SPACE_PARAM(Rf, Bf, YMin, YMax, CbCrRange) {Rf, Bf, YMin, YMax, CbCrRange}
+
+static const ColorSpaceParam COLOR_SPACE[] = {COLOR_SPACES(COLOR_SPACE_PARAM)};
+
+// see above for description
+typedef struct
+{
+	int16_t matrix[3][3];  // [M], 14 bits fixed point, all coefficients are lower than 2, M10 and M20 are 0
+	int16_t y_offset;      // YMin of the source
+	int16_t y_offset_2;    // YMin of the destination
+} YUV2YUVParam;
+
+// Kernels are written once as inline functions, and instantiated for each YCbCrType by the
+// public functions. Each instance sees its parameters as constants, so that they are used as
+// immediates and steps that do nothing for its color space (luma rescale and offset for full
+// range) are removed by the compiler.
+#if defined(__GNUC__)
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define ALWAYS_INLINE static __forceinline
+#else
+#define ALWAYS_INLINE static inline
+#endif
+
+#define SPECIALIZE_YUV_TYPE(kernel, ...) \
+	switch(yuv_type) \
+	{ \
+		case YCBCR_JPEG: kernel(__VA_ARGS__, YCBCR_JPEG); break; \
+		case YCBCR_601: kernel(__VA_ARGS__, YCBCR_601); break; \
+		case YCBCR_709: kernel(__VA_ARGS__, YCBCR_709); break; \
+		case YCBCR_2020: kernel(__VA_ARGS__, YCBCR_2020); break; \
+	}
+
+
+ALWAYS_INLINE void rgb24_yuv420_std_impl(
 	uint32_t width, uint32_t height, 
 	const uint8_t *RGB, uint32_t RGB_stride, 
 	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
@@ -199,11 +268,21 @@ void rgb24_yuv420_std(
 	}
 }
 
-void rgb32_yuv420_std(
+void rgb24_yuv420_std(
 	uint32_t width, uint32_t height, 
-	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
 	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
 	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb24_yuv420_std_impl, width, height, RGB, RGB_stride, Y, U, V, Y_stride, UV_stride)
+}
+
+// alpha is copied to A if it is not NULL (yuva420 output)
+ALWAYS_INLINE void rgb32_yuv420_std_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
 {
 	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
 	
@@ -245,7 +324,17 @@ void rgb32_yuv420_std(
 			y_ptr2[1]=((y_tmp*param->y_factor)>>7) + param->y_offset;
 
 			u_ptr[0] = (((u_tmp>>2)*param->cb_factor)>>8) + 128;
-			v_ptr[0] = (((v_tmp>>2)*param->cb_factor)>>8) + 128;
+			v_ptr[0] = (((v_tmp>>2)*param->cr_factor)>>8) + 128;
+			
+			if(A)
+			{
+				uint8_t *a_ptr1=A+y*Y_stride+x,
+					*a_ptr2=A+(y+1)*Y_stride+x;
+				a_ptr1[0] = rgb_ptr1[3];
+				a_ptr1[1] = rgb_ptr1[7];
+				a_ptr2[0] = rgb_ptr2[3];
+				a_ptr2[1] = rgb_ptr2[7];
+			}
 			
 			rgb_ptr1 += 8;
 			rgb_ptr2 += 8;
@@ -257,8 +346,26 @@ void rgb32_yuv420_std(
 	}
 }
 
+void rgb32_yuv420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb32_yuv420_std_impl, width, height, RGBA, RGBA_stride, Y, U, V, NULL, Y_stride, UV_stride)
+}
 
-void yuv420_rgb24_std(
+void rgba32_yuva420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb32_yuv420_std_impl, width, height, RGBA, RGBA_stride, Y, U, V, A, Y_stride, UV_stride)
+}
+
+
+ALWAYS_INLINE void yuv420_rgb24_std_impl(
 	uint32_t width, uint32_t height, 
 	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
 	uint8_t *RGB, uint32_t RGB_stride, 
@@ -319,7 +426,16 @@ void yuv420_rgb24_std(
 	}
 }
 
-void nv12_rgb24_std(
+void yuv420_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(yuv420_rgb24_std_impl, width, height, Y, U, V, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+ALWAYS_INLINE void nv12_rgb24_std_impl(
 	uint32_t width, uint32_t height, 
 	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
 	uint8_t *RGB, uint32_t RGB_stride, 
@@ -378,7 +494,16 @@ void nv12_rgb24_std(
 	}
 }
 
-void nv21_rgb24_std(
+void nv12_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(nv12_rgb24_std_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+ALWAYS_INLINE void nv21_rgb24_std_impl(
 	uint32_t width, uint32_t height, 
 	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
 	uint8_t *RGB, uint32_t RGB_stride, 
@@ -437,312 +562,1865 @@ void nv21_rgb24_std(
 	}
 }
 
+void nv21_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(nv21_rgb24_std_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride)
+}
 
-#ifdef _YUVRGB_SSE2_
 
-//see rgb.txt
-#define UNPACK_RGB24_32_STEP(RS1, RS2, RS3, RS4, RS5, RS6, RD1, RD2, RD3, RD4, RD5, RD6) \
-RD1 = _mm_unpacklo_epi8(RS1, RS4); \
-RD2 = _mm_unpackhi_epi8(RS1, RS4); \
-RD3 = _mm_unpacklo_epi8(RS2, RS5); \
-RD4 = _mm_unpackhi_epi8(RS2, RS5); \
-RD5 = _mm_unpacklo_epi8(RS3, RS6); \
-RD6 = _mm_unpackhi_epi8(RS3, RS6);
+// Lookup table implementation of the yuv to rgb conversions, for cores without vector unit where
+// multiplies are slow. All products of the canonical pipeline only depend on one 8bit input, so that
+// they are read from tables, and clamping is done with a table too. The G offset is shifted after
+// the sum of its two products, so its tables keep the unshifted products.
+// Values before clamping are in [-293:552] for all color spaces.
+#define LUT_CLAMP_OFFSET 384
 
-#define RGB2YUV_16(R, G, B, Y, U, V) \
-Y = _mm_add_epi16(_mm_mullo_epi16(R, _mm_set1_epi16(param->r_factor)), \
-                  _mm_mullo_epi16(G, _mm_set1_epi16(param->g_factor))); \
-Y = _mm_add_epi16(Y, _mm_mullo_epi16(B, _mm_set1_epi16(param->b_factor))); \
-Y = _mm_srli_epi16(Y, 8); \
-U = _mm_mullo_epi16(_mm_sub_epi16(B, Y), _mm_set1_epi16(param->cb_factor)); \
-U = _mm_add_epi16(_mm_srai_epi16(U, 8), _mm_set1_epi16(128)); \
-V = _mm_mullo_epi16(_mm_sub_epi16(R, Y), _mm_set1_epi16(param->cr_factor)); \
-V = _mm_add_epi16(_mm_srai_epi16(V, 8), _mm_set1_epi16(128)); \
-Y = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(Y, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset));
+typedef struct
+{
+	int16_t y[256];       // ((Y-YMin)*[255/(YMax-YMin)])>>7
+	int16_t b_cb[256];    // ((Cb-128)*[(255*CbNorm)/CbRange])>>6
+	int16_t r_cr[256];    // ((Cr-128)*[(255*CrNorm)/CrRange])>>6
+	int16_t g_cb[256];    // (Cb-128)*[Bf/Gf*(255*CbNorm)/CbRange]
+	int16_t g_cr[256];    // (Cr-128)*[Rf/Gf*(255*CrNorm)/CrRange]
+	uint8_t clamp[1024];  // clamp(value-LUT_CLAMP_OFFSET)
+} YUV2RGBLut;
 
-#define RGB2YUV_32 \
-	__m128i r_16, g_16, b_16; \
-	__m128i y1_16, y2_16, cb1_16, cb2_16, cr1_16, cr2_16, Y, cb, cr; \
-	__m128i tmp1, tmp2, tmp3, tmp4, tmp5, tmp6; \
-	__m128i rgb1 = LOAD_SI128((const __m128i*)(rgb_ptr1)), \
-		rgb2 = LOAD_SI128((const __m128i*)(rgb_ptr1+16)), \
-		rgb3 = LOAD_SI128((const __m128i*)(rgb_ptr1+32)), \
-		rgb4 = LOAD_SI128((const __m128i*)(rgb_ptr2)), \
-		rgb5 = LOAD_SI128((const __m128i*)(rgb_ptr2+16)), \
-		rgb6 = LOAD_SI128((const __m128i*)(rgb_ptr2+32)); \
-	/* unpack rgb24 data to r, g and b data in separate channels*/ \
-	/* see rgb.txt to get an idea of the algorithm, note that we only go to the next to last step*/ \
-	/* here, because averaging in horizontal direction is easier like this*/ \
-	/* The last step is applied further on the Y channel only*/ \
-	UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6) \
-	UNPACK_RGB24_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6) \
-	UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6) \
-	UNPACK_RGB24_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6) \
-	/* first compute Y', (B-Y') and (R-Y'), in 16bits values, for the first line */ \
-	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are saved*/ \
-	r_16 = _mm_unpacklo_epi8(rgb1, _mm_setzero_si128()); \
-	g_16 = _mm_unpacklo_epi8(rgb2, _mm_setzero_si128()); \
-	b_16 = _mm_unpacklo_epi8(rgb3, _mm_setzero_si128()); \
-	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y1_16 = _mm_srli_epi16(y1_16, 8); \
-	cb1_16 = _mm_sub_epi16(b_16, y1_16); \
-	cr1_16 = _mm_sub_epi16(r_16, y1_16); \
-	r_16 = _mm_unpacklo_epi8(rgb4, _mm_setzero_si128()); \
-	g_16 = _mm_unpacklo_epi8(rgb5, _mm_setzero_si128()); \
-	b_16 = _mm_unpacklo_epi8(rgb6, _mm_setzero_si128()); \
-	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y2_16 = _mm_srli_epi16(y2_16, 8); \
-	cb1_16 = _mm_add_epi16(cb1_16, _mm_sub_epi16(b_16, y2_16)); \
-	cr1_16 = _mm_add_epi16(cr1_16, _mm_sub_epi16(r_16, y2_16)); \
-	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
-	y1_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y1_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	y2_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y2_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	Y = _mm_packus_epi16(y1_16, y2_16); \
-	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
-	SAVE_SI128((__m128i*)(y_ptr1), Y); \
-	/* same for the second line, compute Y', (B-Y') and (R-Y'), in 16bits values */ \
-	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are added to the previous values*/ \
-	r_16 = _mm_unpackhi_epi8(rgb1, _mm_setzero_si128()); \
-	g_16 = _mm_unpackhi_epi8(rgb2, _mm_setzero_si128()); \
-	b_16 = _mm_unpackhi_epi8(rgb3, _mm_setzero_si128()); \
-	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y1_16 = _mm_srli_epi16(y1_16, 8); \
-	cb1_16 = _mm_add_epi16(cb1_16, _mm_sub_epi16(b_16, y1_16)); \
-	cr1_16 = _mm_add_epi16(cr1_16, _mm_sub_epi16(r_16, y1_16)); \
-	r_16 = _mm_unpackhi_epi8(rgb4, _mm_setzero_si128()); \
-	g_16 = _mm_unpackhi_epi8(rgb5, _mm_setzero_si128()); \
-	b_16 = _mm_unpackhi_epi8(rgb6, _mm_setzero_si128()); \
-	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y2_16 = _mm_srli_epi16(y2_16, 8); \
-	cb1_16 = _mm_add_epi16(cb1_16, _mm_sub_epi16(b_16, y2_16)); \
-	cr1_16 = _mm_add_epi16(cr1_16, _mm_sub_epi16(r_16, y2_16)); \
-	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
-	y1_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y1_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	y2_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y2_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	Y = _mm_packus_epi16(y1_16, y2_16); \
-	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
-	SAVE_SI128((__m128i*)(y_ptr2), Y); \
-	/* Rescale Cb and Cr to their final range */ \
-	cb1_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cb1_16, 2), _mm_set1_epi16(param->cb_factor)), 8), _mm_set1_epi16(128)); \
-	cr1_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cr1_16, 2), _mm_set1_epi16(param->cr_factor)), 8), _mm_set1_epi16(128)); \
-	\
-	/* do the same again with next data */ \
-	rgb1 = LOAD_SI128((const __m128i*)(rgb_ptr1+48)), \
-	rgb2 = LOAD_SI128((const __m128i*)(rgb_ptr1+64)), \
-	rgb3 = LOAD_SI128((const __m128i*)(rgb_ptr1+80)), \
-	rgb4 = LOAD_SI128((const __m128i*)(rgb_ptr2+48)), \
-	rgb5 = LOAD_SI128((const __m128i*)(rgb_ptr2+64)), \
-	rgb6 = LOAD_SI128((const __m128i*)(rgb_ptr2+80)); \
-	/* unpack rgb24 data to r, g and b data in separate channels*/ \
-	/* see rgb.txt to get an idea of the algorithm, note that we only go to the next to last step*/ \
-	/* here, because averaging in horizontal direction is easier like this*/ \
-	/* The last step is applied further on the Y channel only*/ \
-	UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6) \
-	UNPACK_RGB24_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6) \
-	UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6) \
-	UNPACK_RGB24_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6) \
-	/* first compute Y', (B-Y') and (R-Y'), in 16bits values, for the first line */ \
-	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are saved*/ \
-	r_16 = _mm_unpacklo_epi8(rgb1, _mm_setzero_si128()); \
-	g_16 = _mm_unpacklo_epi8(rgb2, _mm_setzero_si128()); \
-	b_16 = _mm_unpacklo_epi8(rgb3, _mm_setzero_si128()); \
-	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y1_16 = _mm_srli_epi16(y1_16, 8); \
-	cb2_16 = _mm_sub_epi16(b_16, y1_16); \
-	cr2_16 = _mm_sub_epi16(r_16, y1_16); \
-	r_16 = _mm_unpacklo_epi8(rgb4, _mm_setzero_si128()); \
-	g_16 = _mm_unpacklo_epi8(rgb5, _mm_setzero_si128()); \
-	b_16 = _mm_unpacklo_epi8(rgb6, _mm_setzero_si128()); \
-	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y2_16 = _mm_srli_epi16(y2_16, 8); \
-	cb2_16 = _mm_add_epi16(cb2_16, _mm_sub_epi16(b_16, y2_16)); \
-	cr2_16 = _mm_add_epi16(cr2_16, _mm_sub_epi16(r_16, y2_16)); \
-	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
-	y1_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y1_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	y2_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y2_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	Y = _mm_packus_epi16(y1_16, y2_16); \
-	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
-	SAVE_SI128((__m128i*)(y_ptr1+16), Y); \
-	/* same for the second line, compute Y', (B-Y') and (R-Y'), in 16bits values */ \
-	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are added to the previous values*/ \
-	r_16 = _mm_unpackhi_epi8(rgb1, _mm_setzero_si128()); \
-	g_16 = _mm_unpackhi_epi8(rgb2, _mm_setzero_si128()); \
-	b_16 = _mm_unpackhi_epi8(rgb3, _mm_setzero_si128()); \
-	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y1_16 = _mm_srli_epi16(y1_16, 8); \
-	cb2_16 = _mm_add_epi16(cb2_16, _mm_sub_epi16(b_16, y1_16)); \
-	cr2_16 = _mm_add_epi16(cr2_16, _mm_sub_epi16(r_16, y1_16)); \
-	r_16 = _mm_unpackhi_epi8(rgb4, _mm_setzero_si128()); \
-	g_16 = _mm_unpackhi_epi8(rgb5, _mm_setzero_si128()); \
-	b_16 = _mm_unpackhi_epi8(rgb6, _mm_setzero_si128()); \
-	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y2_16 = _mm_srli_epi16(y2_16, 8); \
-	cb2_16 = _mm_add_epi16(cb2_16, _mm_sub_epi16(b_16, y2_16)); \
-	cr2_16 = _mm_add_epi16(cr2_16, _mm_sub_epi16(r_16, y2_16)); \
-	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
-	y1_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y1_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	y2_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y2_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	Y = _mm_packus_epi16(y1_16, y2_16); \
-	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
-	SAVE_SI128((__m128i*)(y_ptr2+16), Y); \
-	/* Rescale Cb and Cr to their final range */ \
-	cb2_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cb2_16, 2), _mm_set1_epi16(param->cb_factor)), 8), _mm_set1_epi16(128)); \
-	cr2_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cr2_16, 2), _mm_set1_epi16(param->cr_factor)), 8), _mm_set1_epi16(128)); \
-	/* Pack and save Cb Cr */ \
-	cb = _mm_packus_epi16(cb1_16, cb2_16); \
-	cr = _mm_packus_epi16(cr1_16, cr2_16); \
-	SAVE_SI128((__m128i*)(u_ptr), cb); \
-	SAVE_SI128((__m128i*)(v_ptr), cr);
+static YUV2RGBLut yuv2rgb_luts[sizeof(YUV2RGB)/sizeof(YUV2RGB[0])];
+static int yuv2rgb_lut_state[sizeof(YUV2RGB)/sizeof(YUV2RGB[0])];     // 0: not built, 1: being built, 2: ready
 
+// return the tables of a color space, built by the first caller and then shared by all threads
+static const YUV2RGBLut *get_yuv2rgb_lut(YCbCrType yuv_type)
+{
+	YUV2RGBLut *lut = &yuv2rgb_luts[yuv_type];
+	int *state = &yuv2rgb_lut_state[yuv_type];
+	int expected = 0;
+	if(__atomic_load_n(state, __ATOMIC_ACQUIRE)==2)
+		return lut;
+	if(__atomic_compare_exchange_n(state, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+	{
+		const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+		for(int i=0; i<256; ++i)
+		{
+			lut->y[i] = (param->y_factor*(i-param->y_offset))>>7;
+			lut->b_cb[i] = (param->cb_factor*(i-128))>>6;
+			lut->r_cr[i] = (param->cr_factor*(i-128))>>6;
+			lut->g_cb[i] = param->g_cb_factor*(i-128);
+			lut->g_cr[i] = param->g_cr_factor*(i-128);
+		}
+		for(int i=0; i<1024; ++i)
+			lut->clamp[i] = clamp(i-LUT_CLAMP_OFFSET);
+		__atomic_store_n(state, 2, __ATOMIC_RELEASE);
+		return lut;
+	}
+	// another thread is building the tables, it only takes a few microseconds
+	while(__atomic_load_n(state, __ATOMIC_ACQUIRE)!=2)
+		;
+	return lut;
+}
 
-void rgb24_yuv420_sse(uint32_t width, uint32_t height, 
-	const uint8_t *RGB, uint32_t RGB_stride, 
-	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
-	YCbCrType yuv_type)
+// convert a 2x2 block of pixels, sharing one Cb and one Cr value
+ALWAYS_INLINE void lut_yuv2rgb_2x2(const YUV2RGBLut *lut, uint8_t u, uint8_t v, 
+	const uint8_t *y_ptr1, const uint8_t *y_ptr2, uint8_t *rgb_ptr1, uint8_t *rgb_ptr2)
 {
-	#define LOAD_SI128 _mm_load_si128
-	#define SAVE_SI128 _mm_stream_si128
-	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
+	const uint8_t *const clamp_lut = lut->clamp+LUT_CLAMP_OFFSET;
+	const int b_cb_offset = lut->b_cb[u],
+		r_cr_offset = lut->r_cr[v],
+		g_cbcr_offset = (lut->g_cb[u] + lut->g_cr[v])>>7;
 	
-	uint32_t x, y;
-	for(y=0; y<(height-1); y+=2)
-	{
-		const uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+	int y_tmp;
+	y_tmp = lut->y[y_ptr1[0]];
+	rgb_ptr1[0] = clamp_lut[y_tmp + r_cr_offset];
+	rgb_ptr1[1] = clamp_lut[y_tmp - g_cbcr_offset];
+	rgb_ptr1[2] = clamp_lut[y_tmp + b_cb_offset];
+	
+	y_tmp = lut->y[y_ptr1[1]];
+	rgb_ptr1[3] = clamp_lut[y_tmp + r_cr_offset];
+	rgb_ptr1[4] = clamp_lut[y_tmp - g_cbcr_offset];
+	rgb_ptr1[5] = clamp_lut[y_tmp + b_cb_offset];
+	
+	y_tmp = lut->y[y_ptr2[0]];
+	rgb_ptr2[0] = clamp_lut[y_tmp + r_cr_offset];
+	rgb_ptr2[1] = clamp_lut[y_tmp - g_cbcr_offset];
+	rgb_ptr2[2] = clamp_lut[y_tmp + b_cb_offset];
+	
+	y_tmp = lut->y[y_ptr2[1]];
+	rgb_ptr2[3] = clamp_lut[y_tmp + r_cr_offset];
+	rgb_ptr2[4] = clamp_lut[y_tmp - g_cbcr_offset];
+	rgb_ptr2[5] = clamp_lut[y_tmp + b_cb_offset];
+}
+
+void yuv420_rgb24_lut(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	const YUV2RGBLut *const lut = get_yuv2rgb_lut(yuv_type);
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
 			*rgb_ptr2=RGB+(y+1)*RGB_stride;
 		
-		uint8_t *y_ptr1=Y+y*Y_stride,
+		for(x=0; x<(width-1); x+=2)
+		{
+			lut_yuv2rgb_2x2(lut, u_ptr[0], v_ptr[0], y_ptr1, y_ptr2, rgb_ptr1, rgb_ptr2);
+			
+			rgb_ptr1 += 6;
+			rgb_ptr2 += 6;
+			y_ptr1 += 2;
+			y_ptr2 += 2;
+			u_ptr += 1;
+			v_ptr += 1;
+		}
+	}
+}
+
+void nv12_rgb24_lut(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	const YUV2RGBLut *const lut = get_yuv2rgb_lut(yuv_type);
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*uv_ptr=UV+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		for(x=0; x<(width-1); x+=2)
+		{
+			lut_yuv2rgb_2x2(lut, uv_ptr[0], uv_ptr[1], y_ptr1, y_ptr2, rgb_ptr1, rgb_ptr2);
+			
+			rgb_ptr1 += 6;
+			rgb_ptr2 += 6;
+			y_ptr1 += 2;
+			y_ptr2 += 2;
+			uv_ptr += 2;
+		}
+	}
+}
+
+void nv21_rgb24_lut(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	const YUV2RGBLut *const lut = get_yuv2rgb_lut(yuv_type);
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*uv_ptr=UV+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		for(x=0; x<(width-1); x+=2)
+		{
+			lut_yuv2rgb_2x2(lut, uv_ptr[1], uv_ptr[0], y_ptr1, y_ptr2, rgb_ptr1, rgb_ptr2);
+			
+			rgb_ptr1 += 6;
+			rgb_ptr2 += 6;
+			y_ptr1 += 2;
+			y_ptr2 += 2;
+			uv_ptr += 2;
+		}
+	}
+}
+
+
+// Linear light conversions, between 8 bits yuv and linear float rgba, with the transfer function applied
+// through tables in the same pass.
+// For yuv to rgb, the nonlinear R', G' and B' values are computed from the analog matrix with 8 fractional
+// bits, and rounded to 4 fractional bits for the EOTF table index, so that they are never quantized to 8 bits.
+// The EOTF table has margins for values out of [0:255], so that they are clamped by the table.
+// For rgb to yuv, the inverse EOTF table is indexed by the exponent and the 7 highest mantissa bits of the
+// linear value, and linearly interpolated with the next mantissa bits, then Y, Cb and Cr are computed in
+// single precision and only rounded at the end.
+#define EOTF_SCALE 16
+// nonlinear values before clamping are in [-293:552], as for the 8 bits lookup tables
+#define EOTF_OFFSET (LUT_CLAMP_OFFSET*EOTF_SCALE)
+#define EOTF_SIZE (1024*EOTF_SCALE)
+#define OETF_MIN_EXPONENT (-24)   // linear values below 2^-24 are rounded up to 2^-24
+#define OETF_SIZE (-OETF_MIN_EXPONENT*128+2)
+
+typedef struct
+{
+	float eotf[EOTF_SIZE];          // linear value of nonlinear clamp((index-EOTF_OFFSET)/EOTF_SCALE)/255
+	uint16_t eotf_half[EOTF_SIZE];  // the same in half precision
+	float oetf[OETF_SIZE];          // 255*nonlinear value of linear 2^(i/128+OETF_MIN_EXPONENT)*(1+(i%128)/128)
+} TransferLut;
+
+static TransferLut transfer_luts[TRANSFER_BT1886+1];
+static int transfer_lut_state[TRANSFER_BT1886+1];     // 0: not built, 1: being built, 2: ready
+
+static double eotf(TransferFunction transfer, double value)
+{
+	if(transfer==TRANSFER_SRGB)
+		return value<=0.04045 ? value/12.92 : pow((value+0.055)/1.055, 2.4);
+	// BT.1886 with a white luminance of 1 and a black luminance of 0
+	return pow(value, 2.4);
+}
+
+static double inverse_eotf(TransferFunction transfer, double value)
+{
+	if(transfer==TRANSFER_SRGB)
+		return value<=0.0031308 ? value*12.92 : 1.055*pow(value, 1.0/2.4)-0.055;
+	return pow(value, 1.0/2.4);
+}
+
+// convert a value in [0:1] to half precision, rounded to nearest even
+static uint16_t float_to_half(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	if(bits==0)
+		return 0;
+	const int exponent = (int)(bits>>23)-127+15;
+	// subnormal halves have more shifted out bits
+	const uint32_t mantissa = (bits&0x7FFFFF)|0x800000, shift = 13 + (exponent<1 ? 1-exponent : 0);
+	if(shift>24)
+		return 0;
+	const uint32_t rest = mantissa&((1u<<shift)-1), halfway = 1u<<(shift-1);
+	uint32_t half = mantissa>>shift;
+	if(rest>halfway || (rest==halfway && (half&1)))
+		half++;
+	// a carry out of the mantissa gives the next exponent, as expected
+	return exponent<1 ? half : (exponent<<10) + half - 0x400;
+}
+
+// return the tables of a transfer function, built by the first caller and then shared by all threads
+static const TransferLut *get_transfer_lut(TransferFunction transfer)
+{
+	TransferLut *lut = &transfer_luts[transfer];
+	int *state = &transfer_lut_state[transfer];
+	int expected = 0;
+	if(__atomic_load_n(state, __ATOMIC_ACQUIRE)==2)
+		return lut;
+	if(__atomic_compare_exchange_n(state, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+	{
+		for(int i=0; i<EOTF_SIZE; ++i)
+		{
+			const int value = i<EOTF_OFFSET ? 0 : i>EOTF_OFFSET+255*EOTF_SCALE ? 255*EOTF_SCALE : i-EOTF_OFFSET;
+			lut->eotf[i] = eotf(transfer, value/(255.0*EOTF_SCALE));
+			lut->eotf_half[i] = float_to_half(lut->eotf[i]);
+		}
+		for(int i=0; i<OETF_SIZE; ++i)
+			lut->oetf[i] = 255.0*inverse_eotf(transfer, ldexp(1.0+(i%128)/128.0, i/128+OETF_MIN_EXPONENT));
+		__atomic_store_n(state, 2, __ATOMIC_RELEASE);
+		return lut;
+	}
+	// another thread is building the tables, it takes less than a millisecond
+	while(__atomic_load_n(state, __ATOMIC_ACQUIRE)!=2)
+		;
+	return lut;
+}
+
+// products of the yuv to rgb matrix for each 8 bits value, with LINEAR_MATRIX_PRECISION fractional bits
+#define LINEAR_MATRIX_PRECISION 8
+typedef struct
+{
+	int32_t y[256];     // (Y-YMin)*255/(YMax-YMin), plus 1/32 for the rounding of EOTF indexes
+	int32_t b_cb[256];  // (Cb-128)*(255*CbNorm)/CbRange
+	int32_t r_cr[256];  // (Cr-128)*(255*CrNorm)/CrRange
+	int32_t g_cb[256];  // (Cb-128)*Bf/Gf*(255*CbNorm)/CbRange
+	int32_t g_cr[256];  // (Cr-128)*Rf/Gf*(255*CrNorm)/CrRange
+} LinearMatrix;
+
+static void get_linear_matrix(YCbCrType yuv_type, LinearMatrix *matrix)
+{
+	const ColorSpaceParam *space = &COLOR_SPACE[yuv_type];
+	const double rf = space->r_factor, bf = space->b_factor, gf = 1.0-rf-bf, 
+		scale = 1<<LINEAR_MATRIX_PRECISION, 
+		cb_factor = 255.0*2.0*(1.0-bf)/space->cbcr_range, cr_factor = 255.0*2.0*(1.0-rf)/space->cbcr_range;
+	for(int i=0; i<256; ++i)
+	{
+		matrix->y[i] = lround((i-space->y_min)*255.0/(space->y_max-space->y_min)*scale) + (1<<(LINEAR_MATRIX_PRECISION-5));
+		matrix->b_cb[i] = lround((i-128)*cb_factor*scale);
+		matrix->r_cr[i] = lround((i-128)*cr_factor*scale);
+		matrix->g_cb[i] = lround((i-128)*bf/gf*cb_factor*scale);
+		matrix->g_cr[i] = lround((i-128)*rf/gf*cr_factor*scale);
+	}
+}
+
+// EOTF table index of a nonlinear value with LINEAR_MATRIX_PRECISION fractional bits, rounding is included
+// in the y table
+#define EOTF_INDEX(VALUE) (((VALUE)>>(LINEAR_MATRIX_PRECISION-4))+EOTF_OFFSET)
+
+ALWAYS_INLINE void save_linear_pixel(const TransferLut *lut, int32_t y_tmp, 
+	int32_t r_cr_offset, int32_t g_cbcr_offset, int32_t b_cb_offset, uint8_t *rgba_ptr, int half)
+{
+	const int32_t r = EOTF_INDEX(y_tmp + r_cr_offset), 
+		g = EOTF_INDEX(y_tmp - g_cbcr_offset), 
+		b = EOTF_INDEX(y_tmp + b_cb_offset);
+	if(half)
+	{
+		const uint16_t pixel[4] = {lut->eotf_half[r], lut->eotf_half[g], lut->eotf_half[b], 0x3C00};
+		memcpy(rgba_ptr, pixel, sizeof(pixel));
+	}
+	else
+	{
+		const float pixel[4] = {lut->eotf[r], lut->eotf[g], lut->eotf[b], 1.0f};
+		memcpy(rgba_ptr, pixel, sizeof(pixel));
+	}
+}
+
+// U and V are read every uv_step bytes, so that the same code handles planar and semi planar chroma
+ALWAYS_INLINE void yuv_rgbaf_std_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, uint32_t uv_step, 
+	uint8_t *RGBA, uint32_t RGBA_stride, int half, 
+	TransferFunction transfer, YCbCrType yuv_type)
+{
+	const TransferLut *const lut = get_transfer_lut(transfer);
+	const uint32_t pixel_size = half ? 8 : 16;
+	LinearMatrix matrix;
+	get_linear_matrix(yuv_type, &matrix);
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
 			*y_ptr2=Y+(y+1)*Y_stride,
 			*u_ptr=U+(y/2)*UV_stride,
 			*v_ptr=V+(y/2)*UV_stride;
 		
-		for(x=0; x<(width-31); x+=32)
+		uint8_t *rgba_ptr1=RGBA+y*RGBA_stride,
+			*rgba_ptr2=RGBA+(y+1)*RGBA_stride;
+		
+		for(x=0; x<(width-1); x+=2)
 		{
-			RGB2YUV_32
+			const int32_t b_cb_offset = matrix.b_cb[u_ptr[0]], 
+				r_cr_offset = matrix.r_cr[v_ptr[0]], 
+				g_cbcr_offset = matrix.g_cb[u_ptr[0]] + matrix.g_cr[v_ptr[0]];
 			
-			rgb_ptr1+=96;
-			rgb_ptr2+=96;
-			y_ptr1+=32;
-			y_ptr2+=32;
-			u_ptr+=16; 
-			v_ptr+=16;
+			save_linear_pixel(lut, matrix.y[y_ptr1[0]], r_cr_offset, g_cbcr_offset, b_cb_offset, rgba_ptr1, half);
+			save_linear_pixel(lut, matrix.y[y_ptr1[1]], r_cr_offset, g_cbcr_offset, b_cb_offset, rgba_ptr1+pixel_size, half);
+			save_linear_pixel(lut, matrix.y[y_ptr2[0]], r_cr_offset, g_cbcr_offset, b_cb_offset, rgba_ptr2, half);
+			save_linear_pixel(lut, matrix.y[y_ptr2[1]], r_cr_offset, g_cbcr_offset, b_cb_offset, rgba_ptr2+pixel_size, half);
+			
+			rgba_ptr1 += 2*pixel_size;
+			rgba_ptr2 += 2*pixel_size;
+			y_ptr1 += 2;
+			y_ptr2 += 2;
+			u_ptr += uv_step;
+			v_ptr += uv_step;
 		}
 	}
-	#undef LOAD_SI128
-	#undef SAVE_SI128
 }
 
-void rgb24_yuv420_sseu(uint32_t width, uint32_t height, 
-	const uint8_t *RGB, uint32_t RGB_stride, 
+void yuv420_rgbaf32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	float *RGBA, uint32_t RGBA_stride, 
+	TransferFunction transfer, YCbCrType yuv_type)
+{
+	yuv_rgbaf_std_impl(width, height, Y, U, V, Y_stride, UV_stride, 1, (uint8_t *)RGBA, RGBA_stride, 0, transfer, yuv_type);
+}
+
+void nv12_rgbaf32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	float *RGBA, uint32_t RGBA_stride, 
+	TransferFunction transfer, YCbCrType yuv_type)
+{
+	yuv_rgbaf_std_impl(width, height, Y, UV, UV+1, Y_stride, UV_stride, 2, (uint8_t *)RGBA, RGBA_stride, 0, transfer, yuv_type);
+}
+
+void yuv420_rgbaf16_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint16_t *RGBA, uint32_t RGBA_stride, 
+	TransferFunction transfer, YCbCrType yuv_type)
+{
+	yuv_rgbaf_std_impl(width, height, Y, U, V, Y_stride, UV_stride, 1, (uint8_t *)RGBA, RGBA_stride, 1, transfer, yuv_type);
+}
+
+void nv12_rgbaf16_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint16_t *RGBA, uint32_t RGBA_stride, 
+	TransferFunction transfer, YCbCrType yuv_type)
+{
+	yuv_rgbaf_std_impl(width, height, Y, UV, UV+1, Y_stride, UV_stride, 2, (uint8_t *)RGBA, RGBA_stride, 1, transfer, yuv_type);
+}
+
+// nonlinear value in [0:255] of a linear value, clamped to [2^-24:1] (NaN gives 2^-24)
+static inline float oetf_value(const TransferLut *lut, float value)
+{
+	value = value>0x1p-24f ? value : 0x1p-24f;
+	value = value<1.0f ? value : 1.0f;
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	// exponent and 7 highest mantissa bits give the index, the next 16 bits the interpolation weight
+	const uint32_t index = (bits>>16)-((127+OETF_MIN_EXPONENT)<<7);
+	const float weight = (float)(bits&0xFFFF)*(1.0f/65536.0f);
+	return lut->oetf[index] + (lut->oetf[index+1]-lut->oetf[index])*weight;
+}
+
+static inline uint8_t clamp_round_float(float value)
+{
+	return value<=0.0f ? 0 : value>=255.0f ? 255 : (uint8_t)(value+0.5f);
+}
+
+// rgb to yuv matrix in single precision, for nonlinear values in [0:255]
+typedef struct
+{
+	float r_factor;   // Rf
+	float g_factor;   // Gf
+	float b_factor;   // Bf
+	float cb_factor;  // CbRange/(255*CbNorm)/4, for the sum of four pixels
+	float cr_factor;  // CrRange/(255*CrNorm)/4
+	float y_factor;   // (YMax-YMin)/255
+	float y_offset;   // YMin+0.5, for rounding
+} LinearRGB2YUVParam;
+
+// convert one pixel, and add B-Y' and R-Y' to the sums of its block
+ALWAYS_INLINE void linear_rgb2yuv(const TransferLut *lut, const LinearRGB2YUVParam *param, 
+	const float *rgba_ptr, uint8_t *y_ptr, float *b_y_sum, float *r_y_sum)
+{
+	const float r = oetf_value(lut, rgba_ptr[0]), 
+		g = oetf_value(lut, rgba_ptr[1]), 
+		b = oetf_value(lut, rgba_ptr[2]);
+	const float y_tmp = param->r_factor*r + param->g_factor*g + param->b_factor*b;
+	// y_tmp is in [0:255], so Y is in range
+	y_ptr[0] = (uint8_t)(y_tmp*param->y_factor + param->y_offset);
+	*b_y_sum += b - y_tmp;
+	*r_y_sum += r - y_tmp;
+}
+
+void rgbaf32_yuv420_std(
+	uint32_t width, uint32_t height, 
+	const float *RGBA, uint32_t RGBA_stride, 
 	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
-	YCbCrType yuv_type)
+	TransferFunction transfer, YCbCrType yuv_type)
 {
-	#define LOAD_SI128 _mm_loadu_si128
-	#define SAVE_SI128 _mm_storeu_si128
-	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
-	
+	const TransferLut *const lut = get_transfer_lut(transfer);
+	const ColorSpaceParam *space = &COLOR_SPACE[yuv_type];
+	const LinearRGB2YUVParam param = {
+		.r_factor = space->r_factor, 
+		.g_factor = 1.0-space->r_factor-space->b_factor, 
+		.b_factor = space->b_factor, 
+		.cb_factor = space->cbcr_range/(255.0*2.0*(1.0-space->b_factor))/4.0, 
+		.cr_factor = space->cbcr_range/(255.0*2.0*(1.0-space->r_factor))/4.0, 
+		.y_factor = (space->y_max-space->y_min)/255.0, 
+		.y_offset = space->y_min+0.5};
 	uint32_t x, y;
 	for(y=0; y<(height-1); y+=2)
 	{
-		const uint8_t *rgb_ptr1=RGB+y*RGB_stride,
-			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		const float *rgba_ptr1=(const float *)((const uint8_t *)RGBA+y*RGBA_stride),
+			*rgba_ptr2=(const float *)((const uint8_t *)RGBA+(y+1)*RGBA_stride);
 		
 		uint8_t *y_ptr1=Y+y*Y_stride,
 			*y_ptr2=Y+(y+1)*Y_stride,
 			*u_ptr=U+(y/2)*UV_stride,
 			*v_ptr=V+(y/2)*UV_stride;
 		
-		for(x=0; x<(width-31); x+=32)
+		for(x=0; x<(width-1); x+=2)
 		{
-			RGB2YUV_32
+			float b_y_sum = 0.0f, r_y_sum = 0.0f;
+			linear_rgb2yuv(lut, &param, rgba_ptr1, y_ptr1, &b_y_sum, &r_y_sum);
+			linear_rgb2yuv(lut, &param, rgba_ptr1+4, y_ptr1+1, &b_y_sum, &r_y_sum);
+			linear_rgb2yuv(lut, &param, rgba_ptr2, y_ptr2, &b_y_sum, &r_y_sum);
+			linear_rgb2yuv(lut, &param, rgba_ptr2+4, y_ptr2+1, &b_y_sum, &r_y_sum);
+			u_ptr[0] = clamp_round_float(b_y_sum*param.cb_factor + 128.0f);
+			v_ptr[0] = clamp_round_float(r_y_sum*param.cr_factor + 128.0f);
 			
-			rgb_ptr1+=96;
-			rgb_ptr2+=96;
-			y_ptr1+=32;
-			y_ptr2+=32;
-			u_ptr+=16; 
-			v_ptr+=16;
+			rgba_ptr1 += 8;
+			rgba_ptr2 += 8;
+			y_ptr1 += 2;
+			y_ptr2 += 2;
+			u_ptr += 1;
+			v_ptr += 1;
 		}
 	}
-	#undef LOAD_SI128
-	#undef SAVE_SI128
 }
 
+// HDR to SDR conversions, with 12 bits nonlinear values and 14 bits linear values, see the canonical pipeline
+// above. Tables of the HDR transfer function and the tone curve, and of the sdr transfer function, are built
+// by hdr_tone_map_create.
+#define HDR_NONLINEAR_MAX 4095
+#define HDR_LINEAR_MAX 16383
+// luminance of the SDR reference white in cd/m2 (ITU-R BT.2408), and start of the tone curve shoulder, relative 
+// to it
+#define HDR_REFERENCE_WHITE 203.0
+#define HDR_KNEE 0.75
 
-// see rgba.txt
-#define UNPACK_RGB32_32_STEP(RS1, RS2, RS3, RS4, RS5, RS6, RS7, RS8, RD1, RD2, RD3, RD4, RD5, RD6, RD7, RD8) \
-RD1 = _mm_unpacklo_epi8(RS1, RS5); \
-RD2 = _mm_unpackhi_epi8(RS1, RS5); \
-RD3 = _mm_unpacklo_epi8(RS2, RS6); \
-RD4 = _mm_unpackhi_epi8(RS2, RS6); \
-RD5 = _mm_unpacklo_epi8(RS3, RS7); \
-RD6 = _mm_unpackhi_epi8(RS3, RS7); \
-RD7 = _mm_unpacklo_epi8(RS4, RS8); \
-RD8 = _mm_unpackhi_epi8(RS4, RS8);
+// factors from 10 bits BT.2020 limited range to 12 bits full range, with 11 fractional bits
+#define HDR_RF 0.2627
+#define HDR_BF 0.0593
+#define HDR_Y_FACTOR FIXED_POINT_VALUE(4095.0/876.0, 11)
+#define HDR_CB_FACTOR FIXED_POINT_VALUE(4095.0*2.0*(1.0-HDR_BF)/896.0, 11)
+#define HDR_CR_FACTOR FIXED_POINT_VALUE(4095.0*2.0*(1.0-HDR_RF)/896.0, 11)
+#define HDR_G_CB_FACTOR FIXED_POINT_VALUE(HDR_BF/(1.0-HDR_BF-HDR_RF)*4095.0*2.0*(1.0-HDR_BF)/896.0, 11)
+#define HDR_G_CR_FACTOR FIXED_POINT_VALUE(HDR_RF/(1.0-HDR_BF-HDR_RF)*4095.0*2.0*(1.0-HDR_RF)/896.0, 11)
 
+// BT.2020 to BT.709 primaries matrix (ITU-R BT.2087), with 12 fractional bits, rounded so that each line sums 
+// to 4096 and white stays white
+static const int32_t HDR_GAMUT[3][3] = {
+	{6801, -2407, -298}, 
+	{-510, 4640, -34}, 
+	{-74, -412, 4582}};
 
-#define RGBA2YUV_32 \
-	__m128i r_16, g_16, b_16; \
-	__m128i y1_16, y2_16, cb1_16, cb2_16, cr1_16, cr2_16, Y, cb, cr; \
-	__m128i tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8; \
-	__m128i rgb1 = LOAD_SI128((const __m128i*)(rgb_ptr1)), \
-		rgb2 = LOAD_SI128((const __m128i*)(rgb_ptr1+16)), \
-		rgb3 = LOAD_SI128((const __m128i*)(rgb_ptr1+32)), \
-		rgb4 = LOAD_SI128((const __m128i*)(rgb_ptr1+48)), \
-		rgb5 = LOAD_SI128((const __m128i*)(rgb_ptr2)), \
-		rgb6 = LOAD_SI128((const __m128i*)(rgb_ptr2+16)), \
-		rgb7 = LOAD_SI128((const __m128i*)(rgb_ptr2+32)), \
-		rgb8 = LOAD_SI128((const __m128i*)(rgb_ptr2+48)); \
-	/* unpack rgb24 data to r, g and b data in separate channels*/ \
-	/* see rgb.txt to get an idea of the algorithm, note that we only go to the next to last step*/ \
-	/* here, because averaging in horizontal direction is easier like this*/ \
-	/* The last step is applied further on the Y channel only*/ \
-	UNPACK_RGB32_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8) \
-	UNPACK_RGB32_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8) \
-	UNPACK_RGB32_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8) \
-	UNPACK_RGB32_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8) \
-	/* first compute Y', (B-Y') and (R-Y'), in 16bits values, for the first line */ \
-	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are saved*/ \
-	r_16 = _mm_unpacklo_epi8(rgb1, _mm_setzero_si128()); \
-	g_16 = _mm_unpacklo_epi8(rgb2, _mm_setzero_si128()); \
-	b_16 = _mm_unpacklo_epi8(rgb3, _mm_setzero_si128()); \
-	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y1_16 = _mm_srli_epi16(y1_16, 8); \
-	cb1_16 = _mm_sub_epi16(b_16, y1_16); \
-	cr1_16 = _mm_sub_epi16(r_16, y1_16); \
-	r_16 = _mm_unpacklo_epi8(rgb5, _mm_setzero_si128()); \
-	g_16 = _mm_unpacklo_epi8(rgb6, _mm_setzero_si128()); \
-	b_16 = _mm_unpacklo_epi8(rgb7, _mm_setzero_si128()); \
-	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y2_16 = _mm_srli_epi16(y2_16, 8); \
-	cb1_16 = _mm_add_epi16(cb1_16, _mm_sub_epi16(b_16, y2_16)); \
-	cr1_16 = _mm_add_epi16(cr1_16, _mm_sub_epi16(r_16, y2_16)); \
-	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
-	y1_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y1_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	y2_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y2_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	Y = _mm_packus_epi16(y1_16, y2_16); \
-	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
-	SAVE_SI128((__m128i*)(y_ptr1), Y); \
-	/* same for the second line, compute Y', (B-Y') and (R-Y'), in 16bits values */ \
+struct HdrToneMap
+{
+	uint16_t linear[HDR_NONLINEAR_MAX+1];  // tone mapped linear value of each nonlinear value
+	uint8_t sdr[HDR_LINEAR_MAX+1];         // sdr nonlinear value of each linear value
+};
+
+// luminance in cd/m2 of a nonlinear value in [0:1]
+static double hdr_eotf(HdrTransfer transfer, double value, double peak)
+{
+	if(transfer==HDR_TRANSFER_PQ)
+	{
+		const double m1 = 2610.0/16384.0, m2 = 2523.0/4096.0*128.0, 
+			c1 = 3424.0/4096.0, c2 = 2413.0/4096.0*32.0, c3 = 2392.0/4096.0*32.0;
+		const double p = pow(value, 1.0/m2);
+		return 10000.0*pow(fmax(p-c1, 0.0)/(c2-c3*p), 1.0/m1);
+	}
+	// inverse HLG OETF, then OOTF of a display of the peak luminance, with the system gamma extended to all
+	// peak luminances (ITU-R BT.2390), applied to each component instead of the scene luminance
+	const double a = 0.17883277, b = 1.0-4.0*a, c = 0.5-a*log(4.0*a);
+	const double scene = value<=0.5 ? value*value/3.0 : (exp((value-c)/a)+b)/12.0;
+	return peak*pow(scene, 1.2*pow(1.111, log2(peak/1000.0)));
+}
+
+// tone mapped linear value in [0:1] of a luminance, values up to HDR_KNEE times the reference white are kept, 
+// higher ones are compressed by an extended Reinhard curve, with a continuous slope, that maps the peak to 1
+static double hdr_tone_curve(double luminance, double peak)
+{
+	const double x = luminance/HDR_REFERENCE_WHITE, w = peak/HDR_REFERENCE_WHITE, k = HDR_KNEE;
+	if(x<=k || w<=1.0)
+		return x<1.0 ? x : 1.0;
+	if(x>=w)
+		return 1.0;
+	const double u = (x-k)/(1.0-k), m = (w-k)/(1.0-k);
+	return k + (1.0-k)*u*(1.0+u/(m*m))/(1.0+u);
+}
+
+HdrToneMap *hdr_tone_map_create(HdrTransfer transfer, float peak_luminance, TransferFunction sdr_transfer)
+{
+	if(!(peak_luminance>0.0f) || isinf(peak_luminance))
+		return NULL;
+	HdrToneMap *tone_map = malloc(sizeof(HdrToneMap));
+	if(!tone_map)
+		return NULL;
+	for(int i=0; i<=HDR_NONLINEAR_MAX; ++i)
+	{
+		const double luminance = hdr_eotf(transfer, (double)i/HDR_NONLINEAR_MAX, peak_luminance);
+		tone_map->linear[i] = lround(hdr_tone_curve(luminance, peak_luminance)*HDR_LINEAR_MAX);
+	}
+	for(int i=0; i<=HDR_LINEAR_MAX; ++i)
+		tone_map->sdr[i] = lround(255.0*inverse_eotf(sdr_transfer, (double)i/HDR_LINEAR_MAX));
+	return tone_map;
+}
+
+void hdr_tone_map_destroy(HdrToneMap *tone_map)
+{
+	free(tone_map);
+}
+
+// fixed point product of a value with 5 fractional bits and a factor with 11 fractional bits, as _mm_mulhi_epi16
+#define HDR_MUL(VALUE, FACTOR) (((VALUE)*(FACTOR))>>16)
+
+static inline int32_t clamp_hdr(int32_t value, int32_t max)
+{
+	return value<0 ? 0 : value>max ? max : value;
+}
+
+ALWAYS_INLINE void save_hdr_pixel(const HdrToneMap *tone_map, int32_t y_tmp, 
+	int32_t r_tmp, int32_t g_tmp, int32_t b_tmp, uint8_t *rgb_ptr, uint32_t pixel_size)
+{
+	const int32_t r = tone_map->linear[clamp_hdr(y_tmp + r_tmp, HDR_NONLINEAR_MAX)], 
+		g = tone_map->linear[clamp_hdr(y_tmp - g_tmp, HDR_NONLINEAR_MAX)], 
+		b = tone_map->linear[clamp_hdr(y_tmp + b_tmp, HDR_NONLINEAR_MAX)];
+	for(int i=0; i<3; ++i)
+		rgb_ptr[i] = tone_map->sdr[clamp_hdr((HDR_GAMUT[i][0]*r + HDR_GAMUT[i][1]*g + HDR_GAMUT[i][2]*b + 2048)>>12, HDR_LINEAR_MAX)];
+	if(pixel_size==4)
+		rgb_ptr[3] = 255;
+}
+
+// U and V are read every uv_step values, so that the same code handles planar and semi planar chroma, and
+// 10 bits values are in the low bits of 16 bits words shifted left by shift bits (6 for p010)
+ALWAYS_INLINE void hdr_rgb_std_impl(
+	uint32_t width, uint32_t height, 
+	const uint16_t *Y, const uint16_t *U, const uint16_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint32_t uv_step, uint32_t shift, 
+	uint8_t *RGB, uint32_t RGB_stride, uint32_t pixel_size, 
+	const HdrToneMap *tone_map)
+{
+	#define HDR_SAMPLE(PTR) ((int32_t)(((PTR)[0]>>shift)&0x3FF))
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint16_t *y_ptr1=(const uint16_t *)((const uint8_t *)Y+y*Y_stride),
+			*y_ptr2=(const uint16_t *)((const uint8_t *)Y+(y+1)*Y_stride),
+			*u_ptr=(const uint16_t *)((const uint8_t *)U+(y/2)*UV_stride),
+			*v_ptr=(const uint16_t *)((const uint8_t *)V+(y/2)*UV_stride);
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		for(x=0; x<(width-1); x+=2)
+		{
+			const int32_t u_tmp = (HDR_SAMPLE(u_ptr)-512)*32, 
+				v_tmp = (HDR_SAMPLE(v_ptr)-512)*32;
+			const int32_t r_tmp = HDR_MUL(v_tmp, HDR_CR_FACTOR), 
+				g_tmp = HDR_MUL(u_tmp, HDR_G_CB_FACTOR) + HDR_MUL(v_tmp, HDR_G_CR_FACTOR), 
+				b_tmp = HDR_MUL(u_tmp, HDR_CB_FACTOR);
+			
+			save_hdr_pixel(tone_map, HDR_MUL((HDR_SAMPLE(y_ptr1)-64)*32, HDR_Y_FACTOR), 
+				r_tmp, g_tmp, b_tmp, rgb_ptr1, pixel_size);
+			save_hdr_pixel(tone_map, HDR_MUL((HDR_SAMPLE(y_ptr1+1)-64)*32, HDR_Y_FACTOR), 
+				r_tmp, g_tmp, b_tmp, rgb_ptr1+pixel_size, pixel_size);
+			save_hdr_pixel(tone_map, HDR_MUL((HDR_SAMPLE(y_ptr2)-64)*32, HDR_Y_FACTOR), 
+				r_tmp, g_tmp, b_tmp, rgb_ptr2, pixel_size);
+			save_hdr_pixel(tone_map, HDR_MUL((HDR_SAMPLE(y_ptr2+1)-64)*32, HDR_Y_FACTOR), 
+				r_tmp, g_tmp, b_tmp, rgb_ptr2+pixel_size, pixel_size);
+			
+			rgb_ptr1 += 2*pixel_size;
+			rgb_ptr2 += 2*pixel_size;
+			y_ptr1 += 2;
+			y_ptr2 += 2;
+			u_ptr += uv_step;
+			v_ptr += uv_step;
+		}
+	}
+	#undef HDR_SAMPLE
+}
+
+void p010_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint16_t *Y, const uint16_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	const HdrToneMap *tone_map)
+{
+	hdr_rgb_std_impl(width, height, Y, UV, UV+1, Y_stride, UV_stride, 2, 6, RGB, RGB_stride, 3, tone_map);
+}
+
+void p010_rgba32_std(
+	uint32_t width, uint32_t height, 
+	const uint16_t *Y, const uint16_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	const HdrToneMap *tone_map)
+{
+	hdr_rgb_std_impl(width, height, Y, UV, UV+1, Y_stride, UV_stride, 2, 6, RGBA, RGBA_stride, 4, tone_map);
+}
+
+void yuv420p10_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint16_t *Y, const uint16_t *U, const uint16_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	const HdrToneMap *tone_map)
+{
+	hdr_rgb_std_impl(width, height, Y, U, V, Y_stride, UV_stride, 1, 0, RGB, RGB_stride, 3, tone_map);
+}
+
+void yuv420p10_rgba32_std(
+	uint32_t width, uint32_t height, 
+	const uint16_t *Y, const uint16_t *U, const uint16_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	const HdrToneMap *tone_map)
+{
+	hdr_rgb_std_impl(width, height, Y, U, V, Y_stride, UV_stride, 1, 0, RGBA, RGBA_stride, 4, tone_map);
+}
+
+// Luma only conversions, Cb and Cr are neither read nor written, and all pixels are converted,
+// including last column and line of odd sized images.
+// gray is Y' of the yuv to rgb conversion, written to pixel_size channels, alpha is set to 255
+ALWAYS_INLINE void luma_std_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, uint32_t Y_stride, 
+	uint8_t *GRAY, uint32_t GRAY_stride, uint32_t pixel_size, 
+	YCbCrType yuv_type)
+{
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *y_ptr=Y+y*Y_stride;
+		uint8_t *gray_ptr=GRAY+y*GRAY_stride;
+		for(x=0; x<width; ++x)
+		{
+			const uint8_t gray = clamp((param->y_factor*(y_ptr[0]-param->y_offset))>>7);
+			gray_ptr[0] = gray;
+			if(pixel_size>=3)
+			{
+				gray_ptr[1] = gray;
+				gray_ptr[2] = gray;
+			}
+			if(pixel_size==4)
+				gray_ptr[3] = 255;
+			
+			y_ptr += 1;
+			gray_ptr += pixel_size;
+		}
+	}
+}
+
+void luma_gray8_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, uint32_t Y_stride, 
+	uint8_t *GRAY, uint32_t GRAY_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(luma_std_impl, width, height, Y, Y_stride, GRAY, GRAY_stride, 1)
+}
+
+void luma_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, uint32_t Y_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(luma_std_impl, width, height, Y, Y_stride, RGB, RGB_stride, 3)
+}
+
+void luma_rgb32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, uint32_t Y_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(luma_std_impl, width, height, Y, Y_stride, RGBA, RGBA_stride, 4)
+}
+
+// Y of the rgb to yuv conversion, for rgb24 (pixel_size 3) or rgba (pixel_size 4)
+ALWAYS_INLINE void rgb_luma_std_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, uint32_t pixel_size, 
+	uint8_t *Y, uint32_t Y_stride, 
+	YCbCrType yuv_type)
+{
+	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		uint8_t *y_ptr=Y+y*Y_stride;
+		for(x=0; x<width; ++x)
+		{
+			const uint8_t y_tmp = (param->r_factor*rgb_ptr[0] + param->g_factor*rgb_ptr[1] + param->b_factor*rgb_ptr[2])>>8;
+			y_ptr[0] = ((y_tmp*param->y_factor)>>7) + param->y_offset;
+			
+			rgb_ptr += pixel_size;
+			y_ptr += 1;
+		}
+	}
+}
+
+void rgb24_luma_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *Y, uint32_t Y_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb_luma_std_impl, width, height, RGB, RGB_stride, 3, Y, Y_stride)
+}
+
+void rgb32_luma_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint32_t Y_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb_luma_std_impl, width, height, RGBA, RGBA_stride, 4, Y, Y_stride)
+}
+
+
+// Conversion between color spaces, see above for description
+// Each column of M is the conversion of a unit step of Y, Cb or Cr, through analog Y'CbCr and RGB
+static void yuv2yuv_param(YCbCrType src_type, YCbCrType dst_type, YUV2YUVParam *param)
+{
+	const ColorSpaceParam *src = &COLOR_SPACE[src_type], *dst = &COLOR_SPACE[dst_type];
+	for(int c=0; c<3; ++c)
+	{
+		const double y = c==0 ? 1.0/(src->y_max-src->y_min) : 0.0,
+			cb = c==1 ? 1.0/src->cbcr_range : 0.0,
+			cr = c==2 ? 1.0/src->cbcr_range : 0.0;
+		const double r = y + 2.0*(1.0-src->r_factor)*cr,
+			b = y + 2.0*(1.0-src->b_factor)*cb,
+			g = (y - src->r_factor*r - src->b_factor*b)/(1.0-src->r_factor-src->b_factor);
+		const double y2 = dst->r_factor*r + (1.0-dst->r_factor-dst->b_factor)*g + dst->b_factor*b;
+		const double m[3] = {
+			y2*(dst->y_max-dst->y_min),
+			(b-y2)/(2.0*(1.0-dst->b_factor))*dst->cbcr_range,
+			(r-y2)/(2.0*(1.0-dst->r_factor))*dst->cbcr_range};
+		for(int l=0; l<3; ++l)
+			param->matrix[l][c] = m[l]<0 ? -FIXED_POINT_VALUE(-m[l], 14) : FIXED_POINT_VALUE(m[l], 14);
+	}
+	param->y_offset = (int16_t)src->y_min;
+	param->y_offset_2 = (int16_t)dst->y_min;
+}
+
+#define YUV2YUV_MUL(X, M) (((X)*(M))>>16)
+
+// src_uv_step and dst_uv_step are 1 for planar chroma and 2 for semi planar chroma
+// all inputs of a block are read before its outputs are written, so that conversion can be done in place
+ALWAYS_INLINE void yuv2yuv_std_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, uint32_t src_uv_step, 
+	uint8_t *Y2, uint8_t *U2, uint8_t *V2, uint32_t Y2_stride, uint32_t UV2_stride, uint32_t dst_uv_step, 
+	const YUV2YUVParam *param)
+{
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		uint8_t *y2_ptr1=Y2+y*Y2_stride,
+			*y2_ptr2=Y2+(y+1)*Y2_stride,
+			*u2_ptr=U2+(y/2)*UV2_stride,
+			*v2_ptr=V2+(y/2)*UV2_stride;
+		
+		for(x=0; x<(width-1); x+=2)
+		{
+			const int y_11=y_ptr1[0], y_12=y_ptr1[1], y_21=y_ptr2[0], y_22=y_ptr2[1];
+			const int u_tmp=(u_ptr[0]-128)*64, v_tmp=(v_ptr[0]-128)*64;
+			
+			// contribution of Cb and Cr to Y, common to the four pixels
+			const int y_cbcr = YUV2YUV_MUL(u_tmp, param->matrix[0][1]) + YUV2YUV_MUL(v_tmp, param->matrix[0][2]) + 
+				param->y_offset_2*16 + 8;
+			y2_ptr1[0] = clamp((YUV2YUV_MUL((y_11-param->y_offset)*64, param->matrix[0][0]) + y_cbcr)>>4);
+			y2_ptr1[1] = clamp((YUV2YUV_MUL((y_12-param->y_offset)*64, param->matrix[0][0]) + y_cbcr)>>4);
+			y2_ptr2[0] = clamp((YUV2YUV_MUL((y_21-param->y_offset)*64, param->matrix[0][0]) + y_cbcr)>>4);
+			y2_ptr2[1] = clamp((YUV2YUV_MUL((y_22-param->y_offset)*64, param->matrix[0][0]) + y_cbcr)>>4);
+			u2_ptr[0] = clamp((YUV2YUV_MUL(u_tmp, param->matrix[1][1]) + YUV2YUV_MUL(v_tmp, param->matrix[1][2]) + 128*16 + 8)>>4);
+			v2_ptr[0] = clamp((YUV2YUV_MUL(u_tmp, param->matrix[2][1]) + YUV2YUV_MUL(v_tmp, param->matrix[2][2]) + 128*16 + 8)>>4);
+			
+			y_ptr1 += 2;
+			y_ptr2 += 2;
+			u_ptr += src_uv_step;
+			v_ptr += src_uv_step;
+			y2_ptr1 += 2;
+			y2_ptr2 += 2;
+			u2_ptr += dst_uv_step;
+			v2_ptr += dst_uv_step;
+		}
+	}
+}
+
+void yuv420_yuv420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *U2, uint8_t *V2, uint32_t Y2_stride, uint32_t UV2_stride, 
+	YCbCrType src_type, YCbCrType dst_type)
+{
+	YUV2YUVParam param;
+	yuv2yuv_param(src_type, dst_type, &param);
+	yuv2yuv_std_impl(width, height, Y, U, V, Y_stride, UV_stride, 1, Y2, U2, V2, Y2_stride, UV2_stride, 1, &param);
+}
+
+void nv12_nv12_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *UV2, uint32_t Y2_stride, uint32_t UV2_stride, 
+	YCbCrType src_type, YCbCrType dst_type)
+{
+	YUV2YUVParam param;
+	yuv2yuv_param(src_type, dst_type, &param);
+	yuv2yuv_std_impl(width, height, Y, UV, UV+1, Y_stride, UV_stride, 2, Y2, UV2, UV2+1, Y2_stride, UV2_stride, 2, &param);
+}
+
+// Chroma layout conversions only move bytes, so that all pixels are processed, including the last column 
+// and line of odd sizes. The Y plane is copied line by line, unless the destination is NULL or the source.
+
+static void copy_plane_std(uint32_t width, uint32_t height, const uint8_t *src, uint32_t src_stride, 
+	uint8_t *dst, uint32_t dst_stride)
+{
+	if(!dst || dst==src)
+		return;
+	for(uint32_t y=0; y<height; ++y)
+		memcpy(dst+(size_t)y*dst_stride, src+(size_t)y*src_stride, width);
+}
+
+// U and V planes to a UV plane, or to a VU plane when called with swapped U and V
+static void interleave_uv_std(uint32_t width, uint32_t height, 
+	const uint8_t *U, const uint8_t *V, uint32_t UV_stride, 
+	uint8_t *UV2, uint32_t UV2_stride)
+{
+	const uint32_t uv_width=(width+1)/2, uv_height=(height+1)/2;
+	for(uint32_t y=0; y<uv_height; ++y)
+	{
+		const uint8_t *u_ptr=U+(size_t)y*UV_stride, *v_ptr=V+(size_t)y*UV_stride;
+		uint8_t *uv_ptr=UV2+(size_t)y*UV2_stride;
+		for(uint32_t x=0; x<uv_width; ++x)
+		{
+			uv_ptr[2*x] = u_ptr[x];
+			uv_ptr[2*x+1] = v_ptr[x];
+		}
+	}
+}
+
+// UV plane to U and V planes, or VU plane when called with swapped U and V
+static void deinterleave_uv_std(uint32_t width, uint32_t height, 
+	const uint8_t *UV, uint32_t UV_stride, 
+	uint8_t *U2, uint8_t *V2, uint32_t UV2_stride)
+{
+	const uint32_t uv_width=(width+1)/2, uv_height=(height+1)/2;
+	for(uint32_t y=0; y<uv_height; ++y)
+	{
+		const uint8_t *uv_ptr=UV+(size_t)y*UV_stride;
+		uint8_t *u_ptr=U2+(size_t)y*UV2_stride, *v_ptr=V2+(size_t)y*UV2_stride;
+		for(uint32_t x=0; x<uv_width; ++x)
+		{
+			u_ptr[x] = uv_ptr[2*x];
+			v_ptr[x] = uv_ptr[2*x+1];
+		}
+	}
+}
+
+// exchange the two bytes of each chroma sample, works in place
+static void swap_uv_std(uint32_t width, uint32_t height, 
+	const uint8_t *UV, uint32_t UV_stride, 
+	uint8_t *UV2, uint32_t UV2_stride)
+{
+	const uint32_t uv_width=(width+1)/2, uv_height=(height+1)/2;
+	for(uint32_t y=0; y<uv_height; ++y)
+	{
+		const uint8_t *uv_ptr=UV+(size_t)y*UV_stride;
+		uint8_t *uv2_ptr=UV2+(size_t)y*UV2_stride;
+		for(uint32_t x=0; x<uv_width; ++x)
+		{
+			const uint8_t u=uv_ptr[2*x], v=uv_ptr[2*x+1];
+			uv2_ptr[2*x] = v;
+			uv2_ptr[2*x+1] = u;
+		}
+	}
+}
+
+void yuv420_nv12_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *UV2, uint32_t Y2_stride, uint32_t UV2_stride)
+{
+	copy_plane_std(width, height, Y, Y_stride, Y2, Y2_stride);
+	interleave_uv_std(width, height, U, V, UV_stride, UV2, UV2_stride);
+}
+
+void yuv420_nv21_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *VU2, uint32_t Y2_stride, uint32_t VU2_stride)
+{
+	copy_plane_std(width, height, Y, Y_stride, Y2, Y2_stride);
+	interleave_uv_std(width, height, V, U, UV_stride, VU2, VU2_stride);
+}
+
+void nv12_yuv420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *U2, uint8_t *V2, uint32_t Y2_stride, uint32_t UV2_stride)
+{
+	copy_plane_std(width, height, Y, Y_stride, Y2, Y2_stride);
+	deinterleave_uv_std(width, height, UV, UV_stride, U2, V2, UV2_stride);
+}
+
+void nv21_yuv420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *VU, uint32_t Y_stride, uint32_t VU_stride, 
+	uint8_t *Y2, uint8_t *U2, uint8_t *V2, uint32_t Y2_stride, uint32_t UV2_stride)
+{
+	copy_plane_std(width, height, Y, Y_stride, Y2, Y2_stride);
+	deinterleave_uv_std(width, height, VU, VU_stride, V2, U2, UV2_stride);
+}
+
+void nv12_nv21_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *VU2, uint32_t Y2_stride, uint32_t VU2_stride)
+{
+	copy_plane_std(width, height, Y, Y_stride, Y2, Y2_stride);
+	swap_uv_std(width, height, UV, UV_stride, VU2, VU2_stride);
+}
+
+// 16 bits rgb output, rgb565 (green_bits=6) or rgb555 (green_bits=5), stored as little endian words
+// With dither, a threshold of the 4x4 ordered dither matrix, scaled to the quantization step of each 
+// component, is added to the 8 bits value before truncation. Thresholds only depend on the position of 
+// the pixel in the image, so that still images stay still.
+
+// thresholds, in 1/16 of a quantization step
+static const uint8_t DITHER_4X4[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+// select the kernel specialization for dither and color space
+#define SPECIALIZE_RGB16(kernel, ...) \
+	if(dither) \
+	{ \
+		SPECIALIZE_YUV_TYPE(kernel, __VA_ARGS__, 1) \
+	} \
+	else \
+	{ \
+		SPECIALIZE_YUV_TYPE(kernel, __VA_ARGS__, 0) \
+	}
+
+ALWAYS_INLINE void pack_rgb16(uint8_t *rgb_ptr, int16_t r, int16_t g, int16_t b, uint8_t threshold, 
+	int green_bits, int dither)
+{
+	uint16_t r8=clamp(r), g8=clamp(g), b8=clamp(b);
+	if(dither)
+	{
+		r8 = r8+(threshold>>1)>255 ? 255 : r8+(threshold>>1);
+		g8 = g8+(threshold>>(green_bits-4))>255 ? 255 : g8+(threshold>>(green_bits-4));
+		b8 = b8+(threshold>>1)>255 ? 255 : b8+(threshold>>1);
+	}
+	const uint16_t value = ((r8>>3)<<(green_bits+5)) | ((g8>>(8-green_bits))<<5) | (b8>>3);
+	rgb_ptr[0] = value&0xFF;
+	rgb_ptr[1] = value>>8;
+}
+
+ALWAYS_INLINE void yuv420_rgb16_std_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, uint32_t uv_step, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int green_bits, int dither, YCbCrType yuv_type)
+{
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		const uint8_t *dither1=DITHER_4X4[y&3], *dither2=DITHER_4X4[(y+1)&3];
+		
+		for(x=0; x<(width-1); x+=2)
+		{
+			int8_t u_tmp, v_tmp;
+			u_tmp = u_ptr[0]-128;
+			v_tmp = v_ptr[0]-128;
+			
+			//compute Cb Cr color offsets, common to four pixels
+			int16_t b_cb_offset, r_cr_offset, g_cbcr_offset;
+			b_cb_offset = (param->cb_factor*u_tmp)>>6;
+			r_cr_offset = (param->cr_factor*v_tmp)>>6;
+			g_cbcr_offset = (param->g_cb_factor*u_tmp + param->g_cr_factor*v_tmp)>>7;
+			
+			int16_t y_tmp;
+			y_tmp = (param->y_factor*(y_ptr1[0]-param->y_offset))>>7;
+			pack_rgb16(rgb_ptr1, y_tmp + r_cr_offset, y_tmp - g_cbcr_offset, y_tmp + b_cb_offset, 
+				dither1[x&3], green_bits, dither);
+			
+			y_tmp = (param->y_factor*(y_ptr1[1]-param->y_offset))>>7;
+			pack_rgb16(rgb_ptr1+2, y_tmp + r_cr_offset, y_tmp - g_cbcr_offset, y_tmp + b_cb_offset, 
+				dither1[(x+1)&3], green_bits, dither);
+			
+			y_tmp = (param->y_factor*(y_ptr2[0]-param->y_offset))>>7;
+			pack_rgb16(rgb_ptr2, y_tmp + r_cr_offset, y_tmp - g_cbcr_offset, y_tmp + b_cb_offset, 
+				dither2[x&3], green_bits, dither);
+			
+			y_tmp = (param->y_factor*(y_ptr2[1]-param->y_offset))>>7;
+			pack_rgb16(rgb_ptr2+2, y_tmp + r_cr_offset, y_tmp - g_cbcr_offset, y_tmp + b_cb_offset, 
+				dither2[(x+1)&3], green_bits, dither);
+			
+			rgb_ptr1 += 4;
+			rgb_ptr2 += 4;
+			y_ptr1 += 2;
+			y_ptr2 += 2;
+			u_ptr += uv_step;
+			v_ptr += uv_step;
+		}
+	}
+}
+
+void yuv420_rgb565_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int dither, YCbCrType yuv_type)
+{
+	SPECIALIZE_RGB16(yuv420_rgb16_std_impl, width, height, Y, U, V, Y_stride, UV_stride, 1, RGB, RGB_stride, 6)
+}
+
+void yuv420_rgb555_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int dither, YCbCrType yuv_type)
+{
+	SPECIALIZE_RGB16(yuv420_rgb16_std_impl, width, height, Y, U, V, Y_stride, UV_stride, 1, RGB, RGB_stride, 5)
+}
+
+void nv12_rgb565_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int dither, YCbCrType yuv_type)
+{
+	SPECIALIZE_RGB16(yuv420_rgb16_std_impl, width, height, Y, UV, UV+1, Y_stride, UV_stride, 2, RGB, RGB_stride, 6)
+}
+
+void nv12_rgb555_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int dither, YCbCrType yuv_type)
+{
+	SPECIALIZE_RGB16(yuv420_rgb16_std_impl, width, height, Y, UV, UV+1, Y_stride, UV_stride, 2, RGB, RGB_stride, 5)
+}
+
+// Packed rgb utilities, that only move bytes, all pixels are processed
+// swap exchanges the first and third bytes of each pixel (rgb <-> bgr)
+
+ALWAYS_INLINE void rgb24_rgba32_std_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t alpha, int swap)
+{
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		uint8_t *rgba_ptr=RGBA+y*RGBA_stride;
+		for(x=0; x<width; ++x)
+		{
+			rgba_ptr[0] = rgb_ptr[swap ? 2 : 0];
+			rgba_ptr[1] = rgb_ptr[1];
+			rgba_ptr[2] = rgb_ptr[swap ? 0 : 2];
+			rgba_ptr[3] = alpha;
+			rgb_ptr += 3;
+			rgba_ptr += 4;
+		}
+	}
+}
+
+ALWAYS_INLINE void rgba32_rgb24_std_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int swap)
+{
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgba_ptr=RGBA+y*RGBA_stride;
+		uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		for(x=0; x<width; ++x)
+		{
+			rgb_ptr[0] = rgba_ptr[swap ? 2 : 0];
+			rgb_ptr[1] = rgba_ptr[1];
+			rgb_ptr[2] = rgba_ptr[swap ? 0 : 2];
+			rgba_ptr += 4;
+			rgb_ptr += 3;
+		}
+	}
+}
+
+void rgb24_rgba32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t alpha)
+{
+	rgb24_rgba32_std_impl(width, height, RGB, RGB_stride, RGBA, RGBA_stride, alpha, 0);
+}
+
+void rgb24_bgra32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *BGRA, uint32_t BGRA_stride, 
+	uint8_t alpha)
+{
+	rgb24_rgba32_std_impl(width, height, RGB, RGB_stride, BGRA, BGRA_stride, alpha, 1);
+}
+
+void rgba32_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *RGB, uint32_t RGB_stride)
+{
+	rgba32_rgb24_std_impl(width, height, RGBA, RGBA_stride, RGB, RGB_stride, 0);
+}
+
+void bgra32_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *BGRA, uint32_t BGRA_stride, 
+	uint8_t *RGB, uint32_t RGB_stride)
+{
+	rgba32_rgb24_std_impl(width, height, BGRA, BGRA_stride, RGB, RGB_stride, 1);
+}
+
+void rgb24_bgr24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *BGR, uint32_t BGR_stride)
+{
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		uint8_t *bgr_ptr=BGR+y*BGR_stride;
+		for(x=0; x<width; ++x)
+		{
+			const uint8_t r=rgb_ptr[0], b=rgb_ptr[2];
+			bgr_ptr[0] = b;
+			bgr_ptr[1] = rgb_ptr[1];
+			bgr_ptr[2] = r;
+			rgb_ptr += 3;
+			bgr_ptr += 3;
+		}
+	}
+}
+
+void rgba32_bgra32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *BGRA, uint32_t BGRA_stride)
+{
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgba_ptr=RGBA+y*RGBA_stride;
+		uint8_t *bgra_ptr=BGRA+y*BGRA_stride;
+		for(x=0; x<width; ++x)
+		{
+			const uint8_t r=rgba_ptr[0], b=rgba_ptr[2];
+			bgra_ptr[0] = b;
+			bgra_ptr[1] = rgba_ptr[1];
+			bgra_ptr[2] = r;
+			bgra_ptr[3] = rgba_ptr[3];
+			rgba_ptr += 4;
+			bgra_ptr += 4;
+		}
+	}
+}
+
+void rgb24_rgb_planes_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *R, uint8_t *G, uint8_t *B, uint32_t planes_stride)
+{
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		uint8_t *r_ptr=R+y*planes_stride, *g_ptr=G+y*planes_stride, *b_ptr=B+y*planes_stride;
+		for(x=0; x<width; ++x)
+		{
+			r_ptr[x] = rgb_ptr[3*x];
+			g_ptr[x] = rgb_ptr[3*x+1];
+			b_ptr[x] = rgb_ptr[3*x+2];
+		}
+	}
+}
+
+void rgb_planes_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *R, const uint8_t *G, const uint8_t *B, uint32_t planes_stride, 
+	uint8_t *RGB, uint32_t RGB_stride)
+{
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *r_ptr=R+y*planes_stride, *g_ptr=G+y*planes_stride, *b_ptr=B+y*planes_stride;
+		uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		for(x=0; x<width; ++x)
+		{
+			rgb_ptr[3*x] = r_ptr[x];
+			rgb_ptr[3*x+1] = g_ptr[x];
+			rgb_ptr[3*x+2] = b_ptr[x];
+		}
+	}
+}
+
+// yuva420 to rgba32 or bgra32 (swap set), with optional premultiplied alpha
+// c*a/255 is rounded to the nearest value with integer operations only, t=c*a+128 and (t+(t>>8))>>8 give 
+// the exact result for all 8 bits values
+#define PREMULTIPLY_ALPHA(C, A) ((((C)*(A)+128) + (((C)*(A)+128)>>8))>>8)
+
+// select the kernel specialization for premultiply and color space
+#define SPECIALIZE_PREMULTIPLY(kernel, ...) \
+	if(premultiply) \
+	{ \
+		SPECIALIZE_YUV_TYPE(kernel, __VA_ARGS__, 1) \
+	} \
+	else \
+	{ \
+		SPECIALIZE_YUV_TYPE(kernel, __VA_ARGS__, 0) \
+	}
+
+ALWAYS_INLINE void pack_rgba32(uint8_t *rgba_ptr, int16_t r, int16_t g, int16_t b, uint8_t a, 
+	int swap, int premultiply)
+{
+	uint8_t r8=clamp(r), g8=clamp(g), b8=clamp(b);
+	if(premultiply)
+	{
+		r8 = PREMULTIPLY_ALPHA(r8, a);
+		g8 = PREMULTIPLY_ALPHA(g8, a);
+		b8 = PREMULTIPLY_ALPHA(b8, a);
+	}
+	rgba_ptr[0] = swap ? b8 : r8;
+	rgba_ptr[1] = g8;
+	rgba_ptr[2] = swap ? r8 : b8;
+	rgba_ptr[3] = a;
+}
+
+ALWAYS_INLINE void yuva420_rgba32_std_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, const uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	int swap, int premultiply, YCbCrType yuv_type)
+{
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*a_ptr1=A+y*Y_stride,
+			*a_ptr2=A+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		uint8_t *rgba_ptr1=RGBA+y*RGBA_stride,
+			*rgba_ptr2=RGBA+(y+1)*RGBA_stride;
+		
+		for(x=0; x<(width-1); x+=2)
+		{
+			int8_t u_tmp, v_tmp;
+			u_tmp = u_ptr[0]-128;
+			v_tmp = v_ptr[0]-128;
+			
+			//compute Cb Cr color offsets, common to four pixels
+			int16_t b_cb_offset, r_cr_offset, g_cbcr_offset;
+			b_cb_offset = (param->cb_factor*u_tmp)>>6;
+			r_cr_offset = (param->cr_factor*v_tmp)>>6;
+			g_cbcr_offset = (param->g_cb_factor*u_tmp + param->g_cr_factor*v_tmp)>>7;
+			
+			int16_t y_tmp;
+			y_tmp = (param->y_factor*(y_ptr1[0]-param->y_offset))>>7;
+			pack_rgba32(rgba_ptr1, y_tmp + r_cr_offset, y_tmp - g_cbcr_offset, y_tmp + b_cb_offset, a_ptr1[0], swap, premultiply);
+			
+			y_tmp = (param->y_factor*(y_ptr1[1]-param->y_offset))>>7;
+			pack_rgba32(rgba_ptr1+4, y_tmp + r_cr_offset, y_tmp - g_cbcr_offset, y_tmp + b_cb_offset, a_ptr1[1], swap, premultiply);
+			
+			y_tmp = (param->y_factor*(y_ptr2[0]-param->y_offset))>>7;
+			pack_rgba32(rgba_ptr2, y_tmp + r_cr_offset, y_tmp - g_cbcr_offset, y_tmp + b_cb_offset, a_ptr2[0], swap, premultiply);
+			
+			y_tmp = (param->y_factor*(y_ptr2[1]-param->y_offset))>>7;
+			pack_rgba32(rgba_ptr2+4, y_tmp + r_cr_offset, y_tmp - g_cbcr_offset, y_tmp + b_cb_offset, a_ptr2[1], swap, premultiply);
+			
+			rgba_ptr1 += 8;
+			rgba_ptr2 += 8;
+			y_ptr1 += 2;
+			y_ptr2 += 2;
+			a_ptr1 += 2;
+			a_ptr2 += 2;
+			u_ptr += 1;
+			v_ptr += 1;
+		}
+	}
+}
+
+void yuva420_rgba32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, const uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	int premultiply, YCbCrType yuv_type)
+{
+	SPECIALIZE_PREMULTIPLY(yuva420_rgba32_std_impl, width, height, Y, U, V, A, Y_stride, UV_stride, RGBA, RGBA_stride, 0)
+}
+
+void yuva420_bgra32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, const uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *BGRA, uint32_t BGRA_stride, 
+	int premultiply, YCbCrType yuv_type)
+{
+	SPECIALIZE_PREMULTIPLY(yuva420_rgba32_std_impl, width, height, Y, U, V, A, Y_stride, UV_stride, BGRA, BGRA_stride, 1)
+}
+
+// Alpha blending of overlays, see above for description
+// Loops are on the 2x2 blocks of the image that intersect the overlay, and pixels of a block that are outside
+// of the overlay are skipped. uv_step is 1 for planar chroma and 2 for semi planar chroma.
+
+// alpha rescaled to [0:256], so that blending is done with shifts
+#define BLEND_ALPHA(A) ((A)+((A)>>7))
+
+ALWAYS_INLINE void blend_rgba32_std_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, uint32_t uv_step, 
+	uint32_t left, uint32_t top, YCbCrType yuv_type)
+{
+	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
+	uint32_t x, y, i, j;
+	for(y=top&~1u; y<top+height; y+=2)
+	{
+		uint8_t *u_ptr=U+(y/2)*UV_stride+(left/2)*uv_step,
+			*v_ptr=V+(y/2)*UV_stride+(left/2)*uv_step;
+		
+		for(x=left&~1u; x<left+width; x+=2)
+		{
+			uint16_t a_sum=0;
+			int16_t u_sum=0, v_sum=0;
+			for(j=y; j<y+2; ++j)
+			for(i=x; i<x+2; ++i)
+			{
+				if(j<top || j>=top+height || i<left || i>=left+width)
+					continue;
+				
+				const uint8_t *rgba_ptr=RGBA+(j-top)*RGBA_stride+(i-left)*4;
+				uint8_t *y_ptr=Y+j*Y_stride+i;
+				const uint16_t a=BLEND_ALPHA(rgba_ptr[3]);
+				uint16_t y_tmp;
+				
+				y_tmp = (param->r_factor*rgba_ptr[0] + param->g_factor*rgba_ptr[1] + param->b_factor*rgba_ptr[2])>>8;
+				u_sum += ((rgba_ptr[2]-y_tmp)*a)>>8;
+				v_sum += ((rgba_ptr[0]-y_tmp)*a)>>8;
+				a_sum += a;
+				y_tmp = ((y_tmp*param->y_factor)>>7) + param->y_offset;
+				y_ptr[0] = (y_ptr[0]*(256-a) + y_tmp*a + 128)>>8;
+			}
+			
+			a_sum >>= 2;
+			u_ptr[0] = clamp(((u_ptr[0]*(256-a_sum) + 128*a_sum + 128)>>8) + (((u_sum>>2)*param->cb_factor)>>8));
+			v_ptr[0] = clamp(((v_ptr[0]*(256-a_sum) + 128*a_sum + 128)>>8) + (((v_sum>>2)*param->cr_factor)>>8));
+			
+			u_ptr += uv_step;
+			v_ptr += uv_step;
+		}
+	}
+}
+
+void yuv420_blend_rgba32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint32_t left, uint32_t top, YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(blend_rgba32_std_impl, width, height, RGBA, RGBA_stride, Y, U, V, Y_stride, UV_stride, 1, left, top)
+}
+
+void nv12_blend_rgba32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint32_t left, uint32_t top, YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(blend_rgba32_std_impl, width, height, RGBA, RGBA_stride, Y, UV, UV+1, Y_stride, UV_stride, 2, left, top)
+}
+
+// left and top are even, so that blocks of the overlay are blocks of the image
+static void blend_yuva420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *OY, const uint8_t *OU, const uint8_t *OV, const uint8_t *OA, uint32_t OY_stride, uint32_t OUV_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, uint32_t uv_step, 
+	uint32_t left, uint32_t top)
+{
+	uint32_t x, y, i, j;
+	for(y=0; y<height; y+=2)
+	{
+		const uint8_t *ou_ptr=OU+(y/2)*OUV_stride,
+			*ov_ptr=OV+(y/2)*OUV_stride;
+		uint8_t *u_ptr=U+((top+y)/2)*UV_stride+(left/2)*uv_step,
+			*v_ptr=V+((top+y)/2)*UV_stride+(left/2)*uv_step;
+		
+		for(x=0; x<width; x+=2)
+		{
+			uint16_t a_sum=0;
+			for(j=y; j<y+2 && j<height; ++j)
+			for(i=x; i<x+2 && i<width; ++i)
+			{
+				const uint16_t a=BLEND_ALPHA(OA[j*OY_stride+i]);
+				uint8_t *y_ptr=Y+(top+j)*Y_stride+left+i;
+				y_ptr[0] = (y_ptr[0]*(256-a) + OY[j*OY_stride+i]*a + 128)>>8;
+				a_sum += a;
+			}
+			
+			a_sum >>= 2;
+			u_ptr[0] = (u_ptr[0]*(256-a_sum) + ou_ptr[0]*a_sum + 128)>>8;
+			v_ptr[0] = (v_ptr[0]*(256-a_sum) + ov_ptr[0]*a_sum + 128)>>8;
+			
+			ou_ptr += 1;
+			ov_ptr += 1;
+			u_ptr += uv_step;
+			v_ptr += uv_step;
+		}
+	}
+}
+
+void yuv420_blend_yuva420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *OY, const uint8_t *OU, const uint8_t *OV, const uint8_t *OA, uint32_t OY_stride, uint32_t OUV_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint32_t left, uint32_t top)
+{
+	blend_yuva420_std(width, height, OY, OU, OV, OA, OY_stride, OUV_stride, Y, U, V, Y_stride, UV_stride, 1, left, top);
+}
+
+void nv12_blend_yuva420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *OY, const uint8_t *OU, const uint8_t *OV, const uint8_t *OA, uint32_t OY_stride, uint32_t OUV_stride, 
+	uint8_t *Y, uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint32_t left, uint32_t top)
+{
+	blend_yuva420_std(width, height, OY, OU, OV, OA, OY_stride, OUV_stride, Y, UV, UV+1, Y_stride, UV_stride, 2, left, top);
+}
+
+
+#ifdef _YUVRGB_SSE2_
+
+//see rgb.txt
+#define UNPACK_RGB24_32_STEP(RS1, RS2, RS3, RS4, RS5, RS6, RD1, RD2, RD3, RD4, RD5, RD6) \
+RD1 = _mm_unpacklo_epi8(RS1, RS4); \
+RD2 = _mm_unpackhi_epi8(RS1, RS4); \
+RD3 = _mm_unpacklo_epi8(RS2, RS5); \
+RD4 = _mm_unpackhi_epi8(RS2, RS5); \
+RD5 = _mm_unpacklo_epi8(RS3, RS6); \
+RD6 = _mm_unpackhi_epi8(RS3, RS6);
+
+#define RGB2YUV_16(R, G, B, Y, U, V) \
+Y = _mm_add_epi16(_mm_mullo_epi16(R, _mm_set1_epi16(param->r_factor)), \
+                  _mm_mullo_epi16(G, _mm_set1_epi16(param->g_factor))); \
+Y = _mm_add_epi16(Y, _mm_mullo_epi16(B, _mm_set1_epi16(param->b_factor))); \
+Y = _mm_srli_epi16(Y, 8); \
+U = _mm_mullo_epi16(_mm_sub_epi16(B, Y), _mm_set1_epi16(param->cb_factor)); \
+U = _mm_add_epi16(_mm_srai_epi16(U, 8), _mm_set1_epi16(128)); \
+V = _mm_mullo_epi16(_mm_sub_epi16(R, Y), _mm_set1_epi16(param->cr_factor)); \
+V = _mm_add_epi16(_mm_srai_epi16(V, 8), _mm_set1_epi16(128)); \
+Y = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(Y, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset));
+
+// Y = ((Y*[(YMax-YMin)/255])>>7) + YMin, Y is lower than 256 so that both steps are no-ops for full range
+#define SCALE_Y_16(Y) \
+	if(param->y_factor!=128) \
+		Y = _mm_srli_epi16(_mm_mullo_epi16(Y, _mm_set1_epi16(param->y_factor)), 7); \
+	if(param->y_offset!=0) \
+		Y = _mm_add_epi16(Y, _mm_set1_epi16(param->y_offset)); \
+
+#define RGB2YUV_32 \
+	__m128i r_16, g_16, b_16; \
+	__m128i y1_16, y2_16, cb1_16, cb2_16, cr1_16, cr2_16, Y, cb, cr; \
+	__m128i tmp1, tmp2, tmp3, tmp4, tmp5, tmp6; \
+	__m128i rgb1 = LOAD_SI128((const __m128i*)(rgb_ptr1)), \
+		rgb2 = LOAD_SI128((const __m128i*)(rgb_ptr1+16)), \
+		rgb3 = LOAD_SI128((const __m128i*)(rgb_ptr1+32)), \
+		rgb4 = LOAD_SI128((const __m128i*)(rgb_ptr2)), \
+		rgb5 = LOAD_SI128((const __m128i*)(rgb_ptr2+16)), \
+		rgb6 = LOAD_SI128((const __m128i*)(rgb_ptr2+32)); \
+	/* unpack rgb24 data to r, g and b data in separate channels*/ \
+	/* see rgb.txt to get an idea of the algorithm, note that we only go to the next to last step*/ \
+	/* here, because averaging in horizontal direction is easier like this*/ \
+	/* The last step is applied further on the Y channel only*/ \
+	UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6) \
+	UNPACK_RGB24_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6) \
+	UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6) \
+	UNPACK_RGB24_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6) \
+	/* first compute Y', (B-Y') and (R-Y'), in 16bits values, for the first line */ \
+	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are saved*/ \
+	r_16 = _mm_unpacklo_epi8(rgb1, _mm_setzero_si128()); \
+	g_16 = _mm_unpacklo_epi8(rgb2, _mm_setzero_si128()); \
+	b_16 = _mm_unpacklo_epi8(rgb3, _mm_setzero_si128()); \
+	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y1_16 = _mm_srli_epi16(y1_16, 8); \
+	cb1_16 = _mm_sub_epi16(b_16, y1_16); \
+	cr1_16 = _mm_sub_epi16(r_16, y1_16); \
+	r_16 = _mm_unpacklo_epi8(rgb4, _mm_setzero_si128()); \
+	g_16 = _mm_unpacklo_epi8(rgb5, _mm_setzero_si128()); \
+	b_16 = _mm_unpacklo_epi8(rgb6, _mm_setzero_si128()); \
+	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y2_16 = _mm_srli_epi16(y2_16, 8); \
+	cb1_16 = _mm_add_epi16(cb1_16, _mm_sub_epi16(b_16, y2_16)); \
+	cr1_16 = _mm_add_epi16(cr1_16, _mm_sub_epi16(r_16, y2_16)); \
+	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
+	SCALE_Y_16(y1_16) \
+	SCALE_Y_16(y2_16) \
+	Y = _mm_packus_epi16(y1_16, y2_16); \
+	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
+	SAVE_SI128((__m128i*)(y_ptr1), Y); \
+	/* same for the second line, compute Y', (B-Y') and (R-Y'), in 16bits values */ \
+	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are added to the previous values*/ \
+	r_16 = _mm_unpackhi_epi8(rgb1, _mm_setzero_si128()); \
+	g_16 = _mm_unpackhi_epi8(rgb2, _mm_setzero_si128()); \
+	b_16 = _mm_unpackhi_epi8(rgb3, _mm_setzero_si128()); \
+	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y1_16 = _mm_srli_epi16(y1_16, 8); \
+	cb1_16 = _mm_add_epi16(cb1_16, _mm_sub_epi16(b_16, y1_16)); \
+	cr1_16 = _mm_add_epi16(cr1_16, _mm_sub_epi16(r_16, y1_16)); \
+	r_16 = _mm_unpackhi_epi8(rgb4, _mm_setzero_si128()); \
+	g_16 = _mm_unpackhi_epi8(rgb5, _mm_setzero_si128()); \
+	b_16 = _mm_unpackhi_epi8(rgb6, _mm_setzero_si128()); \
+	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y2_16 = _mm_srli_epi16(y2_16, 8); \
+	cb1_16 = _mm_add_epi16(cb1_16, _mm_sub_epi16(b_16, y2_16)); \
+	cr1_16 = _mm_add_epi16(cr1_16, _mm_sub_epi16(r_16, y2_16)); \
+	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
+	SCALE_Y_16(y1_16) \
+	SCALE_Y_16(y2_16) \
+	Y = _mm_packus_epi16(y1_16, y2_16); \
+	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
+	SAVE_SI128((__m128i*)(y_ptr2), Y); \
+	/* Rescale Cb and Cr to their final range */ \
+	cb1_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cb1_16, 2), _mm_set1_epi16(param->cb_factor)), 8), _mm_set1_epi16(128)); \
+	cr1_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cr1_16, 2), _mm_set1_epi16(param->cr_factor)), 8), _mm_set1_epi16(128)); \
+	\
+	/* do the same again with next data */ \
+	rgb1 = LOAD_SI128((const __m128i*)(rgb_ptr1+48)), \
+	rgb2 = LOAD_SI128((const __m128i*)(rgb_ptr1+64)), \
+	rgb3 = LOAD_SI128((const __m128i*)(rgb_ptr1+80)), \
+	rgb4 = LOAD_SI128((const __m128i*)(rgb_ptr2+48)), \
+	rgb5 = LOAD_SI128((const __m128i*)(rgb_ptr2+64)), \
+	rgb6 = LOAD_SI128((const __m128i*)(rgb_ptr2+80)); \
+	/* unpack rgb24 data to r, g and b data in separate channels*/ \
+	/* see rgb.txt to get an idea of the algorithm, note that we only go to the next to last step*/ \
+	/* here, because averaging in horizontal direction is easier like this*/ \
+	/* The last step is applied further on the Y channel only*/ \
+	UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6) \
+	UNPACK_RGB24_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6) \
+	UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6) \
+	UNPACK_RGB24_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6) \
+	/* first compute Y', (B-Y') and (R-Y'), in 16bits values, for the first line */ \
+	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are saved*/ \
+	r_16 = _mm_unpacklo_epi8(rgb1, _mm_setzero_si128()); \
+	g_16 = _mm_unpacklo_epi8(rgb2, _mm_setzero_si128()); \
+	b_16 = _mm_unpacklo_epi8(rgb3, _mm_setzero_si128()); \
+	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y1_16 = _mm_srli_epi16(y1_16, 8); \
+	cb2_16 = _mm_sub_epi16(b_16, y1_16); \
+	cr2_16 = _mm_sub_epi16(r_16, y1_16); \
+	r_16 = _mm_unpacklo_epi8(rgb4, _mm_setzero_si128()); \
+	g_16 = _mm_unpacklo_epi8(rgb5, _mm_setzero_si128()); \
+	b_16 = _mm_unpacklo_epi8(rgb6, _mm_setzero_si128()); \
+	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y2_16 = _mm_srli_epi16(y2_16, 8); \
+	cb2_16 = _mm_add_epi16(cb2_16, _mm_sub_epi16(b_16, y2_16)); \
+	cr2_16 = _mm_add_epi16(cr2_16, _mm_sub_epi16(r_16, y2_16)); \
+	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
+	SCALE_Y_16(y1_16) \
+	SCALE_Y_16(y2_16) \
+	Y = _mm_packus_epi16(y1_16, y2_16); \
+	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
+	SAVE_SI128((__m128i*)(y_ptr1+16), Y); \
+	/* same for the second line, compute Y', (B-Y') and (R-Y'), in 16bits values */ \
+	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are added to the previous values*/ \
+	r_16 = _mm_unpackhi_epi8(rgb1, _mm_setzero_si128()); \
+	g_16 = _mm_unpackhi_epi8(rgb2, _mm_setzero_si128()); \
+	b_16 = _mm_unpackhi_epi8(rgb3, _mm_setzero_si128()); \
+	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y1_16 = _mm_srli_epi16(y1_16, 8); \
+	cb2_16 = _mm_add_epi16(cb2_16, _mm_sub_epi16(b_16, y1_16)); \
+	cr2_16 = _mm_add_epi16(cr2_16, _mm_sub_epi16(r_16, y1_16)); \
+	r_16 = _mm_unpackhi_epi8(rgb4, _mm_setzero_si128()); \
+	g_16 = _mm_unpackhi_epi8(rgb5, _mm_setzero_si128()); \
+	b_16 = _mm_unpackhi_epi8(rgb6, _mm_setzero_si128()); \
+	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y2_16 = _mm_srli_epi16(y2_16, 8); \
+	cb2_16 = _mm_add_epi16(cb2_16, _mm_sub_epi16(b_16, y2_16)); \
+	cr2_16 = _mm_add_epi16(cr2_16, _mm_sub_epi16(r_16, y2_16)); \
+	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
+	SCALE_Y_16(y1_16) \
+	SCALE_Y_16(y2_16) \
+	Y = _mm_packus_epi16(y1_16, y2_16); \
+	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
+	SAVE_SI128((__m128i*)(y_ptr2+16), Y); \
+	/* Rescale Cb and Cr to their final range */ \
+	cb2_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cb2_16, 2), _mm_set1_epi16(param->cb_factor)), 8), _mm_set1_epi16(128)); \
+	cr2_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cr2_16, 2), _mm_set1_epi16(param->cr_factor)), 8), _mm_set1_epi16(128)); \
+	/* Pack and save Cb Cr */ \
+	cb = _mm_packus_epi16(cb1_16, cb2_16); \
+	cr = _mm_packus_epi16(cr1_16, cr2_16); \
+	SAVE_SI128((__m128i*)(u_ptr), cb); \
+	SAVE_SI128((__m128i*)(v_ptr), cr);
+
+
+ALWAYS_INLINE void rgb24_yuv420_sse_impl(uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			RGB2YUV_32
+			
+			rgb_ptr1+=96;
+			rgb_ptr2+=96;
+			y_ptr1+=32;
+			y_ptr2+=32;
+			u_ptr+=16; 
+			v_ptr+=16;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		rgb24_yuv420_std(width-x, height, RGB+x*3, RGB_stride, Y+x, U+x/2, V+x/2, Y_stride, UV_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void rgb24_yuv420_sse(uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb24_yuv420_sse_impl, width, height, RGB, RGB_stride, Y, U, V, Y_stride, UV_stride)
+}
+
+ALWAYS_INLINE void rgb24_yuv420_sseu_impl(uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			RGB2YUV_32
+			
+			rgb_ptr1+=96;
+			rgb_ptr2+=96;
+			y_ptr1+=32;
+			y_ptr2+=32;
+			u_ptr+=16; 
+			v_ptr+=16;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		rgb24_yuv420_std(width-x, height, RGB+x*3, RGB_stride, Y+x, U+x/2, V+x/2, Y_stride, UV_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void rgb24_yuv420_sseu(uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb24_yuv420_sseu_impl, width, height, RGB, RGB_stride, Y, U, V, Y_stride, UV_stride)
+}
+
+
+// see rgba.txt
+#define UNPACK_RGB32_32_STEP(RS1, RS2, RS3, RS4, RS5, RS6, RS7, RS8, RD1, RD2, RD3, RD4, RD5, RD6, RD7, RD8) \
+RD1 = _mm_unpacklo_epi8(RS1, RS5); \
+RD2 = _mm_unpackhi_epi8(RS1, RS5); \
+RD3 = _mm_unpacklo_epi8(RS2, RS6); \
+RD4 = _mm_unpackhi_epi8(RS2, RS6); \
+RD5 = _mm_unpacklo_epi8(RS3, RS7); \
+RD6 = _mm_unpackhi_epi8(RS3, RS7); \
+RD7 = _mm_unpacklo_epi8(RS4, RS8); \
+RD8 = _mm_unpackhi_epi8(RS4, RS8);
+
+
+#define RGBA2YUV_32 \
+	__m128i r_16, g_16, b_16; \
+	__m128i y1_16, y2_16, cb1_16, cb2_16, cr1_16, cr2_16, Y, cb, cr; \
+	__m128i tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8; \
+	__m128i rgb1 = LOAD_SI128((const __m128i*)(rgb_ptr1)), \
+		rgb2 = LOAD_SI128((const __m128i*)(rgb_ptr1+16)), \
+		rgb3 = LOAD_SI128((const __m128i*)(rgb_ptr1+32)), \
+		rgb4 = LOAD_SI128((const __m128i*)(rgb_ptr1+48)), \
+		rgb5 = LOAD_SI128((const __m128i*)(rgb_ptr2)), \
+		rgb6 = LOAD_SI128((const __m128i*)(rgb_ptr2+16)), \
+		rgb7 = LOAD_SI128((const __m128i*)(rgb_ptr2+32)), \
+		rgb8 = LOAD_SI128((const __m128i*)(rgb_ptr2+48)); \
+	/* unpack rgb24 data to r, g and b data in separate channels*/ \
+	/* see rgb.txt to get an idea of the algorithm, note that we only go to the next to last step*/ \
+	/* here, because averaging in horizontal direction is easier like this*/ \
+	/* The last step is applied further on the Y channel only*/ \
+	UNPACK_RGB32_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8) \
+	UNPACK_RGB32_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8) \
+	UNPACK_RGB32_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8) \
+	UNPACK_RGB32_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8) \
+	/* first compute Y', (B-Y') and (R-Y'), in 16bits values, for the first line */ \
+	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are saved*/ \
+	r_16 = _mm_unpacklo_epi8(rgb1, _mm_setzero_si128()); \
+	g_16 = _mm_unpacklo_epi8(rgb2, _mm_setzero_si128()); \
+	b_16 = _mm_unpacklo_epi8(rgb3, _mm_setzero_si128()); \
+	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y1_16 = _mm_srli_epi16(y1_16, 8); \
+	cb1_16 = _mm_sub_epi16(b_16, y1_16); \
+	cr1_16 = _mm_sub_epi16(r_16, y1_16); \
+	r_16 = _mm_unpacklo_epi8(rgb5, _mm_setzero_si128()); \
+	g_16 = _mm_unpacklo_epi8(rgb6, _mm_setzero_si128()); \
+	b_16 = _mm_unpacklo_epi8(rgb7, _mm_setzero_si128()); \
+	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y2_16 = _mm_srli_epi16(y2_16, 8); \
+	cb1_16 = _mm_add_epi16(cb1_16, _mm_sub_epi16(b_16, y2_16)); \
+	cr1_16 = _mm_add_epi16(cr1_16, _mm_sub_epi16(r_16, y2_16)); \
+	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
+	SCALE_Y_16(y1_16) \
+	SCALE_Y_16(y2_16) \
+	Y = _mm_packus_epi16(y1_16, y2_16); \
+	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
+	SAVE_SI128((__m128i*)(y_ptr1), Y); \
+	/* same for the second line, compute Y', (B-Y') and (R-Y'), in 16bits values */ \
 	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are added to the previous values*/ \
 	r_16 = _mm_unpackhi_epi8(rgb1, _mm_setzero_si128()); \
 	g_16 = _mm_unpackhi_epi8(rgb2, _mm_setzero_si128()); \
@@ -763,488 +2441,3504 @@ RD8 = _mm_unpackhi_epi8(RS4, RS8);
 	cb1_16 = _mm_add_epi16(cb1_16, _mm_sub_epi16(b_16, y2_16)); \
 	cr1_16 = _mm_add_epi16(cr1_16, _mm_sub_epi16(r_16, y2_16)); \
 	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
-	y1_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y1_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	y2_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y2_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
+	SCALE_Y_16(y1_16) \
+	SCALE_Y_16(y2_16) \
 	Y = _mm_packus_epi16(y1_16, y2_16); \
 	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
 	SAVE_SI128((__m128i*)(y_ptr2), Y); \
 	/* Rescale Cb and Cr to their final range */ \
-	cb1_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cb1_16, 2), _mm_set1_epi16(param->cb_factor)), 8), _mm_set1_epi16(128)); \
-	cr1_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cr1_16, 2), _mm_set1_epi16(param->cr_factor)), 8), _mm_set1_epi16(128)); \
+	cb1_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cb1_16, 2), _mm_set1_epi16(param->cb_factor)), 8), _mm_set1_epi16(128)); \
+	cr1_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cr1_16, 2), _mm_set1_epi16(param->cr_factor)), 8), _mm_set1_epi16(128)); \
+	\
+	/* do the same again with next data */ \
+	rgb1 = LOAD_SI128((const __m128i*)(rgb_ptr1+64)), \
+	rgb2 = LOAD_SI128((const __m128i*)(rgb_ptr1+80)), \
+	rgb3 = LOAD_SI128((const __m128i*)(rgb_ptr1+96)), \
+	rgb4 = LOAD_SI128((const __m128i*)(rgb_ptr1+112)), \
+	rgb5 = LOAD_SI128((const __m128i*)(rgb_ptr2+64)), \
+	rgb6 = LOAD_SI128((const __m128i*)(rgb_ptr2+80)), \
+	rgb7 = LOAD_SI128((const __m128i*)(rgb_ptr2+96)), \
+	rgb8 = LOAD_SI128((const __m128i*)(rgb_ptr2+112)); \
+	/* unpack rgb24 data to r, g and b data in separate channels*/ \
+	/* see rgb.txt to get an idea of the algorithm, note that we only go to the next to last step*/ \
+	/* here, because averaging in horizontal direction is easier like this*/ \
+	/* The last step is applied further on the Y channel only*/ \
+	UNPACK_RGB32_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8) \
+	UNPACK_RGB32_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8) \
+	UNPACK_RGB32_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8) \
+	UNPACK_RGB32_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8) \
+	/* first compute Y', (B-Y') and (R-Y'), in 16bits values, for the first line */ \
+	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are saved*/ \
+	r_16 = _mm_unpacklo_epi8(rgb1, _mm_setzero_si128()); \
+	g_16 = _mm_unpacklo_epi8(rgb2, _mm_setzero_si128()); \
+	b_16 = _mm_unpacklo_epi8(rgb3, _mm_setzero_si128()); \
+	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y1_16 = _mm_srli_epi16(y1_16, 8); \
+	cb2_16 = _mm_sub_epi16(b_16, y1_16); \
+	cr2_16 = _mm_sub_epi16(r_16, y1_16); \
+	r_16 = _mm_unpacklo_epi8(rgb5, _mm_setzero_si128()); \
+	g_16 = _mm_unpacklo_epi8(rgb6, _mm_setzero_si128()); \
+	b_16 = _mm_unpacklo_epi8(rgb7, _mm_setzero_si128()); \
+	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y2_16 = _mm_srli_epi16(y2_16, 8); \
+	cb2_16 = _mm_add_epi16(cb2_16, _mm_sub_epi16(b_16, y2_16)); \
+	cr2_16 = _mm_add_epi16(cr2_16, _mm_sub_epi16(r_16, y2_16)); \
+	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
+	SCALE_Y_16(y1_16) \
+	SCALE_Y_16(y2_16) \
+	Y = _mm_packus_epi16(y1_16, y2_16); \
+	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
+	SAVE_SI128((__m128i*)(y_ptr1+16), Y); \
+	/* same for the second line, compute Y', (B-Y') and (R-Y'), in 16bits values */ \
+	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are added to the previous values*/ \
+	r_16 = _mm_unpackhi_epi8(rgb1, _mm_setzero_si128()); \
+	g_16 = _mm_unpackhi_epi8(rgb2, _mm_setzero_si128()); \
+	b_16 = _mm_unpackhi_epi8(rgb3, _mm_setzero_si128()); \
+	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y1_16 = _mm_srli_epi16(y1_16, 8); \
+	cb2_16 = _mm_add_epi16(cb2_16, _mm_sub_epi16(b_16, y1_16)); \
+	cr2_16 = _mm_add_epi16(cr2_16, _mm_sub_epi16(r_16, y1_16)); \
+	r_16 = _mm_unpackhi_epi8(rgb5, _mm_setzero_si128()); \
+	g_16 = _mm_unpackhi_epi8(rgb6, _mm_setzero_si128()); \
+	b_16 = _mm_unpackhi_epi8(rgb7, _mm_setzero_si128()); \
+	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+	y2_16 = _mm_srli_epi16(y2_16, 8); \
+	cb2_16 = _mm_add_epi16(cb2_16, _mm_sub_epi16(b_16, y2_16)); \
+	cr2_16 = _mm_add_epi16(cr2_16, _mm_sub_epi16(r_16, y2_16)); \
+	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
+	SCALE_Y_16(y1_16) \
+	SCALE_Y_16(y2_16) \
+	Y = _mm_packus_epi16(y1_16, y2_16); \
+	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
+	SAVE_SI128((__m128i*)(y_ptr2+16), Y); \
+	/* Rescale Cb and Cr to their final range */ \
+	cb2_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cb2_16, 2), _mm_set1_epi16(param->cb_factor)), 8), _mm_set1_epi16(128)); \
+	cr2_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cr2_16, 2), _mm_set1_epi16(param->cr_factor)), 8), _mm_set1_epi16(128)); \
+	/* Pack and save Cb Cr */ \
+	cb = _mm_packus_epi16(cb1_16, cb2_16); \
+	cr = _mm_packus_epi16(cr1_16, cr2_16); \
+	SAVE_SI128((__m128i*)(u_ptr), cb); \
+	SAVE_SI128((__m128i*)(v_ptr), cr);
+
+// copy the alpha of 32 pixels to the A plane, alpha values are isolated in 32 bits lanes and packed twice
+#define SAVE_ALPHA_32(RGBA_PTR, A_PTR) \
+	{ \
+		const __m128i a1 = _mm_packs_epi32(_mm_srli_epi32(LOAD_SI128((const __m128i*)(RGBA_PTR)), 24), \
+				_mm_srli_epi32(LOAD_SI128((const __m128i*)(RGBA_PTR+16)), 24)), \
+			a2 = _mm_packs_epi32(_mm_srli_epi32(LOAD_SI128((const __m128i*)(RGBA_PTR+32)), 24), \
+				_mm_srli_epi32(LOAD_SI128((const __m128i*)(RGBA_PTR+48)), 24)), \
+			a3 = _mm_packs_epi32(_mm_srli_epi32(LOAD_SI128((const __m128i*)(RGBA_PTR+64)), 24), \
+				_mm_srli_epi32(LOAD_SI128((const __m128i*)(RGBA_PTR+80)), 24)), \
+			a4 = _mm_packs_epi32(_mm_srli_epi32(LOAD_SI128((const __m128i*)(RGBA_PTR+96)), 24), \
+				_mm_srli_epi32(LOAD_SI128((const __m128i*)(RGBA_PTR+112)), 24)); \
+		SAVE_SI128((__m128i*)(A_PTR), _mm_packus_epi16(a1, a2)); \
+		SAVE_SI128((__m128i*)(A_PTR+16), _mm_packus_epi16(a3, a4)); \
+	}
+
+ALWAYS_INLINE void rgb32_yuv420_sse_impl(uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *rgb_ptr1=RGBA+y*RGBA_stride,
+			*rgb_ptr2=RGBA+(y+1)*RGBA_stride;
+		
+		uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			if(A)
+			{
+				SAVE_ALPHA_32(rgb_ptr1, A+y*Y_stride+x)
+				SAVE_ALPHA_32(rgb_ptr2, A+(y+1)*Y_stride+x)
+			}
+			RGBA2YUV_32
+			
+			rgb_ptr1+=128;
+			rgb_ptr2+=128;
+			y_ptr1+=32;
+			y_ptr2+=32;
+			u_ptr+=16; 
+			v_ptr+=16;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		rgb32_yuv420_std_impl(width-x, height, RGBA+x*4, RGBA_stride, Y+x, U+x/2, V+x/2, A ? A+x : NULL, Y_stride, UV_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void rgb32_yuv420_sse(uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb32_yuv420_sse_impl, width, height, RGBA, RGBA_stride, Y, U, V, NULL, Y_stride, UV_stride)
+}
+
+void rgba32_yuva420_sse(uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb32_yuv420_sse_impl, width, height, RGBA, RGBA_stride, Y, U, V, A, Y_stride, UV_stride)
+}
+
+ALWAYS_INLINE void rgb32_yuv420_sseu_impl(uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *rgb_ptr1=RGBA+y*RGBA_stride,
+			*rgb_ptr2=RGBA+(y+1)*RGBA_stride;
+		
+		uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			if(A)
+			{
+				SAVE_ALPHA_32(rgb_ptr1, A+y*Y_stride+x)
+				SAVE_ALPHA_32(rgb_ptr2, A+(y+1)*Y_stride+x)
+			}
+			RGBA2YUV_32
+			
+			rgb_ptr1+=128;
+			rgb_ptr2+=128;
+			y_ptr1+=32;
+			y_ptr2+=32;
+			u_ptr+=16; 
+			v_ptr+=16;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		rgb32_yuv420_std_impl(width-x, height, RGBA+x*4, RGBA_stride, Y+x, U+x/2, V+x/2, A ? A+x : NULL, Y_stride, UV_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void rgb32_yuv420_sseu(uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb32_yuv420_sseu_impl, width, height, RGBA, RGBA_stride, Y, U, V, NULL, Y_stride, UV_stride)
+}
+
+void rgba32_yuva420_sseu(uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb32_yuv420_sseu_impl, width, height, RGBA, RGBA_stride, Y, U, V, A, Y_stride, UV_stride)
+}
+
+#endif
+
+#ifdef _YUVRGB_SSE2_
+
+#define UV2RGB_16(U,V,R1,G1,B1,R2,G2,B2) \
+	r_tmp = _mm_srai_epi16(_mm_mullo_epi16(V, _mm_set1_epi16(param->cr_factor)), 6); \
+	g_tmp = _mm_srai_epi16(_mm_add_epi16( \
+		_mm_mullo_epi16(U, _mm_set1_epi16(param->g_cb_factor)), \
+		_mm_mullo_epi16(V, _mm_set1_epi16(param->g_cr_factor))), 7); \
+	b_tmp = _mm_srai_epi16(_mm_mullo_epi16(U, _mm_set1_epi16(param->cb_factor)), 6); \
+	R1 = _mm_unpacklo_epi16(r_tmp, r_tmp); \
+	G1 = _mm_unpacklo_epi16(g_tmp, g_tmp); \
+	B1 = _mm_unpacklo_epi16(b_tmp, b_tmp); \
+	R2 = _mm_unpackhi_epi16(r_tmp, r_tmp); \
+	G2 = _mm_unpackhi_epi16(g_tmp, g_tmp); \
+	B2 = _mm_unpackhi_epi16(b_tmp, b_tmp); \
+
+// Y1 and Y2 are (Y-YMin), as signed 16bits values
+// (Y-YMin)*[255/(YMax-YMin)] does not fit in a signed 16bits value, so it is computed 
+// as (Y-YMin) + ((Y-YMin)*([255/(YMax-YMin)]-128))>>7, which gives the exact same result
+// For full range, [255/(YMax-YMin)] is 128 and the rescale is skipped
+#define ADD_Y2RGB_16(Y1,Y2,R1,G1,B1,R2,G2,B2) \
+	if(param->y_factor!=128) \
+	{ \
+		Y1 = _mm_add_epi16(Y1, _mm_srai_epi16(_mm_mullo_epi16(Y1, _mm_set1_epi16(param->y_factor-128)), 7)); \
+		Y2 = _mm_add_epi16(Y2, _mm_srai_epi16(_mm_mullo_epi16(Y2, _mm_set1_epi16(param->y_factor-128)), 7)); \
+	} \
+	\
+	R1 = _mm_add_epi16(Y1, R1); \
+	G1 = _mm_sub_epi16(Y1, G1); \
+	B1 = _mm_add_epi16(Y1, B1); \
+	R2 = _mm_add_epi16(Y2, R2); \
+	G2 = _mm_sub_epi16(Y2, G2); \
+	B2 = _mm_add_epi16(Y2, B2); \
+
+#define PACK_RGB24_32_STEP(RS1, RS2, RS3, RS4, RS5, RS6, RD1, RD2, RD3, RD4, RD5, RD6) \
+RD1 = _mm_packus_epi16(_mm_and_si128(RS1,_mm_set1_epi16(0xFF)), _mm_and_si128(RS2,_mm_set1_epi16(0xFF))); \
+RD2 = _mm_packus_epi16(_mm_and_si128(RS3,_mm_set1_epi16(0xFF)), _mm_and_si128(RS4,_mm_set1_epi16(0xFF))); \
+RD3 = _mm_packus_epi16(_mm_and_si128(RS5,_mm_set1_epi16(0xFF)), _mm_and_si128(RS6,_mm_set1_epi16(0xFF))); \
+RD4 = _mm_packus_epi16(_mm_srli_epi16(RS1,8), _mm_srli_epi16(RS2,8)); \
+RD5 = _mm_packus_epi16(_mm_srli_epi16(RS3,8), _mm_srli_epi16(RS4,8)); \
+RD6 = _mm_packus_epi16(_mm_srli_epi16(RS5,8), _mm_srli_epi16(RS6,8)); \
+
+#define PACK_RGB24_32(R1, R2, G1, G2, B1, B2, RGB1, RGB2, RGB3, RGB4, RGB5, RGB6) \
+PACK_RGB24_32_STEP(R1, R2, G1, G2, B1, B2, RGB1, RGB2, RGB3, RGB4, RGB5, RGB6) \
+PACK_RGB24_32_STEP(RGB1, RGB2, RGB3, RGB4, RGB5, RGB6, R1, R2, G1, G2, B1, B2) \
+PACK_RGB24_32_STEP(R1, R2, G1, G2, B1, B2, RGB1, RGB2, RGB3, RGB4, RGB5, RGB6) \
+PACK_RGB24_32_STEP(RGB1, RGB2, RGB3, RGB4, RGB5, RGB6, R1, R2, G1, G2, B1, B2) \
+PACK_RGB24_32_STEP(R1, R2, G1, G2, B1, B2, RGB1, RGB2, RGB3, RGB4, RGB5, RGB6) \
+
+#define LOAD_UV_PLANAR \
+	__m128i u = LOAD_SI128((const __m128i*)(u_ptr)); \
+	__m128i v = LOAD_SI128((const __m128i*)(v_ptr)); \
+
+#define LOAD_UV_NV12 \
+	__m128i uv1 = LOAD_SI128((const __m128i*)(uv_ptr)); \
+	__m128i uv2 = LOAD_SI128((const __m128i*)(uv_ptr+16)); \
+	__m128i u = _mm_packus_epi16(_mm_and_si128(uv1, _mm_set1_epi16(255)), _mm_and_si128(uv2, _mm_set1_epi16(255))); \
+	uv1 = _mm_srli_epi16(uv1, 8); \
+	uv2 = _mm_srli_epi16(uv2, 8); \
+	__m128i v = _mm_packus_epi16(_mm_and_si128(uv1, _mm_set1_epi16(255)), _mm_and_si128(uv2, _mm_set1_epi16(255))); \
+
+#define LOAD_UV_NV21 \
+	__m128i uv1 = LOAD_SI128((const __m128i*)(uv_ptr)); \
+	__m128i uv2 = LOAD_SI128((const __m128i*)(uv_ptr+16)); \
+	__m128i v = _mm_packus_epi16(_mm_and_si128(uv1, _mm_set1_epi16(255)), _mm_and_si128(uv2, _mm_set1_epi16(255))); \
+	uv1 = _mm_srli_epi16(uv1, 8); \
+	uv2 = _mm_srli_epi16(uv2, 8); \
+	__m128i u = _mm_packus_epi16(_mm_and_si128(uv1, _mm_set1_epi16(255)), _mm_and_si128(uv2, _mm_set1_epi16(255))); \
+
+#define YUV2RGB_32 \
+	__m128i r_tmp, g_tmp, b_tmp; \
+	__m128i r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2; \
+	__m128i r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2; \
+	__m128i y_16_1, y_16_2; \
+	\
+	u = _mm_add_epi8(u, _mm_set1_epi8(-128)); \
+	v = _mm_add_epi8(v, _mm_set1_epi8(-128)); \
+	\
+	/* process first 16 pixels of first line */\
+	__m128i u_16 = _mm_srai_epi16(_mm_unpacklo_epi8(u, u), 8); \
+	__m128i v_16 = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8); \
+	\
+	UV2RGB_16(u_16, v_16, r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2) \
+	r_16_1=r_uv_16_1; g_16_1=g_uv_16_1; b_16_1=b_uv_16_1; \
+	r_16_2=r_uv_16_2; g_16_2=g_uv_16_2; b_16_2=b_uv_16_2; \
+	\
+	__m128i y = LOAD_SI128((const __m128i*)(y_ptr1)); \
+	y_16_1 = _mm_sub_epi16(_mm_unpacklo_epi8(y, _mm_setzero_si128()), _mm_set1_epi16(param->y_offset)); \
+	y_16_2 = _mm_sub_epi16(_mm_unpackhi_epi8(y, _mm_setzero_si128()), _mm_set1_epi16(param->y_offset)); \
+	\
+	ADD_Y2RGB_16(y_16_1, y_16_2, r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2) \
+	\
+	__m128i r_8_11 = _mm_packus_epi16(r_16_1, r_16_2); \
+	__m128i g_8_11 = _mm_packus_epi16(g_16_1, g_16_2); \
+	__m128i b_8_11 = _mm_packus_epi16(b_16_1, b_16_2); \
+	\
+	/* process first 16 pixels of second line */\
+	r_16_1=r_uv_16_1; g_16_1=g_uv_16_1; b_16_1=b_uv_16_1; \
+	r_16_2=r_uv_16_2; g_16_2=g_uv_16_2; b_16_2=b_uv_16_2; \
+	\
+	y = LOAD_SI128((const __m128i*)(y_ptr2)); \
+	y_16_1 = _mm_sub_epi16(_mm_unpacklo_epi8(y, _mm_setzero_si128()), _mm_set1_epi16(param->y_offset)); \
+	y_16_2 = _mm_sub_epi16(_mm_unpackhi_epi8(y, _mm_setzero_si128()), _mm_set1_epi16(param->y_offset)); \
+	\
+	ADD_Y2RGB_16(y_16_1, y_16_2, r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2) \
+	\
+	__m128i r_8_21 = _mm_packus_epi16(r_16_1, r_16_2); \
+	__m128i g_8_21 = _mm_packus_epi16(g_16_1, g_16_2); \
+	__m128i b_8_21 = _mm_packus_epi16(b_16_1, b_16_2); \
+	\
+	/* process last 16 pixels of first line */\
+	u_16 = _mm_srai_epi16(_mm_unpackhi_epi8(u, u), 8); \
+	v_16 = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8); \
+	\
+	UV2RGB_16(u_16, v_16, r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2) \
+	r_16_1=r_uv_16_1; g_16_1=g_uv_16_1; b_16_1=b_uv_16_1; \
+	r_16_2=r_uv_16_2; g_16_2=g_uv_16_2; b_16_2=b_uv_16_2; \
+	\
+	y = LOAD_SI128((const __m128i*)(y_ptr1+16)); \
+	y_16_1 = _mm_sub_epi16(_mm_unpacklo_epi8(y, _mm_setzero_si128()), _mm_set1_epi16(param->y_offset)); \
+	y_16_2 = _mm_sub_epi16(_mm_unpackhi_epi8(y, _mm_setzero_si128()), _mm_set1_epi16(param->y_offset)); \
+	\
+	ADD_Y2RGB_16(y_16_1, y_16_2, r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2) \
+	\
+	__m128i r_8_12 = _mm_packus_epi16(r_16_1, r_16_2); \
+	__m128i g_8_12 = _mm_packus_epi16(g_16_1, g_16_2); \
+	__m128i b_8_12 = _mm_packus_epi16(b_16_1, b_16_2); \
+	\
+	/* process last 16 pixels of second line */\
+	r_16_1=r_uv_16_1; g_16_1=g_uv_16_1; b_16_1=b_uv_16_1; \
+	r_16_2=r_uv_16_2; g_16_2=g_uv_16_2; b_16_2=b_uv_16_2; \
+	\
+	y = LOAD_SI128((const __m128i*)(y_ptr2+16)); \
+	y_16_1 = _mm_sub_epi16(_mm_unpacklo_epi8(y, _mm_setzero_si128()), _mm_set1_epi16(param->y_offset)); \
+	y_16_2 = _mm_sub_epi16(_mm_unpackhi_epi8(y, _mm_setzero_si128()), _mm_set1_epi16(param->y_offset)); \
+	\
+	ADD_Y2RGB_16(y_16_1, y_16_2, r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2) \
+	\
+	__m128i r_8_22 = _mm_packus_epi16(r_16_1, r_16_2); \
+	__m128i g_8_22 = _mm_packus_epi16(g_16_1, g_16_2); \
+	__m128i b_8_22 = _mm_packus_epi16(b_16_1, b_16_2); \
+	\
+	__m128i rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6; \
+	\
+	PACK_RGB24(r_8_11, r_8_12, g_8_11, g_8_12, b_8_11, b_8_12, rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6) \
+	SAVE_SI128((__m128i*)(rgb_ptr1), rgb_1); \
+	SAVE_SI128((__m128i*)(rgb_ptr1+16), rgb_2); \
+	SAVE_SI128((__m128i*)(rgb_ptr1+32), rgb_3); \
+	SAVE_SI128((__m128i*)(rgb_ptr1+48), rgb_4); \
+	SAVE_SI128((__m128i*)(rgb_ptr1+64), rgb_5); \
+	SAVE_SI128((__m128i*)(rgb_ptr1+80), rgb_6); \
+	\
+	PACK_RGB24(r_8_21, r_8_22, g_8_21, g_8_22, b_8_21, b_8_22, rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6) \
+	SAVE_SI128((__m128i*)(rgb_ptr2), rgb_1); \
+	SAVE_SI128((__m128i*)(rgb_ptr2+16), rgb_2); \
+	SAVE_SI128((__m128i*)(rgb_ptr2+32), rgb_3); \
+	SAVE_SI128((__m128i*)(rgb_ptr2+48), rgb_4); \
+	SAVE_SI128((__m128i*)(rgb_ptr2+64), rgb_5); \
+	SAVE_SI128((__m128i*)(rgb_ptr2+80), rgb_6); \
+
+#define YUV2RGB_32_PLANAR \
+	LOAD_UV_PLANAR \
+	YUV2RGB_32
+
+#define YUV2RGB_32_NV12 \
+	LOAD_UV_NV12 \
+	YUV2RGB_32
+	
+#define YUV2RGB_32_NV21 \
+	LOAD_UV_NV21 \
+	YUV2RGB_32
+
+
+ALWAYS_INLINE void yuv420_rgb24_sse_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	#define PACK_RGB24 PACK_RGB24_32
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			YUV2RGB_32_PLANAR
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			u_ptr+=16; 
+			v_ptr+=16;
+			rgb_ptr1+=96;
+			rgb_ptr2+=96;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		yuv420_rgb24_std(width-x, height, Y+x, U+x/2, V+x/2, Y_stride, UV_stride, RGB+x*3, RGB_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+	#undef PACK_RGB24
+}
+
+void yuv420_rgb24_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(yuv420_rgb24_sse_impl, width, height, Y, U, V, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+ALWAYS_INLINE void yuv420_rgb24_sseu_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	#define PACK_RGB24 PACK_RGB24_32
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			YUV2RGB_32_PLANAR
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			u_ptr+=16; 
+			v_ptr+=16;
+			rgb_ptr1+=96;
+			rgb_ptr2+=96;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		yuv420_rgb24_std(width-x, height, Y+x, U+x/2, V+x/2, Y_stride, UV_stride, RGB+x*3, RGB_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+	#undef PACK_RGB24
+}
+
+void yuv420_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(yuv420_rgb24_sseu_impl, width, height, Y, U, V, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+ALWAYS_INLINE void nv12_rgb24_sse_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	#define PACK_RGB24 PACK_RGB24_32
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*uv_ptr=UV+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			YUV2RGB_32_NV12
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			uv_ptr+=32; 
+			rgb_ptr1+=96;
+			rgb_ptr2+=96;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		nv12_rgb24_std(width-x, height, Y+x, UV+x, Y_stride, UV_stride, RGB+x*3, RGB_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+	#undef PACK_RGB24
+}
+
+void nv12_rgb24_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(nv12_rgb24_sse_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+ALWAYS_INLINE void nv12_rgb24_sseu_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	#define PACK_RGB24 PACK_RGB24_32
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*uv_ptr=UV+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			YUV2RGB_32_NV12
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			uv_ptr+=32; 
+			rgb_ptr1+=96;
+			rgb_ptr2+=96;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		nv12_rgb24_std(width-x, height, Y+x, UV+x, Y_stride, UV_stride, RGB+x*3, RGB_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+	#undef PACK_RGB24
+}
+
+void nv12_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(nv12_rgb24_sseu_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+ALWAYS_INLINE void nv21_rgb24_sse_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	#define PACK_RGB24 PACK_RGB24_32
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*uv_ptr=UV+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			YUV2RGB_32_NV21
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			uv_ptr+=32; 
+			rgb_ptr1+=96;
+			rgb_ptr2+=96;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		nv21_rgb24_std(width-x, height, Y+x, UV+x, Y_stride, UV_stride, RGB+x*3, RGB_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+	#undef PACK_RGB24
+}
+
+void nv21_rgb24_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(nv21_rgb24_sse_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+ALWAYS_INLINE void nv21_rgb24_sseu_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	#define PACK_RGB24 PACK_RGB24_32
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*uv_ptr=UV+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			YUV2RGB_32_NV21
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			uv_ptr+=32; 
+			rgb_ptr1+=96;
+			rgb_ptr2+=96;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		nv21_rgb24_std(width-x, height, Y+x, UV+x, Y_stride, UV_stride, RGB+x*3, RGB_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+	#undef PACK_RGB24
+}
+
+void nv21_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(nv21_rgb24_sseu_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+
+
+#endif //_YUVRGB_SSE2_
+
+#ifdef _YUVRGB_SSSE3_
+
+// SSSE3 kernels, with the rgb24 interleave done with pshufb instead of the sse2 unpack sequence.
+// They are compiled with a target attribute and only called if the cpu supports ssse3.
+// Pointers do not need to be aligned.
+
+#include <tmmintrin.h>
+
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+
+// interleave 16 r, g and b values to 48 bytes of rgb24
+#define PACK_RGB24_16_SSSE3(R, G, B, RGB1, RGB2, RGB3) \
+	RGB1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(R, _mm_setr_epi8(0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128, 5)), \
+		_mm_shuffle_epi8(G, _mm_setr_epi8(-128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128))), \
+		_mm_shuffle_epi8(B, _mm_setr_epi8(-128, -128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128))); \
+	RGB2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(R, _mm_setr_epi8(-128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128, 10, -128)), \
+		_mm_shuffle_epi8(G, _mm_setr_epi8(5, -128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128, 10))), \
+		_mm_shuffle_epi8(B, _mm_setr_epi8(-128, 5, -128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128))); \
+	RGB3 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(R, _mm_setr_epi8(-128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15, -128, -128)), \
+		_mm_shuffle_epi8(G, _mm_setr_epi8(-128, -128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15, -128))), \
+		_mm_shuffle_epi8(B, _mm_setr_epi8(10, -128, -128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15))); \
+
+// same interface as PACK_RGB24_32, used by YUV2RGB_32
+#define PACK_RGB24_32_SSSE3(R1, R2, G1, G2, B1, B2, RGB1, RGB2, RGB3, RGB4, RGB5, RGB6) \
+	PACK_RGB24_16_SSSE3(R1, G1, B1, RGB1, RGB2, RGB3) \
+	PACK_RGB24_16_SSSE3(R2, G2, B2, RGB4, RGB5, RGB6) \
+
+// deinterleave 48 bytes of rgb24 to 16 r, g and b values
+#define UNPACK_RGB24_16_SSSE3(RGB1, RGB2, RGB3, R, G, B) \
+	R = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(RGB1, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128)), \
+		_mm_shuffle_epi8(RGB2, _mm_setr_epi8(-128, -128, -128, -128, -128, -128, 2, 5, 8, 11, 14, -128, -128, -128, -128, -128))), \
+		_mm_shuffle_epi8(RGB3, _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 1, 4, 7, 10, 13))); \
+	G = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(RGB1, _mm_setr_epi8(1, 4, 7, 10, 13, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128)), \
+		_mm_shuffle_epi8(RGB2, _mm_setr_epi8(-128, -128, -128, -128, -128, 0, 3, 6, 9, 12, 15, -128, -128, -128, -128, -128))), \
+		_mm_shuffle_epi8(RGB3, _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 2, 5, 8, 11, 14))); \
+	B = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(RGB1, _mm_setr_epi8(2, 5, 8, 11, 14, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128)), \
+		_mm_shuffle_epi8(RGB2, _mm_setr_epi8(-128, -128, -128, -128, -128, 1, 4, 7, 10, 13, -128, -128, -128, -128, -128, -128))), \
+		_mm_shuffle_epi8(RGB3, _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 0, 3, 6, 9, 12, 15))); \
+
+// compute Y' of 16 pixels of a line, rescale and save Y, and add (B-Y') and (R-Y') of each pair of
+// pixels to CB and CR, even and odd pixels are processed separately in 16bits values
+#define RGB2YUV_16_SSSE3(RGB_PTR, Y_PTR, CB, CR) \
+	{ \
+		__m128i r, g, b, r_16, g_16, b_16, y_even, y_odd; \
+		UNPACK_RGB24_16_SSSE3(LOAD_SI128((const __m128i*)(RGB_PTR)), LOAD_SI128((const __m128i*)(RGB_PTR+16)), \
+			LOAD_SI128((const __m128i*)(RGB_PTR+32)), r, g, b) \
+		r_16 = _mm_and_si128(r, _mm_set1_epi16(0xFF)); \
+		g_16 = _mm_and_si128(g, _mm_set1_epi16(0xFF)); \
+		b_16 = _mm_and_si128(b, _mm_set1_epi16(0xFF)); \
+		y_even = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+			_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+		y_even = _mm_add_epi16(y_even, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+		y_even = _mm_srli_epi16(y_even, 8); \
+		CB = _mm_add_epi16(CB, _mm_sub_epi16(b_16, y_even)); \
+		CR = _mm_add_epi16(CR, _mm_sub_epi16(r_16, y_even)); \
+		r_16 = _mm_srli_epi16(r, 8); \
+		g_16 = _mm_srli_epi16(g, 8); \
+		b_16 = _mm_srli_epi16(b, 8); \
+		y_odd = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
+			_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
+		y_odd = _mm_add_epi16(y_odd, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
+		y_odd = _mm_srli_epi16(y_odd, 8); \
+		CB = _mm_add_epi16(CB, _mm_sub_epi16(b_16, y_odd)); \
+		CR = _mm_add_epi16(CR, _mm_sub_epi16(r_16, y_odd)); \
+		SCALE_Y_16(y_even) \
+		SCALE_Y_16(y_odd) \
+		/* Y is lower than 256, even and odd values can be merged without saturation */ \
+		SAVE_SI128((__m128i*)(Y_PTR), _mm_or_si128(y_even, _mm_slli_epi16(y_odd, 8))); \
+	}
+
+#define RGB2YUV_32_SSSE3 \
+	__m128i cb1 = _mm_setzero_si128(), cr1 = _mm_setzero_si128(), cb2 = _mm_setzero_si128(), cr2 = _mm_setzero_si128(); \
+	RGB2YUV_16_SSSE3(rgb_ptr1, y_ptr1, cb1, cr1) \
+	RGB2YUV_16_SSSE3(rgb_ptr2, y_ptr2, cb1, cr1) \
+	RGB2YUV_16_SSSE3(rgb_ptr1+48, y_ptr1+16, cb2, cr2) \
+	RGB2YUV_16_SSSE3(rgb_ptr2+48, y_ptr2+16, cb2, cr2) \
+	/* Rescale Cb and Cr to their final range */ \
+	cb1 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cb1, 2), _mm_set1_epi16(param->cb_factor)), 8), _mm_set1_epi16(128)); \
+	cr1 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cr1, 2), _mm_set1_epi16(param->cr_factor)), 8), _mm_set1_epi16(128)); \
+	cb2 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cb2, 2), _mm_set1_epi16(param->cb_factor)), 8), _mm_set1_epi16(128)); \
+	cr2 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cr2, 2), _mm_set1_epi16(param->cr_factor)), 8), _mm_set1_epi16(128)); \
+	SAVE_SI128((__m128i*)(u_ptr), _mm_packus_epi16(cb1, cb2)); \
+	SAVE_SI128((__m128i*)(v_ptr), _mm_packus_epi16(cr1, cr2)); \
+
+SSSE3_TARGET ALWAYS_INLINE void rgb24_yuv420_ssse3_impl(uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			RGB2YUV_32_SSSE3
+			
+			rgb_ptr1+=96;
+			rgb_ptr2+=96;
+			y_ptr1+=32;
+			y_ptr2+=32;
+			u_ptr+=16; 
+			v_ptr+=16;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		rgb24_yuv420_std(width-x, height, RGB+x*3, RGB_stride, Y+x, U+x/2, V+x/2, Y_stride, UV_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+SSSE3_TARGET void rgb24_yuv420_ssse3(uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb24_yuv420_ssse3_impl, width, height, RGB, RGB_stride, Y, U, V, Y_stride, UV_stride)
+}
+
+SSSE3_TARGET ALWAYS_INLINE void yuv420_rgb24_ssse3_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	#define PACK_RGB24 PACK_RGB24_32_SSSE3
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			YUV2RGB_32_PLANAR
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			u_ptr+=16; 
+			v_ptr+=16;
+			rgb_ptr1+=96;
+			rgb_ptr2+=96;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		yuv420_rgb24_std(width-x, height, Y+x, U+x/2, V+x/2, Y_stride, UV_stride, RGB+x*3, RGB_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+	#undef PACK_RGB24
+}
+
+SSSE3_TARGET void yuv420_rgb24_ssse3(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(yuv420_rgb24_ssse3_impl, width, height, Y, U, V, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+SSSE3_TARGET ALWAYS_INLINE void nv12_rgb24_ssse3_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	#define PACK_RGB24 PACK_RGB24_32_SSSE3
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*uv_ptr=UV+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			YUV2RGB_32_NV12
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			uv_ptr+=32;
+			rgb_ptr1+=96;
+			rgb_ptr2+=96;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		nv12_rgb24_std(width-x, height, Y+x, UV+x, Y_stride, UV_stride, RGB+x*3, RGB_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+	#undef PACK_RGB24
+}
+
+SSSE3_TARGET void nv12_rgb24_ssse3(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(nv12_rgb24_ssse3_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+SSSE3_TARGET ALWAYS_INLINE void nv21_rgb24_ssse3_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	#define PACK_RGB24 PACK_RGB24_32_SSSE3
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*uv_ptr=UV+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			YUV2RGB_32_NV21
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			uv_ptr+=32;
+			rgb_ptr1+=96;
+			rgb_ptr2+=96;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		nv21_rgb24_std(width-x, height, Y+x, UV+x, Y_stride, UV_stride, RGB+x*3, RGB_stride, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+	#undef PACK_RGB24
+}
+
+SSSE3_TARGET void nv21_rgb24_ssse3(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(nv21_rgb24_ssse3_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+#endif //_YUVRGB_SSSE3_
+
+#ifdef _YUVRGB_SSE2_
+
+// Luma only sse kernels, pointers do not need to be aligned
+
+// compute 16 gray values from 16 Y values
+#define LUMA_16(Y) \
+	{ \
+		__m128i y_lo = _mm_unpacklo_epi8(Y, _mm_setzero_si128()), \
+			y_hi = _mm_unpackhi_epi8(Y, _mm_setzero_si128()); \
+		if(param->y_offset!=0) \
+		{ \
+			y_lo = _mm_sub_epi16(y_lo, _mm_set1_epi16(param->y_offset)); \
+			y_hi = _mm_sub_epi16(y_hi, _mm_set1_epi16(param->y_offset)); \
+		} \
+		if(param->y_factor!=128) \
+		{ \
+			y_lo = _mm_add_epi16(y_lo, _mm_srai_epi16(_mm_mullo_epi16(y_lo, _mm_set1_epi16(param->y_factor-128)), 7)); \
+			y_hi = _mm_add_epi16(y_hi, _mm_srai_epi16(_mm_mullo_epi16(y_hi, _mm_set1_epi16(param->y_factor-128)), 7)); \
+		} \
+		Y = _mm_packus_epi16(y_lo, y_hi); \
+	}
+
+// save 16 gray values as rgba, with alpha set to 255
+#define SAVE_GRAY_RGBA_16(PTR, GRAY) \
+	{ \
+		const __m128i gg_lo = _mm_unpacklo_epi8(GRAY, GRAY), gg_hi = _mm_unpackhi_epi8(GRAY, GRAY), \
+			ga_lo = _mm_unpacklo_epi8(GRAY, _mm_set1_epi8(-1)), ga_hi = _mm_unpackhi_epi8(GRAY, _mm_set1_epi8(-1)); \
+		_mm_storeu_si128((__m128i*)(PTR), _mm_unpacklo_epi16(gg_lo, ga_lo)); \
+		_mm_storeu_si128((__m128i*)(PTR+16), _mm_unpackhi_epi16(gg_lo, ga_lo)); \
+		_mm_storeu_si128((__m128i*)(PTR+32), _mm_unpacklo_epi16(gg_hi, ga_hi)); \
+		_mm_storeu_si128((__m128i*)(PTR+48), _mm_unpackhi_epi16(gg_hi, ga_hi)); \
+	}
+
+ALWAYS_INLINE void luma_sseu_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, uint32_t Y_stride, 
+	uint8_t *GRAY, uint32_t GRAY_stride, uint32_t pixel_size, 
+	YCbCrType yuv_type)
+{
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *y_ptr=Y+y*Y_stride;
+		uint8_t *gray_ptr=GRAY+y*GRAY_stride;
+		for(x=0; x+31<width; x+=32)
+		{
+			__m128i gray1 = _mm_loadu_si128((const __m128i*)(y_ptr)),
+				gray2 = _mm_loadu_si128((const __m128i*)(y_ptr+16));
+			LUMA_16(gray1)
+			LUMA_16(gray2)
+			if(pixel_size==1)
+			{
+				_mm_storeu_si128((__m128i*)(gray_ptr), gray1);
+				_mm_storeu_si128((__m128i*)(gray_ptr+16), gray2);
+			}
+			else if(pixel_size==3)
+			{
+				// PACK_RGB24_32 overwrites its inputs, so each channel needs its own copy
+				__m128i r1=gray1, r2=gray2, g1=gray1, g2=gray2, b1=gray1, b2=gray2, 
+					rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6;
+				PACK_RGB24_32(r1, r2, g1, g2, b1, b2, rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6)
+				_mm_storeu_si128((__m128i*)(gray_ptr), rgb_1);
+				_mm_storeu_si128((__m128i*)(gray_ptr+16), rgb_2);
+				_mm_storeu_si128((__m128i*)(gray_ptr+32), rgb_3);
+				_mm_storeu_si128((__m128i*)(gray_ptr+48), rgb_4);
+				_mm_storeu_si128((__m128i*)(gray_ptr+64), rgb_5);
+				_mm_storeu_si128((__m128i*)(gray_ptr+80), rgb_6);
+			}
+			else
+			{
+				SAVE_GRAY_RGBA_16(gray_ptr, gray1)
+				SAVE_GRAY_RGBA_16(gray_ptr+64, gray2)
+			}
+			
+			y_ptr += 32;
+			gray_ptr += 32*pixel_size;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		luma_std_impl(width-x, height, Y+x, Y_stride, GRAY+x*pixel_size, GRAY_stride, pixel_size, yuv_type);
+}
+
+void luma_gray8_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, uint32_t Y_stride, 
+	uint8_t *GRAY, uint32_t GRAY_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(luma_sseu_impl, width, height, Y, Y_stride, GRAY, GRAY_stride, 1)
+}
+
+void luma_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, uint32_t Y_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(luma_sseu_impl, width, height, Y, Y_stride, RGB, RGB_stride, 3)
+}
+
+void luma_rgb32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, uint32_t Y_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(luma_sseu_impl, width, height, Y, Y_stride, RGBA, RGBA_stride, 4)
+}
+
+// compute Y of 8 pixels in 16bits values
+#define RGB2LUMA_8(R, G, B, Y) \
+	Y = _mm_add_epi16(_mm_mullo_epi16(R, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(G, _mm_set1_epi16(param->g_factor))); \
+	Y = _mm_add_epi16(Y, _mm_mullo_epi16(B, _mm_set1_epi16(param->b_factor))); \
+	Y = _mm_srli_epi16(Y, 8); \
+	SCALE_Y_16(Y)
+
+// compute Y of 8 rgba pixels
+#define RGBA2LUMA_8(RGBA1, RGBA2, Y) \
+	{ \
+		const __m128i mask = _mm_set1_epi32(0xFF); \
+		const __m128i r = _mm_packs_epi32(_mm_and_si128(RGBA1, mask), _mm_and_si128(RGBA2, mask)), \
+			g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(RGBA1, 8), mask), _mm_and_si128(_mm_srli_epi32(RGBA2, 8), mask)), \
+			b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(RGBA1, 16), mask), _mm_and_si128(_mm_srli_epi32(RGBA2, 16), mask)); \
+		RGB2LUMA_8(r, g, b, Y) \
+	}
+
+ALWAYS_INLINE void rgb_luma_sseu_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, uint32_t pixel_size, 
+	uint8_t *Y, uint32_t Y_stride, 
+	YCbCrType yuv_type)
+{
+	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		uint8_t *y_ptr=Y+y*Y_stride;
+		for(x=0; x+31<width; x+=32)
+		{
+			__m128i y1, y2, y3, y4;
+			if(pixel_size==3)
+			{
+				__m128i r, g, b, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6;
+				__m128i rgb1 = _mm_loadu_si128((const __m128i*)(rgb_ptr)),
+					rgb2 = _mm_loadu_si128((const __m128i*)(rgb_ptr+16)),
+					rgb3 = _mm_loadu_si128((const __m128i*)(rgb_ptr+32)),
+					rgb4 = _mm_loadu_si128((const __m128i*)(rgb_ptr+48)),
+					rgb5 = _mm_loadu_si128((const __m128i*)(rgb_ptr+64)),
+					rgb6 = _mm_loadu_si128((const __m128i*)(rgb_ptr+80));
+				// same unpacking as RGB2YUV_32, with pixels 16 to 31 in place of the second line
+				// low halves then contain even and odd pixels of 0 to 15, high halves of 16 to 31
+				UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6)
+				UNPACK_RGB24_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6)
+				UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6)
+				UNPACK_RGB24_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6)
+				r = _mm_unpacklo_epi8(rgb1, _mm_setzero_si128());
+				g = _mm_unpacklo_epi8(rgb2, _mm_setzero_si128());
+				b = _mm_unpacklo_epi8(rgb3, _mm_setzero_si128());
+				RGB2LUMA_8(r, g, b, y1)
+				r = _mm_unpacklo_epi8(rgb4, _mm_setzero_si128());
+				g = _mm_unpacklo_epi8(rgb5, _mm_setzero_si128());
+				b = _mm_unpacklo_epi8(rgb6, _mm_setzero_si128());
+				RGB2LUMA_8(r, g, b, y2)
+				r = _mm_unpackhi_epi8(rgb1, _mm_setzero_si128());
+				g = _mm_unpackhi_epi8(rgb2, _mm_setzero_si128());
+				b = _mm_unpackhi_epi8(rgb3, _mm_setzero_si128());
+				RGB2LUMA_8(r, g, b, y3)
+				r = _mm_unpackhi_epi8(rgb4, _mm_setzero_si128());
+				g = _mm_unpackhi_epi8(rgb5, _mm_setzero_si128());
+				b = _mm_unpackhi_epi8(rgb6, _mm_setzero_si128());
+				RGB2LUMA_8(r, g, b, y4)
+				// interleave even and odd pixels
+				y1 = _mm_packus_epi16(y1, y2);
+				y1 = _mm_unpackhi_epi8(_mm_slli_si128(y1, 8), y1);
+				y3 = _mm_packus_epi16(y3, y4);
+				y3 = _mm_unpackhi_epi8(_mm_slli_si128(y3, 8), y3);
+			}
+			else
+			{
+				RGBA2LUMA_8(_mm_loadu_si128((const __m128i*)(rgb_ptr)), _mm_loadu_si128((const __m128i*)(rgb_ptr+16)), y1)
+				RGBA2LUMA_8(_mm_loadu_si128((const __m128i*)(rgb_ptr+32)), _mm_loadu_si128((const __m128i*)(rgb_ptr+48)), y2)
+				RGBA2LUMA_8(_mm_loadu_si128((const __m128i*)(rgb_ptr+64)), _mm_loadu_si128((const __m128i*)(rgb_ptr+80)), y3)
+				RGBA2LUMA_8(_mm_loadu_si128((const __m128i*)(rgb_ptr+96)), _mm_loadu_si128((const __m128i*)(rgb_ptr+112)), y4)
+				y1 = _mm_packus_epi16(y1, y2);
+				y3 = _mm_packus_epi16(y3, y4);
+			}
+			_mm_storeu_si128((__m128i*)(y_ptr), y1);
+			_mm_storeu_si128((__m128i*)(y_ptr+16), y3);
+			
+			rgb_ptr += 32*pixel_size;
+			y_ptr += 32;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		rgb_luma_std_impl(width-x, height, RGB+x*pixel_size, RGB_stride, pixel_size, Y+x, Y_stride, yuv_type);
+}
+
+void rgb24_luma_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *Y, uint32_t Y_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb_luma_sseu_impl, width, height, RGB, RGB_stride, 3, Y, Y_stride)
+}
+
+void rgb32_luma_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint32_t Y_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb_luma_sseu_impl, width, height, RGBA, RGBA_stride, 4, Y, Y_stride)
+}
+
+// Conversion between color spaces, sse implementation, 16 pixels of two lines per iteration
+// pointers do not need to be aligned
+ALWAYS_INLINE void yuv2yuv_sseu_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, uint32_t src_uv_step, 
+	uint8_t *Y2, uint8_t *U2, uint8_t *V2, uint32_t Y2_stride, uint32_t UV2_stride, uint32_t dst_uv_step, 
+	const YUV2YUVParam *param)
+{
+	const __m128i m00 = _mm_set1_epi16(param->matrix[0][0]), m01 = _mm_set1_epi16(param->matrix[0][1]), 
+		m02 = _mm_set1_epi16(param->matrix[0][2]), m11 = _mm_set1_epi16(param->matrix[1][1]), 
+		m12 = _mm_set1_epi16(param->matrix[1][2]), m21 = _mm_set1_epi16(param->matrix[2][1]), 
+		m22 = _mm_set1_epi16(param->matrix[2][2]);
+	const __m128i y_offset = _mm_set1_epi16(param->y_offset), 
+		y_cbcr_offset = _mm_set1_epi16(param->y_offset_2*16+8), 
+		cbcr_offset = _mm_set1_epi16(128*16+8);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		uint8_t *y2_ptr1=Y2+y*Y2_stride,
+			*y2_ptr2=Y2+(y+1)*Y2_stride,
+			*u2_ptr=U2+(y/2)*UV2_stride,
+			*v2_ptr=V2+(y/2)*UV2_stride;
+		
+		for(x=0; x+15<width; x+=16)
+		{
+			const __m128i y1 = _mm_loadu_si128((const __m128i*)(y_ptr1)),
+				y2 = _mm_loadu_si128((const __m128i*)(y_ptr2));
+			__m128i u, v;
+			if(src_uv_step==1)
+			{
+				u = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(u_ptr)), _mm_setzero_si128());
+				v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(v_ptr)), _mm_setzero_si128());
+			}
+			else
+			{
+				const __m128i uv = _mm_loadu_si128((const __m128i*)(u_ptr));
+				u = _mm_and_si128(uv, _mm_set1_epi16(0xFF));
+				v = _mm_srli_epi16(uv, 8);
+			}
+			u = _mm_slli_epi16(_mm_sub_epi16(u, _mm_set1_epi16(128)), 6);
+			v = _mm_slli_epi16(_mm_sub_epi16(v, _mm_set1_epi16(128)), 6);
+			
+			__m128i y1_lo = _mm_unpacklo_epi8(y1, _mm_setzero_si128()), y1_hi = _mm_unpackhi_epi8(y1, _mm_setzero_si128()), 
+				y2_lo = _mm_unpacklo_epi8(y2, _mm_setzero_si128()), y2_hi = _mm_unpackhi_epi8(y2, _mm_setzero_si128());
+			
+			// contribution of Cb and Cr to Y, duplicated for the two pixels of each block
+			const __m128i y_cbcr = _mm_add_epi16(_mm_add_epi16(_mm_mulhi_epi16(u, m01), _mm_mulhi_epi16(v, m02)), y_cbcr_offset);
+			const __m128i y_cbcr_lo = _mm_unpacklo_epi16(y_cbcr, y_cbcr), y_cbcr_hi = _mm_unpackhi_epi16(y_cbcr, y_cbcr);
+			
+			y1_lo = _mm_srai_epi16(_mm_add_epi16(_mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(y1_lo, y_offset), 6), m00), y_cbcr_lo), 4);
+			y1_hi = _mm_srai_epi16(_mm_add_epi16(_mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(y1_hi, y_offset), 6), m00), y_cbcr_hi), 4);
+			y2_lo = _mm_srai_epi16(_mm_add_epi16(_mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(y2_lo, y_offset), 6), m00), y_cbcr_lo), 4);
+			y2_hi = _mm_srai_epi16(_mm_add_epi16(_mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(y2_hi, y_offset), 6), m00), y_cbcr_hi), 4);
+			
+			const __m128i u2 = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mulhi_epi16(u, m11), _mm_mulhi_epi16(v, m12)), cbcr_offset), 4);
+			const __m128i v2 = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mulhi_epi16(u, m21), _mm_mulhi_epi16(v, m22)), cbcr_offset), 4);
+			// Cb in low 8 bytes, Cr in high 8 bytes
+			const __m128i uv2 = _mm_packus_epi16(u2, v2);
+			
+			_mm_storeu_si128((__m128i*)(y2_ptr1), _mm_packus_epi16(y1_lo, y1_hi));
+			_mm_storeu_si128((__m128i*)(y2_ptr2), _mm_packus_epi16(y2_lo, y2_hi));
+			if(dst_uv_step==1)
+			{
+				_mm_storel_epi64((__m128i*)(u2_ptr), uv2);
+				_mm_storel_epi64((__m128i*)(v2_ptr), _mm_srli_si128(uv2, 8));
+			}
+			else
+				_mm_storeu_si128((__m128i*)(u2_ptr), _mm_unpacklo_epi8(uv2, _mm_srli_si128(uv2, 8)));
+			
+			y_ptr1 += 16;
+			y_ptr2 += 16;
+			u_ptr += 8*src_uv_step;
+			v_ptr += 8*src_uv_step;
+			y2_ptr1 += 16;
+			y2_ptr2 += 16;
+			u2_ptr += 8*dst_uv_step;
+			v2_ptr += 8*dst_uv_step;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~15u;
+	if(x<width)
+		yuv2yuv_std_impl(width-x, height, Y+x, U+x/2*src_uv_step, V+x/2*src_uv_step, Y_stride, UV_stride, src_uv_step, 
+			Y2+x, U2+x/2*dst_uv_step, V2+x/2*dst_uv_step, Y2_stride, UV2_stride, dst_uv_step, param);
+}
+
+void yuv420_yuv420_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *U2, uint8_t *V2, uint32_t Y2_stride, uint32_t UV2_stride, 
+	YCbCrType src_type, YCbCrType dst_type)
+{
+	YUV2YUVParam param;
+	yuv2yuv_param(src_type, dst_type, &param);
+	yuv2yuv_sseu_impl(width, height, Y, U, V, Y_stride, UV_stride, 1, Y2, U2, V2, Y2_stride, UV2_stride, 1, &param);
+}
+
+void nv12_nv12_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *UV2, uint32_t Y2_stride, uint32_t UV2_stride, 
+	YCbCrType src_type, YCbCrType dst_type)
+{
+	YUV2YUVParam param;
+	yuv2yuv_param(src_type, dst_type, &param);
+	yuv2yuv_sseu_impl(width, height, Y, UV, UV+1, Y_stride, UV_stride, 2, Y2, UV2, UV2+1, Y2_stride, UV2_stride, 2, &param);
+}
+
+// Chroma layout conversions, 16 chroma samples per iteration, remaining ones are processed by the std 
+// functions
+
+#define COPY_16 \
+	SAVE_SI128((__m128i*)(dst_ptr), LOAD_SI128((const __m128i*)(src_ptr)));
+
+#define INTERLEAVE_UV_16 \
+	{ \
+		const __m128i u = LOAD_SI128((const __m128i*)(u_ptr)), v = LOAD_SI128((const __m128i*)(v_ptr)); \
+		SAVE_SI128((__m128i*)(uv_ptr), _mm_unpacklo_epi8(u, v)); \
+		SAVE_SI128((__m128i*)(uv_ptr+16), _mm_unpackhi_epi8(u, v)); \
+	}
+
+#define DEINTERLEAVE_UV_16 \
+	{ \
+		const __m128i uv1 = LOAD_SI128((const __m128i*)(uv_ptr)), uv2 = LOAD_SI128((const __m128i*)(uv_ptr+16)); \
+		SAVE_SI128((__m128i*)(u_ptr), _mm_packus_epi16(_mm_and_si128(uv1, _mm_set1_epi16(255)), \
+			_mm_and_si128(uv2, _mm_set1_epi16(255)))); \
+		SAVE_SI128((__m128i*)(v_ptr), _mm_packus_epi16(_mm_srli_epi16(uv1, 8), _mm_srli_epi16(uv2, 8))); \
+	}
+
+#define SWAP_UV_8(OFFSET) \
+	{ \
+		const __m128i uv = LOAD_SI128((const __m128i*)(uv_ptr+OFFSET)); \
+		SAVE_SI128((__m128i*)(uv2_ptr+OFFSET), _mm_or_si128(_mm_slli_epi16(uv, 8), _mm_srli_epi16(uv, 8))); \
+	}
+
+static void copy_plane_sse(uint32_t width, uint32_t height, const uint8_t *src, uint32_t src_stride, 
+	uint8_t *dst, uint32_t dst_stride)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	if(!dst || dst==src)
+		return;
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *src_ptr=src+(size_t)y*src_stride;
+		uint8_t *dst_ptr=dst+(size_t)y*dst_stride;
+		for(x=0; x+15<width; x+=16)
+		{
+			COPY_16
+			src_ptr+=16;
+			dst_ptr+=16;
+		}
+	}
+	x = width&~15u;
+	if(x<width)
+		copy_plane_std(width-x, height, src+x, src_stride, dst+x, dst_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+static void copy_plane_sseu(uint32_t width, uint32_t height, const uint8_t *src, uint32_t src_stride, 
+	uint8_t *dst, uint32_t dst_stride)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	if(!dst || dst==src)
+		return;
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *src_ptr=src+(size_t)y*src_stride;
+		uint8_t *dst_ptr=dst+(size_t)y*dst_stride;
+		for(x=0; x+15<width; x+=16)
+		{
+			COPY_16
+			src_ptr+=16;
+			dst_ptr+=16;
+		}
+	}
+	x = width&~15u;
+	if(x<width)
+		copy_plane_std(width-x, height, src+x, src_stride, dst+x, dst_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+static void interleave_uv_sse(uint32_t width, uint32_t height, 
+	const uint8_t *U, const uint8_t *V, uint32_t UV_stride, 
+	uint8_t *UV2, uint32_t UV2_stride)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	const uint32_t uv_width=(width+1)/2, uv_height=(height+1)/2;
+	uint32_t x, y;
+	for(y=0; y<uv_height; ++y)
+	{
+		const uint8_t *u_ptr=U+(size_t)y*UV_stride, *v_ptr=V+(size_t)y*UV_stride;
+		uint8_t *uv_ptr=UV2+(size_t)y*UV2_stride;
+		for(x=0; x+15<uv_width; x+=16)
+		{
+			INTERLEAVE_UV_16
+			u_ptr+=16;
+			v_ptr+=16;
+			uv_ptr+=32;
+		}
+	}
+	x = uv_width&~15u;
+	if(x<uv_width)
+		interleave_uv_std(width-2*x, height, U+x, V+x, UV_stride, UV2+2*x, UV2_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+static void interleave_uv_sseu(uint32_t width, uint32_t height, 
+	const uint8_t *U, const uint8_t *V, uint32_t UV_stride, 
+	uint8_t *UV2, uint32_t UV2_stride)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	const uint32_t uv_width=(width+1)/2, uv_height=(height+1)/2;
+	uint32_t x, y;
+	for(y=0; y<uv_height; ++y)
+	{
+		const uint8_t *u_ptr=U+(size_t)y*UV_stride, *v_ptr=V+(size_t)y*UV_stride;
+		uint8_t *uv_ptr=UV2+(size_t)y*UV2_stride;
+		for(x=0; x+15<uv_width; x+=16)
+		{
+			INTERLEAVE_UV_16
+			u_ptr+=16;
+			v_ptr+=16;
+			uv_ptr+=32;
+		}
+	}
+	x = uv_width&~15u;
+	if(x<uv_width)
+		interleave_uv_std(width-2*x, height, U+x, V+x, UV_stride, UV2+2*x, UV2_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+static void deinterleave_uv_sse(uint32_t width, uint32_t height, 
+	const uint8_t *UV, uint32_t UV_stride, 
+	uint8_t *U2, uint8_t *V2, uint32_t UV2_stride)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	const uint32_t uv_width=(width+1)/2, uv_height=(height+1)/2;
+	uint32_t x, y;
+	for(y=0; y<uv_height; ++y)
+	{
+		const uint8_t *uv_ptr=UV+(size_t)y*UV_stride;
+		uint8_t *u_ptr=U2+(size_t)y*UV2_stride, *v_ptr=V2+(size_t)y*UV2_stride;
+		for(x=0; x+15<uv_width; x+=16)
+		{
+			DEINTERLEAVE_UV_16
+			uv_ptr+=32;
+			u_ptr+=16;
+			v_ptr+=16;
+		}
+	}
+	x = uv_width&~15u;
+	if(x<uv_width)
+		deinterleave_uv_std(width-2*x, height, UV+2*x, UV_stride, U2+x, V2+x, UV2_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+static void deinterleave_uv_sseu(uint32_t width, uint32_t height, 
+	const uint8_t *UV, uint32_t UV_stride, 
+	uint8_t *U2, uint8_t *V2, uint32_t UV2_stride)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	const uint32_t uv_width=(width+1)/2, uv_height=(height+1)/2;
+	uint32_t x, y;
+	for(y=0; y<uv_height; ++y)
+	{
+		const uint8_t *uv_ptr=UV+(size_t)y*UV_stride;
+		uint8_t *u_ptr=U2+(size_t)y*UV2_stride, *v_ptr=V2+(size_t)y*UV2_stride;
+		for(x=0; x+15<uv_width; x+=16)
+		{
+			DEINTERLEAVE_UV_16
+			uv_ptr+=32;
+			u_ptr+=16;
+			v_ptr+=16;
+		}
+	}
+	x = uv_width&~15u;
+	if(x<uv_width)
+		deinterleave_uv_std(width-2*x, height, UV+2*x, UV_stride, U2+x, V2+x, UV2_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+static void swap_uv_sse(uint32_t width, uint32_t height, 
+	const uint8_t *UV, uint32_t UV_stride, 
+	uint8_t *UV2, uint32_t UV2_stride)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	const uint32_t uv_width=(width+1)/2, uv_height=(height+1)/2;
+	uint32_t x, y;
+	for(y=0; y<uv_height; ++y)
+	{
+		const uint8_t *uv_ptr=UV+(size_t)y*UV_stride;
+		uint8_t *uv2_ptr=UV2+(size_t)y*UV2_stride;
+		for(x=0; x+15<uv_width; x+=16)
+		{
+			SWAP_UV_8(0)
+			SWAP_UV_8(16)
+			uv_ptr+=32;
+			uv2_ptr+=32;
+		}
+	}
+	x = uv_width&~15u;
+	if(x<uv_width)
+		swap_uv_std(width-2*x, height, UV+2*x, UV_stride, UV2+2*x, UV2_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+static void swap_uv_sseu(uint32_t width, uint32_t height, 
+	const uint8_t *UV, uint32_t UV_stride, 
+	uint8_t *UV2, uint32_t UV2_stride)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	const uint32_t uv_width=(width+1)/2, uv_height=(height+1)/2;
+	uint32_t x, y;
+	for(y=0; y<uv_height; ++y)
+	{
+		const uint8_t *uv_ptr=UV+(size_t)y*UV_stride;
+		uint8_t *uv2_ptr=UV2+(size_t)y*UV2_stride;
+		for(x=0; x+15<uv_width; x+=16)
+		{
+			SWAP_UV_8(0)
+			SWAP_UV_8(16)
+			uv_ptr+=32;
+			uv2_ptr+=32;
+		}
+	}
+	x = uv_width&~15u;
+	if(x<uv_width)
+		swap_uv_std(width-2*x, height, UV+2*x, UV_stride, UV2+2*x, UV2_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void yuv420_nv12_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *UV2, uint32_t Y2_stride, uint32_t UV2_stride)
+{
+	copy_plane_sse(width, height, Y, Y_stride, Y2, Y2_stride);
+	interleave_uv_sse(width, height, U, V, UV_stride, UV2, UV2_stride);
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+}
+
+void yuv420_nv12_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *UV2, uint32_t Y2_stride, uint32_t UV2_stride)
+{
+	copy_plane_sseu(width, height, Y, Y_stride, Y2, Y2_stride);
+	interleave_uv_sseu(width, height, U, V, UV_stride, UV2, UV2_stride);
+}
+
+void yuv420_nv21_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *VU2, uint32_t Y2_stride, uint32_t VU2_stride)
+{
+	copy_plane_sse(width, height, Y, Y_stride, Y2, Y2_stride);
+	interleave_uv_sse(width, height, V, U, UV_stride, VU2, VU2_stride);
+	_mm_sfence();
+}
+
+void yuv420_nv21_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *VU2, uint32_t Y2_stride, uint32_t VU2_stride)
+{
+	copy_plane_sseu(width, height, Y, Y_stride, Y2, Y2_stride);
+	interleave_uv_sseu(width, height, V, U, UV_stride, VU2, VU2_stride);
+}
+
+void nv12_yuv420_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *U2, uint8_t *V2, uint32_t Y2_stride, uint32_t UV2_stride)
+{
+	copy_plane_sse(width, height, Y, Y_stride, Y2, Y2_stride);
+	deinterleave_uv_sse(width, height, UV, UV_stride, U2, V2, UV2_stride);
+	_mm_sfence();
+}
+
+void nv12_yuv420_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *U2, uint8_t *V2, uint32_t Y2_stride, uint32_t UV2_stride)
+{
+	copy_plane_sseu(width, height, Y, Y_stride, Y2, Y2_stride);
+	deinterleave_uv_sseu(width, height, UV, UV_stride, U2, V2, UV2_stride);
+}
+
+void nv21_yuv420_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *VU, uint32_t Y_stride, uint32_t VU_stride, 
+	uint8_t *Y2, uint8_t *U2, uint8_t *V2, uint32_t Y2_stride, uint32_t UV2_stride)
+{
+	copy_plane_sse(width, height, Y, Y_stride, Y2, Y2_stride);
+	deinterleave_uv_sse(width, height, VU, VU_stride, V2, U2, UV2_stride);
+	_mm_sfence();
+}
+
+void nv21_yuv420_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *VU, uint32_t Y_stride, uint32_t VU_stride, 
+	uint8_t *Y2, uint8_t *U2, uint8_t *V2, uint32_t Y2_stride, uint32_t UV2_stride)
+{
+	copy_plane_sseu(width, height, Y, Y_stride, Y2, Y2_stride);
+	deinterleave_uv_sseu(width, height, VU, VU_stride, V2, U2, UV2_stride);
+}
+
+void nv12_nv21_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *VU2, uint32_t Y2_stride, uint32_t VU2_stride)
+{
+	copy_plane_sse(width, height, Y, Y_stride, Y2, Y2_stride);
+	swap_uv_sse(width, height, UV, UV_stride, VU2, VU2_stride);
+	_mm_sfence();
+}
+
+void nv12_nv21_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *Y2, uint8_t *VU2, uint32_t Y2_stride, uint32_t VU2_stride)
+{
+	copy_plane_sseu(width, height, Y, Y_stride, Y2, Y2_stride);
+	swap_uv_sseu(width, height, UV, UV_stride, VU2, VU2_stride);
+}
+
+// 16 bits rgb output, the rgb values of UV2RGB_16 and ADD_Y2RGB_16 are clamped and packed in 16 bits lanes, 
+// without going through bytes
+
+// dither thresholds of 8 consecutive pixels of line y, starting on a multiple of 4, for a component of 
+// the given number of bits
+ALWAYS_INLINE __m128i dither_thresholds_8(uint32_t y, int bits)
+{
+	const uint8_t *dither=DITHER_4X4[y&3];
+	const int shift=bits-4;
+	return _mm_setr_epi16(dither[0]>>shift, dither[1]>>shift, dither[2]>>shift, dither[3]>>shift, 
+		dither[0]>>shift, dither[1]>>shift, dither[2]>>shift, dither[3]>>shift);
+}
+
+// clamp the 16 bits values R, G and B of 8 pixels, add dither thresholds, and pack them in RGB16
+#define PACK_RGB16_8(R, G, B, DITHER_RB, DITHER_G, RGB16) \
+	R = _mm_max_epi16(R, _mm_setzero_si128()); \
+	G = _mm_max_epi16(G, _mm_setzero_si128()); \
+	B = _mm_max_epi16(B, _mm_setzero_si128()); \
+	if(dither) \
+	{ \
+		R = _mm_add_epi16(R, DITHER_RB); \
+		G = _mm_add_epi16(G, DITHER_G); \
+		B = _mm_add_epi16(B, DITHER_RB); \
+	} \
+	R = _mm_min_epi16(R, _mm_set1_epi16(255)); \
+	G = _mm_min_epi16(G, _mm_set1_epi16(255)); \
+	B = _mm_min_epi16(B, _mm_set1_epi16(255)); \
+	RGB16 = _mm_or_si128(_mm_or_si128( \
+		_mm_and_si128(_mm_slli_epi16(R, green_bits+2), _mm_set1_epi16((short)(0x1F<<(green_bits+5)))), \
+		_mm_and_si128(_mm_slli_epi16(G, green_bits-3), _mm_set1_epi16((short)(((1<<green_bits)-1)<<5)))), \
+		_mm_srli_epi16(B, 3)); \
+
+// 16 pixels of a line, rgb offsets of u and v must be computed
+#define YUV2RGB16_16(Y_PTR, RGB_PTR, DITHER_RB, DITHER_G) \
+	r_16_1=r_uv_16_1; g_16_1=g_uv_16_1; b_16_1=b_uv_16_1; \
+	r_16_2=r_uv_16_2; g_16_2=g_uv_16_2; b_16_2=b_uv_16_2; \
 	\
-	/* do the same again with next data */ \
-	rgb1 = LOAD_SI128((const __m128i*)(rgb_ptr1+64)), \
-	rgb2 = LOAD_SI128((const __m128i*)(rgb_ptr1+80)), \
-	rgb3 = LOAD_SI128((const __m128i*)(rgb_ptr1+96)), \
-	rgb4 = LOAD_SI128((const __m128i*)(rgb_ptr1+112)), \
-	rgb5 = LOAD_SI128((const __m128i*)(rgb_ptr2+64)), \
-	rgb6 = LOAD_SI128((const __m128i*)(rgb_ptr2+80)), \
-	rgb7 = LOAD_SI128((const __m128i*)(rgb_ptr2+96)), \
-	rgb8 = LOAD_SI128((const __m128i*)(rgb_ptr2+112)); \
-	/* unpack rgb24 data to r, g and b data in separate channels*/ \
-	/* see rgb.txt to get an idea of the algorithm, note that we only go to the next to last step*/ \
-	/* here, because averaging in horizontal direction is easier like this*/ \
-	/* The last step is applied further on the Y channel only*/ \
-	UNPACK_RGB32_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8) \
-	UNPACK_RGB32_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8) \
-	UNPACK_RGB32_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8) \
-	UNPACK_RGB32_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, rgb7, rgb8) \
-	/* first compute Y', (B-Y') and (R-Y'), in 16bits values, for the first line */ \
-	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are saved*/ \
-	r_16 = _mm_unpacklo_epi8(rgb1, _mm_setzero_si128()); \
-	g_16 = _mm_unpacklo_epi8(rgb2, _mm_setzero_si128()); \
-	b_16 = _mm_unpacklo_epi8(rgb3, _mm_setzero_si128()); \
-	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y1_16 = _mm_srli_epi16(y1_16, 8); \
-	cb2_16 = _mm_sub_epi16(b_16, y1_16); \
-	cr2_16 = _mm_sub_epi16(r_16, y1_16); \
-	r_16 = _mm_unpacklo_epi8(rgb5, _mm_setzero_si128()); \
-	g_16 = _mm_unpacklo_epi8(rgb6, _mm_setzero_si128()); \
-	b_16 = _mm_unpacklo_epi8(rgb7, _mm_setzero_si128()); \
-	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y2_16 = _mm_srli_epi16(y2_16, 8); \
-	cb2_16 = _mm_add_epi16(cb2_16, _mm_sub_epi16(b_16, y2_16)); \
-	cr2_16 = _mm_add_epi16(cr2_16, _mm_sub_epi16(r_16, y2_16)); \
-	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
-	y1_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y1_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	y2_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y2_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	Y = _mm_packus_epi16(y1_16, y2_16); \
-	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
-	SAVE_SI128((__m128i*)(y_ptr1+16), Y); \
-	/* same for the second line, compute Y', (B-Y') and (R-Y'), in 16bits values */ \
-	/* Y is saved for each pixel, while only sums of (B-Y') and (R-Y') for pairs of adjacents pixels are added to the previous values*/ \
-	r_16 = _mm_unpackhi_epi8(rgb1, _mm_setzero_si128()); \
-	g_16 = _mm_unpackhi_epi8(rgb2, _mm_setzero_si128()); \
-	b_16 = _mm_unpackhi_epi8(rgb3, _mm_setzero_si128()); \
-	y1_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y1_16 = _mm_add_epi16(y1_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y1_16 = _mm_srli_epi16(y1_16, 8); \
-	cb2_16 = _mm_add_epi16(cb2_16, _mm_sub_epi16(b_16, y1_16)); \
-	cr2_16 = _mm_add_epi16(cr2_16, _mm_sub_epi16(r_16, y1_16)); \
-	r_16 = _mm_unpackhi_epi8(rgb5, _mm_setzero_si128()); \
-	g_16 = _mm_unpackhi_epi8(rgb6, _mm_setzero_si128()); \
-	b_16 = _mm_unpackhi_epi8(rgb7, _mm_setzero_si128()); \
-	y2_16 = _mm_add_epi16(_mm_mullo_epi16(r_16, _mm_set1_epi16(param->r_factor)), \
-		_mm_mullo_epi16(g_16, _mm_set1_epi16(param->g_factor))); \
-	y2_16 = _mm_add_epi16(y2_16, _mm_mullo_epi16(b_16, _mm_set1_epi16(param->b_factor))); \
-	y2_16 = _mm_srli_epi16(y2_16, 8); \
-	cb2_16 = _mm_add_epi16(cb2_16, _mm_sub_epi16(b_16, y2_16)); \
-	cr2_16 = _mm_add_epi16(cr2_16, _mm_sub_epi16(r_16, y2_16)); \
-	/* Rescale Y' to Y, pack it to 8bit values and save it */ \
-	y1_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y1_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	y2_16 = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(y2_16, _mm_set1_epi16(param->y_factor)), 7), _mm_set1_epi16(param->y_offset)); \
-	Y = _mm_packus_epi16(y1_16, y2_16); \
-	Y = _mm_unpackhi_epi8(_mm_slli_si128(Y, 8), Y); \
-	SAVE_SI128((__m128i*)(y_ptr2+16), Y); \
-	/* Rescale Cb and Cr to their final range */ \
-	cb2_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cb2_16, 2), _mm_set1_epi16(param->cb_factor)), 8), _mm_set1_epi16(128)); \
-	cr2_16 = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(cr2_16, 2), _mm_set1_epi16(param->cr_factor)), 8), _mm_set1_epi16(128)); \
-	/* Pack and save Cb Cr */ \
-	cb = _mm_packus_epi16(cb1_16, cb2_16); \
-	cr = _mm_packus_epi16(cr1_16, cr2_16); \
-	SAVE_SI128((__m128i*)(u_ptr), cb); \
-	SAVE_SI128((__m128i*)(v_ptr), cr);
+	y = LOAD_SI128((const __m128i*)(Y_PTR)); \
+	y_16_1 = _mm_sub_epi16(_mm_unpacklo_epi8(y, _mm_setzero_si128()), _mm_set1_epi16(param->y_offset)); \
+	y_16_2 = _mm_sub_epi16(_mm_unpackhi_epi8(y, _mm_setzero_si128()), _mm_set1_epi16(param->y_offset)); \
+	\
+	ADD_Y2RGB_16(y_16_1, y_16_2, r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2) \
+	\
+	PACK_RGB16_8(r_16_1, g_16_1, b_16_1, DITHER_RB, DITHER_G, rgb16_1) \
+	PACK_RGB16_8(r_16_2, g_16_2, b_16_2, DITHER_RB, DITHER_G, rgb16_2) \
+	SAVE_SI128((__m128i*)(RGB_PTR), rgb16_1); \
+	SAVE_SI128((__m128i*)(RGB_PTR+16), rgb16_2); \
+
+#define YUV2RGB16_32 \
+	__m128i r_tmp, g_tmp, b_tmp; \
+	__m128i r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2; \
+	__m128i r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2; \
+	__m128i y, y_16_1, y_16_2, rgb16_1, rgb16_2; \
+	\
+	u = _mm_add_epi8(u, _mm_set1_epi8(-128)); \
+	v = _mm_add_epi8(v, _mm_set1_epi8(-128)); \
+	\
+	/* process first 16 pixels of both lines */\
+	__m128i u_16 = _mm_srai_epi16(_mm_unpacklo_epi8(u, u), 8); \
+	__m128i v_16 = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8); \
+	\
+	UV2RGB_16(u_16, v_16, r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2) \
+	YUV2RGB16_16(y_ptr1, rgb_ptr1, dither_rb_1, dither_g_1) \
+	YUV2RGB16_16(y_ptr2, rgb_ptr2, dither_rb_2, dither_g_2) \
+	\
+	/* process last 16 pixels of both lines */\
+	u_16 = _mm_srai_epi16(_mm_unpackhi_epi8(u, u), 8); \
+	v_16 = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8); \
+	\
+	UV2RGB_16(u_16, v_16, r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2) \
+	YUV2RGB16_16(y_ptr1+16, rgb_ptr1+32, dither_rb_1, dither_g_1) \
+	YUV2RGB16_16(y_ptr2+16, rgb_ptr2+32, dither_rb_2, dither_g_2) \
+
+ALWAYS_INLINE void yuv420_rgb16_sse_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int green_bits, int dither, YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		const __m128i dither_rb_1=dither_thresholds_8(y, 5), dither_g_1=dither_thresholds_8(y, green_bits), 
+			dither_rb_2=dither_thresholds_8(y+1, 5), dither_g_2=dither_thresholds_8(y+1, green_bits);
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			LOAD_UV_PLANAR
+			YUV2RGB16_32
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			u_ptr+=16;
+			v_ptr+=16;
+			rgb_ptr1+=64;
+			rgb_ptr2+=64;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		yuv420_rgb16_std_impl(width-x, height, Y+x, U+x/2, V+x/2, Y_stride, UV_stride, 1, RGB+x*2, RGB_stride, green_bits, dither, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+ALWAYS_INLINE void yuv420_rgb16_sseu_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int green_bits, int dither, YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		const __m128i dither_rb_1=dither_thresholds_8(y, 5), dither_g_1=dither_thresholds_8(y, green_bits), 
+			dither_rb_2=dither_thresholds_8(y+1, 5), dither_g_2=dither_thresholds_8(y+1, green_bits);
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			LOAD_UV_PLANAR
+			YUV2RGB16_32
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			u_ptr+=16;
+			v_ptr+=16;
+			rgb_ptr1+=64;
+			rgb_ptr2+=64;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		yuv420_rgb16_std_impl(width-x, height, Y+x, U+x/2, V+x/2, Y_stride, UV_stride, 1, RGB+x*2, RGB_stride, green_bits, dither, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+ALWAYS_INLINE void nv12_rgb16_sse_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int green_bits, int dither, YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*uv_ptr=UV+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		const __m128i dither_rb_1=dither_thresholds_8(y, 5), dither_g_1=dither_thresholds_8(y, green_bits), 
+			dither_rb_2=dither_thresholds_8(y+1, 5), dither_g_2=dither_thresholds_8(y+1, green_bits);
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			LOAD_UV_NV12
+			YUV2RGB16_32
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			uv_ptr+=32;
+			rgb_ptr1+=64;
+			rgb_ptr2+=64;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		yuv420_rgb16_std_impl(width-x, height, Y+x, UV+x, UV+x+1, Y_stride, UV_stride, 2, RGB+x*2, RGB_stride, green_bits, dither, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+ALWAYS_INLINE void nv12_rgb16_sseu_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int green_bits, int dither, YCbCrType yuv_type)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	
+	uint32_t x, y;
+	for(y=0; y<(height-1); y+=2)
+	{
+		const uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*uv_ptr=UV+(y/2)*UV_stride;
+		
+		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		
+		const __m128i dither_rb_1=dither_thresholds_8(y, 5), dither_g_1=dither_thresholds_8(y, green_bits), 
+			dither_rb_2=dither_thresholds_8(y+1, 5), dither_g_2=dither_thresholds_8(y+1, green_bits);
+		
+		for(x=0; x+31<width; x+=32)
+		{
+			LOAD_UV_NV12
+			YUV2RGB16_32
+			
+			y_ptr1+=32;
+			y_ptr2+=32;
+			uv_ptr+=32;
+			rgb_ptr1+=64;
+			rgb_ptr2+=64;
+		}
+	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		yuv420_rgb16_std_impl(width-x, height, Y+x, UV+x, UV+x+1, Y_stride, UV_stride, 2, RGB+x*2, RGB_stride, green_bits, dither, yuv_type);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void yuv420_rgb565_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int dither, YCbCrType yuv_type)
+{
+	SPECIALIZE_RGB16(yuv420_rgb16_sse_impl, width, height, Y, U, V, Y_stride, UV_stride, RGB, RGB_stride, 6)
+}
+
+void yuv420_rgb555_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int dither, YCbCrType yuv_type)
+{
+	SPECIALIZE_RGB16(yuv420_rgb16_sse_impl, width, height, Y, U, V, Y_stride, UV_stride, RGB, RGB_stride, 5)
+}
+
+void yuv420_rgb565_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int dither, YCbCrType yuv_type)
+{
+	SPECIALIZE_RGB16(yuv420_rgb16_sseu_impl, width, height, Y, U, V, Y_stride, UV_stride, RGB, RGB_stride, 6)
+}
+
+void yuv420_rgb555_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int dither, YCbCrType yuv_type)
+{
+	SPECIALIZE_RGB16(yuv420_rgb16_sseu_impl, width, height, Y, U, V, Y_stride, UV_stride, RGB, RGB_stride, 5)
+}
+
+void nv12_rgb565_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int dither, YCbCrType yuv_type)
+{
+	SPECIALIZE_RGB16(nv12_rgb16_sse_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride, 6)
+}
+
+void nv12_rgb555_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int dither, YCbCrType yuv_type)
+{
+	SPECIALIZE_RGB16(nv12_rgb16_sse_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride, 5)
+}
+
+void nv12_rgb565_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int dither, YCbCrType yuv_type)
+{
+	SPECIALIZE_RGB16(nv12_rgb16_sseu_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride, 6)
+}
+
+void nv12_rgb555_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int dither, YCbCrType yuv_type)
+{
+	SPECIALIZE_RGB16(nv12_rgb16_sseu_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride, 5)
+}
+
+// Packed rgb utilities, 32 pixels of a line are unpacked to r, g and b (and a) vectors with the steps of 
+// rgb.txt and rgba.txt, and packed again with PACK_RGB24_32, or by interleaving for rgba
+
+#define UNPACK_RGB24_32(R1, R2, G1, G2, B1, B2) \
+	__m128i rgb1 = LOAD_SI128((const __m128i*)(rgb_ptr)), \
+		rgb2 = LOAD_SI128((const __m128i*)(rgb_ptr+16)), \
+		rgb3 = LOAD_SI128((const __m128i*)(rgb_ptr+32)), \
+		rgb4 = LOAD_SI128((const __m128i*)(rgb_ptr+48)), \
+		rgb5 = LOAD_SI128((const __m128i*)(rgb_ptr+64)), \
+		rgb6 = LOAD_SI128((const __m128i*)(rgb_ptr+80)); \
+	__m128i tmp1, tmp2, tmp3, tmp4, tmp5, tmp6; \
+	UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6) \
+	UNPACK_RGB24_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6) \
+	UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6) \
+	UNPACK_RGB24_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, rgb1, rgb2, rgb3, rgb4, rgb5, rgb6) \
+	UNPACK_RGB24_32_STEP(rgb1, rgb2, rgb3, rgb4, rgb5, rgb6, R1, R2, G1, G2, B1, B2) \
+
+#define UNPACK_RGBA32_32(R1, R2, G1, G2, B1, B2, A1, A2) \
+	__m128i rgba1 = LOAD_SI128((const __m128i*)(rgba_ptr)), \
+		rgba2 = LOAD_SI128((const __m128i*)(rgba_ptr+16)), \
+		rgba3 = LOAD_SI128((const __m128i*)(rgba_ptr+32)), \
+		rgba4 = LOAD_SI128((const __m128i*)(rgba_ptr+48)), \
+		rgba5 = LOAD_SI128((const __m128i*)(rgba_ptr+64)), \
+		rgba6 = LOAD_SI128((const __m128i*)(rgba_ptr+80)), \
+		rgba7 = LOAD_SI128((const __m128i*)(rgba_ptr+96)), \
+		rgba8 = LOAD_SI128((const __m128i*)(rgba_ptr+112)); \
+	__m128i tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8; \
+	UNPACK_RGB32_32_STEP(rgba1, rgba2, rgba3, rgba4, rgba5, rgba6, rgba7, rgba8, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8) \
+	UNPACK_RGB32_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, rgba1, rgba2, rgba3, rgba4, rgba5, rgba6, rgba7, rgba8) \
+	UNPACK_RGB32_32_STEP(rgba1, rgba2, rgba3, rgba4, rgba5, rgba6, rgba7, rgba8, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8) \
+	UNPACK_RGB32_32_STEP(tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, rgba1, rgba2, rgba3, rgba4, rgba5, rgba6, rgba7, rgba8) \
+	UNPACK_RGB32_32_STEP(rgba1, rgba2, rgba3, rgba4, rgba5, rgba6, rgba7, rgba8, R1, R2, G1, G2, B1, B2, A1, A2) \
+
+// interleave r, g, b and a of 16 pixels, and save them at RGBA_PTR
+#define SAVE_RGBA32_16(R, G, B, A, RGBA_PTR) \
+	{ \
+		const __m128i rg_lo = _mm_unpacklo_epi8(R, G), ba_lo = _mm_unpacklo_epi8(B, A), \
+			rg_hi = _mm_unpackhi_epi8(R, G), ba_hi = _mm_unpackhi_epi8(B, A); \
+		SAVE_SI128((__m128i*)(RGBA_PTR), _mm_unpacklo_epi16(rg_lo, ba_lo)); \
+		SAVE_SI128((__m128i*)(RGBA_PTR+16), _mm_unpackhi_epi16(rg_lo, ba_lo)); \
+		SAVE_SI128((__m128i*)(RGBA_PTR+32), _mm_unpacklo_epi16(rg_hi, ba_hi)); \
+		SAVE_SI128((__m128i*)(RGBA_PTR+48), _mm_unpackhi_epi16(rg_hi, ba_hi)); \
+	}
+
+#define SAVE_RGB24_32(RGB_PTR) \
+	SAVE_SI128((__m128i*)(RGB_PTR), rgb_1); \
+	SAVE_SI128((__m128i*)(RGB_PTR+16), rgb_2); \
+	SAVE_SI128((__m128i*)(RGB_PTR+32), rgb_3); \
+	SAVE_SI128((__m128i*)(RGB_PTR+48), rgb_4); \
+	SAVE_SI128((__m128i*)(RGB_PTR+64), rgb_5); \
+	SAVE_SI128((__m128i*)(RGB_PTR+80), rgb_6); \
+
+#define RGB24_RGBA32_32 \
+	__m128i r1, r2, g1, g2, b1, b2; \
+	UNPACK_RGB24_32(r1, r2, g1, g2, b1, b2) \
+	if(swap) \
+	{ \
+		SAVE_RGBA32_16(b1, g1, r1, a, rgba_ptr) \
+		SAVE_RGBA32_16(b2, g2, r2, a, rgba_ptr+64) \
+	} \
+	else \
+	{ \
+		SAVE_RGBA32_16(r1, g1, b1, a, rgba_ptr) \
+		SAVE_RGBA32_16(r2, g2, b2, a, rgba_ptr+64) \
+	} \
+
+#define RGBA32_RGB24_32 \
+	__m128i r1, r2, g1, g2, b1, b2, a1, a2; \
+	__m128i rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6; \
+	UNPACK_RGBA32_32(r1, r2, g1, g2, b1, b2, a1, a2) \
+	(void)a1; \
+	(void)a2; \
+	if(swap) \
+	{ \
+		PACK_RGB24_32(b1, b2, g1, g2, r1, r2, rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6) \
+	} \
+	else \
+	{ \
+		PACK_RGB24_32(r1, r2, g1, g2, b1, b2, rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6) \
+	} \
+	SAVE_RGB24_32(rgb_ptr) \
+
+#define RGB24_BGR24_32 \
+	__m128i r1, r2, g1, g2, b1, b2; \
+	__m128i rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6; \
+	UNPACK_RGB24_32(r1, r2, g1, g2, b1, b2) \
+	PACK_RGB24_32(b1, b2, g1, g2, r1, r2, rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6) \
+	SAVE_RGB24_32(bgr_ptr) \
+
+// swap the first and third bytes of 4 pixels
+#define RGBA32_BGRA32_4(OFFSET) \
+	{ \
+		const __m128i rgba = LOAD_SI128((const __m128i*)(rgba_ptr+OFFSET)); \
+		SAVE_SI128((__m128i*)(bgra_ptr+OFFSET), _mm_or_si128(_mm_and_si128(rgba, _mm_set1_epi32((int)0xFF00FF00)), \
+			_mm_or_si128(_mm_and_si128(_mm_slli_epi32(rgba, 16), _mm_set1_epi32(0x00FF0000)), \
+				_mm_and_si128(_mm_srli_epi32(rgba, 16), _mm_set1_epi32(0x000000FF))))); \
+	}
+
+#define RGB24_RGB_PLANES_32 \
+	__m128i r1, r2, g1, g2, b1, b2; \
+	UNPACK_RGB24_32(r1, r2, g1, g2, b1, b2) \
+	SAVE_SI128((__m128i*)(r_ptr), r1); \
+	SAVE_SI128((__m128i*)(r_ptr+16), r2); \
+	SAVE_SI128((__m128i*)(g_ptr), g1); \
+	SAVE_SI128((__m128i*)(g_ptr+16), g2); \
+	SAVE_SI128((__m128i*)(b_ptr), b1); \
+	SAVE_SI128((__m128i*)(b_ptr+16), b2); \
+
+#define RGB_PLANES_RGB24_32 \
+	__m128i r1 = LOAD_SI128((const __m128i*)(r_ptr)), r2 = LOAD_SI128((const __m128i*)(r_ptr+16)), \
+		g1 = LOAD_SI128((const __m128i*)(g_ptr)), g2 = LOAD_SI128((const __m128i*)(g_ptr+16)), \
+		b1 = LOAD_SI128((const __m128i*)(b_ptr)), b2 = LOAD_SI128((const __m128i*)(b_ptr+16)); \
+	__m128i rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6; \
+	PACK_RGB24_32(r1, r2, g1, g2, b1, b2, rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6) \
+	SAVE_RGB24_32(rgb_ptr) \
+
+ALWAYS_INLINE void rgb24_rgba32_sse_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t alpha, int swap)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		uint8_t *rgba_ptr=RGBA+y*RGBA_stride;
+		const __m128i a=_mm_set1_epi8((char)alpha);
+		for(x=0; x+31<width; x+=32)
+		{
+			RGB24_RGBA32_32
+			
+			rgb_ptr+=96;
+			rgba_ptr+=128;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation
+	x = width&~31u;
+	if(x<width)
+		rgb24_rgba32_std_impl(width-x, height, RGB+x*3, RGB_stride, RGBA+x*4, RGBA_stride, alpha, swap);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+ALWAYS_INLINE void rgb24_rgba32_sseu_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t alpha, int swap)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		uint8_t *rgba_ptr=RGBA+y*RGBA_stride;
+		const __m128i a=_mm_set1_epi8((char)alpha);
+		for(x=0; x+31<width; x+=32)
+		{
+			RGB24_RGBA32_32
+			
+			rgb_ptr+=96;
+			rgba_ptr+=128;
+		}
+	}
+	// process remaining pixels with the standard implementation
+	x = width&~31u;
+	if(x<width)
+		rgb24_rgba32_std_impl(width-x, height, RGB+x*3, RGB_stride, RGBA+x*4, RGBA_stride, alpha, swap);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+ALWAYS_INLINE void rgba32_rgb24_sse_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int swap)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgba_ptr=RGBA+y*RGBA_stride;
+		uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		for(x=0; x+31<width; x+=32)
+		{
+			RGBA32_RGB24_32
+			
+			rgba_ptr+=128;
+			rgb_ptr+=96;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation
+	x = width&~31u;
+	if(x<width)
+		rgba32_rgb24_std_impl(width-x, height, RGBA+x*4, RGBA_stride, RGB+x*3, RGB_stride, swap);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+ALWAYS_INLINE void rgba32_rgb24_sseu_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int swap)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgba_ptr=RGBA+y*RGBA_stride;
+		uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		for(x=0; x+31<width; x+=32)
+		{
+			RGBA32_RGB24_32
+			
+			rgba_ptr+=128;
+			rgb_ptr+=96;
+		}
+	}
+	// process remaining pixels with the standard implementation
+	x = width&~31u;
+	if(x<width)
+		rgba32_rgb24_std_impl(width-x, height, RGBA+x*4, RGBA_stride, RGB+x*3, RGB_stride, swap);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void rgb24_rgba32_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t alpha)
+{
+	rgb24_rgba32_sse_impl(width, height, RGB, RGB_stride, RGBA, RGBA_stride, alpha, 0);
+}
+
+void rgb24_bgra32_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *BGRA, uint32_t BGRA_stride, 
+	uint8_t alpha)
+{
+	rgb24_rgba32_sse_impl(width, height, RGB, RGB_stride, BGRA, BGRA_stride, alpha, 1);
+}
+
+void rgba32_rgb24_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *RGB, uint32_t RGB_stride)
+{
+	rgba32_rgb24_sse_impl(width, height, RGBA, RGBA_stride, RGB, RGB_stride, 0);
+}
+
+void bgra32_rgb24_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *BGRA, uint32_t BGRA_stride, 
+	uint8_t *RGB, uint32_t RGB_stride)
+{
+	rgba32_rgb24_sse_impl(width, height, BGRA, BGRA_stride, RGB, RGB_stride, 1);
+}
+
+void rgb24_rgba32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t alpha)
+{
+	rgb24_rgba32_sseu_impl(width, height, RGB, RGB_stride, RGBA, RGBA_stride, alpha, 0);
+}
+
+void rgb24_bgra32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *BGRA, uint32_t BGRA_stride, 
+	uint8_t alpha)
+{
+	rgb24_rgba32_sseu_impl(width, height, RGB, RGB_stride, BGRA, BGRA_stride, alpha, 1);
+}
+
+void rgba32_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *RGB, uint32_t RGB_stride)
+{
+	rgba32_rgb24_sseu_impl(width, height, RGBA, RGBA_stride, RGB, RGB_stride, 0);
+}
+
+void bgra32_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *BGRA, uint32_t BGRA_stride, 
+	uint8_t *RGB, uint32_t RGB_stride)
+{
+	rgba32_rgb24_sseu_impl(width, height, BGRA, BGRA_stride, RGB, RGB_stride, 1);
+}
+
+void rgb24_bgr24_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *BGR, uint32_t BGR_stride)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		uint8_t *bgr_ptr=BGR+y*BGR_stride;
+		for(x=0; x+31<width; x+=32)
+		{
+			RGB24_BGR24_32
+			
+			rgb_ptr+=96;
+			bgr_ptr+=96;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation
+	x = width&~31u;
+	if(x<width)
+		rgb24_bgr24_std(width-x, height, RGB+x*3, RGB_stride, BGR+x*3, BGR_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void rgb24_bgr24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *BGR, uint32_t BGR_stride)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		uint8_t *bgr_ptr=BGR+y*BGR_stride;
+		for(x=0; x+31<width; x+=32)
+		{
+			RGB24_BGR24_32
+			
+			rgb_ptr+=96;
+			bgr_ptr+=96;
+		}
+	}
+	// process remaining pixels with the standard implementation
+	x = width&~31u;
+	if(x<width)
+		rgb24_bgr24_std(width-x, height, RGB+x*3, RGB_stride, BGR+x*3, BGR_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void rgba32_bgra32_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *BGRA, uint32_t BGRA_stride)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgba_ptr=RGBA+y*RGBA_stride;
+		uint8_t *bgra_ptr=BGRA+y*BGRA_stride;
+		for(x=0; x+15<width; x+=16)
+		{
+			RGBA32_BGRA32_4(0)
+			RGBA32_BGRA32_4(16)
+			RGBA32_BGRA32_4(32)
+			RGBA32_BGRA32_4(48)
+			
+			rgba_ptr+=64;
+			bgra_ptr+=64;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation
+	x = width&~15u;
+	if(x<width)
+		rgba32_bgra32_std(width-x, height, RGBA+x*4, RGBA_stride, BGRA+x*4, BGRA_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void rgba32_bgra32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *BGRA, uint32_t BGRA_stride)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgba_ptr=RGBA+y*RGBA_stride;
+		uint8_t *bgra_ptr=BGRA+y*BGRA_stride;
+		for(x=0; x+15<width; x+=16)
+		{
+			RGBA32_BGRA32_4(0)
+			RGBA32_BGRA32_4(16)
+			RGBA32_BGRA32_4(32)
+			RGBA32_BGRA32_4(48)
+			
+			rgba_ptr+=64;
+			bgra_ptr+=64;
+		}
+	}
+	// process remaining pixels with the standard implementation
+	x = width&~15u;
+	if(x<width)
+		rgba32_bgra32_std(width-x, height, RGBA+x*4, RGBA_stride, BGRA+x*4, BGRA_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void rgb24_rgb_planes_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *R, uint8_t *G, uint8_t *B, uint32_t planes_stride)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		uint8_t *r_ptr=R+y*planes_stride, *g_ptr=G+y*planes_stride, *b_ptr=B+y*planes_stride;
+		for(x=0; x+31<width; x+=32)
+		{
+			RGB24_RGB_PLANES_32
+			
+			rgb_ptr+=96;
+			r_ptr+=32;
+			g_ptr+=32;
+			b_ptr+=32;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation
+	x = width&~31u;
+	if(x<width)
+		rgb24_rgb_planes_std(width-x, height, RGB+x*3, RGB_stride, R+x, G+x, B+x, planes_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void rgb24_rgb_planes_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *R, uint8_t *G, uint8_t *B, uint32_t planes_stride)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		uint8_t *r_ptr=R+y*planes_stride, *g_ptr=G+y*planes_stride, *b_ptr=B+y*planes_stride;
+		for(x=0; x+31<width; x+=32)
+		{
+			RGB24_RGB_PLANES_32
+			
+			rgb_ptr+=96;
+			r_ptr+=32;
+			g_ptr+=32;
+			b_ptr+=32;
+		}
+	}
+	// process remaining pixels with the standard implementation
+	x = width&~31u;
+	if(x<width)
+		rgb24_rgb_planes_std(width-x, height, RGB+x*3, RGB_stride, R+x, G+x, B+x, planes_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void rgb_planes_rgb24_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *R, const uint8_t *G, const uint8_t *B, uint32_t planes_stride, 
+	uint8_t *RGB, uint32_t RGB_stride)
+{
+	#define LOAD_SI128 _mm_load_si128
+	#define SAVE_SI128 _mm_stream_si128
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *r_ptr=R+y*planes_stride, *g_ptr=G+y*planes_stride, *b_ptr=B+y*planes_stride;
+		uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		for(x=0; x+31<width; x+=32)
+		{
+			RGB_PLANES_RGB24_32
+			
+			r_ptr+=32;
+			g_ptr+=32;
+			b_ptr+=32;
+			rgb_ptr+=96;
+		}
+	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation
+	x = width&~31u;
+	if(x<width)
+		rgb_planes_rgb24_std(width-x, height, R+x, G+x, B+x, planes_stride, RGB+x*3, RGB_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
+
+void rgb_planes_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *R, const uint8_t *G, const uint8_t *B, uint32_t planes_stride, 
+	uint8_t *RGB, uint32_t RGB_stride)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	uint32_t x, y;
+	for(y=0; y<height; ++y)
+	{
+		const uint8_t *r_ptr=R+y*planes_stride, *g_ptr=G+y*planes_stride, *b_ptr=B+y*planes_stride;
+		uint8_t *rgb_ptr=RGB+y*RGB_stride;
+		for(x=0; x+31<width; x+=32)
+		{
+			RGB_PLANES_RGB24_32
+			
+			r_ptr+=32;
+			g_ptr+=32;
+			b_ptr+=32;
+			rgb_ptr+=96;
+		}
+	}
+	// process remaining pixels with the standard implementation
+	x = width&~31u;
+	if(x<width)
+		rgb_planes_rgb24_std(width-x, height, R+x, G+x, B+x, planes_stride, RGB+x*3, RGB_stride);
+	#undef LOAD_SI128
+	#undef SAVE_SI128
+}
 
-void rgb32_yuv420_sse(uint32_t width, uint32_t height, 
-	const uint8_t *RGBA, uint32_t RGBA_stride, 
-	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
-	YCbCrType yuv_type)
+// yuva420 to rgba32 or bgra32, the rgb values of UV2RGB_16 and ADD_Y2RGB_16 are interleaved with alpha
+
+// multiply the 16 bits values C of 8 pixels, in [0:255], by A/255, see PREMULTIPLY_ALPHA
+// C*A does not fit in a signed 16 bits value, but its low 16 bits are right and are used as unsigned
+#define PREMULTIPLY_ALPHA_8(C, A) \
+	C = _mm_add_epi16(_mm_mullo_epi16(C, A), _mm_set1_epi16(128)); \
+	C = _mm_srli_epi16(_mm_add_epi16(C, _mm_srli_epi16(C, 8)), 8);
+
+#define PREMULTIPLY_RGB_8(R, G, B, A) \
+	R = _mm_min_epi16(_mm_max_epi16(R, _mm_setzero_si128()), _mm_set1_epi16(255)); \
+	G = _mm_min_epi16(_mm_max_epi16(G, _mm_setzero_si128()), _mm_set1_epi16(255)); \
+	B = _mm_min_epi16(_mm_max_epi16(B, _mm_setzero_si128()), _mm_set1_epi16(255)); \
+	PREMULTIPLY_ALPHA_8(R, A) \
+	PREMULTIPLY_ALPHA_8(G, A) \
+	PREMULTIPLY_ALPHA_8(B, A)
+
+// 16 pixels of a line, rgb offsets of u and v must be computed
+#define YUVA2RGBA_16(Y_PTR, A_PTR, RGBA_PTR) \
+	r_16_1=r_uv_16_1; g_16_1=g_uv_16_1; b_16_1=b_uv_16_1; \
+	r_16_2=r_uv_16_2; g_16_2=g_uv_16_2; b_16_2=b_uv_16_2; \
+	\
+	y = LOAD_SI128((const __m128i*)(Y_PTR)); \
+	y_16_1 = _mm_sub_epi16(_mm_unpacklo_epi8(y, _mm_setzero_si128()), _mm_set1_epi16(param->y_offset)); \
+	y_16_2 = _mm_sub_epi16(_mm_unpackhi_epi8(y, _mm_setzero_si128()), _mm_set1_epi16(param->y_offset)); \
+	\
+	ADD_Y2RGB_16(y_16_1, y_16_2, r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2) \
+	\
+	a = LOAD_SI128((const __m128i*)(A_PTR)); \
+	if(premultiply) \
+	{ \
+		const __m128i a_16_1 = _mm_unpacklo_epi8(a, _mm_setzero_si128()), \
+			a_16_2 = _mm_unpackhi_epi8(a, _mm_setzero_si128()); \
+		PREMULTIPLY_RGB_8(r_16_1, g_16_1, b_16_1, a_16_1) \
+		PREMULTIPLY_RGB_8(r_16_2, g_16_2, b_16_2, a_16_2) \
+	} \
+	r = _mm_packus_epi16(r_16_1, r_16_2); \
+	g = _mm_packus_epi16(g_16_1, g_16_2); \
+	b = _mm_packus_epi16(b_16_1, b_16_2); \
+	if(swap) \
+	{ \
+		SAVE_RGBA32_16(b, g, r, a, RGBA_PTR) \
+	} \
+	else \
+	{ \
+		SAVE_RGBA32_16(r, g, b, a, RGBA_PTR) \
+	}
+
+#define YUVA2RGBA_32 \
+	__m128i r_tmp, g_tmp, b_tmp; \
+	__m128i r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2; \
+	__m128i r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2; \
+	__m128i y, y_16_1, y_16_2, a, r, g, b; \
+	\
+	u = _mm_add_epi8(u, _mm_set1_epi8(-128)); \
+	v = _mm_add_epi8(v, _mm_set1_epi8(-128)); \
+	\
+	/* process first 16 pixels of both lines */\
+	__m128i u_16 = _mm_srai_epi16(_mm_unpacklo_epi8(u, u), 8); \
+	__m128i v_16 = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8); \
+	\
+	UV2RGB_16(u_16, v_16, r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2) \
+	YUVA2RGBA_16(y_ptr1, a_ptr1, rgba_ptr1) \
+	YUVA2RGBA_16(y_ptr2, a_ptr2, rgba_ptr2) \
+	\
+	/* process last 16 pixels of both lines */\
+	u_16 = _mm_srai_epi16(_mm_unpackhi_epi8(u, u), 8); \
+	v_16 = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8); \
+	\
+	UV2RGB_16(u_16, v_16, r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2) \
+	YUVA2RGBA_16(y_ptr1+16, a_ptr1+16, rgba_ptr1+64) \
+	YUVA2RGBA_16(y_ptr2+16, a_ptr2+16, rgba_ptr2+64) \
+
+ALWAYS_INLINE void yuva420_rgba32_sse_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, const uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	int swap, int premultiply, YCbCrType yuv_type)
 {
 	#define LOAD_SI128 _mm_load_si128
 	#define SAVE_SI128 _mm_stream_si128
-	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
 	
 	uint32_t x, y;
 	for(y=0; y<(height-1); y+=2)
 	{
-		const uint8_t *rgb_ptr1=RGBA+y*RGBA_stride,
-			*rgb_ptr2=RGBA+(y+1)*RGBA_stride;
-		
-		uint8_t *y_ptr1=Y+y*Y_stride,
+		const uint8_t *y_ptr1=Y+y*Y_stride,
 			*y_ptr2=Y+(y+1)*Y_stride,
+			*a_ptr1=A+y*Y_stride,
+			*a_ptr2=A+(y+1)*Y_stride,
 			*u_ptr=U+(y/2)*UV_stride,
 			*v_ptr=V+(y/2)*UV_stride;
 		
-		for(x=0; x<(width-31); x+=32)
+		uint8_t *rgba_ptr1=RGBA+y*RGBA_stride,
+			*rgba_ptr2=RGBA+(y+1)*RGBA_stride;
+		
+		for(x=0; x+31<width; x+=32)
 		{
-			RGBA2YUV_32
+			LOAD_UV_PLANAR
+			YUVA2RGBA_32
 			
-			rgb_ptr1+=128;
-			rgb_ptr2+=128;
 			y_ptr1+=32;
 			y_ptr2+=32;
-			u_ptr+=16; 
+			a_ptr1+=32;
+			a_ptr2+=32;
+			u_ptr+=16;
 			v_ptr+=16;
+			rgba_ptr1+=128;
+			rgba_ptr2+=128;
 		}
 	}
+	// make non temporal stores visible to other threads
+	_mm_sfence();
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		yuva420_rgba32_std_impl(width-x, height, Y+x, U+x/2, V+x/2, A+x, Y_stride, UV_stride, RGBA+x*4, RGBA_stride, swap, premultiply, yuv_type);
 	#undef LOAD_SI128
 	#undef SAVE_SI128
 }
 
-void rgb32_yuv420_sseu(uint32_t width, uint32_t height, 
-	const uint8_t *RGBA, uint32_t RGBA_stride, 
-	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
-	YCbCrType yuv_type)
+void yuva420_rgba32_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, const uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	int premultiply, YCbCrType yuv_type)
+{
+	SPECIALIZE_PREMULTIPLY(yuva420_rgba32_sse_impl, width, height, Y, U, V, A, Y_stride, UV_stride, RGBA, RGBA_stride, 0)
+}
+
+void yuva420_bgra32_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, const uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *BGRA, uint32_t BGRA_stride, 
+	int premultiply, YCbCrType yuv_type)
+{
+	SPECIALIZE_PREMULTIPLY(yuva420_rgba32_sse_impl, width, height, Y, U, V, A, Y_stride, UV_stride, BGRA, BGRA_stride, 1)
+}
+
+ALWAYS_INLINE void yuva420_rgba32_sseu_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, const uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	int swap, int premultiply, YCbCrType yuv_type)
 {
 	#define LOAD_SI128 _mm_loadu_si128
 	#define SAVE_SI128 _mm_storeu_si128
-	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
 	
 	uint32_t x, y;
 	for(y=0; y<(height-1); y+=2)
 	{
-		const uint8_t *rgb_ptr1=RGBA+y*RGBA_stride,
-			*rgb_ptr2=RGBA+(y+1)*RGBA_stride;
-		
-		uint8_t *y_ptr1=Y+y*Y_stride,
+		const uint8_t *y_ptr1=Y+y*Y_stride,
 			*y_ptr2=Y+(y+1)*Y_stride,
+			*a_ptr1=A+y*Y_stride,
+			*a_ptr2=A+(y+1)*Y_stride,
 			*u_ptr=U+(y/2)*UV_stride,
 			*v_ptr=V+(y/2)*UV_stride;
 		
-		for(x=0; x<(width-31); x+=32)
+		uint8_t *rgba_ptr1=RGBA+y*RGBA_stride,
+			*rgba_ptr2=RGBA+(y+1)*RGBA_stride;
+		
+		for(x=0; x+31<width; x+=32)
 		{
-			RGBA2YUV_32
+			LOAD_UV_PLANAR
+			YUVA2RGBA_32
 			
-			rgb_ptr1+=128;
-			rgb_ptr2+=128;
 			y_ptr1+=32;
 			y_ptr2+=32;
-			u_ptr+=16; 
+			a_ptr1+=32;
+			a_ptr2+=32;
+			u_ptr+=16;
 			v_ptr+=16;
+			rgba_ptr1+=128;
+			rgba_ptr2+=128;
 		}
 	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		yuva420_rgba32_std_impl(width-x, height, Y+x, U+x/2, V+x/2, A+x, Y_stride, UV_stride, RGBA+x*4, RGBA_stride, swap, premultiply, yuv_type);
 	#undef LOAD_SI128
 	#undef SAVE_SI128
 }
 
-#endif
-
-#ifdef _YUVRGB_SSE2_
-
-#define UV2RGB_16(U,V,R1,G1,B1,R2,G2,B2) \
-	r_tmp = _mm_srai_epi16(_mm_mullo_epi16(V, _mm_set1_epi16(param->cr_factor)), 6); \
-	g_tmp = _mm_srai_epi16(_mm_add_epi16( \
-		_mm_mullo_epi16(U, _mm_set1_epi16(param->g_cb_factor)), \
-		_mm_mullo_epi16(V, _mm_set1_epi16(param->g_cr_factor))), 7); \
-	b_tmp = _mm_srai_epi16(_mm_mullo_epi16(U, _mm_set1_epi16(param->cb_factor)), 6); \
-	R1 = _mm_unpacklo_epi16(r_tmp, r_tmp); \
-	G1 = _mm_unpacklo_epi16(g_tmp, g_tmp); \
-	B1 = _mm_unpacklo_epi16(b_tmp, b_tmp); \
-	R2 = _mm_unpackhi_epi16(r_tmp, r_tmp); \
-	G2 = _mm_unpackhi_epi16(g_tmp, g_tmp); \
-	B2 = _mm_unpackhi_epi16(b_tmp, b_tmp); \
+void yuva420_rgba32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, const uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	int premultiply, YCbCrType yuv_type)
+{
+	SPECIALIZE_PREMULTIPLY(yuva420_rgba32_sseu_impl, width, height, Y, U, V, A, Y_stride, UV_stride, RGBA, RGBA_stride, 0)
+}
 
-#define ADD_Y2RGB_16(Y1,Y2,R1,G1,B1,R2,G2,B2) \
-	Y1 = _mm_srli_epi16(_mm_mullo_epi16(Y1, _mm_set1_epi16(param->y_factor)), 7); \
-	Y2 = _mm_srli_epi16(_mm_mullo_epi16(Y2, _mm_set1_epi16(param->y_factor)), 7); \
-	\
-	R1 = _mm_add_epi16(Y1, R1); \
-	G1 = _mm_sub_epi16(Y1, G1); \
-	B1 = _mm_add_epi16(Y1, B1); \
-	R2 = _mm_add_epi16(Y2, R2); \
-	G2 = _mm_sub_epi16(Y2, G2); \
-	B2 = _mm_add_epi16(Y2, B2); \
+void yuva420_bgra32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, const uint8_t *A, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *BGRA, uint32_t BGRA_stride, 
+	int premultiply, YCbCrType yuv_type)
+{
+	SPECIALIZE_PREMULTIPLY(yuva420_rgba32_sseu_impl, width, height, Y, U, V, A, Y_stride, UV_stride, BGRA, BGRA_stride, 1)
+}
 
-#define PACK_RGB24_32_STEP(RS1, RS2, RS3, RS4, RS5, RS6, RD1, RD2, RD3, RD4, RD5, RD6) \
-RD1 = _mm_packus_epi16(_mm_and_si128(RS1,_mm_set1_epi16(0xFF)), _mm_and_si128(RS2,_mm_set1_epi16(0xFF))); \
-RD2 = _mm_packus_epi16(_mm_and_si128(RS3,_mm_set1_epi16(0xFF)), _mm_and_si128(RS4,_mm_set1_epi16(0xFF))); \
-RD3 = _mm_packus_epi16(_mm_and_si128(RS5,_mm_set1_epi16(0xFF)), _mm_and_si128(RS6,_mm_set1_epi16(0xFF))); \
-RD4 = _mm_packus_epi16(_mm_srli_epi16(RS1,8), _mm_srli_epi16(RS2,8)); \
-RD5 = _mm_packus_epi16(_mm_srli_epi16(RS3,8), _mm_srli_epi16(RS4,8)); \
-RD6 = _mm_packus_epi16(_mm_srli_epi16(RS5,8), _mm_srli_epi16(RS6,8)); \
+// Alpha blending of overlays, only sseu versions since the overlay can be anywhere in the image
+// The largest part of the overlay made of whole blocks of the image is processed 32 pixels at a time, even and
+// odd pixels of a line being in separate 16 bits lanes so that sums of blocks are vertical, and the borders are
+// blended by the std implementation.
 
-#define PACK_RGB24_32(R1, R2, G1, G2, B1, B2, RGB1, RGB2, RGB3, RGB4, RGB5, RGB6) \
-PACK_RGB24_32_STEP(R1, R2, G1, G2, B1, B2, RGB1, RGB2, RGB3, RGB4, RGB5, RGB6) \
-PACK_RGB24_32_STEP(RGB1, RGB2, RGB3, RGB4, RGB5, RGB6, R1, R2, G1, G2, B1, B2) \
-PACK_RGB24_32_STEP(R1, R2, G1, G2, B1, B2, RGB1, RGB2, RGB3, RGB4, RGB5, RGB6) \
-PACK_RGB24_32_STEP(RGB1, RGB2, RGB3, RGB4, RGB5, RGB6, R1, R2, G1, G2, B1, B2) \
-PACK_RGB24_32_STEP(R1, R2, G1, G2, B1, B2, RGB1, RGB2, RGB3, RGB4, RGB5, RGB6) \
+// (DST*(256-A) + SRC*A + 128)>>8 for 8 values in 16 bits lanes, A in [0:256]
+#define BLEND_8(DST, SRC, A) \
+	_mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(DST, _mm_sub_epi16(_mm_set1_epi16(256), A)), \
+		_mm_mullo_epi16(SRC, A)), _mm_set1_epi16(128)), 8)
 
-#define LOAD_UV_PLANAR \
-	__m128i u = LOAD_SI128((const __m128i*)(u_ptr)); \
-	__m128i v = LOAD_SI128((const __m128i*)(v_ptr)); \
+// blend 8 pixels of an rgba overlay to the luma values YDST, and add alpha and premultiplied (B-Y') and (R-Y') 
+// to the sums of their blocks
+// ((B-Y')*a)>>8 is computed as ((B-Y')<<6)*(a<<2)>>16, so that the product fits in 32 bits
+#define BLEND_RGBA_8(R, G, B, A, YDST, A_SUM, U_SUM, V_SUM) \
+	A = _mm_add_epi16(A, _mm_srli_epi16(A, 7)); \
+	y_tmp = _mm_add_epi16(_mm_mullo_epi16(R, _mm_set1_epi16(param->r_factor)), \
+		_mm_mullo_epi16(G, _mm_set1_epi16(param->g_factor))); \
+	y_tmp = _mm_srli_epi16(_mm_add_epi16(y_tmp, _mm_mullo_epi16(B, _mm_set1_epi16(param->b_factor))), 8); \
+	U_SUM = _mm_add_epi16(U_SUM, _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(B, y_tmp), 6), _mm_slli_epi16(A, 2))); \
+	V_SUM = _mm_add_epi16(V_SUM, _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(R, y_tmp), 6), _mm_slli_epi16(A, 2))); \
+	A_SUM = _mm_add_epi16(A_SUM, A); \
+	SCALE_Y_16(y_tmp) \
+	YDST = BLEND_8(YDST, y_tmp, A);
 
-#define LOAD_UV_NV12 \
-	__m128i uv1 = LOAD_SI128((const __m128i*)(uv_ptr)); \
-	__m128i uv2 = LOAD_SI128((const __m128i*)(uv_ptr+16)); \
-	__m128i u = _mm_packus_epi16(_mm_and_si128(uv1, _mm_set1_epi16(255)), _mm_and_si128(uv2, _mm_set1_epi16(255))); \
-	uv1 = _mm_srli_epi16(uv1, 8); \
-	uv2 = _mm_srli_epi16(uv2, 8); \
-	__m128i v = _mm_packus_epi16(_mm_and_si128(uv1, _mm_set1_epi16(255)), _mm_and_si128(uv2, _mm_set1_epi16(255))); \
+// blend 16 pixels of a line, R, G, B and A are 8 bits values
+#define BLEND_RGBA_16(R, G, B, A, Y_PTR, A_SUM, U_SUM, V_SUM) \
+	{ \
+		const __m128i y_dst = LOAD_SI128((const __m128i*)(Y_PTR)); \
+		__m128i r_e = _mm_and_si128(R, _mm_set1_epi16(255)), r_o = _mm_srli_epi16(R, 8), \
+			g_e = _mm_and_si128(G, _mm_set1_epi16(255)), g_o = _mm_srli_epi16(G, 8), \
+			b_e = _mm_and_si128(B, _mm_set1_epi16(255)), b_o = _mm_srli_epi16(B, 8), \
+			a_e = _mm_and_si128(A, _mm_set1_epi16(255)), a_o = _mm_srli_epi16(A, 8), \
+			y_e = _mm_and_si128(y_dst, _mm_set1_epi16(255)), y_o = _mm_srli_epi16(y_dst, 8), y_tmp; \
+		BLEND_RGBA_8(r_e, g_e, b_e, a_e, y_e, A_SUM, U_SUM, V_SUM) \
+		BLEND_RGBA_8(r_o, g_o, b_o, a_o, y_o, A_SUM, U_SUM, V_SUM) \
+		SAVE_SI128((__m128i*)(Y_PTR), _mm_or_si128(y_e, _mm_slli_epi16(y_o, 8))); \
+	}
 
-#define LOAD_UV_NV21 \
-	__m128i uv1 = LOAD_SI128((const __m128i*)(uv_ptr)); \
-	__m128i uv2 = LOAD_SI128((const __m128i*)(uv_ptr+16)); \
-	__m128i v = _mm_packus_epi16(_mm_and_si128(uv1, _mm_set1_epi16(255)), _mm_and_si128(uv2, _mm_set1_epi16(255))); \
-	uv1 = _mm_srli_epi16(uv1, 8); \
-	uv2 = _mm_srli_epi16(uv2, 8); \
-	__m128i u = _mm_packus_epi16(_mm_and_si128(uv1, _mm_set1_epi16(255)), _mm_and_si128(uv2, _mm_set1_epi16(255))); \
+// blend 32 pixels of a line, at rgba_ptr and y_ptr
+#define BLEND_RGBA32_LINE_32 \
+	{ \
+		__m128i r1, r2, g1, g2, b1, b2, a1, a2; \
+		UNPACK_RGBA32_32(r1, r2, g1, g2, b1, b2, a1, a2) \
+		BLEND_RGBA_16(r1, g1, b1, a1, y_ptr, a_sum1, u_sum1, v_sum1) \
+		BLEND_RGBA_16(r2, g2, b2, a2, y_ptr+16, a_sum2, u_sum2, v_sum2) \
+	}
 
-#define YUV2RGB_32 \
-	__m128i r_tmp, g_tmp, b_tmp; \
-	__m128i r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2; \
-	__m128i r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2; \
-	__m128i y_16_1, y_16_2; \
-	\
-	u = _mm_add_epi8(u, _mm_set1_epi8(-128)); \
-	v = _mm_add_epi8(v, _mm_set1_epi8(-128)); \
-	\
-	/* process first 16 pixels of first line */\
-	__m128i u_16 = _mm_srai_epi16(_mm_unpacklo_epi8(u, u), 8); \
-	__m128i v_16 = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8); \
-	\
-	UV2RGB_16(u_16, v_16, r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2) \
-	r_16_1=r_uv_16_1; g_16_1=g_uv_16_1; b_16_1=b_uv_16_1; \
-	r_16_2=r_uv_16_2; g_16_2=g_uv_16_2; b_16_2=b_uv_16_2; \
-	\
-	__m128i y = LOAD_SI128((const __m128i*)(y_ptr1)); \
-	y = _mm_subs_epu8(y, _mm_set1_epi8(param->y_offset)); \
-	y_16_1 = _mm_unpacklo_epi8(y, _mm_setzero_si128()); \
-	y_16_2 = _mm_unpackhi_epi8(y, _mm_setzero_si128()); \
-	\
-	ADD_Y2RGB_16(y_16_1, y_16_2, r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2) \
-	\
-	__m128i r_8_11 = _mm_packus_epi16(r_16_1, r_16_2); \
-	__m128i g_8_11 = _mm_packus_epi16(g_16_1, g_16_2); \
-	__m128i b_8_11 = _mm_packus_epi16(b_16_1, b_16_2); \
-	\
-	/* process first 16 pixels of second line */\
-	r_16_1=r_uv_16_1; g_16_1=g_uv_16_1; b_16_1=b_uv_16_1; \
-	r_16_2=r_uv_16_2; g_16_2=g_uv_16_2; b_16_2=b_uv_16_2; \
-	\
-	y = LOAD_SI128((const __m128i*)(y_ptr2)); \
-	y = _mm_subs_epu8(y, _mm_set1_epi8(param->y_offset)); \
-	y_16_1 = _mm_unpacklo_epi8(y, _mm_setzero_si128()); \
-	y_16_2 = _mm_unpackhi_epi8(y, _mm_setzero_si128()); \
-	\
-	ADD_Y2RGB_16(y_16_1, y_16_2, r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2) \
-	\
-	__m128i r_8_21 = _mm_packus_epi16(r_16_1, r_16_2); \
-	__m128i g_8_21 = _mm_packus_epi16(g_16_1, g_16_2); \
-	__m128i b_8_21 = _mm_packus_epi16(b_16_1, b_16_2); \
-	\
-	/* process last 16 pixels of first line */\
-	u_16 = _mm_srai_epi16(_mm_unpackhi_epi8(u, u), 8); \
-	v_16 = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8); \
-	\
-	UV2RGB_16(u_16, v_16, r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2) \
-	r_16_1=r_uv_16_1; g_16_1=g_uv_16_1; b_16_1=b_uv_16_1; \
-	r_16_2=r_uv_16_2; g_16_2=g_uv_16_2; b_16_2=b_uv_16_2; \
-	\
-	y = LOAD_SI128((const __m128i*)(y_ptr1+16)); \
-	y = _mm_subs_epu8(y, _mm_set1_epi8(param->y_offset)); \
-	y_16_1 = _mm_unpacklo_epi8(y, _mm_setzero_si128()); \
-	y_16_2 = _mm_unpackhi_epi8(y, _mm_setzero_si128()); \
-	\
-	ADD_Y2RGB_16(y_16_1, y_16_2, r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2) \
-	\
-	__m128i r_8_12 = _mm_packus_epi16(r_16_1, r_16_2); \
-	__m128i g_8_12 = _mm_packus_epi16(g_16_1, g_16_2); \
-	__m128i b_8_12 = _mm_packus_epi16(b_16_1, b_16_2); \
-	\
-	/* process last 16 pixels of second line */\
-	r_16_1=r_uv_16_1; g_16_1=g_uv_16_1; b_16_1=b_uv_16_1; \
-	r_16_2=r_uv_16_2; g_16_2=g_uv_16_2; b_16_2=b_uv_16_2; \
-	\
-	y = LOAD_SI128((const __m128i*)(y_ptr2+16)); \
-	y = _mm_subs_epu8(y, _mm_set1_epi8(param->y_offset)); \
-	y_16_1 = _mm_unpacklo_epi8(y, _mm_setzero_si128()); \
-	y_16_2 = _mm_unpackhi_epi8(y, _mm_setzero_si128()); \
-	\
-	ADD_Y2RGB_16(y_16_1, y_16_2, r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2) \
-	\
-	__m128i r_8_22 = _mm_packus_epi16(r_16_1, r_16_2); \
-	__m128i g_8_22 = _mm_packus_epi16(g_16_1, g_16_2); \
-	__m128i b_8_22 = _mm_packus_epi16(b_16_1, b_16_2); \
-	\
-	__m128i rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6; \
-	\
-	PACK_RGB24_32(r_8_11, r_8_12, g_8_11, g_8_12, b_8_11, b_8_12, rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6) \
-	SAVE_SI128((__m128i*)(rgb_ptr1), rgb_1); \
-	SAVE_SI128((__m128i*)(rgb_ptr1+16), rgb_2); \
-	SAVE_SI128((__m128i*)(rgb_ptr1+32), rgb_3); \
-	SAVE_SI128((__m128i*)(rgb_ptr1+48), rgb_4); \
-	SAVE_SI128((__m128i*)(rgb_ptr1+64), rgb_5); \
-	SAVE_SI128((__m128i*)(rgb_ptr1+80), rgb_6); \
-	\
-	PACK_RGB24_32(r_8_21, r_8_22, g_8_21, g_8_22, b_8_21, b_8_22, rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6) \
-	SAVE_SI128((__m128i*)(rgb_ptr2), rgb_1); \
-	SAVE_SI128((__m128i*)(rgb_ptr2+16), rgb_2); \
-	SAVE_SI128((__m128i*)(rgb_ptr2+32), rgb_3); \
-	SAVE_SI128((__m128i*)(rgb_ptr2+48), rgb_4); \
-	SAVE_SI128((__m128i*)(rgb_ptr2+64), rgb_5); \
-	SAVE_SI128((__m128i*)(rgb_ptr2+80), rgb_6); \
+// C = clamp(((C*(256-a) + 128*a + 128)>>8) + (((SUM>>2)*FACTOR)>>8)), clamping is done when packing
+#define BLEND_CHROMA_8(C, A, SUM, FACTOR) \
+	C = _mm_add_epi16(BLEND_8(C, _mm_set1_epi16(128), A), \
+		_mm_srai_epi16(_mm_mullo_epi16(_mm_srai_epi16(SUM, 2), _mm_set1_epi16(FACTOR)), 8));
 
-#define YUV2RGB_32_PLANAR \
-	LOAD_UV_PLANAR \
-	YUV2RGB_32
+// blend the 16 chroma samples at u_ptr and v_ptr, or at u_ptr for semi planar chroma, a_sum are rescaled
+#define BLEND_UV_16(BLEND_U, BLEND_V) \
+	a_sum1 = _mm_srli_epi16(a_sum1, 2); \
+	a_sum2 = _mm_srli_epi16(a_sum2, 2); \
+	if(uv_step==1) \
+	{ \
+		const __m128i u = LOAD_SI128((const __m128i*)(u_ptr)), v = LOAD_SI128((const __m128i*)(v_ptr)); \
+		__m128i u_1 = _mm_unpacklo_epi8(u, _mm_setzero_si128()), u_2 = _mm_unpackhi_epi8(u, _mm_setzero_si128()), \
+			v_1 = _mm_unpacklo_epi8(v, _mm_setzero_si128()), v_2 = _mm_unpackhi_epi8(v, _mm_setzero_si128()); \
+		BLEND_U(u_1, a_sum1, u_sum1) \
+		BLEND_U(u_2, a_sum2, u_sum2) \
+		BLEND_V(v_1, a_sum1, v_sum1) \
+		BLEND_V(v_2, a_sum2, v_sum2) \
+		SAVE_SI128((__m128i*)(u_ptr), _mm_packus_epi16(u_1, u_2)); \
+		SAVE_SI128((__m128i*)(v_ptr), _mm_packus_epi16(v_1, v_2)); \
+	} \
+	else \
+	{ \
+		const __m128i uv1 = LOAD_SI128((const __m128i*)(u_ptr)), uv2 = LOAD_SI128((const __m128i*)(u_ptr+16)); \
+		__m128i u_1 = _mm_and_si128(uv1, _mm_set1_epi16(255)), u_2 = _mm_and_si128(uv2, _mm_set1_epi16(255)), \
+			v_1 = _mm_srli_epi16(uv1, 8), v_2 = _mm_srli_epi16(uv2, 8); \
+		BLEND_U(u_1, a_sum1, u_sum1) \
+		BLEND_U(u_2, a_sum2, u_sum2) \
+		BLEND_V(v_1, a_sum1, v_sum1) \
+		BLEND_V(v_2, a_sum2, v_sum2) \
+		const __m128i u = _mm_packus_epi16(u_1, u_2), v = _mm_packus_epi16(v_1, v_2); \
+		SAVE_SI128((__m128i*)(u_ptr), _mm_unpacklo_epi8(u, v)); \
+		SAVE_SI128((__m128i*)(u_ptr+16), _mm_unpackhi_epi8(u, v)); \
+	}
 
-#define YUV2RGB_32_NV12 \
-	LOAD_UV_NV12 \
-	YUV2RGB_32
-	
-#define YUV2RGB_32_NV21 \
-	LOAD_UV_NV21 \
-	YUV2RGB_32
+#define BLEND_CHROMA_U(C, A, SUM) BLEND_CHROMA_8(C, A, SUM, param->cb_factor)
+#define BLEND_CHROMA_V(C, A, SUM) BLEND_CHROMA_8(C, A, SUM, param->cr_factor)
 
+#define BLEND_RGBA32_32 \
+	__m128i a_sum1 = _mm_setzero_si128(), a_sum2 = _mm_setzero_si128(), \
+		u_sum1 = _mm_setzero_si128(), u_sum2 = _mm_setzero_si128(), \
+		v_sum1 = _mm_setzero_si128(), v_sum2 = _mm_setzero_si128(); \
+	{ \
+		const uint8_t *rgba_ptr=rgba_ptr1; \
+		uint8_t *y_ptr=y_ptr1; \
+		BLEND_RGBA32_LINE_32 \
+	} \
+	{ \
+		const uint8_t *rgba_ptr=rgba_ptr2; \
+		uint8_t *y_ptr=y_ptr2; \
+		BLEND_RGBA32_LINE_32 \
+	} \
+	BLEND_UV_16(BLEND_CHROMA_U, BLEND_CHROMA_V)
 
-void yuv420_rgb24_sse(
+ALWAYS_INLINE void blend_rgba32_sseu_impl(
 	uint32_t width, uint32_t height, 
-	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
-	uint8_t *RGB, uint32_t RGB_stride, 
-	YCbCrType yuv_type)
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, uint32_t uv_step, 
+	uint32_t left, uint32_t top, YCbCrType yuv_type)
 {
-	#define LOAD_SI128 _mm_load_si128
-	#define SAVE_SI128 _mm_stream_si128
-	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
+	// whole blocks are in [left2:right2[ x [top2:bottom2[, and processed up to x_end by sse
+	const uint32_t left2=(left+1)&~1u, top2=(top+1)&~1u, 
+		right2=(left+width)&~1u, bottom2=(top+height)&~1u;
+	if(width==0 || height==0)
+		return;
+	if(right2<=left2 || bottom2<=top2)
+	{
+		blend_rgba32_std_impl(width, height, RGBA, RGBA_stride, Y, U, V, Y_stride, UV_stride, uv_step, left, top, yuv_type);
+		return;
+	}
+	const uint32_t x_end=left2+((right2-left2)&~31u);
 	
 	uint32_t x, y;
-	for(y=0; y<(height-1); y+=2)
+	for(y=top2; y<bottom2; y+=2)
 	{
-		const uint8_t *y_ptr1=Y+y*Y_stride,
-			*y_ptr2=Y+(y+1)*Y_stride,
-			*u_ptr=U+(y/2)*UV_stride,
-			*v_ptr=V+(y/2)*UV_stride;
+		const uint8_t *rgba_ptr1=RGBA+(y-top)*RGBA_stride+(left2-left)*4,
+			*rgba_ptr2=RGBA+(y+1-top)*RGBA_stride+(left2-left)*4;
 		
-		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
-			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		uint8_t *y_ptr1=Y+y*Y_stride+left2,
+			*y_ptr2=Y+(y+1)*Y_stride+left2,
+			*u_ptr=U+(y/2)*UV_stride+(left2/2)*uv_step,
+			*v_ptr=V+(y/2)*UV_stride+(left2/2)*uv_step;
 		
-		for(x=0; x<(width-31); x+=32)
+		for(x=left2; x<x_end; x+=32)
 		{
-			YUV2RGB_32_PLANAR
+			BLEND_RGBA32_32
 			
+			rgba_ptr1+=128;
+			rgba_ptr2+=128;
 			y_ptr1+=32;
 			y_ptr2+=32;
-			u_ptr+=16; 
-			v_ptr+=16;
-			rgb_ptr1+=96;
-			rgb_ptr2+=96;
+			u_ptr+=16*uv_step;
+			v_ptr+=16*uv_step;
 		}
 	}
+	// borders with partial blocks, and remaining whole blocks, with the standard implementation, that gives the 
+	// exact same result
+	if(top2>top)
+		blend_rgba32_std_impl(width, 1, RGBA, RGBA_stride, Y, U, V, Y_stride, UV_stride, uv_step, left, top, yuv_type);
+	if(bottom2<top+height)
+		blend_rgba32_std_impl(width, 1, RGBA+(bottom2-top)*RGBA_stride, RGBA_stride, Y, U, V, Y_stride, UV_stride, 
+			uv_step, left, bottom2, yuv_type);
+	if(left2>left)
+		blend_rgba32_std_impl(1, bottom2-top2, RGBA+(top2-top)*RGBA_stride, RGBA_stride, Y, U, V, Y_stride, UV_stride, 
+			uv_step, left, top2, yuv_type);
+	if(x_end<left+width)
+		blend_rgba32_std_impl(left+width-x_end, bottom2-top2, RGBA+(top2-top)*RGBA_stride+(x_end-left)*4, RGBA_stride, 
+			Y, U, V, Y_stride, UV_stride, uv_step, x_end, top2, yuv_type);
 	#undef LOAD_SI128
 	#undef SAVE_SI128
 }
 
-void yuv420_rgb24_sseu(
+void yuv420_blend_rgba32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint32_t left, uint32_t top, YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(blend_rgba32_sseu_impl, width, height, RGBA, RGBA_stride, Y, U, V, Y_stride, UV_stride, 1, left, top)
+}
+
+void nv12_blend_rgba32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint32_t left, uint32_t top, YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(blend_rgba32_sseu_impl, width, height, RGBA, RGBA_stride, Y, UV, UV+1, Y_stride, UV_stride, 2, left, top)
+}
+
+// blend 16 pixels of a line of a yuva overlay
+#define BLEND_YUVA_16(OY_PTR, OA_PTR, Y_PTR, A_SUM) \
+	{ \
+		const __m128i oy = LOAD_SI128((const __m128i*)(OY_PTR)), oa = LOAD_SI128((const __m128i*)(OA_PTR)), \
+			y_dst = LOAD_SI128((const __m128i*)(Y_PTR)); \
+		__m128i a_e = _mm_and_si128(oa, _mm_set1_epi16(255)), a_o = _mm_srli_epi16(oa, 8); \
+		a_e = _mm_add_epi16(a_e, _mm_srli_epi16(a_e, 7)); \
+		a_o = _mm_add_epi16(a_o, _mm_srli_epi16(a_o, 7)); \
+		const __m128i y_e = BLEND_8(_mm_and_si128(y_dst, _mm_set1_epi16(255)), _mm_and_si128(oy, _mm_set1_epi16(255)), a_e), \
+			y_o = BLEND_8(_mm_srli_epi16(y_dst, 8), _mm_srli_epi16(oy, 8), a_o); \
+		SAVE_SI128((__m128i*)(Y_PTR), _mm_or_si128(y_e, _mm_slli_epi16(y_o, 8))); \
+		A_SUM = _mm_add_epi16(A_SUM, _mm_add_epi16(a_e, a_o)); \
+	}
+
+#define BLEND_YUVA_U(C, A, SUM) C = BLEND_8(C, SUM, A);
+#define BLEND_YUVA_V(C, A, SUM) C = BLEND_8(C, SUM, A);
+
+// the chroma sums are the overlay chroma values
+#define BLEND_YUVA420_32 \
+	__m128i a_sum1 = _mm_setzero_si128(), a_sum2 = _mm_setzero_si128(); \
+	BLEND_YUVA_16(oy_ptr1, oa_ptr1, y_ptr1, a_sum1) \
+	BLEND_YUVA_16(oy_ptr2, oa_ptr2, y_ptr2, a_sum1) \
+	BLEND_YUVA_16(oy_ptr1+16, oa_ptr1+16, y_ptr1+16, a_sum2) \
+	BLEND_YUVA_16(oy_ptr2+16, oa_ptr2+16, y_ptr2+16, a_sum2) \
+	const __m128i ou = LOAD_SI128((const __m128i*)(ou_ptr)), ov = LOAD_SI128((const __m128i*)(ov_ptr)); \
+	const __m128i u_sum1 = _mm_unpacklo_epi8(ou, _mm_setzero_si128()), u_sum2 = _mm_unpackhi_epi8(ou, _mm_setzero_si128()), \
+		v_sum1 = _mm_unpacklo_epi8(ov, _mm_setzero_si128()), v_sum2 = _mm_unpackhi_epi8(ov, _mm_setzero_si128()); \
+	BLEND_UV_16(BLEND_YUVA_U, BLEND_YUVA_V)
+
+ALWAYS_INLINE void blend_yuva420_sseu_impl(
 	uint32_t width, uint32_t height, 
-	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
-	uint8_t *RGB, uint32_t RGB_stride, 
-	YCbCrType yuv_type)
+	const uint8_t *OY, const uint8_t *OU, const uint8_t *OV, const uint8_t *OA, uint32_t OY_stride, uint32_t OUV_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, uint32_t uv_step, 
+	uint32_t left, uint32_t top)
 {
 	#define LOAD_SI128 _mm_loadu_si128
 	#define SAVE_SI128 _mm_storeu_si128
-	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	if(width==0 || height==0)
+		return;
 	
 	uint32_t x, y;
 	for(y=0; y<(height-1); y+=2)
 	{
-		const uint8_t *y_ptr1=Y+y*Y_stride,
-			*y_ptr2=Y+(y+1)*Y_stride,
-			*u_ptr=U+(y/2)*UV_stride,
-			*v_ptr=V+(y/2)*UV_stride;
+		const uint8_t *oy_ptr1=OY+y*OY_stride,
+			*oy_ptr2=OY+(y+1)*OY_stride,
+			*oa_ptr1=OA+y*OY_stride,
+			*oa_ptr2=OA+(y+1)*OY_stride,
+			*ou_ptr=OU+(y/2)*OUV_stride,
+			*ov_ptr=OV+(y/2)*OUV_stride;
 		
-		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
-			*rgb_ptr2=RGB+(y+1)*RGB_stride;
+		uint8_t *y_ptr1=Y+(top+y)*Y_stride+left,
+			*y_ptr2=Y+(top+y+1)*Y_stride+left,
+			*u_ptr=U+((top+y)/2)*UV_stride+(left/2)*uv_step,
+			*v_ptr=V+((top+y)/2)*UV_stride+(left/2)*uv_step;
 		
-		for(x=0; x<(width-31); x+=32)
+		for(x=0; x+31<width; x+=32)
 		{
-			YUV2RGB_32_PLANAR
+			BLEND_YUVA420_32
 			
+			oy_ptr1+=32;
+			oy_ptr2+=32;
+			oa_ptr1+=32;
+			oa_ptr2+=32;
+			ou_ptr+=16;
+			ov_ptr+=16;
 			y_ptr1+=32;
 			y_ptr2+=32;
-			u_ptr+=16; 
-			v_ptr+=16;
-			rgb_ptr1+=96;
-			rgb_ptr2+=96;
+			u_ptr+=16*uv_step;
+			v_ptr+=16*uv_step;
 		}
 	}
+	// remaining pixels and last line of odd heights with the standard implementation, that gives the exact same 
+	// result
+	x = width&~31u;
+	if(x<width && height>1)
+		blend_yuva420_std(width-x, height&~1u, OY+x, OU+x/2, OV+x/2, OA+x, OY_stride, OUV_stride, 
+			Y, U, V, Y_stride, UV_stride, uv_step, left+x, top);
+	if(height&1)
+		blend_yuva420_std(width, 1, OY+(height-1)*OY_stride, OU+(height/2)*OUV_stride, OV+(height/2)*OUV_stride, 
+			OA+(height-1)*OY_stride, OY_stride, OUV_stride, Y, U, V, Y_stride, UV_stride, uv_step, left, top+height-1);
 	#undef LOAD_SI128
 	#undef SAVE_SI128
 }
 
-void nv12_rgb24_sse(
+void yuv420_blend_yuva420_sseu(
 	uint32_t width, uint32_t height, 
-	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
-	uint8_t *RGB, uint32_t RGB_stride, 
-	YCbCrType yuv_type)
+	const uint8_t *OY, const uint8_t *OU, const uint8_t *OV, const uint8_t *OA, uint32_t OY_stride, uint32_t OUV_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint32_t left, uint32_t top)
 {
-	#define LOAD_SI128 _mm_load_si128
-	#define SAVE_SI128 _mm_stream_si128
-	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	blend_yuva420_sseu_impl(width, height, OY, OU, OV, OA, OY_stride, OUV_stride, Y, U, V, Y_stride, UV_stride, 1, left, top);
+}
+
+void nv12_blend_yuva420_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *OY, const uint8_t *OU, const uint8_t *OV, const uint8_t *OA, uint32_t OY_stride, uint32_t OUV_stride, 
+	uint8_t *Y, uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint32_t left, uint32_t top)
+{
+	blend_yuva420_sseu_impl(width, height, OY, OU, OV, OA, OY_stride, OUV_stride, Y, UV, UV+1, Y_stride, UV_stride, 2, left, top);
+}
+
+// HDR to SDR conversion, 32 pixels of two lines per iteration, with the structure of YUV2RGB_32 and the integer 
+// operations of hdr_rgb_std_impl. Table lookups are scalar, since sse2 has no gather.
+
+// 10 bits samples of 8 16 bits values, shifted right by shift_count
+#define HDR_SAMPLES(PTR) \
+	_mm_and_si128(_mm_srl_epi16(LOAD_SI128((const __m128i*)(PTR)), shift_count), _mm_set1_epi16(0x3FF))
+
+// 8 values of TABLE, at the indexes in the 16 bits values of V
+#define HDR_LOOKUP_8(TABLE, V) \
+	_mm_setr_epi16(TABLE[_mm_extract_epi16(V, 0)], TABLE[_mm_extract_epi16(V, 1)], \
+		TABLE[_mm_extract_epi16(V, 2)], TABLE[_mm_extract_epi16(V, 3)], \
+		TABLE[_mm_extract_epi16(V, 4)], TABLE[_mm_extract_epi16(V, 5)], \
+		TABLE[_mm_extract_epi16(V, 6)], TABLE[_mm_extract_epi16(V, 7)])
+
+#define HDR_CLAMP_16(V, MAX) _mm_min_epi16(_mm_max_epi16(V, _mm_setzero_si128()), _mm_set1_epi16(MAX))
+
+#define HDR_PAIR(A, B) _mm_setr_epi16(A, B, A, B, A, B, A, B)
+
+// line LINE of the gamut matrix applied to 8 pixels, from the interleaved (r, g) and (b, 1) linear values of their 
+// first and last 4 pixels, the 1 adds the rounding term
+#define HDR_GAMUT_8(RG_LO, RG_HI, B1_LO, B1_HI, LINE) \
+	HDR_CLAMP_16(_mm_packs_epi32( \
+		_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(RG_LO, HDR_PAIR(HDR_GAMUT[LINE][0], HDR_GAMUT[LINE][1])), \
+			_mm_madd_epi16(B1_LO, HDR_PAIR(HDR_GAMUT[LINE][2], 2048))), 12), \
+		_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(RG_HI, HDR_PAIR(HDR_GAMUT[LINE][0], HDR_GAMUT[LINE][1])), \
+			_mm_madd_epi16(B1_HI, HDR_PAIR(HDR_GAMUT[LINE][2], 2048))), 12)), HDR_LINEAR_MAX)
+
+// chroma terms of 8 blocks, duplicated for the 16 pixels of each line
+#define HDR_UV2RGB_16(U, V, R1, G1, B1, R2, G2, B2) \
+	U = _mm_slli_epi16(_mm_sub_epi16(U, _mm_set1_epi16(512)), 5); \
+	V = _mm_slli_epi16(_mm_sub_epi16(V, _mm_set1_epi16(512)), 5); \
+	r_tmp = _mm_mulhi_epi16(V, _mm_set1_epi16(HDR_CR_FACTOR)); \
+	g_tmp = _mm_add_epi16(_mm_mulhi_epi16(U, _mm_set1_epi16(HDR_G_CB_FACTOR)), \
+		_mm_mulhi_epi16(V, _mm_set1_epi16(HDR_G_CR_FACTOR))); \
+	b_tmp = _mm_mulhi_epi16(U, _mm_set1_epi16(HDR_CB_FACTOR)); \
+	R1 = _mm_unpacklo_epi16(r_tmp, r_tmp); \
+	G1 = _mm_unpacklo_epi16(g_tmp, g_tmp); \
+	B1 = _mm_unpacklo_epi16(b_tmp, b_tmp); \
+	R2 = _mm_unpackhi_epi16(r_tmp, r_tmp); \
+	G2 = _mm_unpackhi_epi16(g_tmp, g_tmp); \
+	B2 = _mm_unpackhi_epi16(b_tmp, b_tmp); \
+
+// sdr values of 8 pixels, as 16 bits values, from their Y' and chroma terms
+#define HDR_RGB_8(Y, R_UV, G_UV, B_UV, R, G, B) \
+	{ \
+		const __m128i r_lin = HDR_LOOKUP_8(tone_map->linear, HDR_CLAMP_16(_mm_add_epi16(Y, R_UV), HDR_NONLINEAR_MAX)), \
+			g_lin = HDR_LOOKUP_8(tone_map->linear, HDR_CLAMP_16(_mm_sub_epi16(Y, G_UV), HDR_NONLINEAR_MAX)), \
+			b_lin = HDR_LOOKUP_8(tone_map->linear, HDR_CLAMP_16(_mm_add_epi16(Y, B_UV), HDR_NONLINEAR_MAX)); \
+		const __m128i rg_lo = _mm_unpacklo_epi16(r_lin, g_lin), rg_hi = _mm_unpackhi_epi16(r_lin, g_lin), \
+			b1_lo = _mm_unpacklo_epi16(b_lin, _mm_set1_epi16(1)), b1_hi = _mm_unpackhi_epi16(b_lin, _mm_set1_epi16(1)); \
+		const __m128i r_709 = HDR_GAMUT_8(rg_lo, rg_hi, b1_lo, b1_hi, 0), \
+			g_709 = HDR_GAMUT_8(rg_lo, rg_hi, b1_lo, b1_hi, 1), \
+			b_709 = HDR_GAMUT_8(rg_lo, rg_hi, b1_lo, b1_hi, 2); \
+		R = HDR_LOOKUP_8(tone_map->sdr, r_709); \
+		G = HDR_LOOKUP_8(tone_map->sdr, g_709); \
+		B = HDR_LOOKUP_8(tone_map->sdr, b_709); \
+	}
+
+// sdr values of 16 pixels of a line, as 8 bits values
+#define HDR_LINE_16(Y_PTR, R_8, G_8, B_8) \
+	{ \
+		__m128i r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2; \
+		const __m128i y_16_1 = _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(HDR_SAMPLES(Y_PTR), \
+				_mm_set1_epi16(64)), 5), _mm_set1_epi16(HDR_Y_FACTOR)), \
+			y_16_2 = _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(HDR_SAMPLES(Y_PTR+8), \
+				_mm_set1_epi16(64)), 5), _mm_set1_epi16(HDR_Y_FACTOR)); \
+		HDR_RGB_8(y_16_1, r_uv_16_1, g_uv_16_1, b_uv_16_1, r_16_1, g_16_1, b_16_1) \
+		HDR_RGB_8(y_16_2, r_uv_16_2, g_uv_16_2, b_uv_16_2, r_16_2, g_16_2, b_16_2) \
+		R_8 = _mm_packus_epi16(r_16_1, r_16_2); \
+		G_8 = _mm_packus_epi16(g_16_1, g_16_2); \
+		B_8 = _mm_packus_epi16(b_16_1, b_16_2); \
+	}
+
+#define HDR2RGB_32 \
+	__m128i r_tmp, g_tmp, b_tmp; \
+	__m128i r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2; \
+	__m128i r_8_11, g_8_11, b_8_11, r_8_12, g_8_12, b_8_12, r_8_21, g_8_21, b_8_21, r_8_22, g_8_22, b_8_22; \
+	\
+	/* process first 16 pixels of both lines */\
+	HDR_UV2RGB_16(u_1, v_1, r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2) \
+	HDR_LINE_16(y_ptr1, r_8_11, g_8_11, b_8_11) \
+	HDR_LINE_16(y_ptr2, r_8_21, g_8_21, b_8_21) \
+	\
+	/* process last 16 pixels of both lines */\
+	HDR_UV2RGB_16(u_2, v_2, r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2) \
+	HDR_LINE_16(y_ptr1+16, r_8_12, g_8_12, b_8_12) \
+	HDR_LINE_16(y_ptr2+16, r_8_22, g_8_22, b_8_22) \
+	\
+	if(pixel_size==3) \
+	{ \
+		__m128i rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6; \
+		PACK_RGB24_32(r_8_11, r_8_12, g_8_11, g_8_12, b_8_11, b_8_12, rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6) \
+		SAVE_RGB24_32(rgb_ptr1) \
+		PACK_RGB24_32(r_8_21, r_8_22, g_8_21, g_8_22, b_8_21, b_8_22, rgb_1, rgb_2, rgb_3, rgb_4, rgb_5, rgb_6) \
+		SAVE_RGB24_32(rgb_ptr2) \
+	} \
+	else \
+	{ \
+		const __m128i a = _mm_set1_epi8(-1); \
+		SAVE_RGBA32_16(r_8_11, g_8_11, b_8_11, a, rgb_ptr1) \
+		SAVE_RGBA32_16(r_8_12, g_8_12, b_8_12, a, rgb_ptr1+64) \
+		SAVE_RGBA32_16(r_8_21, g_8_21, b_8_21, a, rgb_ptr2) \
+		SAVE_RGBA32_16(r_8_22, g_8_22, b_8_22, a, rgb_ptr2+64) \
+	} \
+
+ALWAYS_INLINE void hdr_rgb_sseu_impl(
+	uint32_t width, uint32_t height, 
+	const uint16_t *Y, const uint16_t *U, const uint16_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint32_t uv_step, uint32_t shift, 
+	uint8_t *RGB, uint32_t RGB_stride, uint32_t pixel_size, 
+	const HdrToneMap *tone_map)
+{
+	#define LOAD_SI128 _mm_loadu_si128
+	#define SAVE_SI128 _mm_storeu_si128
+	const __m128i shift_count = _mm_cvtsi32_si128((int)shift);
 	
 	uint32_t x, y;
 	for(y=0; y<(height-1); y+=2)
 	{
-		const uint8_t *y_ptr1=Y+y*Y_stride,
-			*y_ptr2=Y+(y+1)*Y_stride,
-			*uv_ptr=UV+(y/2)*UV_stride;
+		const uint16_t *y_ptr1=(const uint16_t *)((const uint8_t *)Y+y*Y_stride),
+			*y_ptr2=(const uint16_t *)((const uint8_t *)Y+(y+1)*Y_stride),
+			*u_ptr=(const uint16_t *)((const uint8_t *)U+(y/2)*UV_stride),
+			*v_ptr=(const uint16_t *)((const uint8_t *)V+(y/2)*UV_stride);
 		
 		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
 			*rgb_ptr2=RGB+(y+1)*RGB_stride;
 		
-		for(x=0; x<(width-31); x+=32)
+		for(x=0; x+31<width; x+=32)
 		{
-			YUV2RGB_32_NV12
+			__m128i u_1, u_2, v_1, v_2;
+			if(uv_step==2)
+			{
+				// samples are below 1024, so that the signed saturation of the packs does not change them
+				const __m128i uv_1 = HDR_SAMPLES(u_ptr), uv_2 = HDR_SAMPLES(u_ptr+8), 
+					uv_3 = HDR_SAMPLES(u_ptr+16), uv_4 = HDR_SAMPLES(u_ptr+24), 
+					mask = _mm_set1_epi32(0xFFFF);
+				u_1 = _mm_packs_epi32(_mm_and_si128(uv_1, mask), _mm_and_si128(uv_2, mask));
+				u_2 = _mm_packs_epi32(_mm_and_si128(uv_3, mask), _mm_and_si128(uv_4, mask));
+				v_1 = _mm_packs_epi32(_mm_srli_epi32(uv_1, 16), _mm_srli_epi32(uv_2, 16));
+				v_2 = _mm_packs_epi32(_mm_srli_epi32(uv_3, 16), _mm_srli_epi32(uv_4, 16));
+			}
+			else
+			{
+				u_1 = HDR_SAMPLES(u_ptr);
+				u_2 = HDR_SAMPLES(u_ptr+8);
+				v_1 = HDR_SAMPLES(v_ptr);
+				v_2 = HDR_SAMPLES(v_ptr+8);
+			}
+			
+			HDR2RGB_32
 			
 			y_ptr1+=32;
 			y_ptr2+=32;
-			uv_ptr+=32; 
-			rgb_ptr1+=96;
-			rgb_ptr2+=96;
+			u_ptr+=16*uv_step;
+			v_ptr+=16*uv_step;
+			rgb_ptr1+=32*pixel_size;
+			rgb_ptr2+=32*pixel_size;
 		}
 	}
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~31u;
+	if(x<width)
+		hdr_rgb_std_impl(width-x, height, Y+x, U+x/2*uv_step, V+x/2*uv_step, Y_stride, UV_stride, uv_step, shift, 
+			RGB+x*pixel_size, RGB_stride, pixel_size, tone_map);
 	#undef LOAD_SI128
 	#undef SAVE_SI128
 }
 
-void nv12_rgb24_sseu(
+void p010_rgb24_sseu(
 	uint32_t width, uint32_t height, 
-	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	const uint16_t *Y, const uint16_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	const HdrToneMap *tone_map)
+{
+	hdr_rgb_sseu_impl(width, height, Y, UV, UV+1, Y_stride, UV_stride, 2, 6, RGB, RGB_stride, 3, tone_map);
+}
+
+void p010_rgba32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint16_t *Y, const uint16_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	const HdrToneMap *tone_map)
+{
+	hdr_rgb_sseu_impl(width, height, Y, UV, UV+1, Y_stride, UV_stride, 2, 6, RGBA, RGBA_stride, 4, tone_map);
+}
+
+void yuv420p10_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint16_t *Y, const uint16_t *U, const uint16_t *V, uint32_t Y_stride, uint32_t UV_stride, 
 	uint8_t *RGB, uint32_t RGB_stride, 
+	const HdrToneMap *tone_map)
+{
+	hdr_rgb_sseu_impl(width, height, Y, U, V, Y_stride, UV_stride, 1, 0, RGB, RGB_stride, 3, tone_map);
+}
+
+void yuv420p10_rgba32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint16_t *Y, const uint16_t *U, const uint16_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGBA, uint32_t RGBA_stride, 
+	const HdrToneMap *tone_map)
+{
+	hdr_rgb_sseu_impl(width, height, Y, U, V, Y_stride, UV_stride, 1, 0, RGBA, RGBA_stride, 4, tone_map);
+}
+
+#endif //_YUVRGB_SSE2_
+
+#ifdef _YUVRGB_VEC_
+
+// Portable implementation, written with the generic vectors of gcc and clang, that the compiler maps
+// to the simd instructions of the target (sse, neon, rvv...).
+// It uses the same 16bits arithmetic as the sse implementation, so that results are bit exact.
+// As in the sse implementation, even and odd pixels of a line are processed in separate vectors,
+// obtained by reading pairs of bytes as 16bits values, so that no shuffle is needed. Packed rgb
+// pixels are loaded and stored with simple loops, that the compiler turns into the interleaving
+// loads and stores of the target when it has them.
+
+typedef int16_t vec_i16 __attribute__((vector_size(16)));
+typedef uint16_t vec_u16 __attribute__((vector_size(16)));
+typedef uint8_t vec_u8 __attribute__((vector_size(8)));
+
+// position of even and odd bytes in a 16bits value, and of r, g and b bytes in a 32bits rgba pixel
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__==__ORDER_BIG_ENDIAN__
+#define VEC_EVEN_SHIFT 8
+#define VEC_ODD_SHIFT 0
+#define VEC_R_SHIFT 24
+#define VEC_G_SHIFT 16
+#define VEC_B_SHIFT 8
+#else
+#define VEC_EVEN_SHIFT 0
+#define VEC_ODD_SHIFT 8
+#define VEC_R_SHIFT 0
+#define VEC_G_SHIFT 8
+#define VEC_B_SHIFT 16
+#endif
+
+// 8 bytes to 16bits values
+ALWAYS_INLINE vec_i16 vec_load_8(const uint8_t *ptr)
+{
+	vec_u8 value;
+	memcpy(&value, ptr, sizeof(value));
+	return __builtin_convertvector(value, vec_i16);
+}
+
+// 16 bytes to 16bits values, split in even and odd bytes
+ALWAYS_INLINE void vec_load_16(const uint8_t *ptr, vec_i16 *even, vec_i16 *odd)
+{
+	vec_u16 value;
+	memcpy(&value, ptr, sizeof(value));
+	*even = (vec_i16)((value>>VEC_EVEN_SHIFT)&0xFF);
+	*odd = (vec_i16)((value>>VEC_ODD_SHIFT)&0xFF);
+}
+
+// clamp 16bits values to [0:255]
+ALWAYS_INLINE vec_u16 vec_clamp(vec_i16 value)
+{
+	value &= ~(vec_i16)(value<0);
+	// values above 255 become -1, that is 255 after masking
+	value |= (vec_i16)(value>255);
+	return (vec_u16)value&0xFF;
+}
+
+ALWAYS_INLINE void vec_store_8(uint8_t *ptr, vec_i16 value)
+{
+	const vec_u8 packed = __builtin_convertvector(vec_clamp(value), vec_u8);
+	memcpy(ptr, &packed, sizeof(packed));
+}
+
+// interleave even and odd values, with unsigned saturation, to 16 bytes
+ALWAYS_INLINE vec_u16 vec_pack_16(vec_i16 even, vec_i16 odd)
+{
+	return (vec_clamp(even)<<VEC_EVEN_SHIFT) | (vec_clamp(odd)<<VEC_ODD_SHIFT);
+}
+
+// low 16bits of the product, as _mm_mullo_epi16, products and their sums are computed as unsigned values,
+// that wrap like sse instructions where signed values would overflow, and are converted to signed values
+// for arithmetic shifts only
+ALWAYS_INLINE vec_u16 vec_mullo(vec_i16 value, int factor)
+{
+	return (vec_u16)value*(uint16_t)factor;
+}
+
+// rgb of 16 pixels of a line, from their luma and the color offsets of their chroma
+ALWAYS_INLINE void vec_yuv2rgb_line(const YUV2RGBParam *param, const uint8_t *y_ptr, uint8_t *rgb_ptr,
+	vec_i16 r_offset, vec_i16 g_offset, vec_i16 b_offset)
+{
+	vec_i16 y_even, y_odd;
+	vec_load_16(y_ptr, &y_even, &y_odd);
+	if(param->y_offset!=0)
+	{
+		y_even -= (int16_t)param->y_offset;
+		y_odd -= (int16_t)param->y_offset;
+	}
+	if(param->y_factor!=128)
+	{
+		y_even += (vec_i16)vec_mullo(y_even, param->y_factor-128)>>7;
+		y_odd += (vec_i16)vec_mullo(y_odd, param->y_factor-128)>>7;
+	}
+	const vec_u16 r = vec_pack_16(y_even+r_offset, y_odd+r_offset),
+		g = vec_pack_16(y_even-g_offset, y_odd-g_offset),
+		b = vec_pack_16(y_even+b_offset, y_odd+b_offset);
+	uint8_t r_8[16], g_8[16], b_8[16];
+	memcpy(r_8, &r, 16);
+	memcpy(g_8, &g, 16);
+	memcpy(b_8, &b, 16);
+	for(int i=0; i<16; ++i)
+	{
+		rgb_ptr[i*3] = r_8[i];
+		rgb_ptr[i*3+1] = g_8[i];
+		rgb_ptr[i*3+2] = b_8[i];
+	}
+}
+
+// rgb of 16 pixels of two lines, u and v are the 8 chroma values minus 128
+ALWAYS_INLINE void vec_yuv2rgb_16(const YUV2RGBParam *param, vec_i16 u, vec_i16 v,
+	const uint8_t *y_ptr1, const uint8_t *y_ptr2, uint8_t *rgb_ptr1, uint8_t *rgb_ptr2)
+{
+	const vec_i16 r_offset = (vec_i16)vec_mullo(v, param->cr_factor)>>6,
+		g_offset = (vec_i16)(vec_mullo(u, param->g_cb_factor)+vec_mullo(v, param->g_cr_factor))>>7,
+		b_offset = (vec_i16)vec_mullo(u, param->cb_factor)>>6;
+	vec_yuv2rgb_line(param, y_ptr1, rgb_ptr1, r_offset, g_offset, b_offset);
+	vec_yuv2rgb_line(param, y_ptr2, rgb_ptr2, r_offset, g_offset, b_offset);
+}
+
+// Y' of 16 pixels of a line, stored after rescale, the sums of (B-Y') and (R-Y') of each pair of
+// pixels are added to cb and cr
+ALWAYS_INLINE void vec_rgb2yuv_line(const RGB2YUVParam *param, const uint8_t *rgb_ptr, uint32_t pixel_size,
+	uint8_t *y_ptr, vec_i16 *cb, vec_i16 *cr)
+{
+	uint8_t r_8[16], g_8[16], b_8[16];
+	if(pixel_size==4)
+	{
+		// whole pixels are read, so that the loop is vectorized without gather
+		for(int i=0; i<16; ++i)
+		{
+			uint32_t pixel;
+			memcpy(&pixel, rgb_ptr+i*4, 4);
+			r_8[i] = (uint8_t)(pixel>>VEC_R_SHIFT);
+			g_8[i] = (uint8_t)(pixel>>VEC_G_SHIFT);
+			b_8[i] = (uint8_t)(pixel>>VEC_B_SHIFT);
+		}
+	}
+	else
+	{
+		for(int i=0; i<16; ++i)
+		{
+			r_8[i] = rgb_ptr[i*pixel_size];
+			g_8[i] = rgb_ptr[i*pixel_size+1];
+			b_8[i] = rgb_ptr[i*pixel_size+2];
+		}
+	}
+	vec_i16 r_even, r_odd, g_even, g_odd, b_even, b_odd;
+	vec_load_16(r_8, &r_even, &r_odd);
+	vec_load_16(g_8, &g_even, &g_odd);
+	vec_load_16(b_8, &b_even, &b_odd);
+	vec_i16 y_even = (vec_i16)((vec_mullo(r_even, param->r_factor)+vec_mullo(g_even, param->g_factor)+
+		vec_mullo(b_even, param->b_factor))>>8);
+	vec_i16 y_odd = (vec_i16)((vec_mullo(r_odd, param->r_factor)+vec_mullo(g_odd, param->g_factor)+
+		vec_mullo(b_odd, param->b_factor))>>8);
+	// differences are in [-255:255], so that the sums of the four pixels of a block fit in 16bits
+	*cb += (b_even-y_even)+(b_odd-y_odd);
+	*cr += (r_even-y_even)+(r_odd-y_odd);
+	if(param->y_factor!=128)
+	{
+		y_even = (vec_i16)(vec_mullo(y_even, param->y_factor)>>7);
+		y_odd = (vec_i16)(vec_mullo(y_odd, param->y_factor)>>7);
+	}
+	if(param->y_offset!=0)
+	{
+		y_even += (int16_t)param->y_offset;
+		y_odd += (int16_t)param->y_offset;
+	}
+	const vec_u16 y = vec_pack_16(y_even, y_odd);
+	memcpy(y_ptr, &y, sizeof(y));
+}
+
+// yuv of 16 pixels of two lines
+ALWAYS_INLINE void vec_rgb2yuv_16(const RGB2YUVParam *param, uint32_t pixel_size,
+	const uint8_t *rgb_ptr1, const uint8_t *rgb_ptr2, uint8_t *y_ptr1, uint8_t *y_ptr2, uint8_t *u_ptr, uint8_t *v_ptr)
+{
+	vec_i16 cb = {0}, cr = {0};
+	vec_rgb2yuv_line(param, rgb_ptr1, pixel_size, y_ptr1, &cb, &cr);
+	vec_rgb2yuv_line(param, rgb_ptr2, pixel_size, y_ptr2, &cb, &cr);
+	vec_store_8(u_ptr, ((vec_i16)vec_mullo(cb>>2, param->cb_factor)>>8)+128);
+	vec_store_8(v_ptr, ((vec_i16)vec_mullo(cr>>2, param->cr_factor)>>8)+128);
+}
+
+ALWAYS_INLINE void rgb_yuv420_vec_impl(uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, uint32_t pixel_size,
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
 	YCbCrType yuv_type)
 {
-	#define LOAD_SI128 _mm_loadu_si128
-	#define SAVE_SI128 _mm_storeu_si128
-	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	const RGB2YUVParam *const param = &(RGB2YUV[yuv_type]);
 	
 	uint32_t x, y;
 	for(y=0; y<(height-1); y+=2)
 	{
-		const uint8_t *y_ptr1=Y+y*Y_stride,
-			*y_ptr2=Y+(y+1)*Y_stride,
-			*uv_ptr=UV+(y/2)*UV_stride;
-		
-		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
+		const uint8_t *rgb_ptr1=RGB+y*RGB_stride,
 			*rgb_ptr2=RGB+(y+1)*RGB_stride;
 		
-		for(x=0; x<(width-31); x+=32)
+		uint8_t *y_ptr1=Y+y*Y_stride,
+			*y_ptr2=Y+(y+1)*Y_stride,
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
+		
+		for(x=0; x+15<width; x+=16)
 		{
-			YUV2RGB_32_NV12
+			vec_rgb2yuv_16(param, pixel_size, rgb_ptr1, rgb_ptr2, y_ptr1, y_ptr2, u_ptr, v_ptr);
 			
-			y_ptr1+=32;
-			y_ptr2+=32;
-			uv_ptr+=32; 
-			rgb_ptr1+=96;
-			rgb_ptr2+=96;
+			rgb_ptr1+=16*pixel_size;
+			rgb_ptr2+=16*pixel_size;
+			y_ptr1+=16;
+			y_ptr2+=16;
+			u_ptr+=8; 
+			v_ptr+=8;
 		}
 	}
-	#undef LOAD_SI128
-	#undef SAVE_SI128
 }
 
-void nv21_rgb24_sse(
+ALWAYS_INLINE void rgb24_yuv420_vec_impl(uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	rgb_yuv420_vec_impl(width, height, RGB, RGB_stride, 3, Y, U, V, Y_stride, UV_stride, yuv_type);
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	const uint32_t x = width&~15u;
+	if(x<width)
+		rgb24_yuv420_std(width-x, height, RGB+x*3, RGB_stride, Y+x, U+x/2, V+x/2, Y_stride, UV_stride, yuv_type);
+}
+
+void rgb24_yuv420_vec(uint32_t width, uint32_t height, 
+	const uint8_t *RGB, uint32_t RGB_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb24_yuv420_vec_impl, width, height, RGB, RGB_stride, Y, U, V, Y_stride, UV_stride)
+}
+
+ALWAYS_INLINE void rgb32_yuv420_vec_impl(uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	rgb_yuv420_vec_impl(width, height, RGBA, RGBA_stride, 4, Y, U, V, Y_stride, UV_stride, yuv_type);
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	const uint32_t x = width&~15u;
+	if(x<width)
+		rgb32_yuv420_std(width-x, height, RGBA+x*4, RGBA_stride, Y+x, U+x/2, V+x/2, Y_stride, UV_stride, yuv_type);
+}
+
+void rgb32_yuv420_vec(uint32_t width, uint32_t height, 
+	const uint8_t *RGBA, uint32_t RGBA_stride, 
+	uint8_t *Y, uint8_t *U, uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(rgb32_yuv420_vec_impl, width, height, RGBA, RGBA_stride, Y, U, V, Y_stride, UV_stride)
+}
+
+ALWAYS_INLINE void yuv420_rgb24_vec_impl(
 	uint32_t width, uint32_t height, 
-	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
 	uint8_t *RGB, uint32_t RGB_stride, 
 	YCbCrType yuv_type)
 {
-	#define LOAD_SI128 _mm_load_si128
-	#define SAVE_SI128 _mm_stream_si128
 	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
 	
 	uint32_t x, y;
@@ -1252,34 +5946,46 @@ void nv21_rgb24_sse(
 	{
 		const uint8_t *y_ptr1=Y+y*Y_stride,
 			*y_ptr2=Y+(y+1)*Y_stride,
-			*uv_ptr=UV+(y/2)*UV_stride;
+			*u_ptr=U+(y/2)*UV_stride,
+			*v_ptr=V+(y/2)*UV_stride;
 		
 		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
 			*rgb_ptr2=RGB+(y+1)*RGB_stride;
 		
-		for(x=0; x<(width-31); x+=32)
+		for(x=0; x+15<width; x+=16)
 		{
-			YUV2RGB_32_NV21
+			vec_yuv2rgb_16(param, vec_load_8(u_ptr)-128, vec_load_8(v_ptr)-128, y_ptr1, y_ptr2, rgb_ptr1, rgb_ptr2);
 			
-			y_ptr1+=32;
-			y_ptr2+=32;
-			uv_ptr+=32; 
-			rgb_ptr1+=96;
-			rgb_ptr2+=96;
+			y_ptr1+=16;
+			y_ptr2+=16;
+			u_ptr+=8; 
+			v_ptr+=8;
+			rgb_ptr1+=48;
+			rgb_ptr2+=48;
 		}
 	}
-	#undef LOAD_SI128
-	#undef SAVE_SI128
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	x = width&~15u;
+	if(x<width)
+		yuv420_rgb24_std(width-x, height, Y+x, U+x/2, V+x/2, Y_stride, UV_stride, RGB+x*3, RGB_stride, yuv_type);
 }
 
-void nv21_rgb24_sseu(
+void yuv420_rgb24_vec(
 	uint32_t width, uint32_t height, 
-	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride, 
 	uint8_t *RGB, uint32_t RGB_stride, 
 	YCbCrType yuv_type)
 {
-	#define LOAD_SI128 _mm_loadu_si128
-	#define SAVE_SI128 _mm_storeu_si128
+	SPECIALIZE_YUV_TYPE(yuv420_rgb24_vec_impl, width, height, Y, U, V, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+// u_first is 1 for nv12, and 0 for nv21
+ALWAYS_INLINE void yuvsp_rgb24_vec_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	int u_first, YCbCrType yuv_type)
+{
 	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
 	
 	uint32_t x, y;
@@ -1292,21 +5998,65 @@ void nv21_rgb24_sseu(
 		uint8_t *rgb_ptr1=RGB+y*RGB_stride,
 			*rgb_ptr2=RGB+(y+1)*RGB_stride;
 		
-		for(x=0; x<(width-31); x+=32)
+		for(x=0; x+15<width; x+=16)
 		{
-			YUV2RGB_32_NV21
+			vec_i16 even, odd;
+			vec_load_16(uv_ptr, &even, &odd);
+			even -= 128;
+			odd -= 128;
+			vec_yuv2rgb_16(param, u_first ? even : odd, u_first ? odd : even, y_ptr1, y_ptr2, rgb_ptr1, rgb_ptr2);
 			
-			y_ptr1+=32;
-			y_ptr2+=32;
-			uv_ptr+=32; 
-			rgb_ptr1+=96;
-			rgb_ptr2+=96;
+			y_ptr1+=16;
+			y_ptr2+=16;
+			uv_ptr+=16;
+			rgb_ptr1+=48;
+			rgb_ptr2+=48;
 		}
 	}
-	#undef LOAD_SI128
-	#undef SAVE_SI128
 }
 
+ALWAYS_INLINE void nv12_rgb24_vec_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	yuvsp_rgb24_vec_impl(width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride, 1, yuv_type);
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	const uint32_t x = width&~15u;
+	if(x<width)
+		nv12_rgb24_std(width-x, height, Y+x, UV+x, Y_stride, UV_stride, RGB+x*3, RGB_stride, yuv_type);
+}
+
+void nv12_rgb24_vec(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(nv12_rgb24_vec_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride)
+}
+
+ALWAYS_INLINE void nv21_rgb24_vec_impl(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	yuvsp_rgb24_vec_impl(width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride, 0, yuv_type);
+	// process remaining pixels with the standard implementation, that gives the exact same result
+	const uint32_t x = width&~15u;
+	if(x<width)
+		nv21_rgb24_std(width-x, height, Y+x, UV+x, Y_stride, UV_stride, RGB+x*3, RGB_stride, yuv_type);
+}
 
+void nv21_rgb24_vec(
+	uint32_t width, uint32_t height, 
+	const uint8_t *Y, const uint8_t *UV, uint32_t Y_stride, uint32_t UV_stride, 
+	uint8_t *RGB, uint32_t RGB_stride, 
+	YCbCrType yuv_type)
+{
+	SPECIALIZE_YUV_TYPE(nv21_rgb24_vec_impl, width, height, Y, UV, Y_stride, UV_stride, RGB, RGB_stride)
+}
 
-#endif //_YUVRGB_SSE2_
+#endif //_YUVRGB_VEC_
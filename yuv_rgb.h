@@ -5,7 +5,8 @@
 
 // There are a few slightly different variations of the YCbCr color space with different parameters that 
 // change the conversion matrix.
-// The three most common YCbCr color space, defined by BT.601, BT.709 and JPEG standard are implemented here.
+// The three most common YCbCr color space, defined by BT.601, BT.709 and JPEG standard are implemented here, 
+// as well as BT.2020 (non constant luminance, 8 bits limited range).
 // See the respective standards for details
 // The matrix values used are derived from http://www.equasys.de/colorconversion.html
 
@@ -14,7 +15,12 @@
 // is suboptimal for image quality, but by far the fastest method.
 
 // For all methods, width and height should be even, if not, the last row/column of the result image won't be affected.
-// For sse methods, if the width if not divisable by 32, the last (width%32) pixels of each line won't be affected.
+// For sse methods, if the width if not divisable by 32, the last (width%32) pixels of each line are processed 
+// by the standard c implementation.
+// All methods give bit exact results, see yuv_rgb.c for a description of the integer operations used.
+
+#ifndef YUV_RGB_H
+#define YUV_RGB_H
 
 #include <stdint.h>
 
@@ -22,9 +28,37 @@ typedef enum
 {
 	YCBCR_JPEG,
 	YCBCR_601,
-	YCBCR_709
+	YCBCR_709,
+	YCBCR_2020
 } YCbCrType;
 
+// Pixel formats, used by the apis that work on several formats (batch conversion, ...)
+typedef enum
+{
+	PIXEL_FORMAT_YUV420, // three planes Y, U and V, U and V are subsampled by a 2 factor in both directions
+	PIXEL_FORMAT_NV12,   // two planes Y and UV, with interleaved and subsampled U and V values
+	PIXEL_FORMAT_NV21,   // two planes Y and VU, with interleaved and subsampled V and U values
+	PIXEL_FORMAT_RGB24,  // single plane, R, G and B bytes for each pixel
+	PIXEL_FORMAT_RGB32   // single plane, R, G, B and A bytes for each pixel
+} PixelFormat;
+
+// Transfer functions, between nonlinear rgb values and linear light, used by the linear float conversions
+typedef enum
+{
+	TRANSFER_SRGB,   // IEC 61966-2-1 sRGB
+	TRANSFER_BT1886  // ITU-R BT.1886 EOTF, a 2.4 power, with a white luminance of 1 and a black luminance of 0
+} TransferFunction;
+
+// Transfer functions of HDR sources, used by the HDR to SDR conversions
+typedef enum
+{
+	HDR_TRANSFER_PQ,  // SMPTE ST 2084 perceptual quantizer (HDR10)
+	HDR_TRANSFER_HLG  // ARIB STD-B67 / ITU-R BT.2100 hybrid log-gamma
+} HdrTransfer;
+
+// Tables of an HDR to SDR conversion, see hdr_tone_map_create
+typedef struct HdrToneMap HdrToneMap;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -150,6 +184,700 @@ void rgb32_yuv420_sseu(
 	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
 	YCbCrType yuv_type);
 
+// Luma only conversions, for jobs that do not need color. Cb and Cr are neither read nor written,
+// and width and height do not need to be even.
+// luma_* write the full range luma (R=G=B value of the yuv to rgb conversion) as gray8, gray rgb24
+// or gray rgba (alpha set to 255), *_luma write the Y plane of the rgb to yuv conversion only.
+// sseu functions do not need 16 byte aligned pointers, and are only available with sse2.
+void luma_gray8_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, uint32_t y_stride, 
+	uint8_t *gray, uint32_t gray_stride, 
+	YCbCrType yuv_type);
+
+void luma_gray8_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, uint32_t y_stride, 
+	uint8_t *gray, uint32_t gray_stride, 
+	YCbCrType yuv_type);
+
+void luma_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, uint32_t y_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	YCbCrType yuv_type);
+
+void luma_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, uint32_t y_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	YCbCrType yuv_type);
+
+void luma_rgb32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, uint32_t y_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, 
+	YCbCrType yuv_type);
+
+void luma_rgb32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, uint32_t y_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, 
+	YCbCrType yuv_type);
+
+void rgb24_luma_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *y, uint32_t y_stride, 
+	YCbCrType yuv_type);
+
+void rgb24_luma_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *y, uint32_t y_stride, 
+	YCbCrType yuv_type);
+
+void rgb32_luma_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint32_t y_stride, 
+	YCbCrType yuv_type);
+
+void rgb32_luma_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint32_t y_stride, 
+	YCbCrType yuv_type);
+
+// Conversion between color spaces (and ranges), without going through rgb. The 3x3 matrix of the 
+// conversion is applied directly to the yuv planes, each Y uses the Cb and Cr of its block. 
+// Source and destination may be the same planes.
+// sseu functions do not need 16 byte aligned pointers, and are only available with sse2.
+void yuv420_yuv420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *u2, uint8_t *v2, uint32_t y2_stride, uint32_t uv2_stride, 
+	YCbCrType src_type, YCbCrType dst_type);
+
+void yuv420_yuv420_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *u2, uint8_t *v2, uint32_t y2_stride, uint32_t uv2_stride, 
+	YCbCrType src_type, YCbCrType dst_type);
+
+void nv12_nv12_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *uv2, uint32_t y2_stride, uint32_t uv2_stride, 
+	YCbCrType src_type, YCbCrType dst_type);
+
+void nv12_nv12_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *uv2, uint32_t y2_stride, uint32_t uv2_stride, 
+	YCbCrType src_type, YCbCrType dst_type);
+
+// Conversion between chroma layouts, samples are only moved so that results are exact, and all pixels 
+// are processed, including the last column and line of odd sizes.
+// The Y plane is copied, unless y2 is NULL or equal to y, so that only the chroma planes are written when 
+// the destination shares the Y plane of the source.
+// yv12 is yuv420 with the V plane before the U plane, it is handled by swapping the u and v pointers.
+// nv12_nv21 swaps the two bytes of each chroma sample, it also converts nv21 to nv12, and works in place.
+// sse functions require 16 bytes aligned pointers and strides, sseu functions do not, both are only 
+// available with sse2.
+void yuv420_nv12_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *uv2, uint32_t y2_stride, uint32_t uv2_stride);
+
+void yuv420_nv12_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *uv2, uint32_t y2_stride, uint32_t uv2_stride);
+
+void yuv420_nv12_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *uv2, uint32_t y2_stride, uint32_t uv2_stride);
+
+void yuv420_nv21_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *vu2, uint32_t y2_stride, uint32_t vu2_stride);
+
+void yuv420_nv21_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *vu2, uint32_t y2_stride, uint32_t vu2_stride);
+
+void yuv420_nv21_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *vu2, uint32_t y2_stride, uint32_t vu2_stride);
+
+void nv12_yuv420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *u2, uint8_t *v2, uint32_t y2_stride, uint32_t uv2_stride);
+
+void nv12_yuv420_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *u2, uint8_t *v2, uint32_t y2_stride, uint32_t uv2_stride);
+
+void nv12_yuv420_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *u2, uint8_t *v2, uint32_t y2_stride, uint32_t uv2_stride);
+
+void nv21_yuv420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *vu, uint32_t y_stride, uint32_t vu_stride, 
+	uint8_t *y2, uint8_t *u2, uint8_t *v2, uint32_t y2_stride, uint32_t uv2_stride);
+
+void nv21_yuv420_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *vu, uint32_t y_stride, uint32_t vu_stride, 
+	uint8_t *y2, uint8_t *u2, uint8_t *v2, uint32_t y2_stride, uint32_t uv2_stride);
+
+void nv21_yuv420_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *vu, uint32_t y_stride, uint32_t vu_stride, 
+	uint8_t *y2, uint8_t *u2, uint8_t *v2, uint32_t y2_stride, uint32_t uv2_stride);
+
+void nv12_nv21_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *vu2, uint32_t y2_stride, uint32_t vu2_stride);
+
+void nv12_nv21_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *vu2, uint32_t y2_stride, uint32_t vu2_stride);
+
+void nv12_nv21_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *y2, uint8_t *vu2, uint32_t y2_stride, uint32_t vu2_stride);
+
+// yuv to 16 bits rgb, for rgb565 (5 bits red in the most significant bits, 6 bits green, 5 bits blue) and 
+// rgb555 (most significant bit is 0, 5 bits per component) framebuffers. Pixels are stored as little endian 
+// 16 bits words, rgb_stride is in bytes.
+// If dither is not 0, a 4x4 ordered dither is applied, that depends on the position of pixels in the image.
+// sse functions require 16 bytes aligned pointers and strides, sseu functions do not, both are only 
+// available with sse2.
+void yuv420_rgb565_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	int dither, YCbCrType yuv_type);
+
+void yuv420_rgb565_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	int dither, YCbCrType yuv_type);
+
+void yuv420_rgb565_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	int dither, YCbCrType yuv_type);
+
+void yuv420_rgb555_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	int dither, YCbCrType yuv_type);
+
+void yuv420_rgb555_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	int dither, YCbCrType yuv_type);
+
+void yuv420_rgb555_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	int dither, YCbCrType yuv_type);
+
+void nv12_rgb565_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	int dither, YCbCrType yuv_type);
+
+void nv12_rgb565_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	int dither, YCbCrType yuv_type);
+
+void nv12_rgb565_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	int dither, YCbCrType yuv_type);
+
+void nv12_rgb555_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	int dither, YCbCrType yuv_type);
+
+void nv12_rgb555_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	int dither, YCbCrType yuv_type);
+
+void nv12_rgb555_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	int dither, YCbCrType yuv_type);
+
+// Packed rgb utilities, that only move bytes, all pixels are processed.
+// rgb24_rgba32 and rgb24_bgra32 add an alpha channel, set to alpha, rgba32_rgb24 and bgra32_rgb24 remove it.
+// rgb24_bgr24 and rgba32_bgra32 swap the red and blue channels (so they also convert bgr to rgb), and 
+// work in place.
+// rgb24_rgb_planes and rgb_planes_rgb24 convert between packed rgb and three planes, with the same stride.
+// sse functions require 16 bytes aligned pointers and strides, sseu functions do not, both are only 
+// available with sse2.
+void rgb24_rgba32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t alpha);
+
+void rgb24_rgba32_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t alpha);
+
+void rgb24_rgba32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t alpha);
+
+void rgb24_bgra32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *bgra, uint32_t bgra_stride, 
+	uint8_t alpha);
+
+void rgb24_bgra32_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *bgra, uint32_t bgra_stride, 
+	uint8_t alpha);
+
+void rgb24_bgra32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *bgra, uint32_t bgra_stride, 
+	uint8_t alpha);
+
+void rgba32_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *rgb, uint32_t rgb_stride);
+
+void rgba32_rgb24_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *rgb, uint32_t rgb_stride);
+
+void rgba32_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *rgb, uint32_t rgb_stride);
+
+void bgra32_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *bgra, uint32_t bgra_stride, 
+	uint8_t *rgb, uint32_t rgb_stride);
+
+void bgra32_rgb24_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *bgra, uint32_t bgra_stride, 
+	uint8_t *rgb, uint32_t rgb_stride);
+
+void bgra32_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *bgra, uint32_t bgra_stride, 
+	uint8_t *rgb, uint32_t rgb_stride);
+
+void rgb24_bgr24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *bgr, uint32_t bgr_stride);
+
+void rgb24_bgr24_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *bgr, uint32_t bgr_stride);
+
+void rgb24_bgr24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *bgr, uint32_t bgr_stride);
+
+void rgba32_bgra32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *bgra, uint32_t bgra_stride);
+
+void rgba32_bgra32_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *bgra, uint32_t bgra_stride);
+
+void rgba32_bgra32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *bgra, uint32_t bgra_stride);
+
+void rgb24_rgb_planes_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *r, uint8_t *g, uint8_t *b, uint32_t planes_stride);
+
+void rgb24_rgb_planes_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *r, uint8_t *g, uint8_t *b, uint32_t planes_stride);
+
+void rgb24_rgb_planes_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *r, uint8_t *g, uint8_t *b, uint32_t planes_stride);
+
+void rgb_planes_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *r, const uint8_t *g, const uint8_t *b, uint32_t planes_stride, 
+	uint8_t *rgb, uint32_t rgb_stride);
+
+void rgb_planes_rgb24_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *r, const uint8_t *g, const uint8_t *b, uint32_t planes_stride, 
+	uint8_t *rgb, uint32_t rgb_stride);
+
+void rgb_planes_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *r, const uint8_t *g, const uint8_t *b, uint32_t planes_stride, 
+	uint8_t *rgb, uint32_t rgb_stride);
+
+// yuva420 is yuv420 with a full resolution alpha plane a, that uses the y stride.
+// rgba32_yuva420 converts like rgb32_yuv420, and copies alpha to the a plane in the same pass.
+// yuva420_rgba32 and yuva420_bgra32 convert like yuv420_rgb24 and add alpha from the a plane. With premultiply 
+// set, r, g and b are multiplied by alpha/255, rounded to the nearest value.
+// As for other yuv420 conversions, the last column and line of odd sized images are not processed.
+void rgba32_yuva420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *a, uint32_t y_stride, uint32_t uv_stride, 
+	YCbCrType yuv_type);
+
+void rgba32_yuva420_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *a, uint32_t y_stride, uint32_t uv_stride, 
+	YCbCrType yuv_type);
+
+void rgba32_yuva420_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *a, uint32_t y_stride, uint32_t uv_stride, 
+	YCbCrType yuv_type);
+
+void yuva420_rgba32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, 
+	int premultiply, YCbCrType yuv_type);
+
+void yuva420_rgba32_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, 
+	int premultiply, YCbCrType yuv_type);
+
+void yuva420_rgba32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, 
+	int premultiply, YCbCrType yuv_type);
+
+void yuva420_bgra32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *bgra, uint32_t bgra_stride, 
+	int premultiply, YCbCrType yuv_type);
+
+void yuva420_bgra32_sse(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *bgra, uint32_t bgra_stride, 
+	int premultiply, YCbCrType yuv_type);
+
+void yuva420_bgra32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *bgra, uint32_t bgra_stride, 
+	int premultiply, YCbCrType yuv_type);
+
+// Alpha blending of an overlay onto a yuv420 or nv12 image, in place, so that only the pixels covered by the 
+// overlay are read and written. The overlay of width x height pixels is placed at (left, top) in the image, and 
+// must be inside of it. It can be an rgba32 image with straight alpha, converted with the rgb to yuv parameters of 
+// yuv_type, or a yuva420 image of the same color space, then left and top must be even.
+// Luma is blended for each pixel, and chroma for each 2x2 block with the mean alpha of its pixels, pixels of 
+// blocks on the overlay borders that are outside of it count as transparent. A fully opaque rgba32 overlay gives 
+// the same result as rgb32_yuv420. See yuv_rgb.c for the exact integer operations.
+void yuv420_blend_rgba32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint32_t left, uint32_t top, YCbCrType yuv_type);
+
+void yuv420_blend_rgba32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint32_t left, uint32_t top, YCbCrType yuv_type);
+
+void nv12_blend_rgba32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint32_t left, uint32_t top, YCbCrType yuv_type);
+
+void nv12_blend_rgba32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint32_t left, uint32_t top, YCbCrType yuv_type);
+
+void yuv420_blend_yuva420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *overlay_y, const uint8_t *overlay_u, const uint8_t *overlay_v, const uint8_t *overlay_a, 
+	uint32_t overlay_y_stride, uint32_t overlay_uv_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint32_t left, uint32_t top);
+
+void yuv420_blend_yuva420_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *overlay_y, const uint8_t *overlay_u, const uint8_t *overlay_v, const uint8_t *overlay_a, 
+	uint32_t overlay_y_stride, uint32_t overlay_uv_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint32_t left, uint32_t top);
+
+void nv12_blend_yuva420_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *overlay_y, const uint8_t *overlay_u, const uint8_t *overlay_v, const uint8_t *overlay_a, 
+	uint32_t overlay_y_stride, uint32_t overlay_uv_stride, 
+	uint8_t *y, uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint32_t left, uint32_t top);
+
+void nv12_blend_yuva420_sseu(
+	uint32_t width, uint32_t height, 
+	const uint8_t *overlay_y, const uint8_t *overlay_u, const uint8_t *overlay_v, const uint8_t *overlay_a, 
+	uint32_t overlay_y_stride, uint32_t overlay_uv_stride, 
+	uint8_t *y, uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint32_t left, uint32_t top);
+
+// HDR to SDR conversion, for previews of HDR10 (PQ) and HLG video on SDR displays, from 10 bits BT.2020 limited 
+// range yuv420: p010 (a Y plane and an interleaved UV plane, with 10 bits values in the high bits of 16 bits 
+// words) or yuv420p10 (three planes, with 10 bits values in the low bits of 16 bits words). Strides are in bytes.
+// In a single pass, each pixel is converted to nonlinear BT.2020 rgb with 12 bits, then to tone mapped linear 
+// light with 14 bits through a table, converted to BT.709 primaries with a 3x3 matrix, and encoded with the sdr 
+// transfer function through a second table. See yuv_rgb.c for the exact integer operations, sseu functions give 
+// the same results as std ones, and are only available with sse2.
+// hdr_tone_map_create builds the tables for a source transfer function and the peak luminance of the content 
+// in cd/m2 (mastering display peak for PQ, display peak for HLG, typically 1000). Tone mapping is applied to 
+// each component, so that the SDR reference white (203 cd/m2) maps to 1, luminances up to 0.75 of it are kept, 
+// and higher ones are compressed so that the peak maps to 1. For HLG, the OOTF system gamma of the peak 
+// luminance is applied to each component too. It returns NULL if peak_luminance is not positive or if 
+// allocation fails.
+// As for other yuv420 conversions, the last column and line of odd sized images are not processed.
+HdrToneMap *hdr_tone_map_create(HdrTransfer transfer, float peak_luminance, TransferFunction sdr_transfer);
+
+void hdr_tone_map_destroy(HdrToneMap *tone_map);
+
+void p010_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint16_t *y, const uint16_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	const HdrToneMap *tone_map);
+
+void p010_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint16_t *y, const uint16_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	const HdrToneMap *tone_map);
+
+void p010_rgba32_std(
+	uint32_t width, uint32_t height, 
+	const uint16_t *y, const uint16_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, 
+	const HdrToneMap *tone_map);
+
+void p010_rgba32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint16_t *y, const uint16_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, 
+	const HdrToneMap *tone_map);
+
+void yuv420p10_rgb24_std(
+	uint32_t width, uint32_t height, 
+	const uint16_t *y, const uint16_t *u, const uint16_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	const HdrToneMap *tone_map);
+
+void yuv420p10_rgb24_sseu(
+	uint32_t width, uint32_t height, 
+	const uint16_t *y, const uint16_t *u, const uint16_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	const HdrToneMap *tone_map);
+
+void yuv420p10_rgba32_std(
+	uint32_t width, uint32_t height, 
+	const uint16_t *y, const uint16_t *u, const uint16_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, 
+	const HdrToneMap *tone_map);
+
+void yuv420p10_rgba32_sseu(
+	uint32_t width, uint32_t height, 
+	const uint16_t *y, const uint16_t *u, const uint16_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgba, uint32_t rgba_stride, 
+	const HdrToneMap *tone_map);
+
+// Portable vector implementation, written with gcc and clang vector extensions, so that targets
+// without sse (arm, risc-v...) also get vector code. Only available when built with these compilers.
+// Pointers do not need to be aligned, and results are bit exact with the other implementations.
+void yuv420_rgb24_vec(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	YCbCrType yuv_type);
+
+void nv12_rgb24_vec(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	YCbCrType yuv_type);
+
+void nv21_rgb24_vec(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	YCbCrType yuv_type);
+
+void rgb24_yuv420_vec(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	YCbCrType yuv_type);
+
+// alpha channel is ignored
+void rgb32_yuv420_vec(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	YCbCrType yuv_type);
+
+// Linear light conversions, for compositing in linear float rgba.
+// yuv420_rgbaf32 and nv12_rgbaf32 convert to rgba with 32 bits float components, and yuv420_rgbaf16 and 
+// nv12_rgbaf16 to rgba with 16 bits half float components, in [0:1], with alpha set to 1. The EOTF is applied 
+// to the nonlinear rgb values in the same pass, through a table with 16 entries per 8 bits level, so that they 
+// are not quantized to 8 bits first.
+// rgbaf32_yuv420 applies the inverse EOTF to linear rgb values clamped to [0:1] and converts them to yuv420, 
+// alpha is ignored.
+// Float rgba strides are in bytes. Tables of each transfer function are built on first use. Results are not 
+// bit exact with the 8 bits conversions, since no intermediate value is rounded.
+void yuv420_rgbaf32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	float *rgba, uint32_t rgba_stride, 
+	TransferFunction transfer, YCbCrType yuv_type);
+
+void nv12_rgbaf32_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	float *rgba, uint32_t rgba_stride, 
+	TransferFunction transfer, YCbCrType yuv_type);
+
+void yuv420_rgbaf16_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint16_t *rgba, uint32_t rgba_stride, 
+	TransferFunction transfer, YCbCrType yuv_type);
+
+void nv12_rgbaf16_std(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint16_t *rgba, uint32_t rgba_stride, 
+	TransferFunction transfer, YCbCrType yuv_type);
+
+void rgbaf32_yuv420_std(
+	uint32_t width, uint32_t height, 
+	const float *rgba, uint32_t rgba_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	TransferFunction transfer, YCbCrType yuv_type);
+
+// Lookup table implementation, for cores without vector unit, where it is faster than the std
+// functions. Tables of each color space are built on first use. Results are bit exact with the other
+// implementations.
+void yuv420_rgb24_lut(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	YCbCrType yuv_type);
+
+void nv12_rgb24_lut(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	YCbCrType yuv_type);
+
+void nv21_rgb24_lut(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	YCbCrType yuv_type);
+
+// SSSE3 implementation, rgb24 data is interleaved and deinterleaved with byte shuffles
+// Only available on x86 with gcc or clang, and must only be called if the cpu supports ssse3.
+// Pointers do not need to be aligned.
+void yuv420_rgb24_ssse3(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	YCbCrType yuv_type);
+
+void nv12_rgb24_ssse3(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	YCbCrType yuv_type);
+
+void nv21_rgb24_ssse3(
+	uint32_t width, uint32_t height, 
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride, 
+	uint8_t *rgb, uint32_t rgb_stride, 
+	YCbCrType yuv_type);
+
+void rgb24_yuv420_ssse3(
+	uint32_t width, uint32_t height, 
+	const uint8_t *rgb, uint32_t rgb_stride, 
+	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride, 
+	YCbCrType yuv_type);
+
 #ifdef __cplusplus
 }
 #endif
+
+#endif // YUV_RGB_H
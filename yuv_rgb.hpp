@@ -0,0 +1,326 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// C++17 interface: typed image views, owning frames and compile time conversion dispatch
+
+// Views (Yuv420View, Nv12View, Nv21View, Rgb24View, Rgb32View) describe an image without owning it,
+// they are small trivially copyable structs that are passed by value. The Const* views are used for
+// read only sources, a mutable view converts implicitly to the corresponding const view.
+// convert(src, dst) selects the kernel from the view types at compile time, unsupported pairs do not
+// compile. Only the choice between the aligned and unaligned sse kernels is done at run time,
+// from the pointers and strides, and everything is inlined down to a single kernel call.
+// Frame<View> owns planes allocated with frame_buffer_alloc (aligned on 64 bytes, so that the aligned
+// kernels are used), it can be moved but not copied. Conversions never allocate.
+
+#ifndef YUV_RGB_HPP
+#define YUV_RGB_HPP
+
+#include "yuv_rgb.h"
+#include "yuv_rgb_alloc.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// call the aligned sse kernel if both images are aligned, the unaligned one otherwise
+// sse kernels are only built when the compiler targets sse2, the portable vector kernels are used
+// instead when the compiler supports them (see yuv_rgb_private.h)
+#if (defined(__SSE2__) || defined(_M_AMD64) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP == 2)) && \
+	!defined(FORCE_VEC)
+#define YUV_RGB_HPP_KERNEL(name, aligned, ...) \
+	((aligned) ? name##_sse(__VA_ARGS__) : name##_sseu(__VA_ARGS__))
+#elif defined(__clang__) || (defined(__GNUC__) && __GNUC__>=9)
+#define YUV_RGB_HPP_KERNEL(name, aligned, ...) \
+	((void)(aligned), name##_vec(__VA_ARGS__))
+#else
+#define YUV_RGB_HPP_KERNEL(name, aligned, ...) \
+	((void)(aligned), name##_std(__VA_ARGS__))
+#endif
+
+namespace yuv_rgb {
+
+// three planes Y, U and V, U and V are subsampled by a 2 factor in both directions
+template<typename T>
+struct BasicYuv420View
+{
+	using value_type = T;
+	static constexpr PixelFormat format = PIXEL_FORMAT_YUV420;
+
+	uint32_t width = 0, height = 0;
+	T *y = nullptr, *u = nullptr, *v = nullptr;
+	uint32_t y_stride = 0, uv_stride = 0;
+	YCbCrType yuv_type = YCBCR_601;
+
+	constexpr BasicYuv420View() = default;
+	constexpr BasicYuv420View(uint32_t width_, uint32_t height_, T *y_, T *u_, T *v_,
+		uint32_t y_stride_, uint32_t uv_stride_, YCbCrType yuv_type_) :
+		width(width_), height(height_), y(y_), u(u_), v(v_),
+		y_stride(y_stride_), uv_stride(uv_stride_), yuv_type(yuv_type_) {}
+	template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+	constexpr BasicYuv420View(const BasicYuv420View<U> &other) :
+		BasicYuv420View(other.width, other.height, other.y, other.u, other.v,
+			other.y_stride, other.uv_stride, other.yuv_type) {}
+
+	constexpr T *y_row(uint32_t row) const { return y+std::size_t(row)*y_stride; }
+	constexpr T *u_row(uint32_t row) const { return u+std::size_t(row/2)*uv_stride; }
+	constexpr T *v_row(uint32_t row) const { return v+std::size_t(row/2)*uv_stride; }
+};
+
+// two planes Y and interleaved subsampled chroma, UV for nv12, VU for nv21
+template<typename T, PixelFormat Format>
+struct BasicSemiPlanarView
+{
+	using value_type = T;
+	static constexpr PixelFormat format = Format;
+
+	uint32_t width = 0, height = 0;
+	T *y = nullptr, *uv = nullptr;
+	uint32_t y_stride = 0, uv_stride = 0;
+	YCbCrType yuv_type = YCBCR_601;
+
+	constexpr BasicSemiPlanarView() = default;
+	constexpr BasicSemiPlanarView(uint32_t width_, uint32_t height_, T *y_, T *uv_,
+		uint32_t y_stride_, uint32_t uv_stride_, YCbCrType yuv_type_) :
+		width(width_), height(height_), y(y_), uv(uv_),
+		y_stride(y_stride_), uv_stride(uv_stride_), yuv_type(yuv_type_) {}
+	template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+	constexpr BasicSemiPlanarView(const BasicSemiPlanarView<U, Format> &other) :
+		BasicSemiPlanarView(other.width, other.height, other.y, other.uv,
+			other.y_stride, other.uv_stride, other.yuv_type) {}
+
+	constexpr T *y_row(uint32_t row) const { return y+std::size_t(row)*y_stride; }
+	constexpr T *uv_row(uint32_t row) const { return uv+std::size_t(row/2)*uv_stride; }
+};
+
+// single plane of packed pixels
+template<typename T, PixelFormat Format>
+struct BasicPackedView
+{
+	using value_type = T;
+	static constexpr PixelFormat format = Format;
+	static constexpr uint32_t pixel_size = Format==PIXEL_FORMAT_RGB32 ? 4 : 3;
+
+	uint32_t width = 0, height = 0;
+	T *pixels = nullptr;
+	uint32_t stride = 0;
+
+	constexpr BasicPackedView() = default;
+	constexpr BasicPackedView(uint32_t width_, uint32_t height_, T *pixels_, uint32_t stride_) :
+		width(width_), height(height_), pixels(pixels_), stride(stride_) {}
+	template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+	constexpr BasicPackedView(const BasicPackedView<U, Format> &other) :
+		BasicPackedView(other.width, other.height, other.pixels, other.stride) {}
+
+	constexpr T *row(uint32_t row) const { return pixels+std::size_t(row)*stride; }
+	constexpr T *pixel(uint32_t x, uint32_t y) const { return row(y)+std::size_t(x)*pixel_size; }
+};
+
+using Yuv420View = BasicYuv420View<uint8_t>;
+using ConstYuv420View = BasicYuv420View<const uint8_t>;
+using Nv12View = BasicSemiPlanarView<uint8_t, PIXEL_FORMAT_NV12>;
+using ConstNv12View = BasicSemiPlanarView<const uint8_t, PIXEL_FORMAT_NV12>;
+using Nv21View = BasicSemiPlanarView<uint8_t, PIXEL_FORMAT_NV21>;
+using ConstNv21View = BasicSemiPlanarView<const uint8_t, PIXEL_FORMAT_NV21>;
+using Rgb24View = BasicPackedView<uint8_t, PIXEL_FORMAT_RGB24>;
+using ConstRgb24View = BasicPackedView<const uint8_t, PIXEL_FORMAT_RGB24>;
+using Rgb32View = BasicPackedView<uint8_t, PIXEL_FORMAT_RGB32>;
+using ConstRgb32View = BasicPackedView<const uint8_t, PIXEL_FORMAT_RGB32>;
+
+namespace detail {
+
+template<typename View>
+struct ViewTraits;
+
+template<typename T>
+struct ViewTraits<BasicYuv420View<T>>
+{
+	using const_view = BasicYuv420View<const T>;
+	static BasicYuv420View<T> from_buffer(const FrameBuffer &buffer, YCbCrType yuv_type)
+	{
+		return {buffer.width, buffer.height, buffer.plane[0], buffer.plane[1], buffer.plane[2],
+			buffer.stride[0], buffer.stride[1], yuv_type};
+	}
+	static bool aligned(const BasicYuv420View<T> &view)
+	{
+		return ((reinterpret_cast<uintptr_t>(view.y) | reinterpret_cast<uintptr_t>(view.u) |
+			reinterpret_cast<uintptr_t>(view.v) | view.y_stride | view.uv_stride) & 15)==0;
+	}
+};
+
+template<typename T, PixelFormat Format>
+struct ViewTraits<BasicSemiPlanarView<T, Format>>
+{
+	using const_view = BasicSemiPlanarView<const T, Format>;
+	static BasicSemiPlanarView<T, Format> from_buffer(const FrameBuffer &buffer, YCbCrType yuv_type)
+	{
+		return {buffer.width, buffer.height, buffer.plane[0], buffer.plane[1],
+			buffer.stride[0], buffer.stride[1], yuv_type};
+	}
+	static bool aligned(const BasicSemiPlanarView<T, Format> &view)
+	{
+		return ((reinterpret_cast<uintptr_t>(view.y) | reinterpret_cast<uintptr_t>(view.uv) |
+			view.y_stride | view.uv_stride) & 15)==0;
+	}
+};
+
+template<typename T, PixelFormat Format>
+struct ViewTraits<BasicPackedView<T, Format>>
+{
+	using const_view = BasicPackedView<const T, Format>;
+	static BasicPackedView<T, Format> from_buffer(const FrameBuffer &buffer, YCbCrType)
+	{
+		return {buffer.width, buffer.height, buffer.plane[0], buffer.stride[0]};
+	}
+	static bool aligned(const BasicPackedView<T, Format> &view)
+	{
+		return ((reinterpret_cast<uintptr_t>(view.pixels) | view.stride) & 15)==0;
+	}
+};
+
+template<typename View>
+inline bool aligned(const View &view)
+{
+	return ViewTraits<View>::aligned(view);
+}
+
+} // namespace detail
+
+// true if convert(Src, Dst) compiles
+template<typename Src, typename Dst>
+inline constexpr bool can_convert_v = !std::is_const_v<typename Dst::value_type> && (
+	((Src::format==PIXEL_FORMAT_YUV420 || Src::format==PIXEL_FORMAT_NV12 || Src::format==PIXEL_FORMAT_NV21) &&
+		Dst::format==PIXEL_FORMAT_RGB24) ||
+	((Src::format==PIXEL_FORMAT_RGB24 || Src::format==PIXEL_FORMAT_RGB32) && Dst::format==PIXEL_FORMAT_YUV420));
+
+// convert src to dst, the color space is the one of the yuv view
+// return 0 on success, -1 if sizes are different
+template<typename Src, typename Dst>
+inline int convert(const Src &src, const Dst &dst)
+{
+	static_assert(can_convert_v<Src, Dst>, "unsupported conversion");
+	constexpr PixelFormat src_format = Src::format, dst_format = Dst::format;
+	if(src.width!=dst.width || src.height!=dst.height)
+		return -1;
+	if(src.width==0 || src.height==0)
+		return 0;
+	const bool aligned = detail::aligned(src) && detail::aligned(dst);
+	if constexpr(src_format==PIXEL_FORMAT_YUV420)
+		YUV_RGB_HPP_KERNEL(yuv420_rgb24, aligned,
+			src.width, src.height, src.y, src.u, src.v, src.y_stride, src.uv_stride,
+			dst.pixels, dst.stride, src.yuv_type);
+	else if constexpr(src_format==PIXEL_FORMAT_NV12)
+		YUV_RGB_HPP_KERNEL(nv12_rgb24, aligned,
+			src.width, src.height, src.y, src.uv, src.y_stride, src.uv_stride,
+			dst.pixels, dst.stride, src.yuv_type);
+	else if constexpr(src_format==PIXEL_FORMAT_NV21)
+		YUV_RGB_HPP_KERNEL(nv21_rgb24, aligned,
+			src.width, src.height, src.y, src.uv, src.y_stride, src.uv_stride,
+			dst.pixels, dst.stride, src.yuv_type);
+	else if constexpr(src_format==PIXEL_FORMAT_RGB24 && dst_format==PIXEL_FORMAT_YUV420)
+		YUV_RGB_HPP_KERNEL(rgb24_yuv420, aligned,
+			src.width, src.height, src.pixels, src.stride,
+			dst.y, dst.u, dst.v, dst.y_stride, dst.uv_stride, dst.yuv_type);
+	else if constexpr(src_format==PIXEL_FORMAT_RGB32 && dst_format==PIXEL_FORMAT_YUV420)
+		YUV_RGB_HPP_KERNEL(rgb32_yuv420, aligned,
+			src.width, src.height, src.pixels, src.stride,
+			dst.y, dst.u, dst.v, dst.y_stride, dst.uv_stride, dst.yuv_type);
+	return 0;
+}
+
+// image owning its planes, View is one of the mutable views above
+// a const frame only gives the corresponding const view, so it can only be a conversion source
+template<typename View>
+class Frame
+{
+public:
+	using view_type = View;
+	using const_view_type = typename detail::ViewTraits<View>::const_view;
+
+	// throw std::bad_alloc on allocation failure, flags is a combination of FrameBufferFlags
+	Frame(uint32_t width, uint32_t height, YCbCrType yuv_type = YCBCR_601, uint32_t flags = 0) :
+		yuv_type_(yuv_type)
+	{
+		if(frame_buffer_alloc(&buffer_, View::format, width, height, flags)!=0)
+			throw std::bad_alloc();
+	}
+
+	Frame(Frame &&other) noexcept : buffer_(other.buffer_), yuv_type_(other.yuv_type_)
+	{
+		other.buffer_ = FrameBuffer();
+	}
+
+	Frame &operator=(Frame &&other) noexcept
+	{
+		if(this!=&other)
+		{
+			frame_buffer_free(&buffer_);
+			buffer_ = other.buffer_;
+			yuv_type_ = other.yuv_type_;
+			other.buffer_ = FrameBuffer();
+		}
+		return *this;
+	}
+
+	Frame(const Frame &) = delete;
+	Frame &operator=(const Frame &) = delete;
+
+	~Frame()
+	{
+		frame_buffer_free(&buffer_);
+	}
+
+	View view()
+	{
+		return detail::ViewTraits<View>::from_buffer(buffer_, yuv_type_);
+	}
+
+	const_view_type view() const
+	{
+		return detail::ViewTraits<View>::from_buffer(buffer_, yuv_type_);
+	}
+
+	operator View()
+	{
+		return view();
+	}
+
+	operator const_view_type() const
+	{
+		return view();
+	}
+
+	uint32_t width() const { return buffer_.width; }
+	uint32_t height() const { return buffer_.height; }
+	const FrameBuffer &buffer() const { return buffer_; }
+
+private:
+	FrameBuffer buffer_ = FrameBuffer();
+	YCbCrType yuv_type_;
+};
+
+// convert between owning frames, or between frames and views
+template<typename Src, typename Dst>
+inline int convert(const Frame<Src> &src, Frame<Dst> &dst)
+{
+	return convert(src.view(), dst.view());
+}
+
+template<typename Src, typename Dst>
+inline int convert(const Frame<Src> &src, const Dst &dst)
+{
+	return convert(src.view(), dst);
+}
+
+template<typename Src, typename Dst>
+inline int convert(const Src &src, Frame<Dst> &dst)
+{
+	return convert(src, dst.view());
+}
+
+} // namespace yuv_rgb
+
+#undef YUV_RGB_HPP_KERNEL
+
+#endif // YUV_RGB_HPP
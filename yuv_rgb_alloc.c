@@ -0,0 +1,169 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// _DEFAULT_SOURCE is needed for madvise flags
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include "yuv_rgb_alloc.h"
+#include "yuv_rgb_pipeline.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// size of transparent huge pages on x86_64
+#define HUGE_PAGE_SIZE (2*1024*1024)
+
+#define ALIGN_SIZE(size, alignment) (((size)+(alignment)-1)&~((size_t)(alignment)-1))
+
+// size of each plane of an image, return the number of planes
+static uint32_t plane_sizes(PixelFormat format, uint32_t width, uint32_t height,
+	uint32_t line_size[3], uint32_t lines[3])
+{
+	switch(format)
+	{
+		case PIXEL_FORMAT_YUV420:
+			line_size[0] = width;
+			lines[0] = height;
+			line_size[1] = line_size[2] = (width+1)/2;
+			lines[1] = lines[2] = (height+1)/2;
+			return 3;
+		case PIXEL_FORMAT_NV12:
+		case PIXEL_FORMAT_NV21:
+			line_size[0] = width;
+			lines[0] = height;
+			line_size[1] = ((width+1)/2)*2;
+			lines[1] = (height+1)/2;
+			return 2;
+		case PIXEL_FORMAT_RGB24:
+			line_size[0] = width*3;
+			lines[0] = height;
+			return 1;
+		case PIXEL_FORMAT_RGB32:
+			line_size[0] = width*4;
+			lines[0] = height;
+			return 1;
+	}
+	return 0;
+}
+
+int frame_buffer_alloc(FrameBuffer *frame, PixelFormat format, uint32_t width, uint32_t height, uint32_t flags)
+{
+	uint32_t line_size[3], lines[3];
+	memset(frame, 0, sizeof(FrameBuffer));
+	frame->plane_number = plane_sizes(format, width, height, line_size, lines);
+	if(frame->plane_number==0)
+		return -1;
+
+	const size_t guard = (flags&FRAME_BUFFER_GUARD) ? FRAME_BUFFER_ALIGNMENT : 0;
+	size_t offset[3], size = 0;
+	for(uint32_t p=0; p<frame->plane_number; ++p)
+	{
+		frame->stride[p] = (uint32_t)ALIGN_SIZE(line_size[p], FRAME_BUFFER_ALIGNMENT);
+		offset[p] = size;
+		size += (size_t)frame->stride[p]*lines[p]+guard;
+	}
+
+	size_t alignment = FRAME_BUFFER_ALIGNMENT;
+	if(size>=HUGE_PAGE_SIZE)
+	{
+		alignment = HUGE_PAGE_SIZE;
+		size = ALIGN_SIZE(size, HUGE_PAGE_SIZE);
+	}
+	if(posix_memalign(&frame->memory, alignment, size ? size : 1)!=0)
+	{
+		frame->memory = NULL;
+		return -1;
+	}
+#ifdef MADV_HUGEPAGE
+	// only a hint, the frame works without huge pages
+	if(alignment==HUGE_PAGE_SIZE)
+		madvise(frame->memory, size, MADV_HUGEPAGE);
+#endif
+
+	frame->width = width;
+	frame->height = height;
+	frame->format = format;
+	frame->size = size;
+	for(uint32_t p=0; p<frame->plane_number; ++p)
+	{
+		frame->plane[p] = (uint8_t *)frame->memory+offset[p];
+		if(guard)
+			memset(frame->plane[p]+(size_t)frame->stride[p]*lines[p], 0, guard);
+	}
+	return 0;
+}
+
+void frame_buffer_free(FrameBuffer *frame)
+{
+	free(frame->memory);
+	memset(frame, 0, sizeof(FrameBuffer));
+}
+
+// Pool
+
+struct FramePool
+{
+	PixelFormat format;
+	uint32_t width, height;
+	uint32_t flags;
+	FrameRing *free_frames;
+};
+
+FramePool *frame_pool_create(PixelFormat format, uint32_t width, uint32_t height, uint32_t flags, uint32_t capacity)
+{
+	uint32_t line_size[3], lines[3];
+	if(capacity==0 || plane_sizes(format, width, height, line_size, lines)==0)
+		return NULL;
+	FramePool *pool = calloc(1, sizeof(FramePool));
+	if(!pool)
+		return NULL;
+	pool->format = format;
+	pool->width = width;
+	pool->height = height;
+	pool->flags = flags;
+	pool->free_frames = frame_ring_create(capacity, RING_MPMC);
+	if(!pool->free_frames)
+	{
+		free(pool);
+		return NULL;
+	}
+	return pool;
+}
+
+void frame_pool_destroy(FramePool *pool)
+{
+	if(!pool)
+		return;
+	for(FrameBuffer *frame; (frame=(FrameBuffer *)frame_ring_pop(pool->free_frames))!=NULL; )
+	{
+		frame_buffer_free(frame);
+		free(frame);
+	}
+	frame_ring_destroy(pool->free_frames);
+	free(pool);
+}
+
+FrameBuffer *frame_pool_get(FramePool *pool)
+{
+	FrameBuffer *frame = (FrameBuffer *)frame_ring_pop(pool->free_frames);
+	if(frame)
+		return frame;
+	frame = malloc(sizeof(FrameBuffer));
+	if(frame && frame_buffer_alloc(frame, pool->format, pool->width, pool->height, pool->flags)!=0)
+	{
+		free(frame);
+		return NULL;
+	}
+	return frame;
+}
+
+void frame_pool_put(FramePool *pool, FrameBuffer *frame)
+{
+	if(frame_ring_push(pool->free_frames, frame)!=0)
+	{
+		frame_buffer_free(frame);
+		free(frame);
+	}
+}
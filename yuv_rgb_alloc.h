@@ -0,0 +1,74 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// Allocation of frames suited to the aligned kernels, and pool of recycled frames
+
+// All planes of a FrameBuffer are stored in a single allocation, each plane and each line starting
+// on a 64 bytes boundary, so that the aligned sse kernels are always used and no line shares a cache
+// line with another one.
+// Frames larger than a huge page are aligned on huge pages and use transparent huge pages when the
+// system supports them, to reduce TLB misses when processing large frames.
+// FramePool keeps released frames to reuse them, so that there is no allocation per frame once the
+// pool is warm.
+
+#ifndef YUV_RGB_ALLOC_H
+#define YUV_RGB_ALLOC_H
+
+#include "yuv_rgb.h"
+
+#include <stddef.h>
+
+// alignment of planes and strides
+#define FRAME_BUFFER_ALIGNMENT 64
+
+typedef enum
+{
+	// add FRAME_BUFFER_ALIGNMENT bytes after each plane, so that simd code can read past the end of
+	// the last line of a plane
+	FRAME_BUFFER_GUARD = 1
+} FrameBufferFlags;
+
+// Planes are Y, U, V for yuv420, Y, UV for nv12 and nv21, and a single plane for rgb formats
+typedef struct
+{
+	uint32_t width, height;
+	PixelFormat format;
+	uint8_t *plane[3];
+	uint32_t stride[3];
+	uint32_t plane_number;
+	void *memory;
+	size_t size;
+} FrameBuffer;
+
+typedef struct FramePool FramePool;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// allocate the planes of a frame, flags is a combination of FrameBufferFlags
+// return 0 on success, -1 on failure
+int frame_buffer_alloc(FrameBuffer *frame, PixelFormat format, uint32_t width, uint32_t height, uint32_t flags);
+
+void frame_buffer_free(FrameBuffer *frame);
+
+// create a pool of frames of the given format and size, that keeps at most capacity free frames
+// (rounded up to a power of two)
+// return NULL on failure
+FramePool *frame_pool_create(PixelFormat format, uint32_t width, uint32_t height, uint32_t flags, uint32_t capacity);
+
+// free the pool and all its free frames, frames in use must have been put back before
+void frame_pool_destroy(FramePool *pool);
+
+// get a free frame, or allocate a new one if there is none, return NULL on allocation failure
+// get and put can be called from several threads without lock
+FrameBuffer *frame_pool_get(FramePool *pool);
+
+// give back a frame obtained with frame_pool_get, it is freed if the pool is full
+void frame_pool_put(FramePool *pool, FrameBuffer *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YUV_RGB_ALLOC_H
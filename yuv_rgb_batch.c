@@ -0,0 +1,339 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "yuv_rgb_batch.h"
+#include "yuv_rgb_private.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// target number of pixels of a task, large enough to make scheduling cost negligible,
+// small enough to get a good load balancing
+#define TASK_PIXELS (64*1024)
+
+// size of a cache line, used to avoid false sharing between threads
+#define CACHE_LINE 64
+
+// Thread pool
+
+typedef struct
+{
+	ThreadPool *pool;
+	uint32_t index;
+} Worker;
+
+struct ThreadPool
+{
+	uint32_t thread_number;
+	pthread_t *threads;
+	Worker *workers;
+	pthread_mutex_t run_mutex;   // serialize calls to thread_pool_run
+	pthread_mutex_t mutex;       // protect all fields below
+	pthread_cond_t start_cond;
+	pthread_cond_t done_cond;
+	uint64_t generation;         // incremented for each job
+	uint32_t running;            // number of threads (other than the calling one) still running the current job
+	int stop;
+	PoolFunction function;
+	void *arg;
+	// scratch memory reused by batch_convert, protected by run_mutex
+	void *scratch;
+	size_t scratch_size;
+};
+
+static void *worker_main(void *arg)
+{
+	Worker *worker = (Worker *)arg;
+	ThreadPool *pool = worker->pool;
+	uint64_t generation = 0;
+
+	pthread_mutex_lock(&pool->mutex);
+	for(;;)
+	{
+		while(!pool->stop && pool->generation==generation)
+			pthread_cond_wait(&pool->start_cond, &pool->mutex);
+		if(pool->stop)
+			break;
+		generation = pool->generation;
+		PoolFunction function = pool->function;
+		void *function_arg = pool->arg;
+		pthread_mutex_unlock(&pool->mutex);
+
+		function(function_arg, worker->index);
+
+		pthread_mutex_lock(&pool->mutex);
+		if(--pool->running==0)
+			pthread_cond_signal(&pool->done_cond);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+ThreadPool *thread_pool_create(uint32_t thread_number)
+{
+	if(thread_number==0)
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		thread_number = cpus>0 ? (uint32_t)cpus : 1;
+	}
+
+	ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+	if(!pool)
+		return NULL;
+	pool->thread_number = thread_number;
+	pool->threads = calloc(thread_number, sizeof(pthread_t));
+	pool->workers = calloc(thread_number, sizeof(Worker));
+	if(!pool->threads || !pool->workers)
+	{
+		free(pool->threads);
+		free(pool->workers);
+		free(pool);
+		return NULL;
+	}
+	pthread_mutex_init(&pool->run_mutex, NULL);
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->start_cond, NULL);
+	pthread_cond_init(&pool->done_cond, NULL);
+
+	// worker 0 is the calling thread
+	for(uint32_t i=1; i<thread_number; ++i)
+	{
+		pool->workers[i].pool = pool;
+		pool->workers[i].index = i;
+		if(pthread_create(&pool->threads[i], NULL, worker_main, &pool->workers[i])!=0)
+		{
+			pool->thread_number = i;
+			thread_pool_destroy(pool);
+			return NULL;
+		}
+	}
+	return pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool)
+{
+	if(!pool)
+		return;
+	pthread_mutex_lock(&pool->mutex);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->start_cond);
+	pthread_mutex_unlock(&pool->mutex);
+	for(uint32_t i=1; i<pool->thread_number; ++i)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->start_cond);
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_mutex_destroy(&pool->run_mutex);
+	free(pool->scratch);
+	free(pool->workers);
+	free(pool->threads);
+	free(pool);
+}
+
+uint32_t thread_pool_size(const ThreadPool *pool)
+{
+	return pool->thread_number;
+}
+
+static void thread_pool_run_locked(ThreadPool *pool, PoolFunction function, void *arg)
+{
+	if(pool->thread_number>1)
+	{
+		pthread_mutex_lock(&pool->mutex);
+		pool->function = function;
+		pool->arg = arg;
+		pool->running = pool->thread_number-1;
+		pool->generation++;
+		pthread_cond_broadcast(&pool->start_cond);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+
+	function(arg, 0);
+
+	if(pool->thread_number>1)
+	{
+		pthread_mutex_lock(&pool->mutex);
+		while(pool->running>0)
+			pthread_cond_wait(&pool->done_cond, &pool->mutex);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+}
+
+void thread_pool_run(ThreadPool *pool, PoolFunction function, void *arg)
+{
+	pthread_mutex_lock(&pool->run_mutex);
+	thread_pool_run_locked(pool, function, arg);
+	pthread_mutex_unlock(&pool->run_mutex);
+}
+
+// Batch scheduling
+
+// a task is either a band of lines of a single frame, or a group of complete frames
+typedef struct
+{
+	uint32_t frame_begin, frame_end;
+	uint32_t row_begin, row_end;   // only used for bands, when frame_end==frame_begin+1
+} Task;
+
+// range of tasks of a thread, the owner and the thieves take tasks from the same atomic counter,
+// so that there is no need for a lock
+typedef struct
+{
+	uint32_t next;
+	uint32_t end;
+	char padding[CACHE_LINE-2*sizeof(uint32_t)];
+} TaskQueue;
+
+typedef struct
+{
+	const BatchFrame *frames;
+	const Task *tasks;
+	TaskQueue *queues;
+	uint32_t queue_number;
+} BatchJob;
+
+static void run_task(const BatchJob *job, const Task *task)
+{
+	if(task->frame_end==task->frame_begin+1)
+		convert_rows(&job->frames[task->frame_begin], task->row_begin, task->row_end);
+	else
+		for(uint32_t f=task->frame_begin; f<task->frame_end; ++f)
+			convert_rows(&job->frames[f], 0, job->frames[f].height);
+}
+
+static void batch_worker(void *arg, uint32_t worker)
+{
+	BatchJob *job = (BatchJob *)arg;
+	// start with own queue, then steal from the next ones
+	for(uint32_t i=0; i<job->queue_number; ++i)
+	{
+		TaskQueue *queue = &job->queues[(worker+i)%job->queue_number];
+		for(;;)
+		{
+			const uint32_t t = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED);
+			if(t>=queue->end)
+				break;
+			run_task(job, &job->tasks[t]);
+		}
+	}
+}
+
+// split frames in tasks, tasks must be large enough to store the result
+static uint32_t build_tasks(const BatchFrame *frames, uint32_t frame_number, Task *tasks)
+{
+	uint32_t task_number = 0;
+	uint32_t f = 0;
+	while(f<frame_number)
+	{
+		const uint64_t pixels = (uint64_t)frames[f].width*frames[f].height;
+		if(pixels>=TASK_PIXELS)
+		{
+			// large frame, split in bands of an even number of lines
+			uint32_t band = frames[f].width ? (TASK_PIXELS/frames[f].width)&~1u : 0;
+			if(band<2)
+				band = 2;
+			for(uint32_t row=0; row<frames[f].height; row+=band)
+			{
+				Task *task = &tasks[task_number++];
+				task->frame_begin = f;
+				task->frame_end = f+1;
+				task->row_begin = row;
+				task->row_end = frames[f].height-row>band ? row+band : frames[f].height;
+			}
+			f++;
+		}
+		else
+		{
+			// small frames, pack consecutive frames until the task is large enough
+			Task *task = &tasks[task_number++];
+			uint64_t task_pixels = 0;
+			task->frame_begin = f;
+			task->row_begin = 0;
+			task->row_end = frames[f].height;
+			while(f<frame_number && task_pixels<TASK_PIXELS &&
+				(uint64_t)frames[f].width*frames[f].height<TASK_PIXELS)
+			{
+				task_pixels += (uint64_t)frames[f].width*frames[f].height;
+				f++;
+			}
+			task->frame_end = f;
+		}
+	}
+	return task_number;
+}
+
+static uint32_t max_task_number(const BatchFrame *frames, uint32_t frame_number)
+{
+	uint32_t n = 0;
+	for(uint32_t f=0; f<frame_number; ++f)
+	{
+		const uint64_t pixels = (uint64_t)frames[f].width*frames[f].height;
+		uint32_t band = frames[f].width ? (TASK_PIXELS/frames[f].width)&~1u : 0;
+		if(band<2)
+			band = 2;
+		n += pixels>=TASK_PIXELS ? (frames[f].height+band-1)/band : 1;
+	}
+	return n;
+}
+
+int batch_convert(ThreadPool *pool, const BatchFrame *frames, uint32_t frame_number)
+{
+	for(uint32_t f=0; f<frame_number; ++f)
+		if(!is_supported(&frames[f]))
+			return -1;
+
+	if(!pool || pool->thread_number==1)
+	{
+		for(uint32_t f=0; f<frame_number; ++f)
+			convert_rows(&frames[f], 0, frames[f].height);
+		return 0;
+	}
+
+	pthread_mutex_lock(&pool->run_mutex);
+
+	// tasks and queues are stored in the pool scratch memory, reallocated only when too small
+	const uint32_t queue_number = pool->thread_number;
+	const size_t queues_size = (size_t)queue_number*sizeof(TaskQueue);
+	const size_t needed = queues_size + (size_t)max_task_number(frames, frame_number)*sizeof(Task);
+	if(needed>pool->scratch_size)
+	{
+		free(pool->scratch);
+		pool->scratch = NULL;
+		pool->scratch_size = 0;
+		// queues are at the beginning of the scratch memory, that must be aligned on cache lines
+		if(posix_memalign(&pool->scratch, CACHE_LINE, needed)==0)
+			pool->scratch_size = needed;
+	}
+	if(!pool->scratch)
+	{
+		// out of memory, convert with the calling thread only
+		pthread_mutex_unlock(&pool->run_mutex);
+		for(uint32_t f=0; f<frame_number; ++f)
+			convert_rows(&frames[f], 0, frames[f].height);
+		return 0;
+	}
+
+	BatchJob job;
+	job.frames = frames;
+	job.queues = (TaskQueue *)pool->scratch;
+	job.queue_number = queue_number;
+	Task *tasks = (Task *)((char *)pool->scratch + queues_size);
+	job.tasks = tasks;
+	const uint32_t task_number = build_tasks(frames, frame_number, tasks);
+
+	// equal ranges of tasks for each thread
+	for(uint32_t i=0; i<queue_number; ++i)
+	{
+		job.queues[i].next = (uint32_t)(((uint64_t)task_number*i)/queue_number);
+		job.queues[i].end = (uint32_t)(((uint64_t)task_number*(i+1))/queue_number);
+	}
+
+	thread_pool_run_locked(pool, batch_worker, &job);
+
+	pthread_mutex_unlock(&pool->run_mutex);
+	return 0;
+}
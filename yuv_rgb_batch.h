@@ -0,0 +1,69 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// Convert many frames with a single call, using a pool of threads
+
+// A thread pool is created once and reused for all calls, so that no thread is created or destroyed
+// for each batch. The frames of a batch can have different sizes, formats and color spaces.
+// Frames are cut into tasks of roughly the same number of pixels: large frames are split in bands of
+// lines, while consecutive small frames are packed together in a single task.
+// Tasks are distributed in equal ranges to each thread, and a thread that has finished its own range
+// steals tasks from the others, so that all threads stay busy until the end of the batch.
+// The calling thread takes part in the conversion.
+
+// The kernel used for each task is the fastest one available for its pointers and strides: the
+// aligned sse version if all are 16 bytes aligned, the unaligned sse version otherwise. Since all
+// versions give bit exact results, the result does not depend on the way frames are split.
+
+#ifndef YUV_RGB_BATCH_H
+#define YUV_RGB_BATCH_H
+
+#include "yuv_rgb.h"
+
+// Description of a frame conversion
+// Planes are Y, U, V for yuv420, Y, UV for nv12 and nv21, and a single plane for rgb formats,
+// unused planes and strides are ignored.
+// Conversions between a yuv and a rgb format are supported, rgb to yuv conversions only support yuv420
+// as output, since these are the available kernels. Conversions between yuv420, nv12 and nv21 only
+// change the chroma layout, yuv_type is ignored, and the Y plane is not copied if dst[0] is NULL or
+// equal to src[0]. Conversions between rgb24 and rgb32 add an opaque alpha channel or remove it.
+typedef struct
+{
+	uint32_t width, height;
+	PixelFormat src_format;
+	const uint8_t *src[3];
+	uint32_t src_stride[3];
+	PixelFormat dst_format;
+	uint8_t *dst[3];
+	uint32_t dst_stride[3];
+	YCbCrType yuv_type;
+} BatchFrame;
+
+typedef struct ThreadPool ThreadPool;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// create a pool of threads, thread_number includes the calling thread
+// if thread_number is 0, one thread per online cpu is used
+// return NULL on failure
+ThreadPool *thread_pool_create(uint32_t thread_number);
+
+// wait for the end of the threads and release all resources
+void thread_pool_destroy(ThreadPool *pool);
+
+// number of threads of the pool, including the calling thread
+uint32_t thread_pool_size(const ThreadPool *pool);
+
+// convert all frames and return when done
+// if pool is NULL, frames are converted by the calling thread only
+// a pool can only run one batch at a time, concurrent calls on the same pool are serialized
+// return 0 on success, -1 if a conversion is not supported (in that case nothing is converted)
+int batch_convert(ThreadPool *pool, const BatchFrame *frames, uint32_t frame_number);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YUV_RGB_BATCH_H
@@ -0,0 +1,270 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+#include "yuv_rgb.h"
+#include "yuv_rgb_private.h"
+
+#include <stddef.h>
+
+// with FORCE_VEC, sse kernels are not used, so that the portable kernels can be tested on x86
+#if defined(_YUVRGB_SSE2_) && !defined(FORCE_VEC)
+#define SSE_KERNEL(field, name) {.field = name}
+#else
+#define SSE_KERNEL(field, name) {.field = NULL}
+#endif
+
+#if defined(_YUVRGB_SSSE3_) && !defined(FORCE_VEC)
+#define SSSE3_KERNEL(field, name) {.field = name}
+#else
+#define SSSE3_KERNEL(field, name) {.field = NULL}
+#endif
+
+#ifdef _YUVRGB_VEC_
+#define VEC_KERNEL(field, name) {.field = name}
+#else
+#define VEC_KERNEL(field, name) {.field = NULL}
+#endif
+
+static const ConversionKernels conversions[] = {
+	{"yuv420_rgb24", PIXEL_FORMAT_YUV420, PIXEL_FORMAT_RGB24, KERNEL_YUV2RGB, {.yuv2rgb = yuv420_rgb24_std},
+		SSE_KERNEL(yuv2rgb, yuv420_rgb24_sse), SSE_KERNEL(yuv2rgb, yuv420_rgb24_sseu),
+		VEC_KERNEL(yuv2rgb, yuv420_rgb24_vec), SSSE3_KERNEL(yuv2rgb, yuv420_rgb24_ssse3),
+		{.yuv2rgb = yuv420_rgb24_lut}},
+	{"nv12_rgb24", PIXEL_FORMAT_NV12, PIXEL_FORMAT_RGB24, KERNEL_YUVSP2RGB, {.yuvsp2rgb = nv12_rgb24_std},
+		SSE_KERNEL(yuvsp2rgb, nv12_rgb24_sse), SSE_KERNEL(yuvsp2rgb, nv12_rgb24_sseu),
+		VEC_KERNEL(yuvsp2rgb, nv12_rgb24_vec), SSSE3_KERNEL(yuvsp2rgb, nv12_rgb24_ssse3),
+		{.yuvsp2rgb = nv12_rgb24_lut}},
+	{"nv21_rgb24", PIXEL_FORMAT_NV21, PIXEL_FORMAT_RGB24, KERNEL_YUVSP2RGB, {.yuvsp2rgb = nv21_rgb24_std},
+		SSE_KERNEL(yuvsp2rgb, nv21_rgb24_sse), SSE_KERNEL(yuvsp2rgb, nv21_rgb24_sseu),
+		VEC_KERNEL(yuvsp2rgb, nv21_rgb24_vec), SSSE3_KERNEL(yuvsp2rgb, nv21_rgb24_ssse3),
+		{.yuvsp2rgb = nv21_rgb24_lut}},
+	{"rgb24_yuv420", PIXEL_FORMAT_RGB24, PIXEL_FORMAT_YUV420, KERNEL_RGB2YUV, {.rgb2yuv = rgb24_yuv420_std},
+		SSE_KERNEL(rgb2yuv, rgb24_yuv420_sse), SSE_KERNEL(rgb2yuv, rgb24_yuv420_sseu),
+		VEC_KERNEL(rgb2yuv, rgb24_yuv420_vec), SSSE3_KERNEL(rgb2yuv, rgb24_yuv420_ssse3),
+		{.rgb2yuv = NULL}},
+	{"rgb32_yuv420", PIXEL_FORMAT_RGB32, PIXEL_FORMAT_YUV420, KERNEL_RGB2YUV, {.rgb2yuv = rgb32_yuv420_std},
+		SSE_KERNEL(rgb2yuv, rgb32_yuv420_sse), SSE_KERNEL(rgb2yuv, rgb32_yuv420_sseu),
+		VEC_KERNEL(rgb2yuv, rgb32_yuv420_vec), {.rgb2yuv = NULL},
+		{.rgb2yuv = NULL}},
+	// chroma layout conversions, swapping the bytes of each chroma sample converts nv21 to nv12 too
+	{"yuv420_nv12", PIXEL_FORMAT_YUV420, PIXEL_FORMAT_NV12, KERNEL_YUV2YUVSP, {.yuv2yuvsp = yuv420_nv12_std},
+		SSE_KERNEL(yuv2yuvsp, yuv420_nv12_sse), SSE_KERNEL(yuv2yuvsp, yuv420_nv12_sseu),
+		{.yuv2yuvsp = NULL}, {.yuv2yuvsp = NULL}, {.yuv2yuvsp = NULL}},
+	{"yuv420_nv21", PIXEL_FORMAT_YUV420, PIXEL_FORMAT_NV21, KERNEL_YUV2YUVSP, {.yuv2yuvsp = yuv420_nv21_std},
+		SSE_KERNEL(yuv2yuvsp, yuv420_nv21_sse), SSE_KERNEL(yuv2yuvsp, yuv420_nv21_sseu),
+		{.yuv2yuvsp = NULL}, {.yuv2yuvsp = NULL}, {.yuv2yuvsp = NULL}},
+	{"nv12_yuv420", PIXEL_FORMAT_NV12, PIXEL_FORMAT_YUV420, KERNEL_YUVSP2YUV, {.yuvsp2yuv = nv12_yuv420_std},
+		SSE_KERNEL(yuvsp2yuv, nv12_yuv420_sse), SSE_KERNEL(yuvsp2yuv, nv12_yuv420_sseu),
+		{.yuvsp2yuv = NULL}, {.yuvsp2yuv = NULL}, {.yuvsp2yuv = NULL}},
+	{"nv21_yuv420", PIXEL_FORMAT_NV21, PIXEL_FORMAT_YUV420, KERNEL_YUVSP2YUV, {.yuvsp2yuv = nv21_yuv420_std},
+		SSE_KERNEL(yuvsp2yuv, nv21_yuv420_sse), SSE_KERNEL(yuvsp2yuv, nv21_yuv420_sseu),
+		{.yuvsp2yuv = NULL}, {.yuvsp2yuv = NULL}, {.yuvsp2yuv = NULL}},
+	{"nv12_nv21", PIXEL_FORMAT_NV12, PIXEL_FORMAT_NV21, KERNEL_YUVSP2YUVSP, {.yuvsp2yuvsp = nv12_nv21_std},
+		SSE_KERNEL(yuvsp2yuvsp, nv12_nv21_sse), SSE_KERNEL(yuvsp2yuvsp, nv12_nv21_sseu),
+		{.yuvsp2yuvsp = NULL}, {.yuvsp2yuvsp = NULL}, {.yuvsp2yuvsp = NULL}},
+	{"nv21_nv12", PIXEL_FORMAT_NV21, PIXEL_FORMAT_NV12, KERNEL_YUVSP2YUVSP, {.yuvsp2yuvsp = nv12_nv21_std},
+		SSE_KERNEL(yuvsp2yuvsp, nv12_nv21_sse), SSE_KERNEL(yuvsp2yuvsp, nv12_nv21_sseu),
+		{.yuvsp2yuvsp = NULL}, {.yuvsp2yuvsp = NULL}, {.yuvsp2yuvsp = NULL}},
+	// packed rgb conversions
+	{"rgb24_rgb32", PIXEL_FORMAT_RGB24, PIXEL_FORMAT_RGB32, KERNEL_RGB2RGBA, {.rgb2rgba = rgb24_rgba32_std},
+		SSE_KERNEL(rgb2rgba, rgb24_rgba32_sse), SSE_KERNEL(rgb2rgba, rgb24_rgba32_sseu),
+		{.rgb2rgba = NULL}, {.rgb2rgba = NULL}, {.rgb2rgba = NULL}},
+	{"rgb32_rgb24", PIXEL_FORMAT_RGB32, PIXEL_FORMAT_RGB24, KERNEL_RGBA2RGB, {.rgba2rgb = rgba32_rgb24_std},
+		SSE_KERNEL(rgba2rgb, rgba32_rgb24_sse), SSE_KERNEL(rgba2rgb, rgba32_rgb24_sseu),
+		{.rgba2rgb = NULL}, {.rgba2rgb = NULL}, {.rgba2rgb = NULL}},
+};
+
+const ConversionKernels *find_conversion(PixelFormat src_format, PixelFormat dst_format)
+{
+	for(size_t i=0; i<sizeof(conversions)/sizeof(conversions[0]); ++i)
+		if(conversions[i].src_format==src_format && conversions[i].dst_format==dst_format)
+			return &conversions[i];
+	return NULL;
+}
+
+uint32_t conversion_number(void)
+{
+	return sizeof(conversions)/sizeof(conversions[0]);
+}
+
+const ConversionKernels *conversion_at(uint32_t index)
+{
+	return &conversions[index];
+}
+
+uint32_t conversion_index(const ConversionKernels *conversion)
+{
+	return (uint32_t)(conversion-conversions);
+}
+
+const char *const kernel_variant_names[KERNEL_VARIANT_NUMBER] = {"std", "sse", "sseu", "vec", "ssse3", "lut"};
+
+int is_supported(const BatchFrame *frame)
+{
+	return find_conversion(frame->src_format, frame->dst_format)!=NULL;
+}
+
+#define IS_ALIGNED(ptr, stride) (((((uintptr_t)(ptr)) | (stride)) & 15) == 0)
+
+// the v plane uses the stride of the u plane
+static int is_aligned_planes(PixelFormat format, const uint8_t *const plane[3], const uint32_t stride[3])
+{
+	switch(format)
+	{
+		case PIXEL_FORMAT_YUV420:
+			return IS_ALIGNED(plane[0], stride[0]) && IS_ALIGNED(plane[1], stride[1]) && IS_ALIGNED(plane[2], 0);
+		case PIXEL_FORMAT_NV12:
+		case PIXEL_FORMAT_NV21:
+			return IS_ALIGNED(plane[0], stride[0]) && IS_ALIGNED(plane[1], stride[1]);
+		case PIXEL_FORMAT_RGB24:
+		case PIXEL_FORMAT_RGB32:
+			return IS_ALIGNED(plane[0], stride[0]);
+	}
+	return 0;
+}
+
+int is_aligned(const BatchFrame *frame)
+{
+	return is_aligned_planes(frame->src_format, frame->src, frame->src_stride) &&
+		is_aligned_planes(frame->dst_format, (const uint8_t *const *)frame->dst, frame->dst_stride);
+}
+
+int get_kernel(const BatchFrame *frame, KernelVariant variant, SelectedKernel *kernel)
+{
+	const ConversionKernels *conversion = find_conversion(frame->src_format, frame->dst_format);
+	if(!conversion)
+		return -1;
+	kernel->conversion = conversion;
+	kernel->type = conversion->type;
+	kernel->variant = variant;
+	kernel->aligned = variant==KERNEL_VARIANT_SSE;
+	switch(variant)
+	{
+		case KERNEL_VARIANT_STD: kernel->function = conversion->std; break;
+		case KERNEL_VARIANT_SSE: kernel->function = conversion->sse; break;
+		case KERNEL_VARIANT_SSEU: kernel->function = conversion->sseu; break;
+		case KERNEL_VARIANT_VEC: kernel->function = conversion->vec; break;
+		case KERNEL_VARIANT_SSSE3: kernel->function = conversion->ssse3; break;
+		case KERNEL_VARIANT_LUT: kernel->function = conversion->lut; break;
+		default: return -1;
+	}
+	// all members of the union have the same representation, checking one is enough
+	if(!kernel->function.yuv2rgb || (kernel->aligned && !is_aligned(frame)))
+		return -1;
+#ifdef _YUVRGB_SSSE3_
+	if(variant==KERNEL_VARIANT_SSSE3 && !__builtin_cpu_supports("ssse3"))
+		return -1;
+#endif
+	return 0;
+}
+
+int select_kernel(const BatchFrame *frame, int non_temporal, SelectedKernel *kernel)
+{
+	if(non_temporal && get_kernel(frame, KERNEL_VARIANT_SSE, kernel)==0)
+		return 0;
+	if(get_kernel(frame, KERNEL_VARIANT_SSSE3, kernel)==0)
+		return 0;
+	if(get_kernel(frame, KERNEL_VARIANT_SSEU, kernel)==0)
+		return 0;
+	if(get_kernel(frame, KERNEL_VARIANT_VEC, kernel)==0)
+		return 0;
+	if(get_kernel(frame, KERNEL_VARIANT_LUT, kernel)==0)
+		return 0;
+	return get_kernel(frame, KERNEL_VARIANT_STD, kernel);
+}
+
+void run_kernel(const SelectedKernel *kernel, const BatchFrame *frame, uint32_t row_begin, uint32_t row_end)
+{
+	const uint32_t height = row_end-row_begin, uv_row = row_begin/2;
+#ifdef USE_STATS
+	StatsProbe probe;
+	stats_begin(&probe);
+#endif
+	switch(kernel->type)
+	{
+		case KERNEL_YUV2RGB:
+			kernel->function.yuv2rgb(frame->width, height,
+				frame->src[0]+(size_t)row_begin*frame->src_stride[0],
+				frame->src[1]+(size_t)uv_row*frame->src_stride[1],
+				frame->src[2]+(size_t)uv_row*frame->src_stride[1],
+				frame->src_stride[0], frame->src_stride[1],
+				frame->dst[0]+(size_t)row_begin*frame->dst_stride[0], frame->dst_stride[0], frame->yuv_type);
+			break;
+		case KERNEL_YUVSP2RGB:
+			kernel->function.yuvsp2rgb(frame->width, height,
+				frame->src[0]+(size_t)row_begin*frame->src_stride[0],
+				frame->src[1]+(size_t)uv_row*frame->src_stride[1],
+				frame->src_stride[0], frame->src_stride[1],
+				frame->dst[0]+(size_t)row_begin*frame->dst_stride[0], frame->dst_stride[0], frame->yuv_type);
+			break;
+		case KERNEL_RGB2YUV:
+			kernel->function.rgb2yuv(frame->width, height,
+				frame->src[0]+(size_t)row_begin*frame->src_stride[0], frame->src_stride[0],
+				frame->dst[0]+(size_t)row_begin*frame->dst_stride[0],
+				frame->dst[1]+(size_t)uv_row*frame->dst_stride[1],
+				frame->dst[2]+(size_t)uv_row*frame->dst_stride[1],
+				frame->dst_stride[0], frame->dst_stride[1], frame->yuv_type);
+			break;
+		case KERNEL_YUV2YUVSP:
+			kernel->function.yuv2yuvsp(frame->width, height,
+				frame->src[0]+(size_t)row_begin*frame->src_stride[0],
+				frame->src[1]+(size_t)uv_row*frame->src_stride[1],
+				frame->src[2]+(size_t)uv_row*frame->src_stride[1],
+				frame->src_stride[0], frame->src_stride[1],
+				frame->dst[0] ? frame->dst[0]+(size_t)row_begin*frame->dst_stride[0] : NULL,
+				frame->dst[1]+(size_t)uv_row*frame->dst_stride[1],
+				frame->dst_stride[0], frame->dst_stride[1]);
+			break;
+		case KERNEL_YUVSP2YUV:
+			kernel->function.yuvsp2yuv(frame->width, height,
+				frame->src[0]+(size_t)row_begin*frame->src_stride[0],
+				frame->src[1]+(size_t)uv_row*frame->src_stride[1],
+				frame->src_stride[0], frame->src_stride[1],
+				frame->dst[0] ? frame->dst[0]+(size_t)row_begin*frame->dst_stride[0] : NULL,
+				frame->dst[1]+(size_t)uv_row*frame->dst_stride[1],
+				frame->dst[2]+(size_t)uv_row*frame->dst_stride[1],
+				frame->dst_stride[0], frame->dst_stride[1]);
+			break;
+		case KERNEL_YUVSP2YUVSP:
+			kernel->function.yuvsp2yuvsp(frame->width, height,
+				frame->src[0]+(size_t)row_begin*frame->src_stride[0],
+				frame->src[1]+(size_t)uv_row*frame->src_stride[1],
+				frame->src_stride[0], frame->src_stride[1],
+				frame->dst[0] ? frame->dst[0]+(size_t)row_begin*frame->dst_stride[0] : NULL,
+				frame->dst[1]+(size_t)uv_row*frame->dst_stride[1],
+				frame->dst_stride[0], frame->dst_stride[1]);
+			break;
+		case KERNEL_RGB2RGBA:
+			kernel->function.rgb2rgba(frame->width, height,
+				frame->src[0]+(size_t)row_begin*frame->src_stride[0], frame->src_stride[0],
+				frame->dst[0]+(size_t)row_begin*frame->dst_stride[0], frame->dst_stride[0], 255);
+			break;
+		case KERNEL_RGBA2RGB:
+			kernel->function.rgba2rgb(frame->width, height,
+				frame->src[0]+(size_t)row_begin*frame->src_stride[0], frame->src_stride[0],
+				frame->dst[0]+(size_t)row_begin*frame->dst_stride[0], frame->dst_stride[0]);
+			break;
+	}
+#ifdef USE_STATS
+	stats_end(&probe, kernel, frame, height);
+#endif
+}
+
+static int convert_rows_with(const BatchFrame *frame, uint32_t row_begin, uint32_t row_end, int non_temporal)
+{
+	SelectedKernel kernel;
+	if(select_kernel(frame, non_temporal, &kernel)!=0)
+		return -1;
+	run_kernel(&kernel, frame, row_begin, row_end);
+	return 0;
+}
+
+int convert_rows(const BatchFrame *frame, uint32_t row_begin, uint32_t row_end)
+{
+	return convert_rows_with(frame, row_begin, row_end, 1);
+}
+
+int convert_rows_cached(const BatchFrame *frame, uint32_t row_begin, uint32_t row_end)
+{
+	return convert_rows_with(frame, row_begin, row_end, 0);
+}
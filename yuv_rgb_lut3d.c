@@ -0,0 +1,234 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+#include "yuv_rgb_lut3d.h"
+#include "yuv_rgb_private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _YUVRGB_SSE2_
+#include <emmintrin.h>
+#endif
+
+// size of the bands of lut3d_convert, so that a converted band is still in L1 cache when it is graded
+#define BAND_SIZE (16*1024)
+
+struct Lut3D
+{
+	uint32_t size;
+	Lut3DInterpolation interpolation;
+	// for each 8 bits value of each component, offset of the first corner of its cell in the table, and
+	// weight of the second corner, in [0:256]
+	uint32_t offset[3][256];
+	uint16_t weight[256];
+	// offset of the next entry along each axis
+	uint32_t step[3];
+	// rgb values of each entry, rescaled to [0:255] with 7 fractional bits, padded to 4 values
+	uint16_t *table;
+};
+
+Lut3D *lut3d_create(uint32_t size, const uint16_t *table, Lut3DInterpolation interpolation)
+{
+	if(size<2 || size>256)
+		return NULL;
+	Lut3D *lut = malloc(sizeof(Lut3D));
+	if(!lut)
+		return NULL;
+	const size_t entries = (size_t)size*size*size;
+	lut->table = malloc(entries*4*sizeof(uint16_t));
+	if(!lut->table)
+	{
+		free(lut);
+		return NULL;
+	}
+	lut->size = size;
+	lut->interpolation = interpolation;
+	lut->step[0] = 4;
+	lut->step[1] = 4*size;
+	lut->step[2] = 4*size*size;
+	for(uint32_t value=0; value<256; ++value)
+	{
+		// position of value in the cube is value*(size-1)/255, the last value is on the last point, it uses
+		// the last cell with a weight of 256
+		const uint32_t position = value*(size-1);
+		uint32_t index = position/255, weight = ((position%255)*256 + 127)/255;
+		if(index==size-1)
+		{
+			index = size-2;
+			weight = 256;
+		}
+		for(uint32_t axis=0; axis<3; ++axis)
+			lut->offset[axis][value] = index*lut->step[axis];
+		lut->weight[value] = weight;
+	}
+	for(size_t i=0; i<entries; ++i)
+	{
+		for(uint32_t c=0; c<3; ++c)
+			lut->table[4*i+c] = ((uint32_t)table[3*i+c]*255*128 + 32767)/65535;
+		lut->table[4*i+3] = 0;
+	}
+	return lut;
+}
+
+void lut3d_destroy(Lut3D *lut)
+{
+	if(!lut)
+		return;
+	free(lut->table);
+	free(lut);
+}
+
+#ifdef _YUVRGB_SSE2_
+// load the rgb values of two entries, interleaved for _mm_madd_epi16
+#define LOAD_ENTRIES(C1, C2) \
+	_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(C1)), _mm_loadl_epi64((const __m128i*)(C2)))
+// pack two weights, the first one applies to the first entry of each pair
+#define WEIGHTS(W1, W2) _mm_set1_epi32((int)((W1)|((W2)<<16)))
+// interleave two sums of 15 bits for _mm_madd_epi16
+#define INTERLEAVE_SUMS(S1, S2) _mm_or_si128(S1, _mm_slli_epi32(S2, 16))
+
+static void save_rgb(uint8_t *rgb, __m128i rgb_32)
+{
+	const __m128i rgb_8 = _mm_packus_epi16(_mm_packs_epi32(rgb_32, rgb_32), rgb_32);
+	const uint32_t value = (uint32_t)_mm_cvtsi128_si32(rgb_8);
+	memcpy(rgb, &value, 3);
+}
+#endif
+
+// The four corners of the tetrahedron that contains the color are the first corner of the cell, the last
+// one, and the corners reached by moving along the axis of the largest weight, then of the second one.
+// Weights of the corners are differences of sorted weights, so that they sum to 256.
+static void grade_tetrahedral(const Lut3D *lut, uint32_t width, uint8_t *rgb)
+{
+	// local copies, since stores to rgb could alias the lut
+	const uint32_t dr=lut->step[0], dg=lut->step[1], db=lut->step[2];
+	const uint16_t *table = lut->table, *weight = lut->weight;
+	const uint32_t (*offset)[256] = lut->offset;
+	for(uint32_t x=0; x<width; ++x, rgb+=3)
+	{
+		const uint8_t r=rgb[0], g=rgb[1], b=rgb[2];
+		const uint16_t *c = table + offset[0][r] + offset[1][g] + offset[2][b];
+		const uint32_t fr=weight[r], fg=weight[g], fb=weight[b];
+		uint32_t c1, c2, w0, w1, w2, w3;
+		if(fr>=fg)
+		{
+			if(fg>=fb)
+			{
+				c1 = dr; c2 = dr+dg; w0 = 256-fr; w1 = fr-fg; w2 = fg-fb; w3 = fb;
+			}
+			else if(fr>=fb)
+			{
+				c1 = dr; c2 = dr+db; w0 = 256-fr; w1 = fr-fb; w2 = fb-fg; w3 = fg;
+			}
+			else
+			{
+				c1 = db; c2 = db+dr; w0 = 256-fb; w1 = fb-fr; w2 = fr-fg; w3 = fg;
+			}
+		}
+		else
+		{
+			if(fb>=fg)
+			{
+				c1 = db; c2 = db+dg; w0 = 256-fb; w1 = fb-fg; w2 = fg-fr; w3 = fr;
+			}
+			else if(fb>=fr)
+			{
+				c1 = dg; c2 = dg+db; w0 = 256-fg; w1 = fg-fb; w2 = fb-fr; w3 = fr;
+			}
+			else
+			{
+				c1 = dg; c2 = dg+dr; w0 = 256-fg; w1 = fg-fr; w2 = fr-fb; w3 = fb;
+			}
+		}
+		const uint32_t c3 = dr+dg+db;
+#ifdef _YUVRGB_SSE2_
+		__m128i sum = _mm_add_epi32(_mm_madd_epi16(LOAD_ENTRIES(c, c+c1), WEIGHTS(w0, w1)), 
+			_mm_madd_epi16(LOAD_ENTRIES(c+c2, c+c3), WEIGHTS(w2, w3)));
+		save_rgb(rgb, _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1<<14)), 15));
+#else
+		uint8_t result[3];
+		for(uint32_t i=0; i<3; ++i)
+			result[i] = (c[i]*w0 + c[c1+i]*w1 + c[c2+i]*w2 + c[c3+i]*w3 + (1<<14))>>15;
+		memcpy(rgb, result, 3);
+#endif
+	}
+}
+
+// Interpolation along red, then green, then blue, rounded to 7 fractional bits after each step, so that
+// all intermediate values fit in 16 bits signed integers for _mm_madd_epi16
+static void grade_trilinear(const Lut3D *lut, uint32_t width, uint8_t *rgb)
+{
+	// local copies, since stores to rgb could alias the lut
+	const uint32_t dr=lut->step[0], dg=lut->step[1], db=lut->step[2];
+	const uint16_t *table = lut->table, *weight = lut->weight;
+	const uint32_t (*offset)[256] = lut->offset;
+	for(uint32_t x=0; x<width; ++x, rgb+=3)
+	{
+		const uint8_t r=rgb[0], g=rgb[1], b=rgb[2];
+		const uint16_t *c = table + offset[0][r] + offset[1][g] + offset[2][b];
+		const uint32_t fr=weight[r], fg=weight[g], fb=weight[b];
+#ifdef _YUVRGB_SSE2_
+		const __m128i wr = WEIGHTS(256-fr, fr), round = _mm_set1_epi32(128);
+		__m128i x00 = _mm_madd_epi16(LOAD_ENTRIES(c, c+dr), wr), 
+			x10 = _mm_madd_epi16(LOAD_ENTRIES(c+dg, c+dg+dr), wr), 
+			x01 = _mm_madd_epi16(LOAD_ENTRIES(c+db, c+db+dr), wr), 
+			x11 = _mm_madd_epi16(LOAD_ENTRIES(c+db+dg, c+db+dg+dr), wr);
+		x00 = _mm_srli_epi32(_mm_add_epi32(x00, round), 8);
+		x10 = _mm_srli_epi32(_mm_add_epi32(x10, round), 8);
+		x01 = _mm_srli_epi32(_mm_add_epi32(x01, round), 8);
+		x11 = _mm_srli_epi32(_mm_add_epi32(x11, round), 8);
+		__m128i y0 = _mm_madd_epi16(INTERLEAVE_SUMS(x00, x10), WEIGHTS(256-fg, fg)), 
+			y1 = _mm_madd_epi16(INTERLEAVE_SUMS(x01, x11), WEIGHTS(256-fg, fg));
+		y0 = _mm_srli_epi32(_mm_add_epi32(y0, round), 8);
+		y1 = _mm_srli_epi32(_mm_add_epi32(y1, round), 8);
+		const __m128i sum = _mm_madd_epi16(INTERLEAVE_SUMS(y0, y1), WEIGHTS(256-fb, fb));
+		save_rgb(rgb, _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1<<14)), 15));
+#else
+		uint8_t result[3];
+		for(uint32_t i=0; i<3; ++i)
+		{
+			const uint32_t x00 = (c[i]*(256-fr) + c[dr+i]*fr + 128)>>8,
+				x10 = (c[dg+i]*(256-fr) + c[dg+dr+i]*fr + 128)>>8,
+				x01 = (c[db+i]*(256-fr) + c[db+dr+i]*fr + 128)>>8,
+				x11 = (c[db+dg+i]*(256-fr) + c[db+dg+dr+i]*fr + 128)>>8;
+			const uint32_t y0 = (x00*(256-fg) + x10*fg + 128)>>8,
+				y1 = (x01*(256-fg) + x11*fg + 128)>>8;
+			result[i] = (y0*(256-fb) + y1*fb + (1<<14))>>15;
+		}
+		memcpy(rgb, result, 3);
+#endif
+	}
+}
+
+void lut3d_apply_rgb24(const Lut3D *lut, uint32_t width, uint32_t height, uint8_t *rgb, uint32_t rgb_stride)
+{
+	for(uint32_t y=0; y<height; ++y)
+	{
+		if(lut->interpolation==LUT3D_TETRAHEDRAL)
+			grade_tetrahedral(lut, width, rgb+(size_t)y*rgb_stride);
+		else
+			grade_trilinear(lut, width, rgb+(size_t)y*rgb_stride);
+	}
+}
+
+int lut3d_convert(const Lut3D *lut, const BatchFrame *frame)
+{
+	// only yuv sources, rgb32 to rgb24 is also a conversion of the dispatcher, but not a yuv one
+	if((frame->src_format!=PIXEL_FORMAT_YUV420 && frame->src_format!=PIXEL_FORMAT_NV12 &&
+		frame->src_format!=PIXEL_FORMAT_NV21) || frame->dst_format!=PIXEL_FORMAT_RGB24 || !is_supported(frame))
+		return -1;
+
+	// as for all conversions, the last line and column of odd sizes are not converted, so they are not graded
+	const uint32_t width = frame->width&~1u, height = frame->height&~1u;
+	uint32_t band_lines = (BAND_SIZE/(frame->width*3+1))&~1u;
+	if(band_lines<2)
+		band_lines = 2;
+	for(uint32_t row=0; row<height; row+=band_lines)
+	{
+		const uint32_t end = row+band_lines<height ? row+band_lines : height;
+		convert_rows_cached(frame, row, end);
+		lut3d_apply_rgb24(lut, width, end-row, frame->dst[0]+(size_t)row*frame->dst_stride[0], frame->dst_stride[0]);
+	}
+	return 0;
+}
@@ -0,0 +1,53 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// Color grading with a 3D lookup table, fused with the yuv to rgb conversion
+
+// A Lut3D is a cube of size x size x size rgb values, that maps each rgb color to a graded color,
+// colors between the points of the cube being interpolated (trilinear or tetrahedral interpolation).
+// lut3d_convert converts a yuv frame to rgb24 by bands of a few lines, and grades each band right after
+// its conversion, while it is still in cache, so that graded rgb comes out of a single pass over the
+// source planes and the destination, instead of a conversion and a separate grading pass.
+// Lookups are scalar (sse2 has no gather), with the positions and interpolation weights of each 8 bits
+// value prepared when the lut is created.
+
+#ifndef YUV_RGB_LUT3D_H
+#define YUV_RGB_LUT3D_H
+
+#include "yuv_rgb.h"
+#include "yuv_rgb_batch.h"
+
+typedef enum
+{
+	LUT3D_TRILINEAR,   // weighted mean of the 8 corners of the cell
+	LUT3D_TETRAHEDRAL  // weighted mean of the 4 corners of the tetrahedron of the cell, sharper on the gray axis
+} Lut3DInterpolation;
+
+typedef struct Lut3D Lut3D;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// create a lut from size^3 rgb values in [0:65535], with the red index varying fastest, then green, then
+// blue (order of .cube files), the table is copied
+// size must be in [2:256], typical sizes are 17, 33 and 65
+// return NULL on failure (invalid size or out of memory)
+Lut3D *lut3d_create(uint32_t size, const uint16_t *table, Lut3DInterpolation interpolation);
+
+void lut3d_destroy(Lut3D *lut);
+
+// grade an rgb24 image in place
+void lut3d_apply_rgb24(const Lut3D *lut, uint32_t width, uint32_t height, uint8_t *rgb, uint32_t rgb_stride);
+
+// convert a yuv420, nv12 or nv21 frame to rgb24 and grade it, the frame is described as for batch_convert
+// (see yuv_rgb_batch.h), and the result is the one of batch_convert followed by lut3d_apply_rgb24
+// as for all conversions, the last column and line of odd sizes are not converted, and not graded either
+// return -1 if the conversion is not supported (source must be yuv420, nv12 or nv21, destination rgb24)
+int lut3d_convert(const Lut3D *lut, const BatchFrame *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YUV_RGB_LUT3D_H
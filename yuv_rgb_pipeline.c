@@ -0,0 +1,292 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "yuv_rgb_pipeline.h"
+#include "yuv_rgb_alloc.h"
+#include "yuv_rgb_private.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+// size of a cache line, used to avoid false sharing between producer and consumer
+#define CACHE_LINE 64
+
+// Ring
+
+typedef struct
+{
+	uint32_t sequence;  // only used in mpmc mode
+	void *item;
+} Cell;
+
+struct FrameRing
+{
+	Cell *cells;
+	uint32_t mask;
+	RingMode mode;
+	char padding1[CACHE_LINE];
+	uint32_t head;      // next position to push
+	char padding2[CACHE_LINE-sizeof(uint32_t)];
+	uint32_t tail;      // next position to pop
+	char padding3[CACHE_LINE-sizeof(uint32_t)];
+};
+
+FrameRing *frame_ring_create(uint32_t capacity, RingMode mode)
+{
+	uint32_t size = 1;
+	while(size<capacity)
+		size <<= 1;
+
+	FrameRing *ring = NULL;
+	if(posix_memalign((void **)&ring, CACHE_LINE, sizeof(FrameRing))!=0)
+		return NULL;
+	memset(ring, 0, sizeof(FrameRing));
+	ring->cells = calloc(size, sizeof(Cell));
+	if(!ring->cells)
+	{
+		free(ring);
+		return NULL;
+	}
+	ring->mask = size-1;
+	ring->mode = mode;
+	for(uint32_t i=0; i<size; ++i)
+		ring->cells[i].sequence = i;
+	return ring;
+}
+
+void frame_ring_destroy(FrameRing *ring)
+{
+	if(!ring)
+		return;
+	free(ring->cells);
+	free(ring);
+}
+
+int frame_ring_push(FrameRing *ring, void *item)
+{
+	if(ring->mode==RING_SPSC)
+	{
+		const uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+		const uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		if(head-tail>ring->mask)
+			return -1;
+		ring->cells[head&ring->mask].item = item;
+		__atomic_store_n(&ring->head, head+1, __ATOMIC_RELEASE);
+		return 0;
+	}
+
+	// a cell is free for position pos when its sequence is pos
+	uint32_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	Cell *cell;
+	for(;;)
+	{
+		cell = &ring->cells[pos&ring->mask];
+		const uint32_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+		const int32_t diff = (int32_t)(sequence-pos);
+		if(diff==0)
+		{
+			if(__atomic_compare_exchange_n(&ring->head, &pos, pos+1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if(diff<0)
+			return -1;
+		else
+			pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	}
+	cell->item = item;
+	__atomic_store_n(&cell->sequence, pos+1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+void *frame_ring_pop(FrameRing *ring)
+{
+	if(ring->mode==RING_SPSC)
+	{
+		const uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		const uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		if(head==tail)
+			return NULL;
+		void *item = ring->cells[tail&ring->mask].item;
+		__atomic_store_n(&ring->tail, tail+1, __ATOMIC_RELEASE);
+		return item;
+	}
+
+	// a cell is ready for position pos when its sequence is pos+1
+	uint32_t pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	Cell *cell;
+	for(;;)
+	{
+		cell = &ring->cells[pos&ring->mask];
+		const uint32_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+		const int32_t diff = (int32_t)(sequence-(pos+1));
+		if(diff==0)
+		{
+			if(__atomic_compare_exchange_n(&ring->tail, &pos, pos+1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if(diff<0)
+			return NULL;
+		else
+			pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	}
+	void *item = cell->item;
+	__atomic_store_n(&cell->sequence, pos+ring->mask+1, __ATOMIC_RELEASE);
+	return item;
+}
+
+// Pipeline
+
+struct Pipeline
+{
+	FrameSlot *slots;
+	FrameBuffer *buffers;    // src and dst images of each slot
+	uint32_t slot_number;
+	FrameRing *free_slots;   // consumers -> producers
+	FrameRing *input;        // producers -> converters
+	FrameRing *output;       // converters -> consumers
+	int closed;
+};
+
+// allocate the src and dst images of a slot
+static int alloc_slot(FrameSlot *slot, FrameBuffer buffers[2], uint32_t width, uint32_t height,
+	PixelFormat src_format, PixelFormat dst_format, YCbCrType yuv_type)
+{
+	if(frame_buffer_alloc(&buffers[0], src_format, width, height, 0)!=0)
+		return -1;
+	if(frame_buffer_alloc(&buffers[1], dst_format, width, height, 0)!=0)
+	{
+		frame_buffer_free(&buffers[0]);
+		return -1;
+	}
+
+	memset(slot, 0, sizeof(FrameSlot));
+	BatchFrame *frame = &slot->frame;
+	frame->width = width;
+	frame->height = height;
+	frame->src_format = src_format;
+	frame->dst_format = dst_format;
+	frame->yuv_type = yuv_type;
+	for(uint32_t p=0; p<buffers[0].plane_number; ++p)
+	{
+		frame->src[p] = buffers[0].plane[p];
+		frame->src_stride[p] = buffers[0].stride[p];
+	}
+	for(uint32_t p=0; p<buffers[1].plane_number; ++p)
+	{
+		frame->dst[p] = buffers[1].plane[p];
+		frame->dst_stride[p] = buffers[1].stride[p];
+	}
+	return 0;
+}
+
+Pipeline *pipeline_create(uint32_t slot_number, uint32_t width, uint32_t height,
+	PixelFormat src_format, PixelFormat dst_format, YCbCrType yuv_type,
+	RingMode producers, uint32_t converters, RingMode consumers)
+{
+	// slots are converted by convert_rows, so any conversion of the dispatcher is accepted
+	BatchFrame format;
+	memset(&format, 0, sizeof(format));
+	format.src_format = src_format;
+	format.dst_format = dst_format;
+	if(slot_number==0 || !is_supported(&format))
+		return NULL;
+
+	Pipeline *pipeline = calloc(1, sizeof(Pipeline));
+	if(!pipeline)
+		return NULL;
+	pipeline->slots = calloc(slot_number, sizeof(FrameSlot));
+	pipeline->buffers = calloc(2*(size_t)slot_number, sizeof(FrameBuffer));
+	// rings can hold all slots, so that a push never fails
+	pipeline->free_slots = frame_ring_create(slot_number,
+		(producers==RING_SPSC && consumers==RING_SPSC) ? RING_SPSC : RING_MPMC);
+	pipeline->input = frame_ring_create(slot_number,
+		(producers==RING_SPSC && converters<=1) ? RING_SPSC : RING_MPMC);
+	pipeline->output = frame_ring_create(slot_number,
+		(converters<=1 && consumers==RING_SPSC) ? RING_SPSC : RING_MPMC);
+	if(!pipeline->slots || !pipeline->buffers || !pipeline->free_slots || !pipeline->input || !pipeline->output)
+	{
+		pipeline_destroy(pipeline);
+		return NULL;
+	}
+	pipeline->slot_number = slot_number;
+	for(uint32_t i=0; i<slot_number; ++i)
+	{
+		if(alloc_slot(&pipeline->slots[i], &pipeline->buffers[2*i], width, height, src_format, dst_format, yuv_type)!=0)
+		{
+			pipeline_destroy(pipeline);
+			return NULL;
+		}
+		frame_ring_push(pipeline->free_slots, &pipeline->slots[i]);
+	}
+	return pipeline;
+}
+
+void pipeline_destroy(Pipeline *pipeline)
+{
+	if(!pipeline)
+		return;
+	if(pipeline->buffers)
+		for(uint32_t i=0; i<2*pipeline->slot_number; ++i)
+			frame_buffer_free(&pipeline->buffers[i]);
+	free(pipeline->buffers);
+	free(pipeline->slots);
+	frame_ring_destroy(pipeline->free_slots);
+	frame_ring_destroy(pipeline->input);
+	frame_ring_destroy(pipeline->output);
+	free(pipeline);
+}
+
+FrameSlot *pipeline_acquire(Pipeline *pipeline)
+{
+	return (FrameSlot *)frame_ring_pop(pipeline->free_slots);
+}
+
+void pipeline_submit(Pipeline *pipeline, FrameSlot *slot)
+{
+	frame_ring_push(pipeline->input, slot);
+}
+
+int pipeline_convert(Pipeline *pipeline)
+{
+	FrameSlot *slot = (FrameSlot *)frame_ring_pop(pipeline->input);
+	if(!slot)
+		return 0;
+	convert_rows(&slot->frame, 0, slot->frame.height);
+	frame_ring_push(pipeline->output, slot);
+	return 1;
+}
+
+void pipeline_convert_loop(Pipeline *pipeline)
+{
+	for(;;)
+	{
+		if(pipeline_convert(pipeline))
+			continue;
+		// slots submitted before pipeline_close are visible once closed is seen
+		if(__atomic_load_n(&pipeline->closed, __ATOMIC_ACQUIRE))
+		{
+			while(pipeline_convert(pipeline))
+				;
+			return;
+		}
+		sched_yield();
+	}
+}
+
+void pipeline_close(Pipeline *pipeline)
+{
+	__atomic_store_n(&pipeline->closed, 1, __ATOMIC_RELEASE);
+}
+
+FrameSlot *pipeline_receive(Pipeline *pipeline)
+{
+	return (FrameSlot *)frame_ring_pop(pipeline->output);
+}
+
+void pipeline_release(Pipeline *pipeline, FrameSlot *slot)
+{
+	frame_ring_push(pipeline->free_slots, slot);
+}
@@ -0,0 +1,97 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// Lock free pipeline to pass frames between decoding, conversion and consuming threads
+
+// FrameRing is a bounded lock free queue of pointers. In single producer single consumer mode, push
+// and pop are a few loads and stores, in multiple producers multiple consumers mode they use one
+// compare and swap each (see Dmitry Vyukov's bounded mpmc queue).
+//
+// Pipeline owns a fixed number of preallocated frame slots, each with a source and a destination
+// image, and passes them between three rings:
+//   producer:  pipeline_acquire -> fill source image -> pipeline_submit
+//   converter: pipeline_convert (or pipeline_convert_loop in a dedicated thread)
+//   consumer:  pipeline_receive -> read destination image -> pipeline_release
+// Frames flow between stages without any allocation or lock. Functions never block: they return
+// NULL or 0 when nothing is available, and the caller decides how to wait (spin, yield, sleep...).
+
+#ifndef YUV_RGB_PIPELINE_H
+#define YUV_RGB_PIPELINE_H
+
+#include "yuv_rgb.h"
+#include "yuv_rgb_batch.h"
+
+typedef enum
+{
+	RING_SPSC,  // single producer, single consumer
+	RING_MPMC   // multiple producers, multiple consumers
+} RingMode;
+
+typedef struct FrameRing FrameRing;
+
+// a frame slot of a pipeline
+// frame describes the preallocated source and destination images, with all strides aligned
+// so that aligned kernels are used, user_data is free for the application (timestamp, ...)
+typedef struct
+{
+	BatchFrame frame;
+	void *user_data;
+} FrameSlot;
+
+typedef struct Pipeline Pipeline;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// create a ring, capacity is rounded up to a power of two
+// return NULL on failure
+FrameRing *frame_ring_create(uint32_t capacity, RingMode mode);
+
+void frame_ring_destroy(FrameRing *ring);
+
+// add an item (that must not be NULL) to the ring, return 0 on success, -1 if the ring is full
+int frame_ring_push(FrameRing *ring, void *item);
+
+// remove the oldest item from the ring, return NULL if the ring is empty
+void *frame_ring_pop(FrameRing *ring);
+
+// create a pipeline with slot_number preallocated slots of the given geometry and formats
+// producers and consumers give the mode of the input and output rings, converters is the
+// number of threads that will call pipeline_convert
+// return NULL on failure (unsupported conversion or out of memory)
+Pipeline *pipeline_create(uint32_t slot_number, uint32_t width, uint32_t height,
+	PixelFormat src_format, PixelFormat dst_format, YCbCrType yuv_type,
+	RingMode producers, uint32_t converters, RingMode consumers);
+
+// release all slots and rings, no other thread must use the pipeline anymore
+void pipeline_destroy(Pipeline *pipeline);
+
+// producer side: get a free slot, return NULL if all slots are in use
+FrameSlot *pipeline_acquire(Pipeline *pipeline);
+
+// producer side: send a slot with a filled source image to conversion
+void pipeline_submit(Pipeline *pipeline, FrameSlot *slot);
+
+// converter side: convert one submitted slot, if any, and send it to consumers
+// return 1 if a slot was converted, 0 if there was nothing to convert
+int pipeline_convert(Pipeline *pipeline);
+
+// converter side: convert slots until pipeline_close is called and all submitted slots are converted
+// yields the cpu when there is nothing to convert
+void pipeline_convert_loop(Pipeline *pipeline);
+
+// stop pipeline_convert_loop once all submitted slots are converted
+void pipeline_close(Pipeline *pipeline);
+
+// consumer side: get a converted slot, return NULL if none is available
+FrameSlot *pipeline_receive(Pipeline *pipeline);
+
+// consumer side: give a slot back to producers once its destination image is not needed anymore
+void pipeline_release(Pipeline *pipeline, FrameSlot *slot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YUV_RGB_PIPELINE_H
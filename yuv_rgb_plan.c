@@ -0,0 +1,510 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "yuv_rgb_plan.h"
+#include "yuv_rgb_private.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// default number of pixels of a band, large enough to make scheduling cost negligible,
+// small enough to get a good load balancing
+#define BAND_PIXELS (64*1024)
+
+// number of measures of each candidate during tuning, the fastest one is kept
+#define TUNING_RUNS 3
+
+// parameters of a plan, selected by tuning and stored in the wisdom
+typedef struct
+{
+	KernelVariant variant;
+	uint32_t band_lines;
+	uint32_t thread_number;
+} PlanConfig;
+
+struct Plan
+{
+	BatchFrame frame;          // geometry and formats of the frames
+	SelectedKernel kernel;
+	SelectedKernel fallback;   // unaligned kernel, for frames that are not aligned as the descriptors
+	uint32_t band_lines;
+	uint32_t band_number;
+	uint32_t thread_number;    // number of threads used, can be lower than the size of a shared pool
+	ThreadPool *pool;          // NULL for single thread plans
+	int own_pool;
+};
+
+void plan_options_init(PlanOptions *options)
+{
+	options->flags = 0;
+	options->thread_number = 1;
+	options->pool = NULL;
+	options->band_lines = 0;
+}
+
+static void yuv_rgb_frame(BatchFrame *frame, const YUVFrame *src, const RGBFrame *dst)
+{
+	frame->width = src->width;
+	frame->height = src->height;
+	frame->src_format = src->format;
+	frame->src[0] = src->y;
+	frame->src[1] = src->u;
+	frame->src[2] = src->v;
+	frame->src_stride[0] = src->y_stride;
+	frame->src_stride[1] = frame->src_stride[2] = src->uv_stride;
+	frame->dst_format = dst->format;
+	frame->dst[0] = dst->pixels;
+	frame->dst[1] = frame->dst[2] = NULL;
+	frame->dst_stride[0] = dst->stride;
+	frame->dst_stride[1] = frame->dst_stride[2] = 0;
+	frame->yuv_type = src->yuv_type;
+}
+
+static void rgb_yuv_frame(BatchFrame *frame, const RGBFrame *src, const YUVFrame *dst)
+{
+	frame->width = src->width;
+	frame->height = src->height;
+	frame->src_format = src->format;
+	frame->src[0] = src->pixels;
+	frame->src[1] = frame->src[2] = NULL;
+	frame->src_stride[0] = src->stride;
+	frame->src_stride[1] = frame->src_stride[2] = 0;
+	frame->dst_format = dst->format;
+	frame->dst[0] = dst->y;
+	frame->dst[1] = dst->u;
+	frame->dst[2] = dst->v;
+	frame->dst_stride[0] = dst->y_stride;
+	frame->dst_stride[1] = frame->dst_stride[2] = dst->uv_stride;
+	frame->yuv_type = dst->yuv_type;
+}
+
+// Execution
+
+typedef struct
+{
+	const Plan *plan;
+	const BatchFrame *frame;
+	const SelectedKernel *kernel;
+	uint32_t next_band;
+} PlanJob;
+
+static void plan_worker(void *arg, uint32_t worker)
+{
+	PlanJob *job = (PlanJob *)arg;
+	const Plan *plan = job->plan;
+	if(worker>=plan->thread_number)
+		return;
+	for(;;)
+	{
+		const uint32_t band = __atomic_fetch_add(&job->next_band, 1, __ATOMIC_RELAXED);
+		if(band>=plan->band_number)
+			break;
+		const uint32_t row_begin = band*plan->band_lines;
+		const uint32_t row_end = row_begin+plan->band_lines<plan->frame.height ? row_begin+plan->band_lines : plan->frame.height;
+		run_kernel(job->kernel, job->frame, row_begin, row_end);
+	}
+}
+
+static void plan_run(const Plan *plan, const BatchFrame *frame, const SelectedKernel *kernel)
+{
+	if(!plan->pool || plan->thread_number<=1 || plan->band_number==1)
+	{
+		run_kernel(kernel, frame, 0, frame->height);
+		return;
+	}
+	PlanJob job = {plan, frame, kernel, 0};
+	thread_pool_run(plan->pool, plan_worker, &job);
+}
+
+static int plan_execute(const Plan *plan, const BatchFrame *frame)
+{
+	const BatchFrame *reference = &plan->frame;
+	if(frame->width!=reference->width || frame->height!=reference->height ||
+		frame->src_format!=reference->src_format || frame->dst_format!=reference->dst_format ||
+		frame->yuv_type!=reference->yuv_type)
+		return -1;
+	if(frame->height==0)
+		return 0;
+
+	plan_run(plan, frame, (!plan->kernel.aligned || is_aligned(frame)) ? &plan->kernel : &plan->fallback);
+	return 0;
+}
+
+int plan_execute_yuv_rgb(const Plan *plan, const YUVFrame *src, const RGBFrame *dst)
+{
+	if(src->width!=dst->width || src->height!=dst->height)
+		return -1;
+	BatchFrame frame;
+	yuv_rgb_frame(&frame, src, dst);
+	return plan_execute(plan, &frame);
+}
+
+int plan_execute_rgb_yuv(const Plan *plan, const RGBFrame *src, const YUVFrame *dst)
+{
+	if(src->width!=dst->width || src->height!=dst->height)
+		return -1;
+	BatchFrame frame;
+	rgb_yuv_frame(&frame, src, dst);
+	return plan_execute(plan, &frame);
+}
+
+// Wisdom
+
+typedef struct
+{
+	PixelFormat src_format, dst_format;
+	uint32_t width, height;
+	int aligned;
+	PlanConfig config;
+} WisdomEntry;
+
+static pthread_mutex_t wisdom_mutex = PTHREAD_MUTEX_INITIALIZER;
+static WisdomEntry *wisdom = NULL;
+static uint32_t wisdom_size = 0, wisdom_capacity = 0;
+
+static const char *const format_names[] = {"yuv420", "nv12", "nv21", "rgb24", "rgb32"};
+#define FORMAT_NUMBER (sizeof(format_names)/sizeof(format_names[0]))
+
+static int same_frames(const WisdomEntry *a, const WisdomEntry *b)
+{
+	return a->src_format==b->src_format && a->dst_format==b->dst_format &&
+		a->width==b->width && a->height==b->height && a->aligned==b->aligned;
+}
+
+// add or replace an entry, wisdom_mutex must be locked
+static int wisdom_add_locked(const WisdomEntry *entry)
+{
+	for(uint32_t i=0; i<wisdom_size; ++i)
+		if(same_frames(&wisdom[i], entry))
+		{
+			wisdom[i] = *entry;
+			return 0;
+		}
+	if(wisdom_size==wisdom_capacity)
+	{
+		const uint32_t capacity = wisdom_capacity ? 2*wisdom_capacity : 16;
+		WisdomEntry *entries = realloc(wisdom, capacity*sizeof(WisdomEntry));
+		if(!entries)
+			return -1;
+		wisdom = entries;
+		wisdom_capacity = capacity;
+	}
+	wisdom[wisdom_size++] = *entry;
+	return 0;
+}
+
+static void wisdom_add(const WisdomEntry *entry)
+{
+	pthread_mutex_lock(&wisdom_mutex);
+	wisdom_add_locked(entry);
+	pthread_mutex_unlock(&wisdom_mutex);
+}
+
+static int wisdom_find(WisdomEntry *entry)
+{
+	int found = 0;
+	pthread_mutex_lock(&wisdom_mutex);
+	for(uint32_t i=0; i<wisdom_size && !found; ++i)
+		if(same_frames(&wisdom[i], entry))
+		{
+			entry->config = wisdom[i].config;
+			found = 1;
+		}
+	pthread_mutex_unlock(&wisdom_mutex);
+	return found;
+}
+
+int plan_export_wisdom(const char *filename)
+{
+	FILE *fp = fopen(filename, "w");
+	if(!fp)
+		return -1;
+	pthread_mutex_lock(&wisdom_mutex);
+	int error = fprintf(fp, "yuv_rgb wisdom 1\n")<0;
+	for(uint32_t i=0; i<wisdom_size && !error; ++i)
+	{
+		const WisdomEntry *entry = &wisdom[i];
+		error = fprintf(fp, "%s %s %u %u %s %s %u %u\n", format_names[entry->src_format], format_names[entry->dst_format],
+			entry->width, entry->height, entry->aligned ? "aligned" : "unaligned",
+			kernel_variant_names[entry->config.variant], entry->config.band_lines, entry->config.thread_number)<0;
+	}
+	pthread_mutex_unlock(&wisdom_mutex);
+	if(fclose(fp)!=0)
+		error = 1;
+	return error ? -1 : 0;
+}
+
+static int find_name(const char *const names[], uint32_t number, const char *name)
+{
+	for(uint32_t i=0; i<number; ++i)
+		if(strcmp(names[i], name)==0)
+			return (int)i;
+	return -1;
+}
+
+int plan_import_wisdom(const char *filename)
+{
+	FILE *fp = fopen(filename, "r");
+	if(!fp)
+		return -1;
+	int version = 0;
+	if(fscanf(fp, "yuv_rgb wisdom %d", &version)!=1 || version!=1)
+	{
+		fclose(fp);
+		return -1;
+	}
+
+	// read all entries before adding them, so that nothing is loaded from an invalid file
+	WisdomEntry *entries = NULL;
+	uint32_t entry_number = 0, capacity = 0;
+	int error = 0;
+	for(;;)
+	{
+		char src[16], dst[16], alignment[16], variant[16];
+		WisdomEntry entry;
+		const int fields = fscanf(fp, "%15s %15s %u %u %15s %15s %u %u", src, dst, &entry.width, &entry.height,
+			alignment, variant, &entry.config.band_lines, &entry.config.thread_number);
+		if(fields==EOF)
+			break;
+		const int src_format = find_name(format_names, FORMAT_NUMBER, src),
+			dst_format = find_name(format_names, FORMAT_NUMBER, dst),
+			kernel_variant = find_name(kernel_variant_names, KERNEL_VARIANT_NUMBER, variant);
+		if(fields!=8 || src_format<0 || dst_format<0 || kernel_variant<0 ||
+			(strcmp(alignment, "aligned")!=0 && strcmp(alignment, "unaligned")!=0) ||
+			entry.config.band_lines==0 || entry.config.thread_number==0)
+		{
+			error = 1;
+			break;
+		}
+		entry.src_format = (PixelFormat)src_format;
+		entry.dst_format = (PixelFormat)dst_format;
+		entry.aligned = strcmp(alignment, "aligned")==0;
+		entry.config.variant = (KernelVariant)kernel_variant;
+		if(entry_number==capacity)
+		{
+			capacity = capacity ? 2*capacity : 16;
+			WisdomEntry *new_entries = realloc(entries, capacity*sizeof(WisdomEntry));
+			if(!new_entries)
+			{
+				error = 1;
+				break;
+			}
+			entries = new_entries;
+		}
+		entries[entry_number++] = entry;
+	}
+	fclose(fp);
+
+	if(!error)
+	{
+		pthread_mutex_lock(&wisdom_mutex);
+		for(uint32_t i=0; i<entry_number && !error; ++i)
+			error = wisdom_add_locked(&entries[i])!=0;
+		pthread_mutex_unlock(&wisdom_mutex);
+	}
+	free(entries);
+	return error ? -1 : 0;
+}
+
+void plan_forget_wisdom(void)
+{
+	pthread_mutex_lock(&wisdom_mutex);
+	free(wisdom);
+	wisdom = NULL;
+	wisdom_size = wisdom_capacity = 0;
+	pthread_mutex_unlock(&wisdom_mutex);
+}
+
+// Creation and tuning
+
+static void plan_set_bands(Plan *plan, uint32_t band_lines)
+{
+	// bands have an even number of lines, so that they start on a pair of lines
+	if(band_lines==0)
+		band_lines = plan->frame.width ? BAND_PIXELS/plan->frame.width : plan->frame.height;
+	plan->band_lines = band_lines<2 ? 2 : (band_lines+1)&~1u;
+	plan->band_number = (plan->frame.height+plan->band_lines-1)/plan->band_lines;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+// fastest of a few runs of the current plan configuration
+static double measure(const Plan *plan)
+{
+	double best = 0.0;
+	plan_run(plan, &plan->frame, &plan->kernel);
+	for(int run=0; run<TUNING_RUNS; ++run)
+	{
+		const double start = now();
+		plan_run(plan, &plan->frame, &plan->kernel);
+		const double time = now()-start;
+		if(run==0 || time<best)
+			best = time;
+	}
+	return best;
+}
+
+// measure kernels on a single thread, then thread numbers and band sizes with the fastest kernel
+// plan->pool must have at least max_threads threads
+static PlanConfig tune(Plan *plan, uint32_t max_threads, int non_temporal)
+{
+	PlanConfig best = {plan->kernel.variant, plan->band_lines, 1};
+	double best_time = -1.0;
+	SelectedKernel kernel;
+	if(plan->frame.height==0)
+		return best;
+
+	plan->thread_number = 1;
+	for(int variant=0; variant<KERNEL_VARIANT_NUMBER; ++variant)
+	{
+		if((variant==KERNEL_VARIANT_SSE && !non_temporal) || get_kernel(&plan->frame, (KernelVariant)variant, &kernel)!=0)
+			continue;
+		plan->kernel = kernel;
+		const double time = measure(plan);
+		if(best_time<0.0 || time<best_time)
+		{
+			best_time = time;
+			best.variant = (KernelVariant)variant;
+		}
+	}
+	get_kernel(&plan->frame, best.variant, &plan->kernel);
+
+	const uint32_t default_lines = plan->frame.width ? BAND_PIXELS/plan->frame.width : plan->frame.height;
+	for(uint32_t threads=2; max_threads>1; threads*=2)
+	{
+		if(threads>max_threads)
+			threads = max_threads;
+		const uint32_t band_lines[] = {default_lines/4, default_lines, default_lines*4,
+			(plan->frame.height+threads-1)/threads};
+		for(uint32_t b=0; b<sizeof(band_lines)/sizeof(band_lines[0]); ++b)
+		{
+			plan->thread_number = threads;
+			plan_set_bands(plan, band_lines[b]);
+			const double time = measure(plan);
+			if(time<best_time)
+			{
+				best_time = time;
+				best.thread_number = threads;
+				best.band_lines = plan->band_lines;
+			}
+		}
+		if(threads==max_threads)
+			break;
+	}
+	return best;
+}
+
+static Plan *plan_create(const BatchFrame *frame, const PlanOptions *options)
+{
+	PlanOptions default_options;
+	if(!options)
+	{
+		plan_options_init(&default_options);
+		options = &default_options;
+	}
+	const int non_temporal = !(options->flags&PLAN_CACHED_STORES);
+
+	Plan *plan = calloc(1, sizeof(Plan));
+	if(!plan)
+		return NULL;
+	plan->frame = *frame;
+	if(select_kernel(frame, non_temporal, &plan->kernel)!=0)
+	{
+		free(plan);
+		return NULL;
+	}
+	select_kernel(frame, 0, &plan->fallback);
+	plan_set_bands(plan, options->band_lines);
+
+	const int autotune = (options->flags&PLAN_AUTOTUNE)!=0;
+	if(options->pool)
+		plan->pool = options->pool;
+	else if(options->thread_number!=1 && (plan->band_number>1 || autotune))
+	{
+		plan->pool = thread_pool_create(options->thread_number);
+		plan->own_pool = 1;
+		if(!plan->pool)
+		{
+			free(plan);
+			return NULL;
+		}
+	}
+	const uint32_t max_threads = plan->pool ? thread_pool_size(plan->pool) : 1;
+	plan->thread_number = max_threads;
+
+	if(autotune)
+	{
+		WisdomEntry entry;
+		entry.src_format = frame->src_format;
+		entry.dst_format = frame->dst_format;
+		entry.width = frame->width;
+		entry.height = frame->height;
+		entry.aligned = is_aligned(frame);
+		SelectedKernel kernel;
+		// wisdom is only used if it is applicable with the current options
+		if(!wisdom_find(&entry) || get_kernel(frame, entry.config.variant, &kernel)!=0 ||
+			(kernel.aligned && !non_temporal) || entry.config.thread_number>max_threads)
+		{
+			entry.config = tune(plan, max_threads, non_temporal);
+			wisdom_add(&entry);
+		}
+		get_kernel(frame, entry.config.variant, &plan->kernel);
+		plan->thread_number = entry.config.thread_number;
+		plan_set_bands(plan, entry.config.band_lines);
+		// do not keep idle threads
+		if(plan->own_pool && plan->thread_number<max_threads)
+		{
+			thread_pool_destroy(plan->pool);
+			plan->pool = plan->thread_number>1 ? thread_pool_create(plan->thread_number) : NULL;
+			plan->own_pool = plan->pool!=NULL;
+			if(!plan->pool)
+				plan->thread_number = 1;
+		}
+	}
+
+	if(plan->pool && plan->thread_number<=1)
+	{
+		if(plan->own_pool)
+			thread_pool_destroy(plan->pool);
+		plan->pool = NULL;
+		plan->own_pool = 0;
+	}
+	return plan;
+}
+
+Plan *plan_create_yuv_rgb(const YUVFrame *src, const RGBFrame *dst, const PlanOptions *options)
+{
+	if(src->width!=dst->width || src->height!=dst->height)
+		return NULL;
+	BatchFrame frame;
+	yuv_rgb_frame(&frame, src, dst);
+	return plan_create(&frame, options);
+}
+
+Plan *plan_create_rgb_yuv(const RGBFrame *src, const YUVFrame *dst, const PlanOptions *options)
+{
+	if(src->width!=dst->width || src->height!=dst->height)
+		return NULL;
+	BatchFrame frame;
+	rgb_yuv_frame(&frame, src, dst);
+	return plan_create(&frame, options);
+}
+
+void plan_destroy(Plan *plan)
+{
+	if(!plan)
+		return;
+	if(plan->own_pool)
+		thread_pool_destroy(plan->pool);
+	free(plan);
+}
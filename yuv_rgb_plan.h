@@ -0,0 +1,99 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// Conversion plans: choose once how to convert frames of a given geometry, then convert many frames
+
+// Frames are described by YUVFrame and RGBFrame descriptors. A Plan is created from a source and a
+// destination descriptor (the pointers are only used to know their alignment), and resolves the
+// kernel, the number of threads and the size of the bands processed by each thread.
+// Executing a plan on frames with the same geometry and formats then only costs the conversion
+// itself. Frames with another alignment than the descriptors used at plan creation are accepted,
+// an unaligned kernel is used for them.
+//
+// With PLAN_AUTOTUNE, plan creation measures the available kernels, thread numbers and band sizes
+// on the descriptors frames, and keeps the fastest. Tuning results are kept in a process wide
+// wisdom, indexed by formats, geometry and alignment, so that next plans for the same frames are
+// created without tuning. The wisdom can be saved to a file and loaded by another process.
+
+#ifndef YUV_RGB_PLAN_H
+#define YUV_RGB_PLAN_H
+
+#include "yuv_rgb.h"
+#include "yuv_rgb_batch.h"
+
+// a yuv image
+// for yuv420, u and v are the chroma planes, for nv12 and nv21 u is the interleaved chroma plane
+// and v is ignored
+typedef struct
+{
+	uint32_t width, height;
+	PixelFormat format;
+	uint8_t *y, *u, *v;
+	uint32_t y_stride, uv_stride;
+	YCbCrType yuv_type;
+} YUVFrame;
+
+// a packed rgb image
+typedef struct
+{
+	uint32_t width, height;
+	PixelFormat format;
+	uint8_t *pixels;
+	uint32_t stride;
+} RGBFrame;
+
+typedef enum
+{
+	// never use non temporal stores, for results that are read right after conversion
+	PLAN_CACHED_STORES = 1,
+	// measure candidate configurations, the destination frame is overwritten during tuning
+	// thread_number (or the pool size) is the maximum number of threads
+	PLAN_AUTOTUNE = 2
+} PlanFlags;
+
+typedef struct
+{
+	uint32_t flags;           // combination of PlanFlags
+	uint32_t thread_number;   // number of threads, including the calling one, 0 for one per cpu
+	ThreadPool *pool;         // if not NULL, used instead of creating thread_number threads
+	uint32_t band_lines;      // number of lines of a task, 0 to select it automatically
+} PlanOptions;
+
+typedef struct Plan Plan;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// default options: no flag, single thread, automatic band size
+void plan_options_init(PlanOptions *options);
+
+// create a plan, options can be NULL to use default options
+// return NULL if the conversion is not supported, or on failure
+Plan *plan_create_yuv_rgb(const YUVFrame *src, const RGBFrame *dst, const PlanOptions *options);
+Plan *plan_create_rgb_yuv(const RGBFrame *src, const YUVFrame *dst, const PlanOptions *options);
+
+void plan_destroy(Plan *plan);
+
+// convert a frame with a plan created for the same geometry and formats
+// a plan can be executed from several threads, but executions of a threaded plan are serialized
+// return 0 on success, -1 if frames do not match the plan
+int plan_execute_yuv_rgb(const Plan *plan, const YUVFrame *src, const RGBFrame *dst);
+int plan_execute_rgb_yuv(const Plan *plan, const RGBFrame *src, const YUVFrame *dst);
+
+// save all tuning results to a text file
+// return 0 on success, -1 on failure
+int plan_export_wisdom(const char *filename);
+
+// load tuning results saved by plan_export_wisdom, they replace current results for the same frames
+// return 0 on success, -1 on failure (nothing is loaded if the file is invalid)
+int plan_import_wisdom(const char *filename);
+
+// forget all tuning results
+void plan_forget_wisdom(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YUV_RGB_PLAN_H
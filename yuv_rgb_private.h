@@ -0,0 +1,205 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// Internal definitions shared by the different parts of the library, not part of the public api
+
+#ifndef YUV_RGB_PRIVATE_H
+#define YUV_RGB_PRIVATE_H
+
+#ifdef _MSC_VER
+// MSVC does not have __SSE2__ macro
+  #if (defined(_M_AMD64) || defined(_M_X64) || (_M_IX86_FP == 2))
+    #define _YUVRGB_SSE2_
+  #endif
+#else
+// For everything else than MSVC
+  #ifdef __SSE2__
+    #define _YUVRGB_SSE2_
+  #endif // __SSE2__
+#endif // _MSC_VER
+
+// SSSE3 kernels are built with a target attribute and selected at runtime, so that the library still
+// runs on sse2 only cpus
+#if defined(_YUVRGB_SSE2_) && (defined(__clang__) || defined(__GNUC__))
+  #define _YUVRGB_SSSE3_
+#endif
+
+// Portable vector kernels, gcc 9 and clang have the needed vector extensions
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__>=9)
+  #define _YUVRGB_VEC_
+#endif
+
+#include "yuv_rgb_batch.h"
+
+// function run by each thread of a pool, worker is the index of the thread, from 0 (calling thread) to
+// thread_pool_size()-1
+typedef void (*PoolFunction)(void *arg, uint32_t worker);
+
+// run function on all threads of the pool, including the calling thread, and wait for the end
+void thread_pool_run(ThreadPool *pool, PoolFunction function, void *arg);
+
+// Kernel dispatch
+
+typedef void (*yuv2rgb_ptr)(
+	uint32_t width, uint32_t height,
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride,
+	uint8_t *rgb, uint32_t rgb_stride,
+	YCbCrType yuv_type);
+
+typedef void (*yuvsp2rgb_ptr)(
+	uint32_t width, uint32_t height,
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride,
+	uint8_t *rgb, uint32_t rgb_stride,
+	YCbCrType yuv_type);
+
+typedef void (*rgb2yuv_ptr)(
+	uint32_t width, uint32_t height,
+	const uint8_t *rgb, uint32_t rgb_stride,
+	uint8_t *y, uint8_t *u, uint8_t *v, uint32_t y_stride, uint32_t uv_stride,
+	YCbCrType yuv_type);
+
+// chroma layout conversions, the color space is not used
+typedef void (*yuv2yuvsp_ptr)(
+	uint32_t width, uint32_t height,
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t y_stride, uint32_t uv_stride,
+	uint8_t *y2, uint8_t *uv2, uint32_t y2_stride, uint32_t uv2_stride);
+
+typedef void (*yuvsp2yuv_ptr)(
+	uint32_t width, uint32_t height,
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride,
+	uint8_t *y2, uint8_t *u2, uint8_t *v2, uint32_t y2_stride, uint32_t uv2_stride);
+
+typedef void (*yuvsp2yuvsp_ptr)(
+	uint32_t width, uint32_t height,
+	const uint8_t *y, const uint8_t *uv, uint32_t y_stride, uint32_t uv_stride,
+	uint8_t *y2, uint8_t *uv2, uint32_t y2_stride, uint32_t uv2_stride);
+
+// packed rgb conversions, the color space is not used, and alpha is set to 255
+typedef void (*rgb2rgba_ptr)(
+	uint32_t width, uint32_t height,
+	const uint8_t *rgb, uint32_t rgb_stride,
+	uint8_t *rgba, uint32_t rgba_stride,
+	uint8_t alpha);
+
+typedef void (*rgba2rgb_ptr)(
+	uint32_t width, uint32_t height,
+	const uint8_t *rgba, uint32_t rgba_stride,
+	uint8_t *rgb, uint32_t rgb_stride);
+
+// signature of the kernels, that gives how planes of a BatchFrame are passed
+typedef enum
+{
+	KERNEL_YUV2RGB,     // planar yuv to packed rgb
+	KERNEL_YUVSP2RGB,   // semi planar yuv to packed rgb
+	KERNEL_RGB2YUV,     // packed rgb to planar yuv
+	KERNEL_YUV2YUVSP,   // planar yuv to semi planar yuv
+	KERNEL_YUVSP2YUV,   // semi planar yuv to planar yuv
+	KERNEL_YUVSP2YUVSP, // semi planar yuv to semi planar yuv
+	KERNEL_RGB2RGBA,    // packed rgb to packed rgba
+	KERNEL_RGBA2RGB     // packed rgba to packed rgb
+} KernelType;
+
+typedef union
+{
+	yuv2rgb_ptr yuv2rgb;
+	yuvsp2rgb_ptr yuvsp2rgb;
+	rgb2yuv_ptr rgb2yuv;
+	yuv2yuvsp_ptr yuv2yuvsp;
+	yuvsp2yuv_ptr yuvsp2yuv;
+	yuvsp2yuvsp_ptr yuvsp2yuvsp;
+	rgb2rgba_ptr rgb2rgba;
+	rgba2rgb_ptr rgba2rgb;
+} KernelFunction;
+
+// all implementations of a conversion, new conversions and instruction sets are added to the table
+// of yuv_rgb_dispatch.c
+typedef struct
+{
+	const char *name;
+	PixelFormat src_format, dst_format;
+	KernelType type;
+	KernelFunction std;
+	KernelFunction sse;    // aligned pointers and strides, non temporal stores, NULL if not available
+	KernelFunction sseu;   // any alignment, NULL if not available
+	KernelFunction vec;    // portable vector implementation, any alignment, NULL if not available
+	KernelFunction ssse3;  // any alignment, only used if the cpu supports ssse3, NULL if not available
+	KernelFunction lut;    // scalar implementation with lookup tables, NULL if not available
+} ConversionKernels;
+
+// implementations of a conversion
+typedef enum
+{
+	KERNEL_VARIANT_STD,
+	KERNEL_VARIANT_SSE,
+	KERNEL_VARIANT_SSEU,
+	KERNEL_VARIANT_VEC,
+	KERNEL_VARIANT_SSSE3,
+	KERNEL_VARIANT_LUT,
+	KERNEL_VARIANT_NUMBER
+} KernelVariant;
+
+// a kernel selected for a frame
+typedef struct
+{
+	const ConversionKernels *conversion;
+	KernelType type;
+	KernelFunction function;
+	KernelVariant variant;
+	int aligned;           // function requires aligned pointers and strides
+} SelectedKernel;
+
+// return the kernels of a conversion, NULL if not supported
+const ConversionKernels *find_conversion(PixelFormat src_format, PixelFormat dst_format);
+
+// number of supported conversions, and access to each of them by index
+uint32_t conversion_number(void);
+const ConversionKernels *conversion_at(uint32_t index);
+uint32_t conversion_index(const ConversionKernels *conversion);
+
+// name of each kernel variant
+extern const char *const kernel_variant_names[KERNEL_VARIANT_NUMBER];
+
+// return 1 if all planes of the frame have 16 bytes aligned pointers and strides
+int is_aligned(const BatchFrame *frame);
+
+// get a given implementation of the conversion of a frame
+// return -1 if the conversion is not supported, if the variant is not available, or if it requires
+// an alignment that the frame does not have, or an instruction set that the cpu does not support
+int get_kernel(const BatchFrame *frame, KernelVariant variant, SelectedKernel *kernel);
+
+// select the fastest kernel for a frame, depending on pointers and strides alignment
+// aligned kernels use non temporal stores, they are only selected if non_temporal is set
+// ssse3 kernels are preferred to sseu ones when the cpu supports them, the portable vector kernel is
+// used when there is no sse kernel, and the lookup table kernel when there is no vector kernel at all
+// return -1 if the conversion is not supported
+int select_kernel(const BatchFrame *frame, int non_temporal, SelectedKernel *kernel);
+
+// run a kernel on lines [row_begin, row_end) of a frame, row_begin must be even
+void run_kernel(const SelectedKernel *kernel, const BatchFrame *frame, uint32_t row_begin, uint32_t row_end);
+
+// convert lines [row_begin, row_end) of a frame, row_begin must be even
+// the kernel is selected depending on pointers and strides alignment
+// return -1 if the conversion is not supported
+int convert_rows(const BatchFrame *frame, uint32_t row_begin, uint32_t row_end);
+
+// same as convert_rows, but never use non temporal stores, so that the result stays in cache
+// to be used for data that is read right after conversion
+int convert_rows_cached(const BatchFrame *frame, uint32_t row_begin, uint32_t row_end);
+
+// return 1 if convert_rows supports the formats of the frame
+int is_supported(const BatchFrame *frame);
+
+#ifdef USE_STATS
+// Performance counters, see yuv_rgb_stats.h
+
+typedef struct
+{
+	uint64_t start;
+	uint64_t perf_start[2];
+} StatsProbe;
+
+void stats_begin(StatsProbe *probe);
+void stats_end(const StatsProbe *probe, const SelectedKernel *kernel, const BatchFrame *frame, uint32_t lines);
+#endif
+
+#endif // YUV_RGB_PRIVATE_H
@@ -0,0 +1,334 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// _DEFAULT_SOURCE is needed for syscall
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include "yuv_rgb_stats.h"
+#include "yuv_rgb_private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef USE_STATS
+
+int stats_available(void)
+{
+	return 0;
+}
+
+uint32_t stats_snapshot(StatsEntry *entries, uint32_t max_entries)
+{
+	(void)entries;
+	(void)max_entries;
+	return 0;
+}
+
+void stats_reset(void)
+{
+}
+
+int stats_enable_perf(void)
+{
+	return -1;
+}
+
+#else // USE_STATS
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define STATS_TSC
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#define STATS_PERF
+#endif
+
+typedef struct
+{
+	uint64_t calls;
+	uint64_t pixels;
+	uint64_t bytes;
+	uint64_t ticks;
+	uint64_t histogram[STATS_HISTOGRAM_BUCKETS];
+	uint64_t perf[2];
+} Counters;
+
+// counters of a thread. When the thread exits, its perf counters are closed, its counts are moved to
+// retired_counters, and the block is released, to be reused by the next new thread, so that the list
+// grows with the maximum number of threads running kernels at the same time only.
+typedef struct ThreadStats
+{
+	struct ThreadStats *next;
+	int in_use;                   // 1 while owned by a thread
+	int perf_fd[2];               // cycles and cache misses, -1 if not opened
+	int perf_generation;          // value of perf_generation when the counters were opened
+	Counters counters[];          // conversion_number()*KERNEL_VARIANT_NUMBER
+} ThreadStats;
+
+static __thread ThreadStats *thread_stats = NULL;
+static ThreadStats *all_stats = NULL;      // lock free list, threads only push, blocks are never freed
+static int perf_generation = 0;            // incremented by stats_enable_perf
+
+// counts of exited threads, retired_lock serializes their update with snapshots and resets, so that
+// counts that are being moved are not seen twice
+static Counters *retired_counters = NULL;
+static pthread_mutex_t retired_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t stats_key;
+static pthread_once_t stats_key_once = PTHREAD_ONCE_INIT;
+
+// only the owner thread writes a counter, relaxed atomics avoid torn reads by stats_snapshot
+#define COUNTER_ADD(counter, value) \
+	__atomic_store_n(&(counter), __atomic_load_n(&(counter), __ATOMIC_RELAXED)+(value), __ATOMIC_RELAXED)
+
+static uint64_t read_ticks(void)
+{
+#ifdef STATS_TSC
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000u+ts.tv_nsec;
+#endif
+}
+
+#ifdef STATS_PERF
+static int open_perf(uint32_t type, uint64_t config)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+static uint64_t read_perf(int fd)
+{
+	uint64_t value = 0;
+	if(fd<0 || read(fd, &value, sizeof(value))!=sizeof(value))
+		return 0;
+	return value;
+}
+
+// retired counters are only accessed with retired_lock held, and counters of an exited thread are no longer written
+static void add_counters(Counters *sum, const Counters *counters)
+{
+	sum->calls += counters->calls;
+	sum->pixels += counters->pixels;
+	sum->bytes += counters->bytes;
+	sum->ticks += counters->ticks;
+	for(uint32_t b=0; b<STATS_HISTOGRAM_BUCKETS; ++b)
+		sum->histogram[b] += counters->histogram[b];
+	sum->perf[0] += counters->perf[0];
+	sum->perf[1] += counters->perf[1];
+}
+
+// destructor of stats_key, called when a thread that ran a kernel exits
+static void release_thread_stats(void *value)
+{
+	ThreadStats *stats = value;
+	const uint32_t counter_number = conversion_number()*KERNEL_VARIANT_NUMBER;
+	for(uint32_t i=0; i<2; ++i)
+		if(stats->perf_fd[i]>=0)
+		{
+			close(stats->perf_fd[i]);
+			stats->perf_fd[i] = -1;
+		}
+	stats->perf_generation = 0;
+	pthread_mutex_lock(&retired_lock);
+	if(!retired_counters)
+		retired_counters = calloc(counter_number, sizeof(Counters));
+	// counts are lost if the retired counters can not be allocated
+	if(retired_counters)
+		for(uint32_t i=0; i<counter_number; ++i)
+			add_counters(&retired_counters[i], &stats->counters[i]);
+	memset(stats->counters, 0, counter_number*sizeof(Counters));
+	pthread_mutex_unlock(&retired_lock);
+	thread_stats = NULL;
+	__atomic_store_n(&stats->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void create_stats_key(void)
+{
+	pthread_key_create(&stats_key, release_thread_stats);
+}
+
+static ThreadStats *get_thread_stats(void)
+{
+	ThreadStats *stats = thread_stats;
+	if(!stats)
+	{
+		pthread_once(&stats_key_once, create_stats_key);
+		// reuse the block of an exited thread, or allocate a new one
+		for(stats = __atomic_load_n(&all_stats, __ATOMIC_ACQUIRE); stats; stats = stats->next)
+		{
+			int expected = 0;
+			if(__atomic_compare_exchange_n(&stats->in_use, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+				break;
+		}
+		if(!stats)
+		{
+			const size_t counter_number = (size_t)conversion_number()*KERNEL_VARIANT_NUMBER;
+			stats = calloc(1, sizeof(ThreadStats)+counter_number*sizeof(Counters));
+			if(!stats)
+				return NULL;
+			stats->in_use = 1;
+			stats->perf_fd[0] = stats->perf_fd[1] = -1;
+			stats->next = __atomic_load_n(&all_stats, __ATOMIC_RELAXED);
+			while(!__atomic_compare_exchange_n(&all_stats, &stats->next, stats, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+				;
+		}
+		pthread_setspecific(stats_key, stats);
+		thread_stats = stats;
+	}
+#ifdef STATS_PERF
+	const int generation = __atomic_load_n(&perf_generation, __ATOMIC_RELAXED);
+	if(stats->perf_generation!=generation)
+	{
+		stats->perf_generation = generation;
+		if(stats->perf_fd[0]<0)
+			stats->perf_fd[0] = open_perf(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+		if(stats->perf_fd[1]<0)
+			stats->perf_fd[1] = open_perf(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	}
+#endif
+	return stats;
+}
+
+void stats_begin(StatsProbe *probe)
+{
+	ThreadStats *stats = get_thread_stats();
+	probe->perf_start[0] = stats ? read_perf(stats->perf_fd[0]) : 0;
+	probe->perf_start[1] = stats ? read_perf(stats->perf_fd[1]) : 0;
+	probe->start = read_ticks();
+}
+
+// number of bits of a pixel
+static uint32_t pixel_bits(PixelFormat format)
+{
+	switch(format)
+	{
+		case PIXEL_FORMAT_YUV420:
+		case PIXEL_FORMAT_NV12:
+		case PIXEL_FORMAT_NV21:
+			return 12;
+		case PIXEL_FORMAT_RGB24:
+			return 24;
+		case PIXEL_FORMAT_RGB32:
+			return 32;
+	}
+	return 0;
+}
+
+void stats_end(const StatsProbe *probe, const SelectedKernel *kernel, const BatchFrame *frame, uint32_t lines)
+{
+	const uint64_t ticks = read_ticks()-probe->start;
+	ThreadStats *stats = thread_stats;
+	if(!stats)
+		return;
+	Counters *counters = &stats->counters[conversion_index(kernel->conversion)*KERNEL_VARIANT_NUMBER+kernel->variant];
+	const uint64_t pixels = (uint64_t)frame->width*lines;
+	COUNTER_ADD(counters->calls, 1);
+	COUNTER_ADD(counters->pixels, pixels);
+	COUNTER_ADD(counters->bytes, pixels*(pixel_bits(frame->src_format)+pixel_bits(frame->dst_format))/8);
+	COUNTER_ADD(counters->ticks, ticks);
+	uint32_t bucket = 0;
+	while(bucket+1<STATS_HISTOGRAM_BUCKETS && (ticks>>(bucket+1))!=0)
+		bucket++;
+	COUNTER_ADD(counters->histogram[bucket], 1);
+	if(stats->perf_fd[0]>=0)
+		COUNTER_ADD(counters->perf[0], read_perf(stats->perf_fd[0])-probe->perf_start[0]);
+	if(stats->perf_fd[1]>=0)
+		COUNTER_ADD(counters->perf[1], read_perf(stats->perf_fd[1])-probe->perf_start[1]);
+}
+
+int stats_available(void)
+{
+	return 1;
+}
+
+static void add_entry(StatsEntry *entry, const Counters *counters)
+{
+	entry->calls += __atomic_load_n(&counters->calls, __ATOMIC_RELAXED);
+	entry->pixels += __atomic_load_n(&counters->pixels, __ATOMIC_RELAXED);
+	entry->bytes += __atomic_load_n(&counters->bytes, __ATOMIC_RELAXED);
+	entry->ticks += __atomic_load_n(&counters->ticks, __ATOMIC_RELAXED);
+	for(uint32_t b=0; b<STATS_HISTOGRAM_BUCKETS; ++b)
+		entry->histogram[b] += __atomic_load_n(&counters->histogram[b], __ATOMIC_RELAXED);
+	entry->perf_cycles += __atomic_load_n(&counters->perf[0], __ATOMIC_RELAXED);
+	entry->perf_cache_misses += __atomic_load_n(&counters->perf[1], __ATOMIC_RELAXED);
+}
+
+uint32_t stats_snapshot(StatsEntry *entries, uint32_t max_entries)
+{
+	const uint32_t counter_number = conversion_number()*KERNEL_VARIANT_NUMBER;
+	const uint32_t entry_number = max_entries<counter_number ? max_entries : counter_number;
+	memset(entries, 0, entry_number*sizeof(StatsEntry));
+	for(uint32_t i=0; i<entry_number; ++i)
+	{
+		entries[i].conversion = conversion_at(i/KERNEL_VARIANT_NUMBER)->name;
+		entries[i].variant = kernel_variant_names[i%KERNEL_VARIANT_NUMBER];
+	}
+	pthread_mutex_lock(&retired_lock);
+	for(ThreadStats *stats = __atomic_load_n(&all_stats, __ATOMIC_ACQUIRE); stats; stats = stats->next)
+		for(uint32_t i=0; i<entry_number; ++i)
+			add_entry(&entries[i], &stats->counters[i]);
+	if(retired_counters)
+		for(uint32_t i=0; i<entry_number; ++i)
+			add_entry(&entries[i], &retired_counters[i]);
+	pthread_mutex_unlock(&retired_lock);
+	return counter_number;
+}
+
+static void clear_counters(Counters *counters)
+{
+	__atomic_store_n(&counters->calls, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&counters->pixels, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&counters->bytes, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&counters->ticks, 0, __ATOMIC_RELAXED);
+	for(uint32_t b=0; b<STATS_HISTOGRAM_BUCKETS; ++b)
+		__atomic_store_n(&counters->histogram[b], 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&counters->perf[0], 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&counters->perf[1], 0, __ATOMIC_RELAXED);
+}
+
+void stats_reset(void)
+{
+	const uint32_t counter_number = conversion_number()*KERNEL_VARIANT_NUMBER;
+	pthread_mutex_lock(&retired_lock);
+	for(ThreadStats *stats = __atomic_load_n(&all_stats, __ATOMIC_ACQUIRE); stats; stats = stats->next)
+		for(uint32_t i=0; i<counter_number; ++i)
+			clear_counters(&stats->counters[i]);
+	if(retired_counters)
+		for(uint32_t i=0; i<counter_number; ++i)
+			clear_counters(&retired_counters[i]);
+	pthread_mutex_unlock(&retired_lock);
+}
+
+int stats_enable_perf(void)
+{
+#ifdef STATS_PERF
+	// check that counters can be opened, each thread opens its own counters at its next kernel call
+	const int fd = open_perf(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	if(fd<0)
+		return -1;
+	close(fd);
+	__atomic_add_fetch(&perf_generation, 1, __ATOMIC_RELAXED);
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+#endif // USE_STATS
@@ -0,0 +1,63 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// Performance counters of the conversion kernels
+
+// When the library is built with USE_STATS, each kernel call made by the library (batch, plan,
+// stream and pipeline apis, direct calls to kernels are not counted) records its number of pixels
+// and bytes, and its duration in time stamp counter ticks, in a histogram. Counters are per thread
+// and only written by their thread, so recording a call needs no lock nor atomic read-modify-write.
+// Linux perf_event counters (cycles and last level cache misses) can also be enabled, at the cost
+// of a few system calls per kernel call, and of two file descriptors per thread running kernels.
+// When a thread exits, its perf counters are closed, and its counts are kept and its counter block
+// is reused by the next thread, so that creating and destroying threaded plans does not leak.
+// Without USE_STATS, nothing is recorded and there is no cost, the functions below are still
+// available and return empty results.
+
+#ifndef YUV_RGB_STATS_H
+#define YUV_RGB_STATS_H
+
+#include "yuv_rgb.h"
+
+// bucket i of the histogram counts calls that took between 2^i and 2^(i+1)-1 ticks
+#define STATS_HISTOGRAM_BUCKETS 40
+
+// counters of one kernel, summed over all threads
+typedef struct
+{
+	const char *conversion;       // for example "yuv420_rgb24"
+	const char *variant;          // "std", "sse", "sseu"...
+	uint64_t calls;
+	uint64_t pixels;
+	uint64_t bytes;               // read and written
+	uint64_t ticks;               // total duration, in time stamp counter ticks (nanoseconds on non x86 cpus)
+	uint64_t histogram[STATS_HISTOGRAM_BUCKETS];
+	uint64_t perf_cycles;         // 0 if perf counters are not enabled
+	uint64_t perf_cache_misses;
+} StatsEntry;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// return 1 if the library was built with USE_STATS
+int stats_available(void);
+
+// copy the counters of all kernels to entries, at most max_entries are copied
+// counters are read while other threads may update them, each counter is exact but the entry
+// may not be a consistent snapshot of all counters
+// return the total number of kernels
+uint32_t stats_snapshot(StatsEntry *entries, uint32_t max_entries);
+
+// set all counters to zero, must not be called while conversions are running
+void stats_reset(void);
+
+// record perf_event cycles and cache misses for the next kernel calls
+// return 0 on success, -1 if perf counters are not available
+int stats_enable_perf(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YUV_RGB_STATS_H
@@ -0,0 +1,170 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "yuv_rgb_stream.h"
+#include "yuv_rgb_private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct StreamConverter
+{
+	BatchFrame frame;
+	uint32_t pair_capacity;
+	uint32_t pairs_done;     // number of pairs of lines that are completely processed
+	uint8_t *ready;          // number of ready lines of each pair of lines
+};
+
+StreamConverter *stream_converter_create(const BatchFrame *frame)
+{
+	StreamConverter *stream = calloc(1, sizeof(StreamConverter));
+	if(!stream)
+		return NULL;
+	stream->pair_capacity = (frame->height+1)/2;
+	stream->ready = malloc(stream->pair_capacity ? stream->pair_capacity : 1);
+	if(!stream->ready || stream_converter_reset(stream, frame)!=0)
+	{
+		stream_converter_destroy(stream);
+		return NULL;
+	}
+	return stream;
+}
+
+void stream_converter_destroy(StreamConverter *stream)
+{
+	if(!stream)
+		return;
+	free(stream->ready);
+	free(stream);
+}
+
+int stream_converter_reset(StreamConverter *stream, const BatchFrame *frame)
+{
+	if((frame->height+1)/2>stream->pair_capacity)
+		return -1;
+	if(!is_supported(frame))
+		return -1;
+	stream->frame = *frame;
+	for(uint32_t i=0; i<stream->pair_capacity; ++i)
+		stream->ready[i] = 0;
+	__atomic_store_n(&stream->pairs_done, 0, __ATOMIC_RELEASE);
+	return 0;
+}
+
+int stream_converter_push(StreamConverter *stream, uint32_t row_begin, uint32_t row_end)
+{
+	const uint32_t height = stream->frame.height;
+	if(row_begin>row_end || row_end>height)
+		return -1;
+
+	int converted = 0;
+	uint32_t pairs_done = 0;
+	uint32_t run_begin = 0, run_length = 0;
+	for(uint32_t pair=row_begin/2; pair<(row_end+1)/2; ++pair)
+	{
+		const uint32_t first = 2*pair;
+		const uint32_t last = first+2<height ? first+2 : height;
+		const uint32_t begin = first>row_begin ? first : row_begin;
+		const uint32_t end = last<row_end ? last : row_end;
+		// acquire and release, so that the thread that completes the pair sees the lines pushed by the other one
+		const uint8_t ready = __atomic_add_fetch(&stream->ready[pair], (uint8_t)(end-begin), __ATOMIC_ACQ_REL);
+		const int complete = ready==last-first;
+		if(complete)
+			pairs_done++;
+		// a last single line is not converted, as for all kernels
+		if(complete && last-first==2)
+		{
+			if(run_length==0)
+				run_begin = pair;
+			run_length++;
+		}
+		else if(run_length>0)
+		{
+			convert_rows(&stream->frame, 2*run_begin, 2*(run_begin+run_length));
+			converted += 2*run_length;
+			run_length = 0;
+		}
+	}
+	if(run_length>0)
+	{
+		convert_rows(&stream->frame, 2*run_begin, 2*(run_begin+run_length));
+		converted += 2*run_length;
+	}
+	if(pairs_done)
+		__atomic_add_fetch(&stream->pairs_done, pairs_done, __ATOMIC_RELEASE);
+	return converted;
+}
+
+int stream_converter_complete(const StreamConverter *stream)
+{
+	return __atomic_load_n(&stream->pairs_done, __ATOMIC_ACQUIRE)==(stream->frame.height+1)/2;
+}
+
+// Strips
+
+// number of strip buffers, the callback can use the previous strip
+#define STRIP_BUFFERS 2
+// default size of a strip, so that it stays in L1 cache
+#define STRIP_SIZE (32*1024)
+
+#define ALIGN_STRIDE(size) (((size)+63)&~(uint32_t)63)
+
+// move source planes of a frame to line row, that must be even
+static void frame_offset(BatchFrame *frame, uint32_t row)
+{
+	const uint32_t planes = frame->src_format==PIXEL_FORMAT_YUV420 ? 3 : 
+		(frame->src_format==PIXEL_FORMAT_NV12 || frame->src_format==PIXEL_FORMAT_NV21) ? 2 : 1;
+	frame->src[0] += (size_t)row*frame->src_stride[0];
+	for(uint32_t p=1; p<planes; ++p)
+		frame->src[p] += (size_t)(row/2)*frame->src_stride[1];
+}
+
+int convert_to_strips(const BatchFrame *frame, uint32_t strip_lines, StripCallback callback, void *user_data)
+{
+	if(frame->dst_format!=PIXEL_FORMAT_RGB24 || !is_supported(frame))
+		return -1;
+	if(frame->height==0)
+		return 0;
+
+	const uint32_t stride = ALIGN_STRIDE(frame->width*3);
+	if(strip_lines==0)
+		strip_lines = STRIP_SIZE/stride;
+	strip_lines = strip_lines<2 ? 2 : (strip_lines+1)&~1u;
+	if(strip_lines>frame->height)
+		strip_lines = (frame->height+1)&~1u;
+	const size_t strip_size = (size_t)strip_lines*stride;
+	uint8_t *buffer = NULL;
+	if(posix_memalign((void **)&buffer, 64, STRIP_BUFFERS*strip_size)!=0)
+		return -1;
+	// kernels do not write the last column of frames with an odd width
+	memset(buffer, 0, STRIP_BUFFERS*strip_size);
+
+	int result = 0;
+	for(uint32_t row=0, strip=0; row<frame->height && result==0; row+=strip_lines, ++strip)
+	{
+		uint8_t *rgb = buffer+(strip%STRIP_BUFFERS)*strip_size;
+		const uint32_t lines = frame->height-row<strip_lines ? frame->height-row : strip_lines;
+		BatchFrame part = *frame;
+		frame_offset(&part, row);
+		part.height = lines;
+		part.dst[0] = rgb;
+		part.dst_stride[0] = stride;
+		if(lines>=2)
+			convert_rows_cached(&part, 0, lines&~1u);
+		if(lines&1)
+		{
+			// last line of an odd frame, converted as a pair with itself, there is always room
+			// for the second line since strip_lines is even
+			frame_offset(&part, lines-1);
+			part.height = 2;
+			part.src_stride[0] = 0;
+			part.dst[0] = rgb+(size_t)(lines-1)*stride;
+			convert_rows_cached(&part, 0, 2);
+		}
+		result = callback(user_data, row, lines, rgb, stride);
+	}
+	free(buffer);
+	return result;
+}
@@ -0,0 +1,66 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+// Incremental conversion of frames that become available by slices, as emitted by slice
+// threaded decoders
+
+// A StreamConverter is attached to a frame (described by a BatchFrame, see yuv_rgb_batch.h).
+// Each time a range of source lines is ready, stream_converter_push converts all the pairs of
+// lines that are now complete, so that conversion overlaps with decoding.
+// Since yuv420 chroma is shared by two lines, a slice that ends on an odd line leaves its last
+// line pending, it is converted with the first line of the next slice.
+// Slices can be pushed in any order, and from several threads at the same time: each pair of
+// lines is converted by the call that completes it. Each line must be pushed exactly once.
+
+// For consumers that only need a few lines at a time (image encoders, network senders...),
+// convert_to_strips converts a yuv frame to rgb in a small ring of strip buffers, and passes each
+// strip to a callback, so that no full frame rgb buffer is needed and each strip is still in
+// cache when it is read.
+
+#ifndef YUV_RGB_STREAM_H
+#define YUV_RGB_STREAM_H
+
+#include "yuv_rgb.h"
+#include "yuv_rgb_batch.h"
+
+typedef struct StreamConverter StreamConverter;
+
+// receive lines [row, row+lines) of the converted image, stored in rgb with rgb_stride bytes per line
+// the strip stays valid until the end of the next callback, so that the previous lines are still
+// available (for example for png filters)
+// return 0 to continue, any other value stops the conversion
+typedef int (*StripCallback)(void *user_data, uint32_t row, uint32_t lines, const uint8_t *rgb, uint32_t rgb_stride);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// create a converter for the given frame, return NULL on failure (unsupported conversion or out of memory)
+StreamConverter *stream_converter_create(const BatchFrame *frame);
+
+void stream_converter_destroy(StreamConverter *stream);
+
+// start a new frame, with the same or a lower height, without any allocation
+// no push of the previous frame must be running
+// return 0 on success, -1 if the frame is not compatible
+int stream_converter_reset(StreamConverter *stream, const BatchFrame *frame);
+
+// lines [row_begin, row_end) of the source frame are ready, convert all completed pairs of lines
+// return the number of lines converted by this call, or -1 if the range is invalid
+int stream_converter_push(StreamConverter *stream, uint32_t row_begin, uint32_t row_end);
+
+// return 1 when all lines of the frame have been converted
+int stream_converter_complete(const StreamConverter *stream);
+
+// convert a yuv frame to RGB24 by strips of strip_lines lines (rounded up to an even number, 0 to
+// select strips of about 32KB), dst and dst_stride of frame are ignored
+// unlike other functions, the last line of a frame with an odd height is converted too
+// return 0 on success, -1 if the conversion is not supported or on allocation failure, or the
+// value returned by the callback that stopped the conversion
+int convert_to_strips(const BatchFrame *frame, uint32_t strip_lines, StripCallback callback, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YUV_RGB_STREAM_H